@@ -66,6 +66,198 @@ typedef uint32_t ESYS_TR;
 
 typedef struct ESYS_CONTEXT ESYS_CONTEXT;
 
+/*
+ * Crypto callbacks
+ *
+ * By default ESAPI uses the crypto library it was built with. An application
+ * may register its own implementation with Esys_SetCryptoCallbacks(). The
+ * cpHash/rpHash, session HMAC, KDFa, KDFe and parameter obfuscation
+ * computations are built on the hash and hmac callbacks, salt encryption on
+ * rsa_pk_encrypt and get_ecdh_point and parameter encryption on aes_encrypt
+ * and aes_decrypt. Every callback receives the userdata pointer of the
+ * structure as its last parameter.
+ */
+
+/** The opaque hash or HMAC context of a crypto callback implementation. */
+typedef struct ESYS_CRYPTO_CONTEXT_BLOB ESYS_CRYPTO_CONTEXT_BLOB;
+
+/** Start a hash computation.
+ *
+ * @param[out] context The created context (callee-allocated).
+ * @param[in] hashAlg The hash algorithm.
+ * @param[in,out] userdata The userdata of the callbacks.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if hashAlg is not supported.
+ */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_HASH_START_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB **context,
+        TPM2_ALG_ID hashAlg,
+        void *userdata);
+
+/** Feed data into a hash computation. */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_HASH_UPDATE_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB *context,
+        const uint8_t *buffer,
+        size_t size,
+        void *userdata);
+
+/** Finish a hash computation and release the context.
+ *
+ * On input size holds the size of buffer, on success the digest size.
+ */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_HASH_FINISH_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB **context,
+        uint8_t *buffer,
+        size_t *size,
+        void *userdata);
+
+/** Release a hash context without computing the digest. */
+typedef void
+    (*ESYS_CRYPTO_HASH_ABORT_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB **context,
+        void *userdata);
+
+/** Start an HMAC computation with the given key. */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_HMAC_START_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB **context,
+        TPM2_ALG_ID hashAlg,
+        const uint8_t *key,
+        size_t size,
+        void *userdata);
+
+/** Feed data into an HMAC computation. */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_HMAC_UPDATE_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB *context,
+        const uint8_t *buffer,
+        size_t size,
+        void *userdata);
+
+/** Finish an HMAC computation and release the context.
+ *
+ * On input size holds the size of buffer, on success the HMAC size.
+ */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_HMAC_FINISH_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB **context,
+        uint8_t *buffer,
+        size_t *size,
+        void *userdata);
+
+/** Release an HMAC context without computing the HMAC. */
+typedef void
+    (*ESYS_CRYPTO_HMAC_ABORT_FNP)(
+        ESYS_CRYPTO_CONTEXT_BLOB **context,
+        void *userdata);
+
+/** Fill nonce with num_bytes random bytes (the digest size if 0). */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_GET_RANDOM2B_FNP)(
+        TPM2B_NONCE *nonce,
+        size_t num_bytes,
+        void *userdata);
+
+/** Compute the ephemeral ECDH point Q and the shared secret Z for salting.
+ *
+ * The x and y coordinates of Q are marshaled into out_buffer.
+ */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_GET_ECDH_POINT_FNP)(
+        TPM2B_PUBLIC *key,
+        size_t max_out_size,
+        TPM2B_ECC_PARAMETER *Z,
+        TPMS_ECC_POINT *Q,
+        BYTE *out_buffer,
+        size_t *out_size,
+        void *userdata);
+
+/** Encrypt buffer in place for parameter encryption. */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_AES_ENCRYPT_FNP)(
+        uint8_t *key,
+        TPM2_ALG_ID tpm_sym_alg,
+        TPMI_AES_KEY_BITS key_bits,
+        TPM2_ALG_ID tpm_mode,
+        uint8_t *buffer,
+        size_t buffer_size,
+        uint8_t *iv,
+        void *userdata);
+
+/** Decrypt buffer in place for parameter decryption. */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_AES_DECRYPT_FNP)(
+        uint8_t *key,
+        TPM2_ALG_ID tpm_sym_alg,
+        TPMI_AES_KEY_BITS key_bits,
+        TPM2_ALG_ID tpm_mode,
+        uint8_t *buffer,
+        size_t buffer_size,
+        uint8_t *iv,
+        void *userdata);
+
+/** RSA-OAEP encrypt the salt of a session with the given public key. */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_RSA_PK_ENCRYPT_FNP)(
+        TPM2B_PUBLIC *pub_tpm_key,
+        size_t in_size,
+        BYTE *in_buffer,
+        size_t max_out_size,
+        BYTE *out_buffer,
+        size_t *out_size,
+        const char *label,
+        void *userdata);
+
+/** Initialize the crypto implementation (optional). */
+typedef TSS2_RC
+    (*ESYS_CRYPTO_INIT_FNP)(
+        void *userdata);
+
+/** The crypto callbacks used by an ESYS_CONTEXT.
+ *
+ * All members but init and userdata are required.
+ */
+typedef struct {
+    ESYS_CRYPTO_RSA_PK_ENCRYPT_FNP rsa_pk_encrypt;
+    ESYS_CRYPTO_HASH_START_FNP hash_start;
+    ESYS_CRYPTO_HASH_UPDATE_FNP hash_update;
+    ESYS_CRYPTO_HASH_FINISH_FNP hash_finish;
+    ESYS_CRYPTO_HASH_ABORT_FNP hash_abort;
+    ESYS_CRYPTO_HMAC_START_FNP hmac_start;
+    ESYS_CRYPTO_HMAC_UPDATE_FNP hmac_update;
+    ESYS_CRYPTO_HMAC_FINISH_FNP hmac_finish;
+    ESYS_CRYPTO_HMAC_ABORT_FNP hmac_abort;
+    ESYS_CRYPTO_GET_RANDOM2B_FNP get_random2b;
+    ESYS_CRYPTO_GET_ECDH_POINT_FNP get_ecdh_point;
+    ESYS_CRYPTO_AES_ENCRYPT_FNP aes_encrypt;
+    ESYS_CRYPTO_AES_DECRYPT_FNP aes_decrypt;
+    ESYS_CRYPTO_INIT_FNP init;
+    void *userdata;
+} ESYS_CRYPTO_CALLBACKS;
+
+/*
+ * Event loop
+ *
+ * An ESYS_LOOP drives the asynchronous functions of many ESYS_CONTEXTs from a
+ * single thread. After starting a command with one of the Esys_*_Async
+ * functions, the application registers the context together with a callback.
+ * The loop waits on the poll handles of all registered contexts and calls the
+ * callback of a context once its handles signal, which then calls the
+ * matching Esys_*_Finish function. If the callback returns
+ * TSS2_ESYS_RC_TRY_AGAIN the context stays registered, either because the
+ * response wasn't complete yet or because the callback started the next
+ * command. Any other return value removes the context from the loop.
+ */
+typedef struct ESYS_LOOP ESYS_LOOP;
+
+typedef TSS2_RC
+    (*ESYS_LOOP_CALLBACK)(
+        ESYS_CONTEXT *esys_context,
+        void *userdata);
+
 /*
  * TPM 2.0 ESAPI Functions
  */
@@ -96,6 +288,69 @@ Esys_SetTimeout(
     ESYS_CONTEXT *esys_context,
     int32_t timeout);
 
+TSS2_RC
+Esys_SetPoolSize(
+    ESYS_CONTEXT *esys_context,
+    size_t poolSize);
+
+TSS2_RC
+Esys_SetCryptoCallbacks(
+    ESYS_CONTEXT *esys_context,
+    ESYS_CRYPTO_CALLBACKS *callbacks);
+
+TSS2_RC
+Esys_SetSharedCache(
+    ESYS_CONTEXT *esys_context,
+    uint8_t enable);
+
+void
+Esys_InvalidateSharedCache(
+    TPM2_HANDLE tpm_handle);
+
+void
+Esys_ClearSharedCache(void);
+
+TSS2_RC
+Esys_Context_Save(
+    ESYS_CONTEXT *esys_context,
+    uint8_t **buffer,
+    size_t *buffer_size);
+
+TSS2_RC
+Esys_Context_Restore(
+    ESYS_CONTEXT *esys_context,
+    uint8_t const *buffer,
+    size_t buffer_size);
+
+TSS2_RC
+Esys_Loop_Initialize(
+    ESYS_LOOP **loop);
+
+void
+Esys_Loop_Finalize(
+    ESYS_LOOP **loop);
+
+TSS2_RC
+Esys_Loop_Add(
+    ESYS_LOOP *loop,
+    ESYS_CONTEXT *esys_context,
+    ESYS_LOOP_CALLBACK callback,
+    void *userdata);
+
+TSS2_RC
+Esys_Loop_Remove(
+    ESYS_LOOP *loop,
+    ESYS_CONTEXT *esys_context);
+
+TSS2_RC
+Esys_Loop_Dispatch(
+    ESYS_LOOP *loop,
+    int32_t timeout);
+
+TSS2_RC
+Esys_Loop_Run(
+    ESYS_LOOP *loop);
+
 TSS2_RC
 Esys_TR_Serialize(
     ESYS_CONTEXT *esys_context,
@@ -110,6 +365,22 @@ Esys_TR_Deserialize(
     size_t buffer_size,
     ESYS_TR *esys_handle);
 
+TSS2_RC
+Esys_TR_SerializeBatch(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR const *esys_handles,
+    size_t count,
+    uint8_t **buffer,
+    size_t *buffer_size);
+
+TSS2_RC
+Esys_TR_DeserializeBatch(
+    ESYS_CONTEXT *esys_context,
+    uint8_t const *buffer,
+    size_t buffer_size,
+    ESYS_TR **esys_handles,
+    size_t *count);
+
 TSS2_RC
 Esys_TR_FromTPMPublic_Async(
     ESYS_CONTEXT *esysContext,
@@ -1004,6 +1275,24 @@ Esys_Hash_Finish(
     TPM2B_DIGEST **outHash,
     TPMT_TK_HASHCHECK **validation);
 
+TSS2_RC
+Esys_Hash_Into(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    const TPM2B_MAX_BUFFER *data,
+    TPMI_ALG_HASH hashAlg,
+    ESYS_TR hierarchy,
+    TPM2B_DIGEST *outHash,
+    TPMT_TK_HASHCHECK *validation);
+
+TSS2_RC
+Esys_Hash_Finish_Into(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_DIGEST *outHash,
+    TPMT_TK_HASHCHECK *validation);
+
 /* Table 64 - TPM2_HMAC Command */
 
 TSS2_RC
@@ -1032,6 +1321,22 @@ Esys_HMAC_Finish(
     ESYS_CONTEXT *esysContext,
     TPM2B_DIGEST **outHMAC);
 
+TSS2_RC
+Esys_HMAC_Into(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR handle,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    const TPM2B_MAX_BUFFER *buffer,
+    TPMI_ALG_HASH hashAlg,
+    TPM2B_DIGEST *outHMAC);
+
+TSS2_RC
+Esys_HMAC_Finish_Into(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_DIGEST *outHMAC);
+
 /* Table 66 - TPM2_GetRandom Command */
 
 TSS2_RC
@@ -1056,6 +1361,20 @@ Esys_GetRandom_Finish(
     ESYS_CONTEXT *esysContext,
     TPM2B_DIGEST **randomBytes);
 
+TSS2_RC
+Esys_GetRandom_Into(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    UINT16 bytesRequested,
+    TPM2B_DIGEST *randomBytes);
+
+TSS2_RC
+Esys_GetRandom_Finish_Into(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_DIGEST *randomBytes);
+
 /* Table 68 - TPM2_StirRandom Command */
 
 TSS2_RC
@@ -1566,6 +1885,23 @@ Esys_Sign_Finish(
     ESYS_CONTEXT *esysContext,
     TPMT_SIGNATURE **signature);
 
+TSS2_RC
+Esys_Sign_Into(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR keyHandle,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    const TPM2B_DIGEST *digest,
+    const TPMT_SIG_SCHEME *inScheme,
+    const TPMT_TK_HASHCHECK *validation,
+    TPMT_SIGNATURE *signature);
+
+TSS2_RC
+Esys_Sign_Finish_Into(
+    ESYS_CONTEXT *esysContext,
+    TPMT_SIGNATURE *signature);
+
 /* Table 101 - TPM2_SetCommandCodeAuditStatus Command */
 
 TSS2_RC
@@ -34,6 +34,11 @@ Tss2_MU_INT8_Unmarshal(
     size_t         *offset,
     INT8           *dest);
 
+TSS2_RC
+Tss2_MU_INT8_Size(
+    INT8            src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_INT16_Marshal(
     INT16           src,
@@ -48,6 +53,11 @@ Tss2_MU_INT16_Unmarshal(
     size_t         *offset,
     INT16          *dest);
 
+TSS2_RC
+Tss2_MU_INT16_Size(
+    INT16           src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_INT32_Marshal(
     INT32           src,
@@ -62,6 +72,11 @@ Tss2_MU_INT32_Unmarshal(
     size_t         *offset,
     INT32          *dest);
 
+TSS2_RC
+Tss2_MU_INT32_Size(
+    INT32           src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_INT64_Marshal(
     INT64           src,
@@ -76,6 +91,11 @@ Tss2_MU_INT64_Unmarshal(
     size_t         *offset,
     INT64          *dest);
 
+TSS2_RC
+Tss2_MU_INT64_Size(
+    INT64           src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_UINT8_Marshal(
     UINT8           src,
@@ -90,6 +110,11 @@ Tss2_MU_UINT8_Unmarshal(
     size_t         *offset,
     UINT8          *dest);
 
+TSS2_RC
+Tss2_MU_UINT8_Size(
+    UINT8           src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_UINT16_Marshal(
     UINT16          src,
@@ -104,6 +129,11 @@ Tss2_MU_UINT16_Unmarshal(
     size_t         *offset,
     UINT16         *dest);
 
+TSS2_RC
+Tss2_MU_UINT16_Size(
+    UINT16          src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_UINT32_Marshal(
     UINT32          src,
@@ -118,6 +148,11 @@ Tss2_MU_UINT32_Unmarshal(
     size_t         *offset,
     UINT32         *dest);
 
+TSS2_RC
+Tss2_MU_UINT32_Size(
+    UINT32          src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_UINT64_Marshal(
     UINT64          src,
@@ -132,6 +167,11 @@ Tss2_MU_UINT64_Unmarshal(
     size_t         *offset,
     UINT64         *dest);
 
+TSS2_RC
+Tss2_MU_UINT64_Size(
+    UINT64          src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2_CC_Marshal(
     TPM2_CC          src,
@@ -146,6 +186,11 @@ Tss2_MU_TPM2_CC_Unmarshal(
     size_t         *offset,
     TPM2_CC         *dest);
 
+TSS2_RC
+Tss2_MU_TPM2_CC_Size(
+    TPM2_CC         src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2_ST_Marshal(
     TPM2_ST          src,
@@ -160,6 +205,11 @@ Tss2_MU_TPM2_ST_Unmarshal(
     size_t         *offset,
     TPM2_ST         *dest);
 
+TSS2_RC
+Tss2_MU_TPM2_ST_Size(
+    TPM2_ST         src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMA_ALGORITHM_Marshal(
     TPMA_ALGORITHM  src,
@@ -174,6 +224,11 @@ Tss2_MU_TPMA_ALGORITHM_Unmarshal(
     size_t         *offset,
     TPMA_ALGORITHM *dest);
 
+TSS2_RC
+Tss2_MU_TPMA_ALGORITHM_Size(
+    TPMA_ALGORITHM  src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMA_CC_Marshal(
     TPMA_CC         src,
@@ -188,6 +243,11 @@ Tss2_MU_TPMA_CC_Unmarshal(
     size_t         *offset,
     TPMA_CC        *dest);
 
+TSS2_RC
+Tss2_MU_TPMA_CC_Size(
+    TPMA_CC         src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMA_LOCALITY_Marshal(
     TPMA_LOCALITY   src,
@@ -201,6 +261,11 @@ Tss2_MU_TPMA_LOCALITY_Unmarshal(
     size_t          buffer_size,
     size_t         *offset,
     TPMA_LOCALITY  *dest);
+
+TSS2_RC
+Tss2_MU_TPMA_LOCALITY_Size(
+    TPMA_LOCALITY   src,
+    size_t         *size);
 TSS2_RC
 
 Tss2_MU_TPMA_NV_Marshal(
@@ -216,6 +281,11 @@ Tss2_MU_TPMA_NV_Unmarshal(
     size_t         *offset,
     TPMA_NV        *dest);
 
+TSS2_RC
+Tss2_MU_TPMA_NV_Size(
+    TPMA_NV         src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMA_OBJECT_Marshal(
     TPMA_OBJECT     src,
@@ -230,6 +300,11 @@ Tss2_MU_TPMA_OBJECT_Unmarshal(
     size_t         *offset,
     TPMA_OBJECT    *dest);
 
+TSS2_RC
+Tss2_MU_TPMA_OBJECT_Size(
+    TPMA_OBJECT     src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMA_PERMANENT_Marshal(
     TPMA_PERMANENT  src,
@@ -244,6 +319,11 @@ Tss2_MU_TPMA_PERMANENT_Unmarshal(
     size_t         *offset,
     TPMA_PERMANENT *dest);
 
+TSS2_RC
+Tss2_MU_TPMA_PERMANENT_Size(
+    TPMA_PERMANENT  src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMA_SESSION_Marshal(
     TPMA_SESSION    src,
@@ -258,6 +338,11 @@ Tss2_MU_TPMA_SESSION_Unmarshal(
     size_t         *offset,
     TPMA_SESSION   *dest);
 
+TSS2_RC
+Tss2_MU_TPMA_SESSION_Size(
+    TPMA_SESSION    src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMA_STARTUP_CLEAR_Marshal(
     TPMA_STARTUP_CLEAR src,
@@ -272,6 +357,11 @@ Tss2_MU_TPMA_STARTUP_CLEAR_Unmarshal(
     size_t         *offset,
     TPMA_STARTUP_CLEAR *dest);
 
+TSS2_RC
+Tss2_MU_TPMA_STARTUP_CLEAR_Size(
+    TPMA_STARTUP_CLEAR src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_DIGEST_Marshal(
     TPM2B_DIGEST const *src,
@@ -286,6 +376,11 @@ Tss2_MU_TPM2B_DIGEST_Unmarshal(
     size_t         *offset,
     TPM2B_DIGEST   *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_DIGEST_Size(
+    TPM2B_DIGEST const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_ATTEST_Marshal(
     TPM2B_ATTEST const *src,
@@ -300,6 +395,11 @@ Tss2_MU_TPM2B_ATTEST_Unmarshal(
     size_t         *offset,
     TPM2B_ATTEST   *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_ATTEST_Size(
+    TPM2B_ATTEST const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_NAME_Marshal(
     TPM2B_NAME const *src,
@@ -314,6 +414,11 @@ Tss2_MU_TPM2B_NAME_Unmarshal(
     size_t         *offset,
     TPM2B_NAME     *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_NAME_Size(
+    TPM2B_NAME const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_MAX_NV_BUFFER_Marshal(
     TPM2B_MAX_NV_BUFFER const *src,
@@ -328,6 +433,11 @@ Tss2_MU_TPM2B_MAX_NV_BUFFER_Unmarshal(
     size_t         *offset,
     TPM2B_MAX_NV_BUFFER *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_MAX_NV_BUFFER_Size(
+    TPM2B_MAX_NV_BUFFER const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_SENSITIVE_DATA_Marshal(
     TPM2B_SENSITIVE_DATA const *src,
@@ -342,6 +452,11 @@ Tss2_MU_TPM2B_SENSITIVE_DATA_Unmarshal(
     size_t         *offset,
     TPM2B_SENSITIVE_DATA *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_SENSITIVE_DATA_Size(
+    TPM2B_SENSITIVE_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_ECC_PARAMETER_Marshal(
     TPM2B_ECC_PARAMETER const *src,
@@ -356,6 +471,11 @@ Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal(
     size_t         *offset,
     TPM2B_ECC_PARAMETER *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_ECC_PARAMETER_Size(
+    TPM2B_ECC_PARAMETER const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Marshal(
     TPM2B_PUBLIC_KEY_RSA const *src,
@@ -370,6 +490,11 @@ Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Unmarshal(
     size_t         *offset,
     TPM2B_PUBLIC_KEY_RSA *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Size(
+    TPM2B_PUBLIC_KEY_RSA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_PRIVATE_KEY_RSA_Marshal(
     TPM2B_PRIVATE_KEY_RSA const *src,
@@ -384,6 +509,11 @@ Tss2_MU_TPM2B_PRIVATE_KEY_RSA_Unmarshal(
     size_t         *offset,
     TPM2B_PRIVATE_KEY_RSA *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_PRIVATE_KEY_RSA_Size(
+    TPM2B_PRIVATE_KEY_RSA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_PRIVATE_Marshal(
     TPM2B_PRIVATE const *src,
@@ -398,6 +528,11 @@ Tss2_MU_TPM2B_PRIVATE_Unmarshal(
     size_t         *offset,
     TPM2B_PRIVATE  *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_PRIVATE_Size(
+    TPM2B_PRIVATE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_CONTEXT_SENSITIVE_Marshal(
     TPM2B_CONTEXT_SENSITIVE const *src,
@@ -412,6 +547,11 @@ Tss2_MU_TPM2B_CONTEXT_SENSITIVE_Unmarshal(
     size_t         *offset,
     TPM2B_CONTEXT_SENSITIVE *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_CONTEXT_SENSITIVE_Size(
+    TPM2B_CONTEXT_SENSITIVE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_CONTEXT_DATA_Marshal(
     TPM2B_CONTEXT_DATA const *src,
@@ -426,6 +566,11 @@ Tss2_MU_TPM2B_CONTEXT_DATA_Unmarshal(
     size_t         *offset,
     TPM2B_CONTEXT_DATA *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_CONTEXT_DATA_Size(
+    TPM2B_CONTEXT_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_DATA_Marshal(
     TPM2B_DATA      const *src,
@@ -440,6 +585,11 @@ Tss2_MU_TPM2B_DATA_Unmarshal(
     size_t         *offset,
     TPM2B_DATA     *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_DATA_Size(
+    TPM2B_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_SYM_KEY_Marshal(
     TPM2B_SYM_KEY   const *src,
@@ -454,6 +604,11 @@ Tss2_MU_TPM2B_SYM_KEY_Unmarshal(
     size_t         *offset,
     TPM2B_SYM_KEY  *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_SYM_KEY_Size(
+    TPM2B_SYM_KEY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_ECC_POINT_Marshal(
     TPM2B_ECC_POINT const *src,
@@ -468,6 +623,11 @@ Tss2_MU_TPM2B_ECC_POINT_Unmarshal(
     size_t          *offset,
     TPM2B_ECC_POINT *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_ECC_POINT_Size(
+    TPM2B_ECC_POINT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_NV_PUBLIC_Marshal(
     TPM2B_NV_PUBLIC const *src,
@@ -482,6 +642,11 @@ Tss2_MU_TPM2B_NV_PUBLIC_Unmarshal(
     size_t          *offset,
     TPM2B_NV_PUBLIC *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_NV_PUBLIC_Size(
+    TPM2B_NV_PUBLIC const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_SENSITIVE_Marshal(
     TPM2B_SENSITIVE const *src,
@@ -496,6 +661,11 @@ Tss2_MU_TPM2B_SENSITIVE_Unmarshal(
     size_t          *offset,
     TPM2B_SENSITIVE *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_SENSITIVE_Size(
+    TPM2B_SENSITIVE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_SENSITIVE_CREATE_Marshal(
     TPM2B_SENSITIVE_CREATE const *src,
@@ -510,6 +680,11 @@ Tss2_MU_TPM2B_SENSITIVE_CREATE_Unmarshal(
     size_t          *offset,
     TPM2B_SENSITIVE_CREATE *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_SENSITIVE_CREATE_Size(
+    TPM2B_SENSITIVE_CREATE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_CREATION_DATA_Marshal(
     TPM2B_CREATION_DATA const *src,
@@ -524,6 +699,11 @@ Tss2_MU_TPM2B_CREATION_DATA_Unmarshal(
     size_t          *offset,
     TPM2B_CREATION_DATA *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_CREATION_DATA_Size(
+    TPM2B_CREATION_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_PUBLIC_Marshal(
     TPM2B_PUBLIC    const *src,
@@ -538,6 +718,11 @@ Tss2_MU_TPM2B_PUBLIC_Unmarshal(
     size_t          *offset,
     TPM2B_PUBLIC    *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_PUBLIC_Size(
+    TPM2B_PUBLIC const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_ENCRYPTED_SECRET_Marshal(
     TPM2B_ENCRYPTED_SECRET  const *src,
@@ -552,6 +737,11 @@ Tss2_MU_TPM2B_ENCRYPTED_SECRET_Unmarshal(
     size_t          *offset,
     TPM2B_ENCRYPTED_SECRET *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_ENCRYPTED_SECRET_Size(
+    TPM2B_ENCRYPTED_SECRET const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_ID_OBJECT_Marshal(
     TPM2B_ID_OBJECT const *src,
@@ -566,6 +756,11 @@ Tss2_MU_TPM2B_ID_OBJECT_Unmarshal(
     size_t          *offset,
     TPM2B_ID_OBJECT *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_ID_OBJECT_Size(
+    TPM2B_ID_OBJECT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_IV_Marshal(
     TPM2B_IV const *src,
@@ -580,6 +775,11 @@ Tss2_MU_TPM2B_IV_Unmarshal(
     size_t          *offset,
     TPM2B_IV        *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_IV_Size(
+    TPM2B_IV const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_AUTH_Marshal(
     TPM2B_AUTH const *src,
@@ -594,6 +794,11 @@ Tss2_MU_TPM2B_AUTH_Unmarshal(
     size_t          *offset,
     TPM2B_AUTH      *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_AUTH_Size(
+    TPM2B_AUTH const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_EVENT_Marshal(
     TPM2B_EVENT const *src,
@@ -608,6 +813,11 @@ Tss2_MU_TPM2B_EVENT_Unmarshal(
     size_t          *offset,
     TPM2B_EVENT     *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_EVENT_Size(
+    TPM2B_EVENT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_MAX_BUFFER_Marshal(
     TPM2B_MAX_BUFFER const *src,
@@ -622,6 +832,11 @@ Tss2_MU_TPM2B_MAX_BUFFER_Unmarshal(
     size_t          *offset,
     TPM2B_MAX_BUFFER *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_MAX_BUFFER_Size(
+    TPM2B_MAX_BUFFER const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_NONCE_Marshal(
     TPM2B_NONCE const *src,
@@ -636,6 +851,11 @@ Tss2_MU_TPM2B_NONCE_Unmarshal(
     size_t          *offset,
     TPM2B_NONCE     *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_NONCE_Size(
+    TPM2B_NONCE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_OPERAND_Marshal(
     TPM2B_OPERAND const *src,
@@ -650,6 +870,11 @@ Tss2_MU_TPM2B_OPERAND_Unmarshal(
     size_t          *offset,
     TPM2B_OPERAND   *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_OPERAND_Size(
+    TPM2B_OPERAND const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_TIMEOUT_Marshal(
     TPM2B_TIMEOUT const *src,
@@ -664,6 +889,11 @@ Tss2_MU_TPM2B_TIMEOUT_Unmarshal(
     size_t          *offset,
     TPM2B_TIMEOUT   *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_TIMEOUT_Size(
+    TPM2B_TIMEOUT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2B_TEMPLATE_Marshal(
     TPM2B_TEMPLATE  const *src,
@@ -678,6 +908,11 @@ Tss2_MU_TPM2B_TEMPLATE_Unmarshal(
     size_t          *offset,
     TPM2B_TEMPLATE  *dest);
 
+TSS2_RC
+Tss2_MU_TPM2B_TEMPLATE_Size(
+    TPM2B_TEMPLATE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_CONTEXT_Marshal(
     TPMS_CONTEXT    const *src,
@@ -692,6 +927,11 @@ Tss2_MU_TPMS_CONTEXT_Unmarshal(
     size_t         *offset,
     TPMS_CONTEXT   *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_CONTEXT_Size(
+    TPMS_CONTEXT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_TIME_INFO_Marshal(
     TPMS_TIME_INFO  const *src,
@@ -706,6 +946,11 @@ Tss2_MU_TPMS_TIME_INFO_Unmarshal(
     size_t         *offset,
     TPMS_TIME_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_TIME_INFO_Size(
+    TPMS_TIME_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ECC_POINT_Marshal(
     TPMS_ECC_POINT  const *src,
@@ -720,6 +965,11 @@ Tss2_MU_TPMS_ECC_POINT_Unmarshal(
     size_t         *offset,
     TPMS_ECC_POINT *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ECC_POINT_Size(
+    TPMS_ECC_POINT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_NV_PUBLIC_Marshal(
     TPMS_NV_PUBLIC  const *src,
@@ -734,6 +984,11 @@ Tss2_MU_TPMS_NV_PUBLIC_Unmarshal(
     size_t         *offset,
     TPMS_NV_PUBLIC *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_NV_PUBLIC_Size(
+    TPMS_NV_PUBLIC const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ALG_PROPERTY_Marshal(
     TPMS_ALG_PROPERTY  const *src,
@@ -748,6 +1003,11 @@ Tss2_MU_TPMS_ALG_PROPERTY_Unmarshal(
     size_t         *offset,
     TPMS_ALG_PROPERTY *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ALG_PROPERTY_Size(
+    TPMS_ALG_PROPERTY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ALGORITHM_DESCRIPTION_Marshal(
     TPMS_ALGORITHM_DESCRIPTION  const *src,
@@ -762,6 +1022,11 @@ Tss2_MU_TPMS_ALGORITHM_DESCRIPTION_Unmarshal(
     size_t         *offset,
     TPMS_ALGORITHM_DESCRIPTION *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ALGORITHM_DESCRIPTION_Size(
+    TPMS_ALGORITHM_DESCRIPTION const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_TAGGED_PROPERTY_Marshal(
     TPMS_TAGGED_PROPERTY  const *src,
@@ -776,6 +1041,11 @@ Tss2_MU_TPMS_TAGGED_PROPERTY_Unmarshal(
     size_t         *offset,
     TPMS_TAGGED_PROPERTY *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_TAGGED_PROPERTY_Size(
+    TPMS_TAGGED_PROPERTY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_TAGGED_POLICY_Marshal(
     TPMS_TAGGED_POLICY  const *src,
@@ -790,6 +1060,11 @@ Tss2_MU_TPMS_TAGGED_POLICY_Unmarshal(
     size_t         *offset,
     TPMS_TAGGED_POLICY *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_TAGGED_POLICY_Size(
+    TPMS_TAGGED_POLICY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_CLOCK_INFO_Marshal(
     TPMS_CLOCK_INFO  const *src,
@@ -804,6 +1079,11 @@ Tss2_MU_TPMS_CLOCK_INFO_Unmarshal(
     size_t         *offset,
     TPMS_CLOCK_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_CLOCK_INFO_Size(
+    TPMS_CLOCK_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_TIME_ATTEST_INFO_Marshal(
     TPMS_TIME_ATTEST_INFO  const *src,
@@ -818,6 +1098,11 @@ Tss2_MU_TPMS_TIME_ATTEST_INFO_Unmarshal(
     size_t         *offset,
     TPMS_TIME_ATTEST_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_TIME_ATTEST_INFO_Size(
+    TPMS_TIME_ATTEST_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_CERTIFY_INFO_Marshal(
     TPMS_CERTIFY_INFO  const *src,
@@ -832,6 +1117,11 @@ Tss2_MU_TPMS_CERTIFY_INFO_Unmarshal(
     size_t         *offset,
     TPMS_CERTIFY_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_CERTIFY_INFO_Size(
+    TPMS_CERTIFY_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_COMMAND_AUDIT_INFO_Marshal(
     TPMS_COMMAND_AUDIT_INFO  const *src,
@@ -846,6 +1136,11 @@ Tss2_MU_TPMS_COMMAND_AUDIT_INFO_Unmarshal(
     size_t         *offset,
     TPMS_COMMAND_AUDIT_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_COMMAND_AUDIT_INFO_Size(
+    TPMS_COMMAND_AUDIT_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SESSION_AUDIT_INFO_Marshal(
     TPMS_SESSION_AUDIT_INFO  const *src,
@@ -860,6 +1155,11 @@ Tss2_MU_TPMS_SESSION_AUDIT_INFO_Unmarshal(
     size_t         *offset,
     TPMS_SESSION_AUDIT_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SESSION_AUDIT_INFO_Size(
+    TPMS_SESSION_AUDIT_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_CREATION_INFO_Marshal(
     TPMS_CREATION_INFO  const *src,
@@ -874,6 +1174,11 @@ Tss2_MU_TPMS_CREATION_INFO_Unmarshal(
     size_t         *offset,
     TPMS_CREATION_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_CREATION_INFO_Size(
+    TPMS_CREATION_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_NV_CERTIFY_INFO_Marshal(
     TPMS_NV_CERTIFY_INFO  const *src,
@@ -888,6 +1193,11 @@ Tss2_MU_TPMS_NV_CERTIFY_INFO_Unmarshal(
     size_t         *offset,
     TPMS_NV_CERTIFY_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_NV_CERTIFY_INFO_Size(
+    TPMS_NV_CERTIFY_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_AUTH_COMMAND_Marshal(
     TPMS_AUTH_COMMAND  const *src,
@@ -902,6 +1212,11 @@ Tss2_MU_TPMS_AUTH_COMMAND_Unmarshal(
     size_t         *offset,
     TPMS_AUTH_COMMAND *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_AUTH_COMMAND_Size(
+    TPMS_AUTH_COMMAND const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_AUTH_RESPONSE_Marshal(
     TPMS_AUTH_RESPONSE  const *src,
@@ -916,6 +1231,11 @@ Tss2_MU_TPMS_AUTH_RESPONSE_Unmarshal(
     size_t         *offset,
     TPMS_AUTH_RESPONSE *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_AUTH_RESPONSE_Size(
+    TPMS_AUTH_RESPONSE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SENSITIVE_CREATE_Marshal(
     TPMS_SENSITIVE_CREATE  const *src,
@@ -930,6 +1250,11 @@ Tss2_MU_TPMS_SENSITIVE_CREATE_Unmarshal(
     size_t         *offset,
     TPMS_SENSITIVE_CREATE *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SENSITIVE_CREATE_Size(
+    TPMS_SENSITIVE_CREATE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SCHEME_HASH_Marshal(
     TPMS_SCHEME_HASH  const *src,
@@ -944,6 +1269,11 @@ Tss2_MU_TPMS_SCHEME_HASH_Unmarshal(
     size_t         *offset,
     TPMS_SCHEME_HASH *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SCHEME_HASH_Size(
+    TPMS_SCHEME_HASH const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SCHEME_ECDAA_Marshal(
     TPMS_SCHEME_ECDAA  const *src,
@@ -958,6 +1288,11 @@ Tss2_MU_TPMS_SCHEME_ECDAA_Unmarshal(
     size_t         *offset,
     TPMS_SCHEME_ECDAA *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SCHEME_ECDAA_Size(
+    TPMS_SCHEME_ECDAA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SCHEME_XOR_Marshal(
     TPMS_SCHEME_XOR  const *src,
@@ -972,6 +1307,11 @@ Tss2_MU_TPMS_SCHEME_XOR_Unmarshal(
     size_t         *offset,
     TPMS_SCHEME_XOR *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SCHEME_XOR_Size(
+    TPMS_SCHEME_XOR const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SIGNATURE_RSA_Marshal(
     TPMS_SIGNATURE_RSA  const *src,
@@ -986,6 +1326,11 @@ Tss2_MU_TPMS_SIGNATURE_RSA_Unmarshal(
     size_t         *offset,
     TPMS_SIGNATURE_RSA *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SIGNATURE_RSA_Size(
+    TPMS_SIGNATURE_RSA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SIGNATURE_ECC_Marshal(
     TPMS_SIGNATURE_ECC  const *src,
@@ -1000,6 +1345,11 @@ Tss2_MU_TPMS_SIGNATURE_ECC_Unmarshal(
     size_t         *offset,
     TPMS_SIGNATURE_ECC *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SIGNATURE_ECC_Size(
+    TPMS_SIGNATURE_ECC const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_NV_PIN_COUNTER_PARAMETERS_Marshal(
     TPMS_NV_PIN_COUNTER_PARAMETERS  const *src,
@@ -1014,6 +1364,11 @@ Tss2_MU_TPMS_NV_PIN_COUNTER_PARAMETERS_Unmarshal(
     size_t         *offset,
     TPMS_NV_PIN_COUNTER_PARAMETERS *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_NV_PIN_COUNTER_PARAMETERS_Size(
+    TPMS_NV_PIN_COUNTER_PARAMETERS const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_CONTEXT_DATA_Marshal(
     TPMS_CONTEXT_DATA  const *src,
@@ -1028,6 +1383,11 @@ Tss2_MU_TPMS_CONTEXT_DATA_Unmarshal(
     size_t         *offset,
     TPMS_CONTEXT_DATA *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_CONTEXT_DATA_Size(
+    TPMS_CONTEXT_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_PCR_SELECT_Marshal(
     TPMS_PCR_SELECT  const *src,
@@ -1042,6 +1402,11 @@ Tss2_MU_TPMS_PCR_SELECT_Unmarshal(
     size_t         *offset,
     TPMS_PCR_SELECT *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_PCR_SELECT_Size(
+    TPMS_PCR_SELECT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_PCR_SELECTION_Marshal(
     TPMS_PCR_SELECTION  const *src,
@@ -1056,6 +1421,11 @@ Tss2_MU_TPMS_PCR_SELECTION_Unmarshal(
     size_t         *offset,
     TPMS_PCR_SELECTION *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_PCR_SELECTION_Size(
+    TPMS_PCR_SELECTION const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_TAGGED_PCR_SELECT_Marshal(
     TPMS_TAGGED_PCR_SELECT  const *src,
@@ -1070,6 +1440,11 @@ Tss2_MU_TPMS_TAGGED_PCR_SELECT_Unmarshal(
     size_t         *offset,
     TPMS_TAGGED_PCR_SELECT *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_TAGGED_PCR_SELECT_Size(
+    TPMS_TAGGED_PCR_SELECT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_QUOTE_INFO_Marshal(
     TPMS_QUOTE_INFO  const *src,
@@ -1084,6 +1459,11 @@ Tss2_MU_TPMS_QUOTE_INFO_Unmarshal(
     size_t         *offset,
     TPMS_QUOTE_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_QUOTE_INFO_Size(
+    TPMS_QUOTE_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_CREATION_DATA_Marshal(
     TPMS_CREATION_DATA  const *src,
@@ -1098,6 +1478,11 @@ Tss2_MU_TPMS_CREATION_DATA_Unmarshal(
     size_t         *offset,
     TPMS_CREATION_DATA *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_CREATION_DATA_Size(
+    TPMS_CREATION_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ECC_PARMS_Marshal(
     TPMS_ECC_PARMS  const *src,
@@ -1112,6 +1497,11 @@ Tss2_MU_TPMS_ECC_PARMS_Unmarshal(
     size_t         *offset,
     TPMS_ECC_PARMS *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ECC_PARMS_Size(
+    TPMS_ECC_PARMS const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ATTEST_Marshal(
     TPMS_ATTEST     const *src,
@@ -1126,6 +1516,11 @@ Tss2_MU_TPMS_ATTEST_Unmarshal(
     size_t         *offset,
     TPMS_ATTEST *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ATTEST_Size(
+    TPMS_ATTEST const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ALGORITHM_DETAIL_ECC_Marshal(
     TPMS_ALGORITHM_DETAIL_ECC const *src,
@@ -1140,6 +1535,11 @@ Tss2_MU_TPMS_ALGORITHM_DETAIL_ECC_Unmarshal(
     size_t         *offset,
     TPMS_ALGORITHM_DETAIL_ECC *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ALGORITHM_DETAIL_ECC_Size(
+    TPMS_ALGORITHM_DETAIL_ECC const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(
     TPMS_CAPABILITY_DATA const *src,
@@ -1154,6 +1554,11 @@ Tss2_MU_TPMS_CAPABILITY_DATA_Unmarshal(
     size_t         *offset,
     TPMS_CAPABILITY_DATA *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_CAPABILITY_DATA_Size(
+    TPMS_CAPABILITY_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_KEYEDHASH_PARMS_Marshal(
     TPMS_KEYEDHASH_PARMS const *src,
@@ -1168,6 +1573,11 @@ Tss2_MU_TPMS_KEYEDHASH_PARMS_Unmarshal(
     size_t         *offset,
     TPMS_KEYEDHASH_PARMS *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_KEYEDHASH_PARMS_Size(
+    TPMS_KEYEDHASH_PARMS const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_RSA_PARMS_Marshal(
     TPMS_RSA_PARMS  const *src,
@@ -1182,6 +1592,11 @@ Tss2_MU_TPMS_RSA_PARMS_Unmarshal(
     size_t         *offset,
     TPMS_RSA_PARMS *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_RSA_PARMS_Size(
+    TPMS_RSA_PARMS const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_SYMCIPHER_PARMS_Marshal(
     TPMS_SYMCIPHER_PARMS const *src,
@@ -1196,6 +1611,11 @@ Tss2_MU_TPMS_SYMCIPHER_PARMS_Unmarshal(
     size_t         *offset,
     TPMS_SYMCIPHER_PARMS *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_SYMCIPHER_PARMS_Size(
+    TPMS_SYMCIPHER_PARMS const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_AC_OUTPUT_Marshal(
     TPMS_AC_OUTPUT  const *src,
@@ -1210,6 +1630,11 @@ Tss2_MU_TPMS_AC_OUTPUT_Unmarshal(
     size_t         *offset,
     TPMS_AC_OUTPUT *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_AC_OUTPUT_Size(
+    TPMS_AC_OUTPUT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ID_OBJECT_Marshal(
     TPMS_ID_OBJECT  const *src,
@@ -1224,6 +1649,11 @@ Tss2_MU_TPMS_ID_OBJECT_Unmarshal(
     size_t         *offset,
     TPMS_ID_OBJECT *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ID_OBJECT_Size(
+    TPMS_ID_OBJECT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_ACT_DATA_Marshal(
     TPMS_ACT_DATA   const *src,
@@ -1238,6 +1668,11 @@ Tss2_MU_TPMS_ACT_DATA_Unmarshal(
     size_t         *offset,
     TPMS_ACT_DATA  *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_ACT_DATA_Size(
+    TPMS_ACT_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_NV_DIGEST_CERTIFY_INFO_Marshal(
     TPMS_NV_DIGEST_CERTIFY_INFO const *src,
@@ -1252,6 +1687,11 @@ Tss2_MU_TPMS_NV_DIGEST_CERTIFY_INFO_Unmarshal(
     size_t         *offset,
     TPMS_NV_DIGEST_CERTIFY_INFO *dest);
 
+TSS2_RC
+Tss2_MU_TPMS_NV_DIGEST_CERTIFY_INFO_Size(
+    TPMS_NV_DIGEST_CERTIFY_INFO const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_CC_Marshal(
     TPML_CC const *src,
@@ -1266,6 +1706,11 @@ Tss2_MU_TPML_CC_Unmarshal(
     size_t         *offset,
     TPML_CC        *dest);
 
+TSS2_RC
+Tss2_MU_TPML_CC_Size(
+    TPML_CC const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_CCA_Marshal(
     TPML_CCA const *src,
@@ -1280,6 +1725,11 @@ Tss2_MU_TPML_CCA_Unmarshal(
     size_t         *offset,
     TPML_CCA       *dest);
 
+TSS2_RC
+Tss2_MU_TPML_CCA_Size(
+    TPML_CCA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_ALG_Marshal(
     TPML_ALG const *src,
@@ -1294,6 +1744,11 @@ Tss2_MU_TPML_ALG_Unmarshal(
     size_t         *offset,
     TPML_ALG       *dest);
 
+TSS2_RC
+Tss2_MU_TPML_ALG_Size(
+    TPML_ALG const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_HANDLE_Marshal(
     TPML_HANDLE const *src,
@@ -1308,6 +1763,11 @@ Tss2_MU_TPML_HANDLE_Unmarshal(
     size_t         *offset,
     TPML_HANDLE    *dest);
 
+TSS2_RC
+Tss2_MU_TPML_HANDLE_Size(
+    TPML_HANDLE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_DIGEST_Marshal(
     TPML_DIGEST const *src,
@@ -1322,6 +1782,11 @@ Tss2_MU_TPML_DIGEST_Unmarshal(
     size_t         *offset,
     TPML_DIGEST    *dest);
 
+TSS2_RC
+Tss2_MU_TPML_DIGEST_Size(
+    TPML_DIGEST const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_DIGEST_VALUES_Marshal(
     TPML_DIGEST_VALUES const *src,
@@ -1336,6 +1801,11 @@ Tss2_MU_TPML_DIGEST_VALUES_Unmarshal(
     size_t         *offset,
     TPML_DIGEST_VALUES *dest);
 
+TSS2_RC
+Tss2_MU_TPML_DIGEST_VALUES_Size(
+    TPML_DIGEST_VALUES const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_PCR_SELECTION_Marshal(
     TPML_PCR_SELECTION const *src,
@@ -1350,6 +1820,11 @@ Tss2_MU_TPML_PCR_SELECTION_Unmarshal(
     size_t         *offset,
     TPML_PCR_SELECTION *dest);
 
+TSS2_RC
+Tss2_MU_TPML_PCR_SELECTION_Size(
+    TPML_PCR_SELECTION const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_ALG_PROPERTY_Marshal(
     TPML_ALG_PROPERTY const *src,
@@ -1364,6 +1839,11 @@ Tss2_MU_TPML_ALG_PROPERTY_Unmarshal(
     size_t         *offset,
     TPML_ALG_PROPERTY *dest);
 
+TSS2_RC
+Tss2_MU_TPML_ALG_PROPERTY_Size(
+    TPML_ALG_PROPERTY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_ECC_CURVE_Marshal(
     TPML_ECC_CURVE const *src,
@@ -1378,6 +1858,11 @@ Tss2_MU_TPML_ECC_CURVE_Unmarshal(
     size_t         *offset,
     TPML_ECC_CURVE *dest);
 
+TSS2_RC
+Tss2_MU_TPML_ECC_CURVE_Size(
+    TPML_ECC_CURVE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_TAGGED_PCR_PROPERTY_Marshal(
     TPML_TAGGED_PCR_PROPERTY const *src,
@@ -1392,6 +1877,11 @@ Tss2_MU_TPML_TAGGED_PCR_PROPERTY_Unmarshal(
     size_t         *offset,
     TPML_TAGGED_PCR_PROPERTY *dest);
 
+TSS2_RC
+Tss2_MU_TPML_TAGGED_PCR_PROPERTY_Size(
+    TPML_TAGGED_PCR_PROPERTY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Marshal(
     TPML_TAGGED_TPM_PROPERTY const *src,
@@ -1406,6 +1896,11 @@ Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Unmarshal(
     size_t         *offset,
     TPML_TAGGED_TPM_PROPERTY *dest);
 
+TSS2_RC
+Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Size(
+    TPML_TAGGED_TPM_PROPERTY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_INTEL_PTT_PROPERTY_Marshal(
     TPML_INTEL_PTT_PROPERTY const *src,
@@ -1420,6 +1915,11 @@ Tss2_MU_TPML_INTEL_PTT_PROPERTY_Unmarshal(
     size_t         *offset,
     TPML_INTEL_PTT_PROPERTY *dest);
 
+TSS2_RC
+Tss2_MU_TPML_INTEL_PTT_PROPERTY_Size(
+    TPML_INTEL_PTT_PROPERTY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_AC_CAPABILITIES_Marshal(
     TPML_AC_CAPABILITIES const *src,
@@ -1434,6 +1934,11 @@ Tss2_MU_TPML_AC_CAPABILITIES_Unmarshal(
     size_t         *offset,
     TPML_AC_CAPABILITIES *dest);
 
+TSS2_RC
+Tss2_MU_TPML_AC_CAPABILITIES_Size(
+    TPML_AC_CAPABILITIES const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_TAGGED_POLICY_Marshal(
     TPML_TAGGED_POLICY const *src,
@@ -1448,6 +1953,11 @@ Tss2_MU_TPML_TAGGED_POLICY_Unmarshal(
     size_t         *offset,
     TPML_TAGGED_POLICY *dest);
 
+TSS2_RC
+Tss2_MU_TPML_TAGGED_POLICY_Size(
+    TPML_TAGGED_POLICY const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPML_ACT_DATA_Marshal(
     TPML_ACT_DATA const *src,
@@ -1462,6 +1972,11 @@ Tss2_MU_TPML_ACT_DATA_Unmarshal(
     size_t         *offset,
     TPML_ACT_DATA *dest);
 
+TSS2_RC
+Tss2_MU_TPML_ACT_DATA_Size(
+    TPML_ACT_DATA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMU_HA_Marshal(
     TPMU_HA const *src,
@@ -1478,6 +1993,12 @@ Tss2_MU_TPMU_HA_Unmarshal(
     uint32_t       selector_value,
     TPMU_HA       *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_HA_Size(
+    TPMU_HA const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_CAPABILITIES_Marshal(
     TPMU_CAPABILITIES const *src,
@@ -1494,6 +2015,12 @@ Tss2_MU_TPMU_CAPABILITIES_Unmarshal(
     uint32_t       selector_value,
     TPMU_CAPABILITIES *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_CAPABILITIES_Size(
+    TPMU_CAPABILITIES const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_ATTEST_Marshal(
     TPMU_ATTEST const *src,
@@ -1510,6 +2037,12 @@ Tss2_MU_TPMU_ATTEST_Unmarshal(
     uint32_t       selector_value,
     TPMU_ATTEST *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_ATTEST_Size(
+    TPMU_ATTEST const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_SYM_KEY_BITS_Marshal(
     TPMU_SYM_KEY_BITS const *src,
@@ -1526,6 +2059,12 @@ Tss2_MU_TPMU_SYM_KEY_BITS_Unmarshal(
     uint32_t       selector_value,
     TPMU_SYM_KEY_BITS *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_SYM_KEY_BITS_Size(
+    TPMU_SYM_KEY_BITS const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_SYM_MODE_Marshal(
     TPMU_SYM_MODE const *src,
@@ -1542,6 +2081,12 @@ Tss2_MU_TPMU_SYM_MODE_Unmarshal(
     uint32_t       selector_value,
     TPMU_SYM_MODE *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_SYM_MODE_Size(
+    TPMU_SYM_MODE const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_SIG_SCHEME_Marshal(
     TPMU_SIG_SCHEME const *src,
@@ -1558,6 +2103,12 @@ Tss2_MU_TPMU_SIG_SCHEME_Unmarshal(
     uint32_t       selector_value,
     TPMU_SIG_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_SIG_SCHEME_Size(
+    TPMU_SIG_SCHEME const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_KDF_SCHEME_Marshal(
     TPMU_KDF_SCHEME const *src,
@@ -1574,6 +2125,12 @@ Tss2_MU_TPMU_KDF_SCHEME_Unmarshal(
     uint32_t       selector_value,
     TPMU_KDF_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_KDF_SCHEME_Size(
+    TPMU_KDF_SCHEME const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_ASYM_SCHEME_Marshal(
     TPMU_ASYM_SCHEME const *src,
@@ -1590,6 +2147,12 @@ Tss2_MU_TPMU_ASYM_SCHEME_Unmarshal(
     uint32_t       selector_value,
     TPMU_ASYM_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_ASYM_SCHEME_Size(
+    TPMU_ASYM_SCHEME const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_SCHEME_KEYEDHASH_Marshal(
     TPMU_SCHEME_KEYEDHASH const *src,
@@ -1606,6 +2169,12 @@ Tss2_MU_TPMU_SCHEME_KEYEDHASH_Unmarshal(
     uint32_t       selector_value,
     TPMU_SCHEME_KEYEDHASH *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_SCHEME_KEYEDHASH_Size(
+    TPMU_SCHEME_KEYEDHASH const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_SIGNATURE_Marshal(
     TPMU_SIGNATURE const *src,
@@ -1622,6 +2191,12 @@ Tss2_MU_TPMU_SIGNATURE_Unmarshal(
     uint32_t       selector_value,
     TPMU_SIGNATURE *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_SIGNATURE_Size(
+    TPMU_SIGNATURE const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_SENSITIVE_COMPOSITE_Marshal(
     TPMU_SENSITIVE_COMPOSITE const *src,
@@ -1638,6 +2213,12 @@ Tss2_MU_TPMU_SENSITIVE_COMPOSITE_Unmarshal(
     uint32_t       selector_value,
     TPMU_SENSITIVE_COMPOSITE *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_SENSITIVE_COMPOSITE_Size(
+    TPMU_SENSITIVE_COMPOSITE const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_ENCRYPTED_SECRET_Marshal(
     TPMU_ENCRYPTED_SECRET const *src,
@@ -1654,6 +2235,12 @@ Tss2_MU_TPMU_ENCRYPTED_SECRET_Unmarshal(
     uint32_t       selector_value,
     TPMU_ENCRYPTED_SECRET *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_ENCRYPTED_SECRET_Size(
+    TPMU_ENCRYPTED_SECRET const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_PUBLIC_PARMS_Marshal(
     TPMU_PUBLIC_PARMS const *src,
@@ -1670,6 +2257,12 @@ Tss2_MU_TPMU_PUBLIC_PARMS_Unmarshal(
     uint32_t       selector_value,
     TPMU_PUBLIC_PARMS *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_PUBLIC_PARMS_Size(
+    TPMU_PUBLIC_PARMS const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_PUBLIC_ID_Marshal(
     TPMU_PUBLIC_ID const *src,
@@ -1686,6 +2279,12 @@ Tss2_MU_TPMU_PUBLIC_ID_Unmarshal(
     uint32_t       selector_value,
     TPMU_PUBLIC_ID *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_PUBLIC_ID_Size(
+    TPMU_PUBLIC_ID const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMU_NAME_Marshal(
     TPMU_NAME      const *src,
@@ -1702,6 +2301,12 @@ Tss2_MU_TPMU_NAME_Unmarshal(
     uint32_t       selector_value,
     TPMU_NAME     *dest);
 
+TSS2_RC
+Tss2_MU_TPMU_NAME_Size(
+    TPMU_NAME const *src,
+    uint32_t       selector_value,
+    size_t        *size);
+
 TSS2_RC
 Tss2_MU_TPMT_HA_Marshal(
     TPMT_HA const *src,
@@ -1716,6 +2321,11 @@ Tss2_MU_TPMT_HA_Unmarshal(
     size_t        *offset,
     TPMT_HA *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_HA_Size(
+    TPMT_HA const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_SYM_DEF_Marshal(
     TPMT_SYM_DEF const *src,
@@ -1730,6 +2340,11 @@ Tss2_MU_TPMT_SYM_DEF_Unmarshal(
     size_t        *offset,
     TPMT_SYM_DEF  *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_SYM_DEF_Size(
+    TPMT_SYM_DEF const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_SYM_DEF_OBJECT_Marshal(
     TPMT_SYM_DEF_OBJECT const *src,
@@ -1744,6 +2359,11 @@ Tss2_MU_TPMT_SYM_DEF_OBJECT_Unmarshal(
     size_t        *offset,
     TPMT_SYM_DEF_OBJECT *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_SYM_DEF_OBJECT_Size(
+    TPMT_SYM_DEF_OBJECT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_KEYEDHASH_SCHEME_Marshal(
     TPMT_KEYEDHASH_SCHEME const *src,
@@ -1758,6 +2378,11 @@ Tss2_MU_TPMT_KEYEDHASH_SCHEME_Unmarshal(
     size_t        *offset,
     TPMT_KEYEDHASH_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_KEYEDHASH_SCHEME_Size(
+    TPMT_KEYEDHASH_SCHEME const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_SIG_SCHEME_Marshal(
     TPMT_SIG_SCHEME const *src,
@@ -1772,6 +2397,11 @@ Tss2_MU_TPMT_SIG_SCHEME_Unmarshal(
     size_t        *offset,
     TPMT_SIG_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_SIG_SCHEME_Size(
+    TPMT_SIG_SCHEME const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_KDF_SCHEME_Marshal(
     TPMT_KDF_SCHEME const *src,
@@ -1786,6 +2416,11 @@ Tss2_MU_TPMT_KDF_SCHEME_Unmarshal(
     size_t        *offset,
     TPMT_KDF_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_KDF_SCHEME_Size(
+    TPMT_KDF_SCHEME const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_ASYM_SCHEME_Marshal(
     TPMT_ASYM_SCHEME const *src,
@@ -1800,6 +2435,11 @@ Tss2_MU_TPMT_ASYM_SCHEME_Unmarshal(
     size_t        *offset,
     TPMT_ASYM_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_ASYM_SCHEME_Size(
+    TPMT_ASYM_SCHEME const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_RSA_SCHEME_Marshal(
     TPMT_RSA_SCHEME const *src,
@@ -1814,6 +2454,11 @@ Tss2_MU_TPMT_RSA_SCHEME_Unmarshal(
     size_t        *offset,
     TPMT_RSA_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_RSA_SCHEME_Size(
+    TPMT_RSA_SCHEME const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_RSA_DECRYPT_Marshal(
     TPMT_RSA_DECRYPT const *src,
@@ -1828,6 +2473,11 @@ Tss2_MU_TPMT_RSA_DECRYPT_Unmarshal(
     size_t        *offset,
     TPMT_RSA_DECRYPT *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_RSA_DECRYPT_Size(
+    TPMT_RSA_DECRYPT const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_ECC_SCHEME_Marshal(
     TPMT_ECC_SCHEME const *src,
@@ -1842,6 +2492,11 @@ Tss2_MU_TPMT_ECC_SCHEME_Unmarshal(
     size_t        *offset,
     TPMT_ECC_SCHEME *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_ECC_SCHEME_Size(
+    TPMT_ECC_SCHEME const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_SIGNATURE_Marshal(
     TPMT_SIGNATURE const *src,
@@ -1856,6 +2511,11 @@ Tss2_MU_TPMT_SIGNATURE_Unmarshal(
     size_t        *offset,
     TPMT_SIGNATURE *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_SIGNATURE_Size(
+    TPMT_SIGNATURE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_SENSITIVE_Marshal(
     TPMT_SENSITIVE const *src,
@@ -1870,6 +2530,11 @@ Tss2_MU_TPMT_SENSITIVE_Unmarshal(
     size_t        *offset,
     TPMT_SENSITIVE *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_SENSITIVE_Size(
+    TPMT_SENSITIVE const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_PUBLIC_Marshal(
     TPMT_PUBLIC    const *src,
@@ -1884,6 +2549,11 @@ Tss2_MU_TPMT_PUBLIC_Unmarshal(
     size_t        *offset,
     TPMT_PUBLIC   *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_PUBLIC_Size(
+    TPMT_PUBLIC const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_PUBLIC_PARMS_Marshal(
     TPMT_PUBLIC_PARMS const *src,
@@ -1898,6 +2568,11 @@ Tss2_MU_TPMT_PUBLIC_PARMS_Unmarshal(
     size_t        *offset,
     TPMT_PUBLIC_PARMS *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_PUBLIC_PARMS_Size(
+    TPMT_PUBLIC_PARMS const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_TK_CREATION_Marshal(
     TPMT_TK_CREATION const *src,
@@ -1912,6 +2587,11 @@ Tss2_MU_TPMT_TK_CREATION_Unmarshal(
     size_t        *offset,
     TPMT_TK_CREATION *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_TK_CREATION_Size(
+    TPMT_TK_CREATION const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_TK_VERIFIED_Marshal(
     TPMT_TK_VERIFIED const *src,
@@ -1926,6 +2606,11 @@ Tss2_MU_TPMT_TK_VERIFIED_Unmarshal(
     size_t        *offset,
     TPMT_TK_VERIFIED *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_TK_VERIFIED_Size(
+    TPMT_TK_VERIFIED const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_TK_AUTH_Marshal(
     TPMT_TK_AUTH   const *src,
@@ -1940,6 +2625,11 @@ Tss2_MU_TPMT_TK_AUTH_Unmarshal(
     size_t        *offset,
     TPMT_TK_AUTH  *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_TK_AUTH_Size(
+    TPMT_TK_AUTH const *src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMT_TK_HASHCHECK_Marshal(
     TPMT_TK_HASHCHECK const *src,
@@ -1954,6 +2644,11 @@ Tss2_MU_TPMT_TK_HASHCHECK_Unmarshal(
     size_t        *offset,
     TPMT_TK_HASHCHECK *dest);
 
+TSS2_RC
+Tss2_MU_TPMT_TK_HASHCHECK_Size(
+    TPMT_TK_HASHCHECK const *src,
+    size_t         *size);
+
 TSS2_RC Tss2_MU_TPM2_HANDLE_Marshal(
     TPM2_HANDLE     in,
     uint8_t         *buffer,
@@ -1967,6 +2662,11 @@ Tss2_MU_TPM2_HANDLE_Unmarshal(
     size_t          *offset,
     TPM2_HANDLE     *out);
 
+TSS2_RC
+Tss2_MU_TPM2_HANDLE_Size(
+    TPM2_HANDLE     src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMI_ALG_HASH_Marshal(
     TPMI_ALG_HASH   in,
@@ -1981,6 +2681,11 @@ Tss2_MU_TPMI_ALG_HASH_Unmarshal(
     size_t          *offset,
     TPMI_ALG_HASH   *out);
 
+TSS2_RC
+Tss2_MU_TPMI_ALG_HASH_Size(
+    TPMI_ALG_HASH   src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_BYTE_Marshal(
     BYTE            in,
@@ -1995,6 +2700,11 @@ Tss2_MU_BYTE_Unmarshal(
     size_t          *offset,
     BYTE            *out);
 
+TSS2_RC
+Tss2_MU_BYTE_Size(
+    BYTE            src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2_SE_Marshal(
     TPM2_SE         in,
@@ -2009,6 +2719,11 @@ Tss2_MU_TPM2_SE_Unmarshal(
     size_t          *offset,
     TPM2_SE         *out);
 
+TSS2_RC
+Tss2_MU_TPM2_SE_Size(
+    TPM2_SE         src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPM2_NT_Marshal(
     TPM2_NT         in,
@@ -2023,6 +2738,11 @@ Tss2_MU_TPM2_NT_Unmarshal(
     size_t          *offset,
     TPM2_NT         *out);
 
+TSS2_RC
+Tss2_MU_TPM2_NT_Size(
+    TPM2_NT         src,
+    size_t         *size);
+
 TSS2_RC
 Tss2_MU_TPMS_EMPTY_Marshal(
     TPMS_EMPTY const *in,
@@ -2037,6 +2757,11 @@ Tss2_MU_TPMS_EMPTY_Unmarshal(
     size_t          *offset,
     TPMS_EMPTY      *out);
 
+TSS2_RC
+Tss2_MU_TPMS_EMPTY_Size(
+    TPMS_EMPTY const *src,
+    size_t         *size);
+
 #ifdef __cplusplus
 }
 #endif
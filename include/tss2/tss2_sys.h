@@ -87,6 +87,73 @@ TSS2_RC Tss2_Sys_ExecuteFinish(
 TSS2_RC Tss2_Sys_Execute(
     TSS2_SYS_CONTEXT *sysContext);
 
+TSS2_RC Tss2_Sys_ExecuteBatch(
+    TSS2_SYS_CONTEXT **sysContexts,
+    size_t count,
+    TSS2_RC *rcs);
+
+/* Command Execution Metrics */
+typedef struct TSS2_SYS_METRICS TSS2_SYS_METRICS;
+
+/*
+ * Latency histogram with two significant bits per power of two. Bucket b < 4
+ * counts latencies of b microseconds, bucket b >= 4 counts latencies in
+ * [(4 + b % 4) << (b / 4 - 1), (5 + b % 4) << (b / 4 - 1)) microseconds.
+ * The last bucket also counts everything above its range.
+ */
+#define TSS2_SYS_METRICS_HISTOGRAM_BUCKETS 96
+
+typedef struct TSS2_SYS_COMMAND_METRICS TSS2_SYS_COMMAND_METRICS;
+struct TSS2_SYS_COMMAND_METRICS {
+    TPM2_CC commandCode;
+    uint64_t count;         /* Responses received */
+    uint64_t errors;        /* Responses with a TPM error code */
+    uint64_t retries;       /* TPM2_RC_RETRY and TPM2_RC_TESTING responses */
+    uint64_t yielded;       /* TPM2_RC_YIELDED responses */
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint64_t hostTimeNs;    /* Marshaling, from _Prepare to transmission */
+    uint64_t tpmTimeNs;     /* From transmission to the received response */
+    uint64_t histogram[TSS2_SYS_METRICS_HISTOGRAM_BUCKETS];
+};
+
+typedef void (*TSS2_SYS_METRICS_DUMP_CB)(
+    const TSS2_SYS_METRICS *metrics,
+    void *userdata);
+
+TSS2_RC Tss2_Sys_Metrics_New(
+    TSS2_SYS_METRICS **metrics);
+
+void Tss2_Sys_Metrics_Free(
+    TSS2_SYS_METRICS **metrics);
+
+TSS2_RC Tss2_Sys_SetMetrics(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_METRICS *metrics);
+
+TSS2_RC Tss2_Sys_Metrics_Query(
+    const TSS2_SYS_METRICS *metrics,
+    TSS2_SYS_COMMAND_METRICS *entries,
+    size_t *count);
+
+TSS2_RC Tss2_Sys_Metrics_GetCommand(
+    const TSS2_SYS_METRICS *metrics,
+    TPM2_CC commandCode,
+    TSS2_SYS_COMMAND_METRICS *entry);
+
+uint64_t Tss2_Sys_Metrics_Percentile(
+    const TSS2_SYS_COMMAND_METRICS *entry,
+    double percentile);
+
+void Tss2_Sys_Metrics_Reset(
+    TSS2_SYS_METRICS *metrics);
+
+TSS2_RC Tss2_Sys_Metrics_SetDump(
+    TSS2_SYS_METRICS *metrics,
+    uint32_t intervalMs,
+    TSS2_SYS_METRICS_DUMP_CB callback,
+    void *userdata);
+
 /* Command Completion functions */
 TSS2_RC Tss2_Sys_GetCommandCode(
     TSS2_SYS_CONTEXT *sysContext,
@@ -366,6 +433,11 @@ TSS2_RC Tss2_Sys_Unseal_Complete(
     TSS2_SYS_CONTEXT *sysContext,
     TPM2B_SENSITIVE_DATA *outData);
 
+TSS2_RC Tss2_Sys_Unseal_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *outDataSize,
+    const uint8_t **outData);
+
 TSS2_RC Tss2_Sys_Unseal(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_DH_OBJECT itemHandle,
@@ -681,6 +753,11 @@ TSS2_RC Tss2_Sys_GetRandom_Complete(
     TSS2_SYS_CONTEXT *sysContext,
     TPM2B_DIGEST *randomBytes);
 
+TSS2_RC Tss2_Sys_GetRandom_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *randomBytesSize,
+    const uint8_t **randomBytes);
+
 TSS2_RC Tss2_Sys_GetRandom(
     TSS2_SYS_CONTEXT *sysContext,
     TSS2L_SYS_AUTH_COMMAND const *cmdAuthsArray,
@@ -1753,6 +1830,11 @@ TSS2_RC Tss2_Sys_FirmwareRead_Complete(
     TSS2_SYS_CONTEXT *sysContext,
     TPM2B_MAX_BUFFER *fuData);
 
+TSS2_RC Tss2_Sys_FirmwareRead_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *fuDataSize,
+    const uint8_t **fuData);
+
 TSS2_RC Tss2_Sys_FirmwareRead(
     TSS2_SYS_CONTEXT *sysContext,
     TSS2L_SYS_AUTH_COMMAND const *cmdAuthsArray,
@@ -2062,6 +2144,11 @@ TSS2_RC Tss2_Sys_NV_Read_Complete(
     TSS2_SYS_CONTEXT *sysContext,
     TPM2B_MAX_NV_BUFFER *data);
 
+TSS2_RC Tss2_Sys_NV_Read_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *dataSize,
+    const uint8_t **data);
+
 TSS2_RC Tss2_Sys_NV_Read(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_RH_NV_AUTH authHandle,
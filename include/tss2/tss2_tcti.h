@@ -85,6 +85,8 @@ typedef void TSS2_TCTI_POLL_HANDLE;
     ((TSS2_TCTI_CONTEXT_COMMON_V1*)tctiContext)->setLocality
 #define TSS2_TCTI_MAKE_STICKY(tctiContext) \
     ((TSS2_TCTI_CONTEXT_COMMON_V2*)tctiContext)->makeSticky
+#define TSS2_TCTI_SET_PIPELINE_DEPTH(tctiContext) \
+    ((TSS2_TCTI_CONTEXT_COMMON_V3*)tctiContext)->setPipelineDepth
 
 /* Macros to simplify invocation of functions from the common TCTI structure */
 #define Tss2_Tcti_Transmit(tctiContext, size, command) \
@@ -138,6 +140,13 @@ typedef void TSS2_TCTI_POLL_HANDLE;
     (TSS2_TCTI_MAKE_STICKY(tctiContext) == NULL) ? \
         TSS2_TCTI_RC_NOT_IMPLEMENTED: \
     TSS2_TCTI_MAKE_STICKY(tctiContext)(tctiContext, handle, sticky))
+#define Tss2_Tcti_SetPipelineDepth(tctiContext, depth) \
+    ((tctiContext == NULL) ? TSS2_TCTI_RC_BAD_REFERENCE: \
+    (TSS2_TCTI_VERSION(tctiContext) < 3) ? \
+        TSS2_TCTI_RC_ABI_MISMATCH: \
+    (TSS2_TCTI_SET_PIPELINE_DEPTH(tctiContext) == NULL) ? \
+        TSS2_TCTI_RC_NOT_IMPLEMENTED: \
+    TSS2_TCTI_SET_PIPELINE_DEPTH(tctiContext)(tctiContext, depth))
 
 typedef struct TSS2_TCTI_OPAQUE_CONTEXT_BLOB TSS2_TCTI_CONTEXT;
 
@@ -169,6 +178,9 @@ typedef TSS2_RC (*TSS2_TCTI_MAKE_STICKY_FCN) (
     TSS2_TCTI_CONTEXT *tctiContext,
     TPM2_HANDLE *handle,
     uint8_t sticky);
+typedef TSS2_RC (*TSS2_TCTI_SET_PIPELINE_DEPTH_FCN) (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth);
 typedef TSS2_RC (*TSS2_TCTI_INIT_FUNC) (
     TSS2_TCTI_CONTEXT *tctiContext,
     size_t *size,
@@ -193,7 +205,18 @@ struct TSS2_TCTI_CONTEXT_COMMON_V2 {
     TSS2_TCTI_MAKE_STICKY_FCN makeSticky;
 };
 
-typedef TSS2_TCTI_CONTEXT_COMMON_V2 TSS2_TCTI_CONTEXT_COMMON_CURRENT;
+/*
+ * Version 3 adds pipelining: after setPipelineDepth (depth) up to 'depth'
+ * commands may be transmitted before the first response is received. The
+ * responses are returned by receive in the order the commands were sent.
+ */
+typedef struct TSS2_TCTI_CONTEXT_COMMON_V3 TSS2_TCTI_CONTEXT_COMMON_V3;
+struct TSS2_TCTI_CONTEXT_COMMON_V3 {
+    TSS2_TCTI_CONTEXT_COMMON_V2 v2;
+    TSS2_TCTI_SET_PIPELINE_DEPTH_FCN setPipelineDepth;
+};
+
+typedef TSS2_TCTI_CONTEXT_COMMON_V3 TSS2_TCTI_CONTEXT_COMMON_CURRENT;
 
 #define TSS2_TCTI_INFO_SYMBOL "Tss2_Tcti_Info"
 
@@ -208,7 +208,7 @@ Esys_ContextSave_Finish(
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
     /* Allocate memory for response parameters */
-    lcontext = calloc(sizeof(TPMS_CONTEXT), 1);
+    lcontext = iesys_pool_calloc(esysContext, sizeof(TPMS_CONTEXT));
     if (lcontext == NULL) {
         return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
     }
@@ -290,14 +290,14 @@ Esys_ContextSave_Finish(
     if (context != NULL)
         *context = lcontext;
     else
-        SAFE_FREE(lcontext);
+        iesys_pool_free(esysContext, lcontext, sizeof(TPMS_CONTEXT));
 
     esysContext->state = _ESYS_STATE_INIT;
 
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    SAFE_FREE(lcontext);
+    iesys_pool_free(esysContext, lcontext, sizeof(TPMS_CONTEXT));
 
     return r;
 }
@@ -207,6 +207,7 @@ Esys_Create_Async(
     store_input_parameters (esysContext, inSensitive);
     if (inPublic) {
         r = iesys_hash_long_auth_values(
+            &esysContext->crypto_backend,
            &esysContext->in.Create.inSensitive->sensitive.userAuth,
             inPublic->publicArea.nameAlg);
         return_state_if_error(r, _ESYS_STATE_INIT, "Adapt auth value.");
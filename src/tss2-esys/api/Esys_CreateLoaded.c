@@ -204,6 +204,7 @@ Esys_CreateLoaded_Async(
         return_if_error(r, "Unmarshalling inPublic failed");
 
         r = iesys_hash_long_auth_values(
+            &esysContext->crypto_backend,
             &esysContext->in.CreateLoaded.inSensitive->sensitive.userAuth,
              publicArea.nameAlg);
         return_state_if_error(r, _ESYS_STATE_INIT, "Adapt auth value.");
@@ -329,7 +330,7 @@ Esys_CreateLoaded_Finish(
             goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
         }
     }
-    loutPublic = calloc(sizeof(TPM2B_PUBLIC), 1);
+    loutPublic = iesys_pool_calloc(esysContext, sizeof(TPM2B_PUBLIC));
     if (loutPublic == NULL) {
         goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
     }
@@ -400,7 +401,8 @@ Esys_CreateLoaded_Finish(
     objectHandleNode->rsrc.misc.rsrc_key_pub = *loutPublic;
 
     /* Check name and outPublic for consistency */
-    if (!iesys_compare_name(&objectHandleNode->rsrc.misc.rsrc_key_pub, &name))
+    if (!iesys_compare_name(&esysContext->crypto_backend,
+                            &objectHandleNode->rsrc.misc.rsrc_key_pub, &name))
         goto_error(r, TSS2_ESYS_RC_MALFORMED_RESPONSE,
             "in Public name not equal name in response", error_cleanup);
 
@@ -410,7 +412,7 @@ Esys_CreateLoaded_Finish(
     if (outPublic != NULL)
         *outPublic = loutPublic;
     else
-        SAFE_FREE(loutPublic);
+        iesys_pool_free(esysContext, loutPublic, sizeof(TPM2B_PUBLIC));
 
     esysContext->state = _ESYS_STATE_INIT;
 
@@ -420,7 +422,7 @@ error_cleanup:
     Esys_TR_Close(esysContext, objectHandle);
     if (outPrivate != NULL)
         SAFE_FREE(*outPrivate);
-    SAFE_FREE(loutPublic);
+    iesys_pool_free(esysContext, loutPublic, sizeof(TPM2B_PUBLIC));
 
     return r;
 }
@@ -209,6 +209,7 @@ Esys_CreatePrimary_Async(
     store_input_parameters (esysContext, inSensitive);
     if (inPublic) {
         r = iesys_hash_long_auth_values(
+            &esysContext->crypto_backend,
             &esysContext->in.CreatePrimary.inSensitive->sensitive.userAuth,
              inPublic->publicArea.nameAlg);
         return_state_if_error(r, _ESYS_STATE_INIT, "Adapt auth value.");
@@ -343,7 +344,7 @@ Esys_CreatePrimary_Finish(
     if (r != TSS2_RC_SUCCESS)
         return r;
 
-    loutPublic = calloc(sizeof(TPM2B_PUBLIC), 1);
+    loutPublic = iesys_pool_calloc(esysContext, sizeof(TPM2B_PUBLIC));
     if (loutPublic == NULL) {
         goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
     }
@@ -433,7 +434,8 @@ Esys_CreatePrimary_Finish(
 
 
     /* Check name and outPublic for consistency */
-    if (!iesys_compare_name(loutPublic, &name))
+    if (!iesys_compare_name(&esysContext->crypto_backend, loutPublic,
+                            &name))
         goto_error(r, TSS2_ESYS_RC_MALFORMED_RESPONSE,
             "in Public name not equal name in response", error_cleanup);
 
@@ -445,7 +447,7 @@ Esys_CreatePrimary_Finish(
     if (outPublic != NULL)
         *outPublic = loutPublic;
     else
-        SAFE_FREE(loutPublic);
+        iesys_pool_free(esysContext, loutPublic, sizeof(TPM2B_PUBLIC));
 
     esysContext->state = _ESYS_STATE_INIT;
 
@@ -453,7 +455,7 @@ Esys_CreatePrimary_Finish(
 
 error_cleanup:
     Esys_TR_Close(esysContext, objectHandle);
-    SAFE_FREE(loutPublic);
+    iesys_pool_free(esysContext, loutPublic, sizeof(TPM2B_PUBLIC));
     if (creationData != NULL)
         SAFE_FREE(*creationData);
     if (creationHash != NULL)
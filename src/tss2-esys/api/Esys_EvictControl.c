@@ -14,6 +14,7 @@
 
 #include "esys_types.h"
 #include "esys_iutil.h"
+#include "esys_cache.h"
 #include "esys_mu.h"
 #define LOGMODULE esys
 #include "util/log.h"
@@ -361,7 +362,11 @@ Esys_EvictControl_Finish(
     /* The object was already persistent */
     if (iesys_get_handle_type(objectHandleNode->rsrc.handle) == TPM2_HT_PERSISTENT) {
         *newObjectHandle = ESYS_TR_NONE;
+        /* and is evicted for all contexts sharing the metadata cache */
+        iesys_cache_invalidate(objectHandleNode->rsrc.handle);
     } else {
+        /* Drop a cached object that was evicted from this handle before */
+        iesys_cache_invalidate(esysContext->in.EvictControl.persistentHandle);
         /* A new resource is created and updated with date from the not persistent object */
         RSRC_NODE_T *newObjectHandleNode = NULL;
         *newObjectHandle = esysContext->esys_handle_cnt++;
@@ -250,13 +250,12 @@ Esys_Hash_Finish(
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
 
-    /* Check for correct sequence and set sequence to irregular for now */
+    /* Check for correct sequence */
     if (esysContext->state != _ESYS_STATE_SENT &&
         esysContext->state != _ESYS_STATE_RESUBMISSION) {
         LOG_ERROR("Esys called in bad sequence.");
         return TSS2_ESYS_RC_BAD_SEQUENCE;
     }
-    esysContext->state = _ESYS_STATE_INTERNALERROR;
 
     /* Allocate memory for response parameters */
     if (outHash != NULL) {
@@ -272,6 +271,163 @@ Esys_Hash_Finish(
         }
     }
 
+    /* Receive the TPM response into the allocated memory */
+    r = Esys_Hash_Finish_Into(esysContext,
+                              (outHash != NULL) ? *outHash : NULL,
+                              (validation != NULL) ? *validation : NULL);
+    if (r != TSS2_RC_SUCCESS)
+        goto error_cleanup;
+
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    if (outHash != NULL)
+        SAFE_FREE(*outHash);
+    if (validation != NULL)
+        SAFE_FREE(*validation);
+
+    return r;
+}
+
+/** One-Call function for TPM2_Hash into caller-provided memory
+ *
+ * This function invokes the TPM2_Hash command in a one-call
+ * variant. This means the function will block until the TPM response is
+ * available. All input parameters are const. The output parameters are written
+ * to memory provided by the caller, so no memory is allocated for them.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[in]  shandle1 First session handle.
+ * @param[in]  shandle2 Second session handle.
+ * @param[in]  shandle3 Third session handle.
+ * @param[in]  data Data to be hashed.
+ * @param[in]  hashAlg TPM2_Algorithm for the hash being computed - shall not be
+ *             TPM2_ALG_NULL.
+ * @param[in]  hierarchy TPM2_Hierarchy to use for the ticket (TPM2_RH_NULL allowed).
+ * @param[out] outHash Results.
+ *             (caller-allocated)
+ * @param[out] validation TPM2_Ticket indicating that the sequence of octets used to
+ *             compute outDigest did not start with TPM2_GENERATED_VALUE.
+ *             (caller-allocated)
+ * @retval TSS2_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *          at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM
+           did not verify.
+ * @retval TSS2_ESYS_RC_MULTIPLE_DECRYPT_SESSIONS: if more than one session has
+ *         the 'decrypt' attribute bit set.
+ * @retval TSS2_ESYS_RC_MULTIPLE_ENCRYPT_SESSIONS: if more than one session has
+ *         the 'encrypt' attribute bit set.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_Hash_Into(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    const TPM2B_MAX_BUFFER *data,
+    TPMI_ALG_HASH hashAlg,
+    ESYS_TR hierarchy,
+    TPM2B_DIGEST *outHash,
+    TPMT_TK_HASHCHECK *validation)
+{
+    TSS2_RC r;
+
+    r = Esys_Hash_Async(esysContext, shandle1, shandle2, shandle3, data, hashAlg,
+                        hierarchy);
+    return_if_error(r, "Error in async function");
+
+    /* Set the timeout to indefinite for now, since we want _Finish to block */
+    int32_t timeouttmp = esysContext->timeout;
+    esysContext->timeout = -1;
+    /*
+     * Now we call the finish function, until return code is not equal to
+     * from TSS2_BASE_RC_TRY_AGAIN.
+     * Note that the finish function may return TSS2_RC_TRY_AGAIN, even if we
+     * have set the timeout to -1. This occurs for example if the TPM requests
+     * a retransmission of the command via TPM2_RC_YIELDED.
+     */
+    do {
+        r = Esys_Hash_Finish_Into(esysContext, outHash, validation);
+        /* This is just debug information about the reattempt to finish the
+           command */
+        if (base_rc(r) == TSS2_BASE_RC_TRY_AGAIN)
+            LOG_DEBUG("A layer below returned TRY_AGAIN: %" PRIx32
+                      " => resubmitting command", r);
+    } while (base_rc(r) == TSS2_BASE_RC_TRY_AGAIN);
+
+    /* Restore the timeout value to the original value */
+    esysContext->timeout = timeouttmp;
+    return_if_error(r, "Esys Finish");
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Asynchronous finish function for TPM2_Hash into caller-provided memory
+ *
+ * This function returns the results of a TPM2_Hash command
+ * invoked via Esys_Hash_Async. The output parameters are written to memory
+ * provided by the caller, so no memory is allocated for them. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] outHash Results.
+ *             (caller-allocated)
+ * @param[out] validation TPM2_Ticket indicating that the sequence of octets used to
+ *             compute outDigest did not start with TPM2_GENERATED_VALUE.
+ *             (caller-allocated)
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_Hash_Finish_Into(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_DIGEST *outHash,
+    TPMT_TK_HASHCHECK *validation)
+{
+    TSS2_RC r;
+    LOG_TRACE("context=%p, outHash=%p, validation=%p",
+              esysContext, outHash, validation);
+
+    if (esysContext == NULL) {
+        LOG_ERROR("esyscontext is NULL.");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    /* Check for correct sequence and set sequence to irregular for now */
+    if (esysContext->state != _ESYS_STATE_SENT &&
+        esysContext->state != _ESYS_STATE_RESUBMISSION) {
+        LOG_ERROR("Esys called in bad sequence.");
+        return TSS2_ESYS_RC_BAD_SEQUENCE;
+    }
+    esysContext->state = _ESYS_STATE_INTERNALERROR;
+
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if (base_rc(r) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -324,9 +480,8 @@ Esys_Hash_Finish(
      * After the verification of the response we call the complete function
      * to deliver the result.
      */
-    r = Tss2_Sys_Hash_Complete(esysContext->sys,
-                               (outHash != NULL) ? *outHash : NULL,
-                               (validation != NULL) ? *validation : NULL);
+    r = Tss2_Sys_Hash_Complete(esysContext->sys, outHash,
+                               validation);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -336,10 +491,5 @@ Esys_Hash_Finish(
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    if (outHash != NULL)
-        SAFE_FREE(*outHash);
-    if (validation != NULL)
-        SAFE_FREE(*validation);
-
     return r;
 }
@@ -266,11 +266,11 @@ Esys_NV_ReadPublic_Finish(
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
     /* Allocate memory for response parameters */
-    lnvPublic = calloc(sizeof(TPM2B_NV_PUBLIC), 1);
+    lnvPublic = iesys_pool_calloc(esysContext, sizeof(TPM2B_NV_PUBLIC));
     if (lnvPublic == NULL) {
         return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
     }
-    lnvName = calloc(sizeof(TPM2B_NAME), 1);
+    lnvName = iesys_pool_calloc(esysContext, sizeof(TPM2B_NAME));
     if (lnvName == NULL) {
         goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
     }
@@ -343,24 +343,25 @@ Esys_NV_ReadPublic_Finish(
         nvIndexNode->rsrc.rsrcType = IESYSC_NV_RSRC;
         nvIndexNode->rsrc.name = *lnvName;
         nvIndexNode->rsrc.misc.rsrc_nv_pub = *lnvPublic;
+        nvIndexNode->rsrc.nameComputed = 0;
     }
     if (nvPublic != NULL)
         *nvPublic = lnvPublic;
     else
-        SAFE_FREE(lnvPublic);
+        iesys_pool_free(esysContext, lnvPublic, sizeof(TPM2B_NV_PUBLIC));
 
     if (nvName != NULL)
         *nvName = lnvName;
     else
-        SAFE_FREE(lnvName);
+        iesys_pool_free(esysContext, lnvName, sizeof(TPM2B_NAME));
 
     esysContext->state = _ESYS_STATE_INIT;
 
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    SAFE_FREE(lnvPublic);
-    SAFE_FREE(lnvName);
+    iesys_pool_free(esysContext, lnvPublic, sizeof(TPM2B_NV_PUBLIC));
+    iesys_pool_free(esysContext, lnvName, sizeof(TPM2B_NAME));
 
     return r;
 }
@@ -14,6 +14,7 @@
 
 #include "esys_types.h"
 #include "esys_iutil.h"
+#include "esys_cache.h"
 #include "esys_mu.h"
 #define LOGMODULE esys
 #include "util/log.h"
@@ -327,6 +328,14 @@ Esys_NV_UndefineSpace_Finish(
     return_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                           "Received error from SAPI unmarshaling" );
 
+    /* The NV index is gone for all contexts sharing the metadata cache */
+    RSRC_NODE_T *nvIndexNode;
+    r = esys_GetResourceObject(esysContext, esysContext->in.NV.nvIndex,
+                               &nvIndexNode);
+    return_if_error(r, "get resource");
+    if (nvIndexNode != NULL)
+        iesys_cache_invalidate(nvIndexNode->rsrc.handle);
+
     /* The ESYS_TR object (nvIndex) has to be invalidated */
     r = Esys_TR_Close(esysContext, &esysContext->in.NV.nvIndex);
     return_if_error(r, "invalidate object");
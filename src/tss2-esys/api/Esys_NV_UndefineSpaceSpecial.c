@@ -14,6 +14,7 @@
 
 #include "esys_types.h"
 #include "esys_iutil.h"
+#include "esys_cache.h"
 #include "esys_mu.h"
 #define LOGMODULE esys
 #include "util/log.h"
@@ -334,6 +335,9 @@ Esys_NV_UndefineSpaceSpecial_Finish(
 
     session->rsrc.misc.rsrc_session.sizeHmacValue -= nvIndexNode->auth.size;
 
+    /* The NV index is gone for all contexts sharing the metadata cache */
+    iesys_cache_invalidate(nvIndexNode->rsrc.handle);
+
     /* The ESYS_TR object (nvIndex) has to be invalidated */
     r = Esys_TR_Close(esysContext, &esysContext->in.NV.nvIndex);
     return_if_error(r, "TR_Close");
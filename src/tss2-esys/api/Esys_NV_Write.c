@@ -14,6 +14,7 @@
 
 #include "esys_types.h"
 #include "esys_iutil.h"
+#include "esys_cache.h"
 #include "esys_mu.h"
 #define LOGMODULE esys
 #include "util/log.h"
@@ -340,9 +341,15 @@ Esys_NV_Write_Finish(
 
     /* Update name in meta data because of possibly changed attributes */
     if (nvIndexNode != NULL) {
-        nvIndexNode->rsrc.misc.rsrc_nv_pub.nvPublic.attributes |= TPMA_NV_WRITTEN;
-        r = iesys_nv_get_name(&nvIndexNode->rsrc.misc.rsrc_nv_pub,
-                              &nvIndexNode->rsrc.name);
+        /* The names are outdated if the attribute was not set before */
+        if ((nvIndexNode->rsrc.misc.rsrc_nv_pub.nvPublic.attributes &
+             TPMA_NV_WRITTEN) == 0) {
+            iesys_cache_invalidate(nvIndexNode->rsrc.handle);
+            nvIndexNode->rsrc.misc.rsrc_nv_pub.nvPublic.attributes |= TPMA_NV_WRITTEN;
+            nvIndexNode->rsrc.nameComputed = 0;
+        }
+        r = iesys_rsrc_get_name(&esysContext->crypto_backend,
+                                &nvIndexNode->rsrc, &nvIndexNode->rsrc.name);
         return_if_error(r, "Error get nvname")
     }
     esysContext->state = _ESYS_STATE_INIT;
@@ -261,13 +261,12 @@ Esys_Sign_Finish(
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
 
-    /* Check for correct sequence and set sequence to irregular for now */
+    /* Check for correct sequence */
     if (esysContext->state != _ESYS_STATE_SENT &&
         esysContext->state != _ESYS_STATE_RESUBMISSION) {
         LOG_ERROR("Esys called in bad sequence.");
         return TSS2_ESYS_RC_BAD_SEQUENCE;
     }
-    esysContext->state = _ESYS_STATE_INTERNALERROR;
 
     /* Allocate memory for response parameters */
     if (signature != NULL) {
@@ -277,6 +276,160 @@ Esys_Sign_Finish(
         }
     }
 
+    /* Receive the TPM response into the allocated memory */
+    r = Esys_Sign_Finish_Into(esysContext,
+                              (signature != NULL) ? *signature : NULL);
+    if (r != TSS2_RC_SUCCESS)
+        goto error_cleanup;
+
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    if (signature != NULL)
+        SAFE_FREE(*signature);
+
+    return r;
+}
+
+/** One-Call function for TPM2_Sign into caller-provided memory
+ *
+ * This function invokes the TPM2_Sign command in a one-call
+ * variant. This means the function will block until the TPM response is
+ * available. All input parameters are const. The output parameters are written
+ * to memory provided by the caller, so no memory is allocated for them.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[in]  keyHandle Handle of key that will perform signing.
+ * @param[in]  shandle1 Session handle for authorization of keyHandle
+ * @param[in]  shandle2 Second session handle.
+ * @param[in]  shandle3 Third session handle.
+ * @param[in]  digest Digest to be signed.
+ * @param[in]  inScheme TPM2_Signing scheme to use if the scheme for keyHandle is
+ *             TPM2_ALG_NULL.
+ * @param[in]  validation Proof that digest was created by the TPM.
+ * @param[out] signature The signature.
+ *             (caller-allocated)
+ * @retval TSS2_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *          at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM
+           did not verify.
+ * @retval TSS2_ESYS_RC_MULTIPLE_DECRYPT_SESSIONS: if more than one session has
+ *         the 'decrypt' attribute bit set.
+ * @retval TSS2_ESYS_RC_MULTIPLE_ENCRYPT_SESSIONS: if more than one session has
+ *         the 'encrypt' attribute bit set.
+ * @retval TSS2_ESYS_RC_BAD_TR: if any of the ESYS_TR objects are unknown
+ *         to the ESYS_CONTEXT or are of the wrong type or if required
+ *         ESYS_TR objects are ESYS_TR_NONE.
+ * @retval TSS2_ESYS_RC_NO_ENCRYPT_PARAM: if one of the sessions has the
+ *         'encrypt' attribute set and the command does not support encryption
+ *          of the first response parameter.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_Sign_Into(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR keyHandle,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    const TPM2B_DIGEST *digest,
+    const TPMT_SIG_SCHEME *inScheme,
+    const TPMT_TK_HASHCHECK *validation,
+    TPMT_SIGNATURE *signature)
+{
+    TSS2_RC r;
+
+    r = Esys_Sign_Async(esysContext, keyHandle, shandle1, shandle2, shandle3,
+                        digest, inScheme, validation);
+    return_if_error(r, "Error in async function");
+
+    /* Set the timeout to indefinite for now, since we want _Finish to block */
+    int32_t timeouttmp = esysContext->timeout;
+    esysContext->timeout = -1;
+    /*
+     * Now we call the finish function, until return code is not equal to
+     * from TSS2_BASE_RC_TRY_AGAIN.
+     * Note that the finish function may return TSS2_RC_TRY_AGAIN, even if we
+     * have set the timeout to -1. This occurs for example if the TPM requests
+     * a retransmission of the command via TPM2_RC_YIELDED.
+     */
+    do {
+        r = Esys_Sign_Finish_Into(esysContext, signature);
+        /* This is just debug information about the reattempt to finish the
+           command */
+        if (base_rc(r) == TSS2_BASE_RC_TRY_AGAIN)
+            LOG_DEBUG("A layer below returned TRY_AGAIN: %" PRIx32
+                      " => resubmitting command", r);
+    } while (base_rc(r) == TSS2_BASE_RC_TRY_AGAIN);
+
+    /* Restore the timeout value to the original value */
+    esysContext->timeout = timeouttmp;
+    return_if_error(r, "Esys Finish");
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Asynchronous finish function for TPM2_Sign into caller-provided memory
+ *
+ * This function returns the results of a TPM2_Sign command
+ * invoked via Esys_Sign_Async. The output parameters are written to memory
+ * provided by the caller, so no memory is allocated for them. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] signature The signature.
+ *             (caller-allocated)
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_Sign_Finish_Into(
+    ESYS_CONTEXT *esysContext,
+    TPMT_SIGNATURE *signature)
+{
+    TSS2_RC r;
+    LOG_TRACE("context=%p, signature=%p",
+              esysContext, signature);
+
+    if (esysContext == NULL) {
+        LOG_ERROR("esyscontext is NULL.");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    /* Check for correct sequence and set sequence to irregular for now */
+    if (esysContext->state != _ESYS_STATE_SENT &&
+        esysContext->state != _ESYS_STATE_RESUBMISSION) {
+        LOG_ERROR("Esys called in bad sequence.");
+        return TSS2_ESYS_RC_BAD_SEQUENCE;
+    }
+    esysContext->state = _ESYS_STATE_INTERNALERROR;
+
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if (base_rc(r) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -329,8 +482,7 @@ Esys_Sign_Finish(
      * After the verification of the response we call the complete function
      * to deliver the result.
      */
-    r = Tss2_Sys_Sign_Complete(esysContext->sys,
-                               (signature != NULL) ? *signature : NULL);
+    r = Tss2_Sys_Sign_Complete(esysContext->sys, signature);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -340,8 +492,5 @@ Esys_Sign_Finish(
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    if (signature != NULL)
-        SAFE_FREE(*signature);
-
     return r;
 }
@@ -0,0 +1,260 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
+#include "tss2_esys.h"
+
+#include "esys_cache.h"
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/** The number of buckets of the shared cache.
+ *
+ * TPMs only hold a few dozen persistent objects and NV indices, so the table
+ * is not resized. Must be a power of two.
+ */
+#define _ESYS_CACHE_BUCKETS 64
+
+/** An entry of the shared cache.
+ */
+typedef struct IESYS_CACHE_ENTRY IESYS_CACHE_ENTRY;
+struct IESYS_CACHE_ENTRY {
+    IESYS_RESOURCE rsrc;              /**< The metadata as read from the TPM. */
+    IESYS_CACHE_ENTRY *next;          /**< The next entry in the bucket. */
+};
+
+#if defined(_WIN32)
+static SRWLOCK cache_lock = SRWLOCK_INIT;
+#define CACHE_LOCK_SUPPORTED 1
+#define CACHE_RDLOCK() AcquireSRWLockShared(&cache_lock)
+#define CACHE_RDUNLOCK() ReleaseSRWLockShared(&cache_lock)
+#define CACHE_WRLOCK() AcquireSRWLockExclusive(&cache_lock)
+#define CACHE_WRUNLOCK() ReleaseSRWLockExclusive(&cache_lock)
+#elif defined(HAVE_PTHREAD_H)
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+#define CACHE_LOCK_SUPPORTED 1
+#define CACHE_RDLOCK() pthread_rwlock_rdlock(&cache_lock)
+#define CACHE_RDUNLOCK() pthread_rwlock_unlock(&cache_lock)
+#define CACHE_WRLOCK() pthread_rwlock_wrlock(&cache_lock)
+#define CACHE_WRUNLOCK() pthread_rwlock_unlock(&cache_lock)
+#else
+#define CACHE_LOCK_SUPPORTED 0
+#define CACHE_RDLOCK()
+#define CACHE_RDUNLOCK()
+#define CACHE_WRLOCK()
+#define CACHE_WRUNLOCK()
+#endif
+
+static IESYS_CACHE_ENTRY *cache_table[_ESYS_CACHE_BUCKETS];
+
+/* Incremented by every invalidation, see iesys_cache_generation() */
+static uint64_t cache_generation;
+
+static size_t
+cache_bucket(TPM2_HANDLE tpm_handle)
+{
+    return tpm_handle & (_ESYS_CACHE_BUCKETS - 1);
+}
+
+/** Check whether the shared cache can be used on this platform.
+ *
+ * Without a reader-writer lock the cache cannot be shared between threads
+ * and is therefore never used.
+ * @retval true if the cache is available.
+ */
+bool
+iesys_cache_supported(void)
+{
+    return CACHE_LOCK_SUPPORTED;
+}
+
+/** Check whether the metadata of a TPM handle may be cached.
+ *
+ * Only persistent objects and NV indices live longer than the ESYS_CONTEXT
+ * that loaded or created them and are known under the same handle to all
+ * contexts.
+ * @param tpm_handle [in] The TPM handle.
+ * @retval true if the handle is a persistent object or NV index.
+ */
+bool
+iesys_cache_handle_cacheable(TPM2_HANDLE tpm_handle)
+{
+    TPM2_HT type = tpm_handle >> TPM2_HR_SHIFT;
+
+    return type == TPM2_HT_PERSISTENT || type == TPM2_HT_NV_INDEX;
+}
+
+/** Look up the metadata of a TPM handle in the shared cache.
+ *
+ * @param tpm_handle [in] The TPM handle.
+ * @param rsrc [out] The cached metadata.
+ * @retval true if the handle was found.
+ */
+bool
+iesys_cache_get(TPM2_HANDLE tpm_handle, IESYS_RESOURCE *rsrc)
+{
+    IESYS_CACHE_ENTRY *entry;
+    bool found = false;
+
+    if (!CACHE_LOCK_SUPPORTED)
+        return false;
+
+    CACHE_RDLOCK();
+    for (entry = cache_table[cache_bucket(tpm_handle)]; entry != NULL;
+         entry = entry->next) {
+        if (entry->rsrc.handle == tpm_handle) {
+            *rsrc = entry->rsrc;
+            found = true;
+            break;
+        }
+    }
+    CACHE_RDUNLOCK();
+
+    LOG_DEBUG("Shared cache %s for handle 0x%08" PRIx32,
+              found ? "hit" : "miss", tpm_handle);
+    return found;
+}
+
+/** Get the invalidation generation of the shared cache.
+ *
+ * The generation is read before the metadata of a handle is requested from the
+ * TPM and passed to iesys_cache_put() once the response arrived. If the cache
+ * was invalidated in between, the response may predate the change and is not
+ * stored.
+ * @retval The current generation.
+ */
+uint64_t
+iesys_cache_generation(void)
+{
+    uint64_t generation;
+
+    CACHE_RDLOCK();
+    generation = cache_generation;
+    CACHE_RDUNLOCK();
+    return generation;
+}
+
+/** Store the metadata of a persistent object or NV index in the shared cache.
+ *
+ * An existing entry for the same TPM handle is replaced. Nothing is stored if
+ * the cache was invalidated since the metadata was requested. The cache is only
+ * an optimization, so a failed allocation is not reported.
+ * @param rsrc [in] The metadata read from the TPM.
+ * @param generation [in] The result of iesys_cache_generation() before the
+ *        metadata was requested.
+ */
+void
+iesys_cache_put(const IESYS_RESOURCE *rsrc, uint64_t generation)
+{
+    IESYS_CACHE_ENTRY **bucket, *entry;
+
+    if (!CACHE_LOCK_SUPPORTED || !iesys_cache_handle_cacheable(rsrc->handle))
+        return;
+
+    CACHE_WRLOCK();
+    if (generation != cache_generation) {
+        CACHE_WRUNLOCK();
+        LOG_DEBUG("Shared cache invalidated, handle 0x%08" PRIx32
+                  " not cached.", rsrc->handle);
+        return;
+    }
+    bucket = &cache_table[cache_bucket(rsrc->handle)];
+    for (entry = *bucket; entry != NULL; entry = entry->next) {
+        if (entry->rsrc.handle == rsrc->handle)
+            break;
+    }
+    if (entry == NULL) {
+        entry = calloc(1, sizeof(*entry));
+        if (entry == NULL) {
+            CACHE_WRUNLOCK();
+            LOG_WARNING("Out of memory, handle 0x%08" PRIx32 " not cached.",
+                        rsrc->handle);
+            return;
+        }
+        entry->next = *bucket;
+        *bucket = entry;
+    }
+    entry->rsrc = *rsrc;
+    CACHE_WRUNLOCK();
+}
+
+/** Remove the metadata of a TPM handle from the shared cache.
+ *
+ * Called whenever a command deletes a persistent object or NV index or changes
+ * its name. Pending reads of metadata are not cached afterwards, even if the
+ * handle itself is not cached.
+ * @param tpm_handle [in] The TPM handle.
+ */
+void
+iesys_cache_invalidate(TPM2_HANDLE tpm_handle)
+{
+    IESYS_CACHE_ENTRY **link, *entry;
+
+    if (!CACHE_LOCK_SUPPORTED || !iesys_cache_handle_cacheable(tpm_handle))
+        return;
+
+    CACHE_WRLOCK();
+    cache_generation++;
+    for (link = &cache_table[cache_bucket(tpm_handle)]; *link != NULL;
+         link = &(*link)->next) {
+        if ((*link)->rsrc.handle == tpm_handle) {
+            entry = *link;
+            *link = entry->next;
+            free(entry);
+            break;
+        }
+    }
+    CACHE_WRUNLOCK();
+}
+
+/** Remove a TPM handle from the shared cache.
+ *
+ * ESAPI invalidates cached metadata itself when a command of any ESYS_CONTEXT
+ * of the process evicts, undefines or modifies the object. This function must
+ * be called if another process may have done so, so that the next
+ * Esys_TR_FromTPMPublic reads the metadata from the TPM again.
+ * @param tpm_handle [in] The handle of the persistent object or NV index.
+ */
+void
+Esys_InvalidateSharedCache(TPM2_HANDLE tpm_handle)
+{
+    iesys_cache_invalidate(tpm_handle);
+}
+
+/** Remove all entries from the shared cache and free its memory.
+ */
+void
+Esys_ClearSharedCache(void)
+{
+    IESYS_CACHE_ENTRY *entry;
+    size_t i;
+
+    if (!CACHE_LOCK_SUPPORTED)
+        return;
+
+    CACHE_WRLOCK();
+    cache_generation++;
+    for (i = 0; i < _ESYS_CACHE_BUCKETS; i++) {
+        while (cache_table[i] != NULL) {
+            entry = cache_table[i];
+            cache_table[i] = entry->next;
+            free(entry);
+        }
+    }
+    CACHE_WRUNLOCK();
+}
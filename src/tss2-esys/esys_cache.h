@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+#ifndef ESYS_CACHE_H
+#define ESYS_CACHE_H
+
+#include <stdbool.h>
+#include "tss2_esys.h"
+
+#include "esys_int.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The process wide cache of the metadata of persistent objects and NV indices,
+ * shared by all ESYS_CONTEXTs that enabled it with Esys_SetSharedCache().
+ */
+
+bool iesys_cache_supported(void);
+
+bool iesys_cache_handle_cacheable(
+    TPM2_HANDLE tpm_handle);
+
+bool iesys_cache_get(
+    TPM2_HANDLE tpm_handle,
+    IESYS_RESOURCE *rsrc);
+
+uint64_t iesys_cache_generation(void);
+
+void iesys_cache_put(
+    const IESYS_RESOURCE *rsrc,
+    uint64_t generation);
+
+void iesys_cache_invalidate(
+    TPM2_HANDLE tpm_handle);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESYS_CACHE_H */
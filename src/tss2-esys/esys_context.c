@@ -12,6 +12,7 @@
 #include "tss2_esys.h"
 #include "tss2_tctildr.h"
 
+#include "esys_cache.h"
 #include "esys_iutil.h"
 #include "tss2-tcti/tctildr-interface.h"
 #define LOGMODULE esys
@@ -78,7 +79,7 @@ Esys_Initialize(ESYS_CONTEXT ** esys_context, TSS2_TCTI_CONTEXT * tcti,
     (*esys_context)->esys_handle_cnt = ESYS_TR_MIN_OBJECT + (rand() % 6000000);
 
     /* Initialize crypto backend. */
-    r = iesys_initialize_crypto();
+    r = iesys_initialize_crypto_backend(&(*esys_context)->crypto_backend, NULL);
     goto_if_error(r, "Initialize crypto backend.", cleanup_return);
 
     return TSS2_RC_SUCCESS;
@@ -118,6 +119,12 @@ Esys_Finalize(ESYS_CONTEXT ** esys_context)
     /* Flush from TPM and free all resource objects first */
     iesys_DeleteAllResourceObjects(*esys_context);
 
+    /* Release all blocks cached for reuse */
+    (*esys_context)->pool_size = 0;
+    iesys_pool_trim(*esys_context);
+
+    iesys_crypto_hash_cache_free(&(*esys_context)->hash_cache);
+
     /* If no tcti context was provided during initialization, then we need to
        finalize the tcti context. So we retrieve here before finalizing the
        SAPI context. */
@@ -220,6 +227,88 @@ Esys_SetTimeout(ESYS_CONTEXT * esys_context, int32_t timeout)
     return TSS2_RC_SUCCESS;
 }
 
+/** Set the size of the memory pool of an ESYS_CONTEXT.
+ *
+ * Resource objects and temporary structures used internally by the Esys
+ * commands are allocated for every command by default. If a pool size is set,
+ * up to poolSize freed blocks of each size are kept within the context and
+ * reused by subsequent commands, which avoids heap allocations for
+ * applications that continuously create and close objects or sessions.
+ * Memory returned to the application is not affected and still needs to be
+ * freed with Esys_Free().
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param poolSize [in] The maximum number of cached blocks per size or 0 to
+ *        disable the pool and free all cached blocks.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esysContext is NULL.
+ */
+TSS2_RC
+Esys_SetPoolSize(ESYS_CONTEXT * esys_context, size_t poolSize)
+{
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    esys_context->pool_size = poolSize;
+    iesys_pool_trim(esys_context);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Enable the shared metadata cache for an ESYS_CONTEXT.
+ *
+ * Esys_TR_FromTPMPublic reads the public area of a persistent object or NV
+ * index from the TPM and computes its name for every ESYS_CONTEXT. With the
+ * shared cache enabled, the metadata read by one context is kept in a process
+ * wide, reader-writer locked cache and later Esys_TR_FromTPMPublic calls
+ * without sessions on any context with the cache enabled are served from it
+ * without a TPM command. Calls with sessions always query the TPM, since they
+ * are used to verify the metadata, and refresh the cache.
+ * Cached entries are invalidated when a context of this process evicts,
+ * undefines or modifies the object. All contexts that enable the cache must
+ * talk to the same TPM; if other processes may change persistent objects or
+ * NV indices, Esys_InvalidateSharedCache has to be called accordingly.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param enable [in] Non-zero to use the shared cache, 0 to stop using it.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esysContext is NULL.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if the library was built without
+ *         support for reader-writer locks.
+ */
+TSS2_RC
+Esys_SetSharedCache(ESYS_CONTEXT * esys_context, uint8_t enable)
+{
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    if (enable && !iesys_cache_supported()) {
+        LOG_ERROR("Shared cache not supported on this platform.");
+        return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+    }
+    esys_context->shared_cache = enable ? 1 : 0;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Set the crypto callbacks of an ESYS_CONTEXT.
+ *
+ * By default the crypto library libtss2-esys was built with is used for the
+ * cpHash/rpHash and HMAC computations of sessions, key derivation, salt
+ * encryption and parameter encryption. This function replaces it with an
+ * implementation provided by the application, e.g. a hardware accelerated
+ * one. The callbacks are copied into the context; the userdata pointer is
+ * passed unchanged to every callback. If an init callback is provided it is
+ * invoked before this function returns.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param callbacks [in] The crypto callbacks or NULL to restore the built-in
+ *        crypto backend.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esysContext is NULL or a required
+ *         callback is missing.
+ * @retval TSS2_RCs returned by the init callback.
+ */
+TSS2_RC
+Esys_SetCryptoCallbacks(ESYS_CONTEXT * esys_context,
+                        ESYS_CRYPTO_CALLBACKS * callbacks)
+{
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    return iesys_initialize_crypto_backend(&esys_context->crypto_backend,
+                                           callbacks);
+}
+
 /** Helper function that returns sys contest from the give esys context.
  *
  * Function returns sys contest from the give esys context.
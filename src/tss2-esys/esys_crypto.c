@@ -9,6 +9,7 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 
 #include "tss2_esys.h"
 
@@ -60,12 +61,374 @@ iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t * size)
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * The default crypto callbacks forward to the backend libtss2-esys was built
+ * with.
+ */
+
+static TSS2_RC
+default_hash_start(ESYS_CRYPTO_CONTEXT_BLOB ** context, TPM2_ALG_ID hashAlg,
+                   void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_hash_start_internal(context, hashAlg);
+}
+
+static TSS2_RC
+default_hash_update(ESYS_CRYPTO_CONTEXT_BLOB * context, const uint8_t * buffer,
+                    size_t size, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_hash_update_internal(context, buffer, size);
+}
+
+static TSS2_RC
+default_hash_finish(ESYS_CRYPTO_CONTEXT_BLOB ** context, uint8_t * buffer,
+                    size_t * size, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_hash_finish_internal(context, buffer, size);
+}
+
+static void
+default_hash_abort(ESYS_CRYPTO_CONTEXT_BLOB ** context, void *userdata)
+{
+    UNUSED(userdata);
+    iesys_crypto_hash_abort_internal(context);
+}
+
+static TSS2_RC
+default_hmac_start(ESYS_CRYPTO_CONTEXT_BLOB ** context, TPM2_ALG_ID hashAlg,
+                   const uint8_t * key, size_t size, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_hmac_start_internal(context, hashAlg, key, size);
+}
+
+static TSS2_RC
+default_hmac_update(ESYS_CRYPTO_CONTEXT_BLOB * context, const uint8_t * buffer,
+                    size_t size, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_hmac_update_internal(context, buffer, size);
+}
+
+static TSS2_RC
+default_hmac_finish(ESYS_CRYPTO_CONTEXT_BLOB ** context, uint8_t * buffer,
+                    size_t * size, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_hmac_finish_internal(context, buffer, size);
+}
+
+static void
+default_hmac_abort(ESYS_CRYPTO_CONTEXT_BLOB ** context, void *userdata)
+{
+    UNUSED(userdata);
+    iesys_crypto_hmac_abort_internal(context);
+}
+
+static TSS2_RC
+default_get_random2b(TPM2B_NONCE * nonce, size_t num_bytes, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_random2b_internal(nonce, num_bytes);
+}
+
+static TSS2_RC
+default_get_ecdh_point(TPM2B_PUBLIC * key, size_t max_out_size,
+                       TPM2B_ECC_PARAMETER * Z, TPMS_ECC_POINT * Q,
+                       BYTE * out_buffer, size_t * out_size, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_get_ecdh_point_internal(key, max_out_size, Z, Q,
+                                                out_buffer, out_size);
+}
+
+static TSS2_RC
+default_aes_encrypt(uint8_t * key, TPM2_ALG_ID tpm_sym_alg,
+                    TPMI_AES_KEY_BITS key_bits, TPM2_ALG_ID tpm_mode,
+                    uint8_t * buffer, size_t buffer_size, uint8_t * iv,
+                    void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_sym_aes_encrypt_internal(key, tpm_sym_alg, key_bits,
+                                                 tpm_mode, buffer, buffer_size,
+                                                 iv);
+}
+
+static TSS2_RC
+default_aes_decrypt(uint8_t * key, TPM2_ALG_ID tpm_sym_alg,
+                    TPMI_AES_KEY_BITS key_bits, TPM2_ALG_ID tpm_mode,
+                    uint8_t * buffer, size_t buffer_size, uint8_t * iv,
+                    void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_sym_aes_decrypt_internal(key, tpm_sym_alg, key_bits,
+                                                 tpm_mode, buffer, buffer_size,
+                                                 iv);
+}
+
+static TSS2_RC
+default_rsa_pk_encrypt(TPM2B_PUBLIC * pub_tpm_key, size_t in_size,
+                       BYTE * in_buffer, size_t max_out_size,
+                       BYTE * out_buffer, size_t * out_size,
+                       const char *label, void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_pk_encrypt_internal(pub_tpm_key, in_size, in_buffer,
+                                            max_out_size, out_buffer, out_size,
+                                            label);
+}
+
+static TSS2_RC
+default_init(void *userdata)
+{
+    UNUSED(userdata);
+    return iesys_crypto_init_internal();
+}
+
+static const ESYS_CRYPTO_CALLBACKS default_callbacks = {
+    .rsa_pk_encrypt = default_rsa_pk_encrypt,
+    .hash_start = default_hash_start,
+    .hash_update = default_hash_update,
+    .hash_finish = default_hash_finish,
+    .hash_abort = default_hash_abort,
+    .hmac_start = default_hmac_start,
+    .hmac_update = default_hmac_update,
+    .hmac_finish = default_hmac_finish,
+    .hmac_abort = default_hmac_abort,
+    .get_random2b = default_get_random2b,
+    .get_ecdh_point = default_get_ecdh_point,
+    .aes_encrypt = default_aes_encrypt,
+    .aes_decrypt = default_aes_decrypt,
+    .init = default_init,
+    .userdata = NULL,
+};
+
+/** Set up the crypto callbacks of an ESYS_CONTEXT.
+ *
+ * The callbacks provided by the application are checked for completeness and
+ * copied, if user_cb is NULL the callbacks of the built-in backend are used.
+ * Afterwards the init callback is invoked if present.
+ * @param[out] crypto_cb The callbacks of the context.
+ * @param[in] user_cb The callbacks provided by the application (may be NULL).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a required callback is NULL.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if the backend can't be initialized.
+ */
+TSS2_RC
+iesys_initialize_crypto_backend(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                                const ESYS_CRYPTO_CALLBACKS * user_cb)
+{
+    if (user_cb == NULL) {
+        user_cb = &default_callbacks;
+    } else if (user_cb->rsa_pk_encrypt == NULL ||
+               user_cb->hash_start == NULL || user_cb->hash_update == NULL ||
+               user_cb->hash_finish == NULL || user_cb->hash_abort == NULL ||
+               user_cb->hmac_start == NULL || user_cb->hmac_update == NULL ||
+               user_cb->hmac_finish == NULL || user_cb->hmac_abort == NULL ||
+               user_cb->get_random2b == NULL ||
+               user_cb->get_ecdh_point == NULL ||
+               user_cb->aes_encrypt == NULL || user_cb->aes_decrypt == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Crypto callback missing");
+    }
+
+    if (user_cb->init != NULL) {
+        TSS2_RC r = user_cb->init(user_cb->userdata);
+        return_if_error(r, "Initialize crypto backend.");
+    }
+
+    *crypto_cb = *user_cb;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Start a hash computation with the crypto callbacks of a context.
+ *
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[out] context The created context (callee-allocated).
+ * @param[in] hashAlg The hash algorithm.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_* or callback specific errors on failure.
+ */
+TSS2_RC
+iesys_crypto_hash_start(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                        IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                        TPM2_ALG_ID hashAlg)
+{
+    return crypto_cb->hash_start(context, hashAlg, crypto_cb->userdata);
+}
+
+/** Update a hash computation with a byte buffer. */
+TSS2_RC
+iesys_crypto_hash_update(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                         IESYS_CRYPTO_CONTEXT_BLOB * context,
+                         const uint8_t * buffer, size_t size)
+{
+    return crypto_cb->hash_update(context, buffer, size, crypto_cb->userdata);
+}
+
+/** Update a hash computation with the content of a TPM2B. */
+TSS2_RC
+iesys_crypto_hash_update2b(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                           IESYS_CRYPTO_CONTEXT_BLOB * context, TPM2B * b)
+{
+    if (context == NULL || b == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    return crypto_cb->hash_update(context, &b->buffer[0], b->size,
+                                  crypto_cb->userdata);
+}
+
+/** Finish a hash computation and release its context. */
+TSS2_RC
+iesys_crypto_hash_finish(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                         IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                         uint8_t * buffer, size_t * size)
+{
+    return crypto_cb->hash_finish(context, buffer, size, crypto_cb->userdata);
+}
+
+/** Release the context of a hash computation. */
+void
+iesys_crypto_hash_abort(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                        IESYS_CRYPTO_CONTEXT_BLOB ** context)
+{
+    crypto_cb->hash_abort(context, crypto_cb->userdata);
+}
+
+/** Start an HMAC computation with the crypto callbacks of a context.
+ *
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[out] context The created context (callee-allocated).
+ * @param[in] hmacAlg The hash algorithm of the HMAC.
+ * @param[in] key The HMAC key.
+ * @param[in] size The size of the HMAC key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_* or callback specific errors on failure.
+ */
+TSS2_RC
+iesys_crypto_hmac_start(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                        IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                        TPM2_ALG_ID hmacAlg, const uint8_t * key, size_t size)
+{
+    return crypto_cb->hmac_start(context, hmacAlg, key, size,
+                                 crypto_cb->userdata);
+}
+
+/** Update an HMAC computation with a byte buffer. */
+TSS2_RC
+iesys_crypto_hmac_update(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                         IESYS_CRYPTO_CONTEXT_BLOB * context,
+                         const uint8_t * buffer, size_t size)
+{
+    return crypto_cb->hmac_update(context, buffer, size, crypto_cb->userdata);
+}
+
+/** Update an HMAC computation with the content of a TPM2B. */
+TSS2_RC
+iesys_crypto_hmac_update2b(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                           IESYS_CRYPTO_CONTEXT_BLOB * context, TPM2B * b)
+{
+    if (context == NULL || b == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    return crypto_cb->hmac_update(context, &b->buffer[0], b->size,
+                                  crypto_cb->userdata);
+}
+
+/** Finish an HMAC computation and release its context. */
+TSS2_RC
+iesys_crypto_hmac_finish(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                         IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                         uint8_t * buffer, size_t * size)
+{
+    return crypto_cb->hmac_finish(context, buffer, size, crypto_cb->userdata);
+}
+
+/** Finish an HMAC computation into a TPM2B and release its context. */
+TSS2_RC
+iesys_crypto_hmac_finish2b(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                           IESYS_CRYPTO_CONTEXT_BLOB ** context, TPM2B * b)
+{
+    if (context == NULL || *context == NULL || b == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    size_t s = b->size;
+    TSS2_RC r = crypto_cb->hmac_finish(context, &b->buffer[0], &s,
+                                       crypto_cb->userdata);
+    b->size = s;
+    return r;
+}
+
+/** Release the context of an HMAC computation. */
+void
+iesys_crypto_hmac_abort(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                        IESYS_CRYPTO_CONTEXT_BLOB ** context)
+{
+    crypto_cb->hmac_abort(context, crypto_cb->userdata);
+}
+
+/** Generate a random nonce with the crypto callbacks of a context. */
+TSS2_RC
+iesys_crypto_random2b(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                      TPM2B_NONCE * nonce, size_t num_bytes)
+{
+    return crypto_cb->get_random2b(nonce, num_bytes, crypto_cb->userdata);
+}
+
+/** RSA-OAEP encrypt a salt with the crypto callbacks of a context. */
+TSS2_RC
+iesys_crypto_pk_encrypt(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                        TPM2B_PUBLIC * key, size_t in_size, BYTE * in_buffer,
+                        size_t max_out_size, BYTE * out_buffer,
+                        size_t * out_size, const char *label)
+{
+    return crypto_cb->rsa_pk_encrypt(key, in_size, in_buffer, max_out_size,
+                                     out_buffer, out_size, label,
+                                     crypto_cb->userdata);
+}
+
+/** Compute an ephemeral ECDH point with the crypto callbacks of a context. */
+TSS2_RC
+iesys_crypto_get_ecdh_point(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                            TPM2B_PUBLIC * key, size_t max_out_size,
+                            TPM2B_ECC_PARAMETER * Z, TPMS_ECC_POINT * Q,
+                            BYTE * out_buffer, size_t * out_size)
+{
+    return crypto_cb->get_ecdh_point(key, max_out_size, Z, Q, out_buffer,
+                                     out_size, crypto_cb->userdata);
+}
+
+/** AES encrypt a buffer with the crypto callbacks of a context. */
+TSS2_RC
+iesys_crypto_sym_aes_encrypt(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                             uint8_t * key, TPM2_ALG_ID tpm_sym_alg,
+                             TPMI_AES_KEY_BITS key_bits, TPM2_ALG_ID tpm_mode,
+                             uint8_t * dst, size_t dst_size, uint8_t * iv)
+{
+    return crypto_cb->aes_encrypt(key, tpm_sym_alg, key_bits, tpm_mode, dst,
+                                  dst_size, iv, crypto_cb->userdata);
+}
+
+/** AES decrypt a buffer with the crypto callbacks of a context. */
+TSS2_RC
+iesys_crypto_sym_aes_decrypt(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                             uint8_t * key, TPM2_ALG_ID tpm_sym_alg,
+                             TPMI_AES_KEY_BITS key_bits, TPM2_ALG_ID tpm_mode,
+                             uint8_t * dst, size_t dst_size, uint8_t * iv)
+{
+    return crypto_cb->aes_decrypt(key, tpm_sym_alg, key_bits, tpm_mode, dst,
+                                  dst_size, iv, crypto_cb->userdata);
+}
+
 /** Compute the command or response parameter hash.
  *
  * These hashes are needed for the computation of the HMAC used for the
  * authorization of commands, or for the HMAC used for checking the responses.
  * The name parameters are only used for the command parameter hash (cp) and
  * must be NULL for the computation of the response parameter rp hash (rp).
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in] alg The hash algorithm.
  * @param[in] rcBuffer The response code in marshaled form.
  * @param[in] ccBuffer The command code in marshaled form.
@@ -74,13 +437,15 @@ iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t * size)
  * @param[in] pBuffer The byte buffer or the command or the response.
  * @param[in] pBuffer_size The size of the command or response.
  * @param[out] pHash The result digest.
- * @param[out] pHash_size The size of the result digest.
+ * @param[in,out] pHash_size The size of the result digest.
  * @retval TSS2_RC_SUCCESS on success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE if pHash is too small for the digest.
  */
 
 TSS2_RC
-iesys_crypto_pHash(TPM2_ALG_ID alg,
+iesys_crypto_pHash(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                   TPM2_ALG_ID alg,
                    const uint8_t rcBuffer[4],
                    const uint8_t ccBuffer[4],
                    const TPM2B_NAME * name1,
@@ -89,60 +454,177 @@ iesys_crypto_pHash(TPM2_ALG_ID alg,
                    const uint8_t * pBuffer,
                    size_t pBuffer_size, uint8_t * pHash, size_t * pHash_size)
 {
+    HASH_TAB_ITEM item = { .alg = alg };
+
     LOG_TRACE("called");
-    if (ccBuffer == NULL || pBuffer == NULL || pHash == NULL
-        || pHash_size == NULL) {
+    if (pHash == NULL || pHash_size == NULL) {
         LOG_ERROR("Null-Pointer passed");
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
 
-    IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext;
-
-    TSS2_RC r = iesys_crypto_hash_start(&cryptoContext, alg);
+    TSS2_RC r = iesys_crypto_pHash_tab(crypto_cb, NULL, rcBuffer, ccBuffer,
+                                       name1, name2, name3,
+                                       pBuffer, pBuffer_size, &item, 1);
     return_if_error(r, "Error");
 
-    if (rcBuffer != NULL) {
-        r = iesys_crypto_hash_update(cryptoContext, &rcBuffer[0], 4);
-        goto_if_error(r, "Error", error);
+    if (*pHash_size < item.size) {
+        LOG_ERROR("Buffer too small (%zu < %zu)", *pHash_size, item.size);
+        return TSS2_ESYS_RC_BAD_SIZE;
     }
+    memcpy(pHash, &item.digest[0], item.size);
+    *pHash_size = item.size;
+    return TSS2_RC_SUCCESS;
+}
 
-    r = iesys_crypto_hash_update(cryptoContext, &ccBuffer[0], 4);
-    goto_if_error(r, "Error", error);
+/*
+ * The parameter area is fed to the hash contexts in slices of this size,
+ * round robin, so that a large buffer is streamed through the cache once
+ * no matter how many digests are computed over it.
+ */
+#define PHASH_SLICE_SIZE 4096
 
-    if (name1 != NULL) {
-        r = iesys_crypto_hash_update2b(cryptoContext, (TPM2B *) name1);
-        goto_if_error(r, "Error", error);
+/** Start a digest computation with a context kept in *hashCache.
+ *
+ * The context cache is a feature of the built-in backend; with crypto
+ * callbacks provided by the application every digest gets a new context.
+ */
+static TSS2_RC
+hash_start_cached(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                  IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                  IESYS_CRYPTO_HASH_CACHE ** hashCache,
+                  TPM2_ALG_ID alg)
+{
+    if (crypto_cb->hash_start == default_hash_start)
+        return iesys_crypto_hash_start_cached(context, hashCache, alg);
+    return iesys_crypto_hash_start(crypto_cb, context, alg);
+}
+
+/** Compute the command or response parameter hash for several algorithms.
+ *
+ * The same data as for iesys_crypto_pHash() is hashed with every algorithm
+ * listed in pHash_tab in a single pass over the parameter buffer.
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[in,out] hashCache The digest contexts kept for reuse (may be NULL).
+ * @param[in] rcBuffer The response code in marshaled form.
+ * @param[in] ccBuffer The command code in marshaled form.
+ * @param[in] name1, name2, name3 The names associated with the corresponding
+ *            handle. Must be NULL if no handle is passed.
+ * @param[in] pBuffer The byte buffer or the command or the response.
+ * @param[in] pBuffer_size The size of the command or response.
+ * @param[in,out] pHash_tab The table of digests. The alg member of each entry
+ *            selects the hash algorithm, size and digest are set on success.
+ * @param[in] pHashNum The number of entries in pHash_tab
+ *            (at most HASH_TAB_MAX).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if pHashNum is too large.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if a hash algorithm is not implemented.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_crypto_pHash_tab(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                       IESYS_CRYPTO_HASH_CACHE ** hashCache,
+                       const uint8_t rcBuffer[4],
+                       const uint8_t ccBuffer[4],
+                       const TPM2B_NAME * name1,
+                       const TPM2B_NAME * name2,
+                       const TPM2B_NAME * name3,
+                       const uint8_t * pBuffer,
+                       size_t pBuffer_size,
+                       HASH_TAB_ITEM * pHash_tab,
+                       size_t pHashNum)
+{
+    IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext[HASH_TAB_MAX] = { NULL };
+    const TPM2B_NAME *names[] = { name1, name2, name3 };
+    size_t i, j, offset, slice;
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    LOG_TRACE("called");
+    if (ccBuffer == NULL || pBuffer == NULL || pHash_tab == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    if (pHashNum > HASH_TAB_MAX) {
+        LOG_ERROR("Too many hash algorithms (%zu)", pHashNum);
+        return TSS2_ESYS_RC_BAD_VALUE;
     }
 
-    if (name2 != NULL) {
-        r = iesys_crypto_hash_update2b(cryptoContext, (TPM2B *) name2);
+    for (i = 0; i < pHashNum; i++) {
+        r = hash_start_cached(crypto_cb, &cryptoContext[i], hashCache,
+                              pHash_tab[i].alg);
         goto_if_error(r, "Error", error);
-    }
 
-    if (name3 != NULL) {
-        r = iesys_crypto_hash_update2b(cryptoContext, (TPM2B *) name3);
+        if (rcBuffer != NULL) {
+            r = iesys_crypto_hash_update(crypto_cb, cryptoContext[i],
+                                         &rcBuffer[0], 4);
+            goto_if_error(r, "Error", error);
+        }
+
+        r = iesys_crypto_hash_update(crypto_cb, cryptoContext[i],
+                                     &ccBuffer[0], 4);
         goto_if_error(r, "Error", error);
+
+        for (j = 0; j < sizeof(names) / sizeof(names[0]); j++) {
+            if (names[j] == NULL)
+                continue;
+            r = iesys_crypto_hash_update2b(crypto_cb, cryptoContext[i],
+                                           (TPM2B *) names[j]);
+            goto_if_error(r, "Error", error);
+        }
     }
 
-    r = iesys_crypto_hash_update(cryptoContext, pBuffer, pBuffer_size);
-    goto_if_error(r, "Error", error);
+    for (offset = 0; offset < pBuffer_size; offset += slice) {
+        slice = pBuffer_size - offset;
+        if (slice > PHASH_SLICE_SIZE)
+            slice = PHASH_SLICE_SIZE;
+        for (i = 0; i < pHashNum; i++) {
+            r = iesys_crypto_hash_update(crypto_cb, cryptoContext[i],
+                                         &pBuffer[offset], slice);
+            goto_if_error(r, "Error", error);
+        }
+    }
 
-    r = iesys_crypto_hash_finish(&cryptoContext, pHash, pHash_size);
-    goto_if_error(r, "Error", error);
+    for (i = 0; i < pHashNum; i++) {
+        pHash_tab[i].size = sizeof(pHash_tab[i].digest);
+        r = iesys_crypto_hash_finish(crypto_cb, &cryptoContext[i],
+                                     &pHash_tab[i].digest[0],
+                                     &pHash_tab[i].size);
+        goto_if_error(r, "Error", error);
+    }
 
     return r;
 
  error:
-    iesys_crypto_hash_abort(&cryptoContext);
+    for (i = 0; i < pHashNum; i++)
+        iesys_crypto_hash_abort(crypto_cb, &cryptoContext[i]);
     return r;
 }
 
+/** Start an HMAC computation, reusing the keying kept in *hmacCache.
+ *
+ * The keyed context cache is a feature of the built-in backend; with crypto
+ * callbacks provided by the application every HMAC is keyed anew.
+ */
+static TSS2_RC
+hmac_start_cached(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                  IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                  IESYS_CRYPTO_HMAC_CACHE ** hmacCache,
+                  TPM2_ALG_ID alg, const uint8_t * key, size_t size)
+{
+    if (crypto_cb->hmac_start == default_hmac_start)
+        return iesys_crypto_hmac_start_cached(context, hmacCache, alg, key,
+                                              size);
+    return iesys_crypto_hmac_start(crypto_cb, context, alg, key, size);
+}
+
 /** Compute the HMAC for authorization.
  *
  * Based on the session nonces, caller nonce, TPM nonce, if used encryption and
  * decryption nonce, the command parameter hash, and the session attributes the
  * HMAC used for authorization is computed.
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in] alg The hash algorithm used for HMAC computation.
+ * @param[in,out] hmacCache The keyed HMAC cache of the session (may be NULL).
  * @param[in] hmacKey The HMAC key byte buffer.
  * @param[in] hmacKeySize The size of the HMAC key byte buffer.
  * @param[in] pHash The command parameter hash byte buffer.
@@ -158,7 +640,9 @@ iesys_crypto_pHash(TPM2_ALG_ID alg,
  * @retval TSS2_ESYS_RC_BAD_REFERENCE If a pointer is invalid.
  */
 TSS2_RC
-iesys_crypto_authHmac(TPM2_ALG_ID alg,
+iesys_crypto_authHmac(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                      TPM2_ALG_ID alg,
+                      IESYS_CRYPTO_HMAC_CACHE ** hmacCache,
                       uint8_t * hmacKey, size_t hmacKeySize,
                       const uint8_t * pHash,
                       size_t pHash_size,
@@ -180,26 +664,30 @@ iesys_crypto_authHmac(TPM2_ALG_ID alg,
 
     IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext;
 
-    TSS2_RC r =
-        iesys_crypto_hmac_start(&cryptoContext, alg, hmacKey, hmacKeySize);
+    TSS2_RC r = hmac_start_cached(crypto_cb, &cryptoContext, hmacCache, alg,
+                                  hmacKey, hmacKeySize);
     return_if_error(r, "Error");
 
-    r = iesys_crypto_hmac_update(cryptoContext, pHash, pHash_size);
+    r = iesys_crypto_hmac_update(crypto_cb, cryptoContext, pHash, pHash_size);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceNewer);
+    r = iesys_crypto_hmac_update2b(crypto_cb, cryptoContext,
+                                   (TPM2B *) nonceNewer);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceOlder);
+    r = iesys_crypto_hmac_update2b(crypto_cb, cryptoContext,
+                                   (TPM2B *) nonceOlder);
     goto_if_error(r, "Error", error);
 
     if (nonceDecrypt != NULL) {
-        r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceDecrypt);
+        r = iesys_crypto_hmac_update2b(crypto_cb, cryptoContext,
+                                       (TPM2B *) nonceDecrypt);
         goto_if_error(r, "Error", error);
     }
 
     if (nonceEncrypt != NULL) {
-        r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceEncrypt);
+        r = iesys_crypto_hmac_update2b(crypto_cb, cryptoContext,
+                                       (TPM2B *) nonceEncrypt);
         goto_if_error(r, "Error", error);
     }
 
@@ -209,17 +697,17 @@ iesys_crypto_authHmac(TPM2_ALG_ID alg,
                                      &sessionAttribs_size);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_update(cryptoContext, &sessionAttribs[0],
+    r = iesys_crypto_hmac_update(crypto_cb, cryptoContext, &sessionAttribs[0],
                                  sessionAttribs_size);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_finish2b(&cryptoContext, (TPM2B *) hmac);
+    r = iesys_crypto_hmac_finish2b(crypto_cb, &cryptoContext, (TPM2B *) hmac);
     goto_if_error(r, "Error", error);
 
     return r;
 
  error:
-    iesys_crypto_hmac_abort(&cryptoContext);
+    iesys_crypto_hmac_abort(crypto_cb, &cryptoContext);
     return r;
 
 }
@@ -228,7 +716,10 @@ iesys_crypto_authHmac(TPM2_ALG_ID alg,
  * HMAC computation for inner loop of KDFa key derivation.
  *
  * Except of ECDH this function is used for key derivation.
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in] alg The algorithm used for the HMAC.
+ * @param[in,out] hmacCache The keyed HMAC cache of the KDFa computation (may
+ *                be NULL).
  * @param[in] hmacKey The hmacKey used in KDFa.
  * @param[in] hmacKeySize The size of the HMAC key.
  * @param[in] counter The curren iteration step.
@@ -242,7 +733,9 @@ iesys_crypto_authHmac(TPM2_ALG_ID alg,
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
  */
 TSS2_RC
-iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
+iesys_crypto_KDFaHmac(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                      TPM2_ALG_ID alg,
+                      IESYS_CRYPTO_HMAC_CACHE ** hmacCache,
                       uint8_t * hmacKey,
                       size_t hmacKeySize,
                       uint32_t counter,
@@ -262,49 +755,60 @@ iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
 
     IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext;
 
-    TSS2_RC r =
-        iesys_crypto_hmac_start(&cryptoContext, alg, hmacKey, hmacKeySize);
+    TSS2_RC r = hmac_start_cached(crypto_cb, &cryptoContext, hmacCache, alg,
+                                  hmacKey, hmacKeySize);
     return_if_error(r, "Error");
 
     r = Tss2_MU_UINT32_Marshal(counter, &buffer32[0], sizeof(UINT32),
                                &buffer32_size);
     goto_if_error(r, "Marsahling", error);
-    r = iesys_crypto_hmac_update(cryptoContext, &buffer32[0], buffer32_size);
+    r = iesys_crypto_hmac_update(crypto_cb, cryptoContext, &buffer32[0],
+                                 buffer32_size);
     goto_if_error(r, "HMAC-Update", error);
 
     if (label != NULL) {
         size_t lsize = strlen(label) + 1;
-        r = iesys_crypto_hmac_update(cryptoContext, (uint8_t *) label, lsize);
+        r = iesys_crypto_hmac_update(crypto_cb, cryptoContext,
+                                     (uint8_t *) label, lsize);
         goto_if_error(r, "Error", error);
     }
 
-    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) contextU);
+    r = iesys_crypto_hmac_update2b(crypto_cb, cryptoContext,
+                                   (TPM2B *) contextU);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) contextV);
+    r = iesys_crypto_hmac_update2b(crypto_cb, cryptoContext,
+                                   (TPM2B *) contextV);
     goto_if_error(r, "Error", error);
 
     buffer32_size = 0;
     r = Tss2_MU_UINT32_Marshal(bitlength, &buffer32[0], sizeof(UINT32),
                                &buffer32_size);
     goto_if_error(r, "Marsahling", error);
-    r = iesys_crypto_hmac_update(cryptoContext, &buffer32[0], buffer32_size);
+    r = iesys_crypto_hmac_update(crypto_cb, cryptoContext, &buffer32[0],
+                                 buffer32_size);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_finish(&cryptoContext, hmac, hmacSize);
+    r = iesys_crypto_hmac_finish(crypto_cb, &cryptoContext, hmac, hmacSize);
     goto_if_error(r, "Error", error);
 
     return r;
 
  error:
-    iesys_crypto_hmac_abort(&cryptoContext);
+    iesys_crypto_hmac_abort(crypto_cb, &cryptoContext);
     return r;
 }
 
 /**
  * KDFa Key derivation.
  *
- * Except of ECDH this function is used for key derivation.
+ * Except of ECDH this function is used for key derivation. If hmacCache is
+ * not NULL the HMAC key is processed once and the keyed state is reused for
+ * every counter value instead of keying a new HMAC per output block.
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[in,out] hmacCache The keyed HMAC cache (may be NULL). It is
+ *                created on first use and must be released with
+ *                iesys_crypto_hmac_cache_free().
  * @param[in] hashAlg The hash algorithm to use.
  * @param[in] hmacKey The hmacKey used in KDFa.
  * @param[in] hmacKeySize The size of the HMAC key.
@@ -323,16 +827,18 @@ iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
  * @retval TSS2_ESYS_RC_BAD_VALUE if hashAlg is unknown or unsupported.
  */
 TSS2_RC
-iesys_crypto_KDFa(TPM2_ALG_ID hashAlg,
-                  uint8_t * hmacKey,
-                  size_t hmacKeySize,
-                  const char *label,
-                  TPM2B_NONCE * contextU,
-                  TPM2B_NONCE * contextV,
-                  uint32_t bitLength,
-                  uint32_t * counterInOut,
-                  BYTE * outKey,
-                  BOOL use_digest_size)
+iesys_crypto_KDFa_cached(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                         IESYS_CRYPTO_HMAC_CACHE ** hmacCache,
+                         TPM2_ALG_ID hashAlg,
+                         uint8_t * hmacKey,
+                         size_t hmacKeySize,
+                         const char *label,
+                         TPM2B_NONCE * contextU,
+                         TPM2B_NONCE * contextV,
+                         uint32_t bitLength,
+                         uint32_t * counterInOut,
+                         BYTE * outKey,
+                         BOOL use_digest_size)
 {
     LOG_DEBUG("IESYS KDFa hmac key hashAlg: %i label: %s bitLength: %i",
               hashAlg, label, bitLength);
@@ -361,7 +867,7 @@ iesys_crypto_KDFa(TPM2_ALG_ID hashAlg,
         //if(bytes < (INT32)hlen)
         //    hlen = bytes;
         counter++;
-        r = iesys_crypto_KDFaHmac(hashAlg, hmacKey,
+        r = iesys_crypto_KDFaHmac(crypto_cb, hashAlg, hmacCache, hmacKey,
                                   hmacKeySize, counter, label, contextU,
                                   contextV, bitLength, &subKey[0], &hlen);
         return_if_error(r, "Error");
@@ -374,8 +880,59 @@ iesys_crypto_KDFa(TPM2_ALG_ID hashAlg,
     return TPM2_RC_SUCCESS;
 }
 
+/**
+ * KDFa Key derivation.
+ *
+ * See iesys_crypto_KDFa_cached(). If more than one output block is needed the
+ * keyed HMAC state is reused for all of them.
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[in] hashAlg The hash algorithm to use.
+ * @param[in] hmacKey The hmacKey used in KDFa.
+ * @param[in] hmacKeySize The size of the HMAC key.
+ * @param[in] label Indicates the use of the produced key.
+ * @param[in] contextU, contextV are used for construction of a binary string
+ *            containing information related to the derived key.
+ * @param[in] bitLength The size of generated key in bits.
+ * @param[in,out] counterInOut Counter for the KDFa iterations.
+ * @param[out] outKey Byte buffer for the derived key (caller-allocated).
+ * @param[in] use_digest_size Indicate whether the digest size of hashAlg is
+ *            used as size of the generated key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if hashAlg is unknown or unsupported.
+ */
+TSS2_RC
+iesys_crypto_KDFa(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                  TPM2_ALG_ID hashAlg,
+                  uint8_t * hmacKey,
+                  size_t hmacKeySize,
+                  const char *label,
+                  TPM2B_NONCE * contextU,
+                  TPM2B_NONCE * contextV,
+                  uint32_t bitLength,
+                  uint32_t * counterInOut,
+                  BYTE * outKey,
+                  BOOL use_digest_size)
+{
+    IESYS_CRYPTO_HMAC_CACHE *hmacCache = NULL;
+    size_t hlen = 0;
+
+    TSS2_RC r = iesys_crypto_hash_get_digest_size(hashAlg, &hlen);
+    return_if_error(r, "Error");
+
+    /* A single block does not profit from keeping the keyed state. */
+    BOOL cache = !use_digest_size && (bitLength + 7) / 8 > hlen;
+
+    r = iesys_crypto_KDFa_cached(crypto_cb, cache ? &hmacCache : NULL,
+                                 hashAlg, hmacKey, hmacKeySize, label,
+                                 contextU, contextV, bitLength, counterInOut,
+                                 outKey, use_digest_size);
+    iesys_crypto_hmac_cache_free(&hmacCache);
+    return r;
+}
+
 /** Compute KDFe as described in TPM spec part 1 C 6.1
  *
+ * @param crypto_cb [in] The crypto callbacks.
  * @param hashAlg [in] The nameAlg of the recipient key.
  * @param Z [in] the x coordinate (xP) of the product (P) of a public point and a
  *       private key.
@@ -389,7 +946,8 @@ iesys_crypto_KDFa(TPM2_ALG_ID hashAlg,
  * @retval TSS2_ESYS_RC_MEMORY Memory cannot be allocated.
  */
 TSS2_RC
-iesys_crypto_KDFe(TPM2_ALG_ID hashAlg,
+iesys_crypto_KDFe(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                  TPM2_ALG_ID hashAlg,
                   TPM2B_ECC_PARAMETER *Z,
                   const char *label,
                   TPM2B_ECC_PARAMETER *partyUInfo,
@@ -424,37 +982,43 @@ iesys_crypto_KDFe(TPM2_ALG_ID hashAlg,
     for (; byte_size > 0; stream = &stream[hash_len], byte_size = byte_size - hash_len)
         {
             counter ++;
-            r = iesys_crypto_hash_start(&cryptoContext, hashAlg);
+            r = iesys_crypto_hash_start(crypto_cb, &cryptoContext, hashAlg);
             return_if_error(r, "Error hash start");
 
             offset = 0;
             r = Tss2_MU_UINT32_Marshal(counter, &counter_buffer[0], 4, &offset);
             goto_if_error(r, "Error marshaling counter", error);
 
-            r = iesys_crypto_hash_update(cryptoContext, &counter_buffer[0], 4);
+            r = iesys_crypto_hash_update(crypto_cb, cryptoContext,
+                                         &counter_buffer[0], 4);
             goto_if_error(r, "Error hash update", error);
 
             if (Z != NULL) {
-                r = iesys_crypto_hash_update2b(cryptoContext, (TPM2B *) Z);
+                r = iesys_crypto_hash_update2b(crypto_cb, cryptoContext,
+                                               (TPM2B *) Z);
                 goto_if_error(r, "Error hash update2b", error);
             }
 
             if (label != NULL) {
                 size_t lsize = strlen(label) + 1;
-                r = iesys_crypto_hash_update(cryptoContext, (uint8_t *) label, lsize);
+                r = iesys_crypto_hash_update(crypto_cb, cryptoContext,
+                                             (uint8_t *) label, lsize);
                 goto_if_error(r, "Error hash update", error);
             }
 
             if (partyUInfo != NULL) {
-                r = iesys_crypto_hash_update2b(cryptoContext, (TPM2B *) partyUInfo);
+                r = iesys_crypto_hash_update2b(crypto_cb, cryptoContext,
+                                               (TPM2B *) partyUInfo);
                 goto_if_error(r, "Error hash update2b", error);
             }
 
             if (partyVInfo != NULL) {
-                r = iesys_crypto_hash_update2b(cryptoContext,  (TPM2B *) partyVInfo);
+                r = iesys_crypto_hash_update2b(crypto_cb, cryptoContext,
+                                               (TPM2B *) partyVInfo);
                goto_if_error(r, "Error hash update2b", error);
             }
-            r = iesys_crypto_hash_finish(&cryptoContext, (uint8_t *) stream, &hash_len);
+            r = iesys_crypto_hash_finish(crypto_cb, &cryptoContext,
+                                         (uint8_t *) stream, &hash_len);
             goto_if_error(r, "Error", error);
         }
     LOGBLOB_DEBUG(key, bit_size/8, "Result KDFe");
@@ -463,7 +1027,7 @@ iesys_crypto_KDFe(TPM2_ALG_ID hashAlg,
     return r;
 
  error:
-    iesys_crypto_hmac_abort(&cryptoContext);
+    iesys_crypto_hash_abort(crypto_cb, &cryptoContext);
     return r;
 }
 
@@ -472,6 +1036,7 @@ iesys_crypto_KDFe(TPM2_ALG_ID hashAlg,
  * The application of this function to data encrypted with this function will
  * produce the origin data. The key for XOR obfuscation will be derived with
  * KDFa form the passed key the session nonces, and the hash algorithm.
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in] hash_alg The algorithm used for key derivation.
  * @param[in] key key used for obfuscation
  * @param[in] key_size Key size in bits.
@@ -484,7 +1049,8 @@ iesys_crypto_KDFe(TPM2_ALG_ID hashAlg,
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
  */
 TSS2_RC
-iesys_xor_parameter_obfuscation(TPM2_ALG_ID hash_alg,
+iesys_xor_parameter_obfuscation(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                                TPM2_ALG_ID hash_alg,
                                 uint8_t *key,
                                 size_t key_size,
                                 TPM2B_NONCE * contextU,
@@ -493,6 +1059,7 @@ iesys_xor_parameter_obfuscation(TPM2_ALG_ID hash_alg,
                                 size_t data_size)
 {
     TSS2_RC r;
+    IESYS_CRYPTO_HMAC_CACHE *hmacCache = NULL;
     uint32_t counter = 0;
     BYTE  kdfa_result[TPM2_MAX_DIGEST_BUFFER];
     size_t digest_size;
@@ -508,11 +1075,14 @@ iesys_xor_parameter_obfuscation(TPM2_ALG_ID hash_alg,
 
     r = iesys_crypto_hash_get_digest_size(hash_alg, &digest_size);
     return_if_error(r, "Hash alg not supported");
+    /* Key the HMAC once for all blocks of the XOR mask. */
     while(rest_size > 0) {
-        r = iesys_crypto_KDFa(hash_alg, key, key_size, "XOR",
-                              contextU, contextV, data_size_bits, &counter,
-                              kdfa_result, TRUE);
-        return_if_error(r, "iesys_crypto_KDFa failed");
+        r = iesys_crypto_KDFa_cached(crypto_cb,
+                                     data_size > digest_size ? &hmacCache : NULL,
+                                     hash_alg, key, key_size, "XOR",
+                                     contextU, contextV, data_size_bits,
+                                     &counter, kdfa_result, TRUE);
+        goto_if_error(r, "iesys_crypto_KDFa failed", cleanup);
         /* XOR next data sub block with KDFa result  */
         kdfa_byte_ptr = kdfa_result;
         LOGBLOB_TRACE(data_start, data_size, "Parameter data before XOR");
@@ -522,18 +1092,8 @@ iesys_xor_parameter_obfuscation(TPM2_ALG_ID hash_alg,
         LOGBLOB_TRACE(data_start, data_size, "Parameter data after XOR");
         rest_size = rest_size < digest_size ? 0 : rest_size - digest_size;
     }
-    return TSS2_RC_SUCCESS;
-}
-
 
-/** Initialize crypto backend.
- *
- * Initialize internal tables of crypto backend.
- *
- * @retval TSS2_RC_SUCCESS ong success.
- * @retval TSS2_ESYS_RC_GENERAL_FAILURE if backend can't be initialized.
- */
-TSS2_RC
-iesys_initialize_crypto() {
-    return iesys_crypto_init();
+ cleanup:
+    iesys_crypto_hmac_cache_free(&hmacCache);
+    return r;
 }
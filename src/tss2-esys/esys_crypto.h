@@ -23,9 +23,127 @@ extern "C" {
 
 #define AES_BLOCK_SIZE_IN_BYTES 16
 
+/** An entry in a cpHash or rpHash table. */
+typedef struct {
+    TPM2_ALG_ID alg;                 /**< The hash algorithm. */
+    size_t size;                     /**< The digest size. */
+    uint8_t digest[sizeof(TPMU_HA)]; /**< The digest. */
+} HASH_TAB_ITEM;
+
+/** The maximum number of entries in a cpHash or rpHash table. */
+#define HASH_TAB_MAX 3
+
 TSS2_RC iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t *size);
 
+TSS2_RC iesys_initialize_crypto_backend(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    const ESYS_CRYPTO_CALLBACKS *user_cb);
+
+TSS2_RC iesys_crypto_hash_start(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    TPM2_ALG_ID hashAlg);
+
+TSS2_RC iesys_crypto_hash_update(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB *context,
+    const uint8_t *buffer,
+    size_t size);
+
+TSS2_RC iesys_crypto_hash_update2b(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB *context,
+    TPM2B *b);
+
+TSS2_RC iesys_crypto_hash_finish(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    uint8_t *buffer,
+    size_t *size);
+
+void iesys_crypto_hash_abort(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB **context);
+
+TSS2_RC iesys_crypto_hmac_start(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    TPM2_ALG_ID hmacAlg,
+    const uint8_t *key,
+    size_t size);
+
+TSS2_RC iesys_crypto_hmac_update(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB *context,
+    const uint8_t *buffer,
+    size_t size);
+
+TSS2_RC iesys_crypto_hmac_update2b(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB *context,
+    TPM2B *b);
+
+TSS2_RC iesys_crypto_hmac_finish(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    uint8_t *buffer,
+    size_t *size);
+
+TSS2_RC iesys_crypto_hmac_finish2b(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    TPM2B *b);
+
+void iesys_crypto_hmac_abort(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_CONTEXT_BLOB **context);
+
+TSS2_RC iesys_crypto_random2b(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    TPM2B_NONCE *nonce,
+    size_t num_bytes);
+
+TSS2_RC iesys_crypto_pk_encrypt(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    TPM2B_PUBLIC *key,
+    size_t in_size,
+    BYTE *in_buffer,
+    size_t max_out_size,
+    BYTE *out_buffer,
+    size_t *out_size,
+    const char *label);
+
+TSS2_RC iesys_crypto_get_ecdh_point(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    TPM2B_PUBLIC *key,
+    size_t max_out_size,
+    TPM2B_ECC_PARAMETER *Z,
+    TPMS_ECC_POINT *Q,
+    BYTE *out_buffer,
+    size_t *out_size);
+
+TSS2_RC iesys_crypto_sym_aes_encrypt(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    uint8_t *key,
+    TPM2_ALG_ID tpm_sym_alg,
+    TPMI_AES_KEY_BITS key_bits,
+    TPM2_ALG_ID tpm_mode,
+    uint8_t *dst,
+    size_t dst_size,
+    uint8_t *iv);
+
+TSS2_RC iesys_crypto_sym_aes_decrypt(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    uint8_t *key,
+    TPM2_ALG_ID tpm_sym_alg,
+    TPMI_AES_KEY_BITS key_bits,
+    TPM2_ALG_ID tpm_mode,
+    uint8_t *dst,
+    size_t dst_size,
+    uint8_t *iv);
+
 TSS2_RC iesys_crypto_pHash(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2_ALG_ID alg,
     const uint8_t rcBuffer[4],
     const uint8_t ccBuffer[4],
@@ -37,18 +155,33 @@ TSS2_RC iesys_crypto_pHash(
     uint8_t *pHash,
     size_t *pHash_size);
 
-#define iesys_crypto_cpHash(alg, ccBuffer, name1, name2, name3, \
+TSS2_RC iesys_crypto_pHash_tab(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_HASH_CACHE **hashCache,
+    const uint8_t rcBuffer[4],
+    const uint8_t ccBuffer[4],
+    const TPM2B_NAME *name1,
+    const TPM2B_NAME *name2,
+    const TPM2B_NAME *name3,
+    const uint8_t *pBuffer,
+    size_t pBuffer_size,
+    HASH_TAB_ITEM *pHash_tab,
+    size_t pHashNum);
+
+#define iesys_crypto_cpHash(crypto_cb, alg, ccBuffer, name1, name2, name3, \
                             cpBuffer, cpBuffer_size, cpHash, cpHash_size) \
-        iesys_crypto_pHash(alg, NULL, ccBuffer, name1, name2, name3, cpBuffer, \
-                           cpBuffer_size, cpHash, cpHash_size)
-#define iesys_crypto_rpHash(alg, rcBuffer, ccBuffer, rpBuffer, rpBuffer_size, \
-                            rpHash, rpHash_size)                        \
-        iesys_crypto_pHash(alg, rcBuffer, ccBuffer, NULL, NULL, NULL, rpBuffer, \
-                           rpBuffer_size, rpHash, rpHash_size)
+        iesys_crypto_pHash(crypto_cb, alg, NULL, ccBuffer, name1, name2, name3, \
+                           cpBuffer, cpBuffer_size, cpHash, cpHash_size)
+#define iesys_crypto_rpHash(crypto_cb, alg, rcBuffer, ccBuffer, rpBuffer, \
+                            rpBuffer_size, rpHash, rpHash_size)         \
+        iesys_crypto_pHash(crypto_cb, alg, rcBuffer, ccBuffer, NULL, NULL, NULL, \
+                           rpBuffer, rpBuffer_size, rpHash, rpHash_size)
 
 
 TSS2_RC iesys_crypto_authHmac(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2_ALG_ID alg,
+    IESYS_CRYPTO_HMAC_CACHE **hmacCache,
     uint8_t *hmacKey,
     size_t hmacKeySize,
     const uint8_t *pHash,
@@ -61,7 +194,9 @@ TSS2_RC iesys_crypto_authHmac(
     TPM2B_AUTH *hmac);
 
 TSS2_RC iesys_crypto_KDFaHmac(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2_ALG_ID alg,
+    IESYS_CRYPTO_HMAC_CACHE **hmacCache,
     uint8_t *hmacKey,
     size_t hmacKeySize,
     uint32_t counter,
@@ -72,7 +207,22 @@ TSS2_RC iesys_crypto_KDFaHmac(
     uint8_t *hmac,
     size_t *hmacSize);
 
+TSS2_RC iesys_crypto_KDFa_cached(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_CRYPTO_HMAC_CACHE **hmacCache,
+    TPM2_ALG_ID hashAlg,
+    uint8_t *hmacKey,
+    size_t hmacKeySize,
+    const char *label,
+    TPM2B_NONCE *contextU,
+    TPM2B_NONCE *contextV,
+    uint32_t bitLength,
+    uint32_t *counterInOut,
+    BYTE *outKey,
+    BOOL use_digest_size);
+
 TSS2_RC iesys_crypto_KDFa(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2_ALG_ID hashAlg,
     uint8_t *hmacKey,
     size_t hmacKeySize,
@@ -85,6 +235,7 @@ TSS2_RC iesys_crypto_KDFa(
     BOOL use_digest_size);
 
 TSS2_RC iesys_xor_parameter_obfuscation(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2_ALG_ID hash_alg,
     uint8_t *key,
     size_t key_size,
@@ -94,6 +245,7 @@ TSS2_RC iesys_xor_parameter_obfuscation(
     size_t data_size);
 
 TSS2_RC iesys_crypto_KDFe(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2_ALG_ID hashAlg,
     TPM2B_ECC_PARAMETER *Z,
     const char *label,
@@ -102,8 +254,6 @@ TSS2_RC iesys_crypto_KDFe(
     UINT32 bit_size,
     BYTE *key);
 
-TSS2_RC iesys_initialize_crypto();
-
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -17,6 +17,7 @@
 #include <mbedtls/aes.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
+#include <mbedtls/platform_util.h>
 
 #include "esys_iutil.h"
 #include "esys_mu.h"
@@ -25,11 +26,13 @@
 #include "util/aux_util.h"
 
 /** Context to hold temporary values for iesys_crypto */
-typedef struct _IESYS_CRYPTO_CONTEXT {
+typedef struct ESYS_CRYPTO_CONTEXT_BLOB {
     enum {
         IESYS_CRYPTMBED_TYPE_HASH = 1,
         IESYS_CRYPTMBED_TYPE_HMAC,
     } type; /**< The type of context to hold; hash or hmac */
+    int cached; /**< The context is owned by an IESYS_CRYPTO_HMAC_CACHE or
+                     an IESYS_CRYPTO_HASH_CACHE */
     union {
         struct {
             mbedtls_md_context_t mbed_context;
@@ -42,6 +45,35 @@ typedef struct _IESYS_CRYPTO_CONTEXT {
     };
 } IESYS_CRYPTMBED_CONTEXT;
 
+/** Keyed HMAC state kept across HMAC computations with the same key.
+ *
+ * mbedtls_md_hmac_starts derives the inner and outer pads from the key and
+ * keeps them in the context, so that mbedtls_md_hmac_reset can start a new
+ * HMAC with the same key without processing the key again. The context is
+ * therefore kept and reset as long as hash algorithm and key stay the same.
+ */
+struct _IESYS_CRYPTO_HMAC_CACHE {
+    TPM2_ALG_ID hashAlg;            /**< The hash algorithm of work */
+    size_t key_size;                /**< The size of key; 0 if work is unkeyed */
+    uint8_t key[2 * sizeof(TPMU_HA)]; /**< The HMAC key work was keyed with */
+    IESYS_CRYPTMBED_CONTEXT work;   /**< The context handed out to callers;
+                                         type is 0 while it is not in use */
+};
+
+/** Digest contexts kept across commands for the parameter hashes.
+ *
+ * A context that was set up for a hash algorithm is restarted with
+ * mbedtls_md_starts for the next digest of the same algorithm instead of being
+ * allocated and set up anew.
+ */
+struct _IESYS_CRYPTO_HASH_CACHE {
+    TPM2_ALG_ID hashAlg[HASH_TAB_MAX]; /**< The algorithm work[i] is set up
+                                            for; 0 if it is not set up */
+    IESYS_CRYPTMBED_CONTEXT work[HASH_TAB_MAX]; /**< The contexts handed out
+                                         to callers; type is 0 while a context
+                                         is not in use */
+};
+
 /** Provide the context for the computation of a hash digest.
  *
  * The context will be created and initialized according to the hash function.
@@ -195,8 +227,13 @@ iesys_cryptmbed_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
     *size = mycontext->hash.hash_len;
 
  cleanup:
-    mbedtls_md_free(&mycontext->hash.mbed_context);
-    SAFE_FREE(mycontext);
+    if (mycontext->cached) {
+        /* Hand the context back to its cache */
+        mycontext->type = 0;
+    } else {
+        mbedtls_md_free(&mycontext->hash.mbed_context);
+        SAFE_FREE(mycontext);
+    }
     *context = NULL;
 
     return r;
@@ -220,11 +257,130 @@ iesys_cryptmbed_hash_abort(IESYS_CRYPTO_CONTEXT_BLOB ** context)
         return;
     }
 
-    mbedtls_md_free(&mycontext->hash.mbed_context);
-    free(mycontext);
+    if (mycontext->cached) {
+        mycontext->type = 0;
+    } else {
+        mbedtls_md_free(&mycontext->hash.mbed_context);
+        free(mycontext);
+    }
     *context = NULL;
 }
 
+/** Provide the context for a hash digest, reusing a context of the cache.
+ *
+ * Behaves like iesys_cryptmbed_hash_start but takes the context from *cache.
+ * A context that is already set up for hashAlg is only restarted, so no
+ * memory is allocated once the cache is warm. The returned context is
+ * released as usual by iesys_cryptmbed_hash_finish or
+ * iesys_cryptmbed_hash_abort. If all contexts of the cache are in use an
+ * uncached context is returned.
+ * @param[out] context The created context.
+ * @param[in,out] cache The cache (created on first use). If NULL no caching
+ *                takes place.
+ * @param[in] hashAlg The hash algorithm for the creation of the context.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_MEMORY Memory cannot be allocated.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED for an unsupported hash algorithm.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptmbed_hash_start_cached(IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                                  IESYS_CRYPTO_HASH_CACHE ** cache,
+                                  TPM2_ALG_ID hashAlg)
+{
+    IESYS_CRYPTMBED_CONTEXT *mycontext = NULL;
+    const mbedtls_md_info_t* md_info = NULL;
+    size_t i;
+
+    if (cache == NULL) {
+        return iesys_cryptmbed_hash_start(context, hashAlg);
+    }
+    if (context == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE,
+                     "Null-Pointer passed in for context");
+    }
+
+    switch(hashAlg) {
+      case TPM2_ALG_SHA1:
+          md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
+          break;
+      case TPM2_ALG_SHA256:
+          md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+          break;
+      case TPM2_ALG_SHA384:
+          md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA384);
+          break;
+    }
+
+    if (md_info == NULL) {
+        LOG_ERROR("Unsupported hash algorithm (%"PRIu16")", hashAlg);
+        return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+    }
+
+    if (*cache == NULL) {
+        *cache = calloc(1, sizeof(**cache));
+        return_if_null(*cache, "Out of Memory", TSS2_ESYS_RC_MEMORY);
+        for (i = 0; i < HASH_TAB_MAX; i++) {
+            (*cache)->work[i].cached = 1;
+            mbedtls_md_init(&(*cache)->work[i].hash.mbed_context);
+        }
+    }
+
+    /* Prefer a free context that is already set up for hashAlg */
+    for (i = 0; i < HASH_TAB_MAX; i++) {
+        if ((*cache)->work[i].type != 0)
+            continue;
+        if (mycontext == NULL || (*cache)->hashAlg[i] == hashAlg)
+            mycontext = &(*cache)->work[i];
+        if ((*cache)->hashAlg[i] == hashAlg)
+            break;
+    }
+    if (mycontext == NULL) {
+        return iesys_cryptmbed_hash_start(context, hashAlg);
+    }
+    i = mycontext - &(*cache)->work[0];
+
+    if ((*cache)->hashAlg[i] != hashAlg) {
+        (*cache)->hashAlg[i] = 0;
+        mbedtls_md_free(&mycontext->hash.mbed_context);
+        mbedtls_md_init(&mycontext->hash.mbed_context);
+        if (mbedtls_md_setup(&mycontext->hash.mbed_context, md_info,
+                             false) != 0) {
+            return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "MBED HASH setup");
+        }
+        (*cache)->hashAlg[i] = hashAlg;
+        mycontext->hash.hash_len = mbedtls_md_get_size(md_info);
+    }
+
+    if (mbedtls_md_starts(&mycontext->hash.mbed_context) != 0) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "MBED HASH start");
+    }
+
+    mycontext->type = IESYS_CRYPTMBED_TYPE_HASH;
+    *context = (IESYS_CRYPTO_CONTEXT_BLOB *) mycontext;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release a hash context cache.
+ *
+ * The digest contexts are destroyed and *cache is set to NULL.
+ * @param[in,out] cache The cache to be released (may point to NULL).
+ */
+void
+iesys_cryptmbed_hash_cache_free(IESYS_CRYPTO_HASH_CACHE ** cache)
+{
+    size_t i;
+
+    if (cache == NULL || *cache == NULL)
+        return;
+
+    for (i = 0; i < HASH_TAB_MAX; i++)
+        mbedtls_md_free(&(*cache)->work[i].hash.mbed_context);
+    SAFE_FREE(*cache);
+}
+
 /* HMAC */
 
 /** Provide the context an HMAC digest object from a byte buffer key.
@@ -385,8 +541,12 @@ iesys_cryptmbed_hmac_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
     *size = mycontext->hmac.hmac_len;
 
  cleanup:
-    mbedtls_md_free(&mycontext->hmac.mbed_context);
-    SAFE_FREE(mycontext);
+    if (mycontext->cached) {
+        mycontext->type = 0;
+    } else {
+        mbedtls_md_free(&mycontext->hmac.mbed_context);
+        SAFE_FREE(mycontext);
+    }
     *context = NULL;
     return r;
 }
@@ -432,11 +592,130 @@ iesys_cryptmbed_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB ** context)
         return;
     }
 
-    mbedtls_md_free(&mycontext->hmac.mbed_context);
-    free(mycontext);
+    if (mycontext->cached) {
+        mycontext->type = 0;
+    } else {
+        mbedtls_md_free(&mycontext->hmac.mbed_context);
+        free(mycontext);
+    }
     *context = NULL;
 }
 
+/** Provide an HMAC context from a key, reusing the keying of a former call.
+ *
+ * Behaves like iesys_cryptmbed_hmac_start but keeps the keyed mbed context in
+ * *cache. As long as hashAlg and key match the previous call the context is
+ * reset to the state right after keying instead of being keyed again, and no
+ * memory is allocated. The returned context is released as usual by
+ * iesys_cryptmbed_hmac_finish or iesys_cryptmbed_hmac_abort and must be
+ * released before the cache is used again; otherwise an uncached context is
+ * returned.
+ * @param[out] context The created context.
+ * @param[in,out] cache The cache (created on first use). If NULL no caching
+ *                takes place.
+ * @param[in] hashAlg The hash algorithm for the HMAC computation.
+ * @param[in] key The byte buffer of the HMAC key.
+ * @param[in] size The size of the HMAC key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_MEMORY Memory cannot be allocated.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED for an unsupported hash algorithm.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptmbed_hmac_start_cached(IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                                  IESYS_CRYPTO_HMAC_CACHE ** cache,
+                                  TPM2_ALG_ID hashAlg,
+                                  const uint8_t * key, size_t size)
+{
+    IESYS_CRYPTO_HMAC_CACHE *mycache;
+    const mbedtls_md_info_t* md_info = NULL;
+
+    if (cache == NULL || size > sizeof(mycache->key) ||
+            (*cache != NULL && (*cache)->work.type != 0)) {
+        return iesys_cryptmbed_hmac_start(context, hashAlg, key, size);
+    }
+    if (context == NULL || key == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE,
+                     "Null-Pointer passed in for context");
+    }
+
+    switch(hashAlg) {
+      case TPM2_ALG_SHA1:
+          md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
+          break;
+      case TPM2_ALG_SHA256:
+          md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+          break;
+      case TPM2_ALG_SHA384:
+          md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA384);
+          break;
+    }
+
+    if (md_info == NULL) {
+        LOG_ERROR("Unsupported hash algorithm (%"PRIu16")", hashAlg);
+        return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+    }
+
+    if (*cache == NULL) {
+        mycache = calloc(1, sizeof(*mycache));
+        return_if_null(mycache, "Out of Memory", TSS2_ESYS_RC_MEMORY);
+        mycache->work.cached = 1;
+        mbedtls_md_init(&mycache->work.hmac.mbed_context);
+        *cache = mycache;
+    }
+    mycache = *cache;
+
+    if (mycache->key_size != 0 && mycache->hashAlg == hashAlg &&
+            mycache->key_size == size &&
+            memcmp(&mycache->key[0], key, size) == 0) {
+        if (mbedtls_md_hmac_reset(&mycache->work.hmac.mbed_context) != 0) {
+            return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "MBED HMAC reset");
+        }
+    } else {
+        LOG_DEBUG("Keying cached HMAC context");
+        mycache->key_size = 0;
+        mbedtls_md_free(&mycache->work.hmac.mbed_context);
+        mbedtls_md_init(&mycache->work.hmac.mbed_context);
+
+        if (mbedtls_md_setup(&mycache->work.hmac.mbed_context, md_info,
+                             true) != 0) {
+            return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "MBED HMAC setup");
+        }
+        if (mbedtls_md_hmac_starts(&mycache->work.hmac.mbed_context,
+                                   key, size) != 0) {
+            return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "MBED HMAC start");
+        }
+
+        memcpy(&mycache->key[0], key, size);
+        mycache->key_size = size;
+        mycache->hashAlg = hashAlg;
+        mycache->work.hmac.hmac_len = mbedtls_md_get_size(md_info);
+    }
+
+    mycache->work.type = IESYS_CRYPTMBED_TYPE_HMAC;
+    *context = (IESYS_CRYPTO_CONTEXT_BLOB *) &mycache->work;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release an HMAC cache.
+ *
+ * The keyed context and the cached key are destroyed and *cache is set to
+ * NULL.
+ * @param[in,out] cache The cache to be released (may point to NULL).
+ */
+void
+iesys_cryptmbed_hmac_cache_free(IESYS_CRYPTO_HMAC_CACHE ** cache)
+{
+    if (cache == NULL || *cache == NULL)
+        return;
+
+    mbedtls_md_free(&(*cache)->work.hmac.mbed_context);
+    mbedtls_platform_zeroize(&(*cache)->key[0], sizeof((*cache)->key));
+    SAFE_FREE(*cache);
+}
+
 /** Wrapper for mbedtls random number generator
  *
  * @param[in] context Optional unused parameter.
@@ -9,13 +9,16 @@
 
 #include <stddef.h>
 #include "tss2_tpm2_types.h"
+#include "tss2_esys.h"
 #include "tss2-sys/sysapi_util.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-typedef struct _IESYS_CRYPTO_CONTEXT IESYS_CRYPTO_CONTEXT_BLOB;
+typedef ESYS_CRYPTO_CONTEXT_BLOB IESYS_CRYPTO_CONTEXT_BLOB;
+typedef struct _IESYS_CRYPTO_HMAC_CACHE IESYS_CRYPTO_HMAC_CACHE;
+typedef struct _IESYS_CRYPTO_HASH_CACHE IESYS_CRYPTO_HASH_CACHE;
 
 TSS2_RC iesys_cryptmbed_hash_start(
     IESYS_CRYPTO_CONTEXT_BLOB **context,
@@ -40,13 +43,20 @@ TSS2_RC iesys_cryptmbed_hash_finish2b(
 
 void iesys_cryptmbed_hash_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 
-#define iesys_crypto_pk_encrypt iesys_cryptmbed_pk_encrypt
-#define iesys_crypto_hash_start iesys_cryptmbed_hash_start
-#define iesys_crypto_hash_update iesys_cryptmbed_hash_update
-#define iesys_crypto_hash_update2b iesys_cryptmbed_hash_update2b
-#define iesys_crypto_hash_finish iesys_cryptmbed_hash_finish
-#define iesys_crypto_hash_finish2b iesys_cryptmbed_hash_finish2b
-#define iesys_crypto_hash_abort iesys_cryptmbed_hash_abort
+TSS2_RC iesys_cryptmbed_hash_start_cached(
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    IESYS_CRYPTO_HASH_CACHE **cache,
+    TPM2_ALG_ID hashAlg);
+
+void iesys_cryptmbed_hash_cache_free(IESYS_CRYPTO_HASH_CACHE **cache);
+
+#define iesys_crypto_pk_encrypt_internal iesys_cryptmbed_pk_encrypt
+#define iesys_crypto_hash_start_internal iesys_cryptmbed_hash_start
+#define iesys_crypto_hash_update_internal iesys_cryptmbed_hash_update
+#define iesys_crypto_hash_finish_internal iesys_cryptmbed_hash_finish
+#define iesys_crypto_hash_abort_internal iesys_cryptmbed_hash_abort
+#define iesys_crypto_hash_start_cached iesys_cryptmbed_hash_start_cached
+#define iesys_crypto_hash_cache_free iesys_cryptmbed_hash_cache_free
 
 TSS2_RC iesys_cryptmbed_hmac_start(
     IESYS_CRYPTO_CONTEXT_BLOB **context,
@@ -79,13 +89,21 @@ TSS2_RC iesys_cryptmbed_hmac_finish2b(
 
 void iesys_cryptmbed_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 
-#define iesys_crypto_hmac_start iesys_cryptmbed_hmac_start
-#define iesys_crypto_hmac_start2b iesys_cryptmbed_hmac_start2b
-#define iesys_crypto_hmac_update iesys_cryptmbed_hmac_update
-#define iesys_crypto_hmac_update2b iesys_cryptmbed_hmac_update2b
-#define iesys_crypto_hmac_finish iesys_cryptmbed_hmac_finish
-#define iesys_crypto_hmac_finish2b iesys_cryptmbed_hmac_finish2b
-#define iesys_crypto_hmac_abort iesys_cryptmbed_hmac_abort
+TSS2_RC iesys_cryptmbed_hmac_start_cached(
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    IESYS_CRYPTO_HMAC_CACHE **cache,
+    TPM2_ALG_ID hmacAlg,
+    const uint8_t *key,
+    size_t size);
+
+void iesys_cryptmbed_hmac_cache_free(IESYS_CRYPTO_HMAC_CACHE **cache);
+
+#define iesys_crypto_hmac_start_internal iesys_cryptmbed_hmac_start
+#define iesys_crypto_hmac_update_internal iesys_cryptmbed_hmac_update
+#define iesys_crypto_hmac_finish_internal iesys_cryptmbed_hmac_finish
+#define iesys_crypto_hmac_abort_internal iesys_cryptmbed_hmac_abort
+#define iesys_crypto_hmac_start_cached iesys_cryptmbed_hmac_start_cached
+#define iesys_crypto_hmac_cache_free iesys_cryptmbed_hmac_cache_free
 
 TSS2_RC iesys_cryptmbed_random2b(TPM2B_NONCE *nonce, size_t num_bytes);
 
@@ -125,12 +143,12 @@ TSS2_RC iesys_cryptmbed_get_ecdh_point(
     BYTE * out_buffer,
     size_t * out_size);
 
-#define iesys_crypto_random2b iesys_cryptmbed_random2b
-#define iesys_crypto_get_ecdh_point iesys_cryptmbed_get_ecdh_point
-#define iesys_crypto_sym_aes_encrypt iesys_cryptmbed_sym_aes_encrypt
-#define iesys_crypto_sym_aes_decrypt iesys_cryptmbed_sym_aes_decrypt
+#define iesys_crypto_random2b_internal iesys_cryptmbed_random2b
+#define iesys_crypto_get_ecdh_point_internal iesys_cryptmbed_get_ecdh_point
+#define iesys_crypto_sym_aes_encrypt_internal iesys_cryptmbed_sym_aes_encrypt
+#define iesys_crypto_sym_aes_decrypt_internal iesys_cryptmbed_sym_aes_decrypt
 
-#define iesys_crypto_init(...) TSS2_RC_SUCCESS;
+#define iesys_crypto_init_internal(...) TSS2_RC_SUCCESS
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -50,12 +50,18 @@ iesys_bn2binpad(const BIGNUM *bn, unsigned char *bin, int bin_length)
     return 1;
 }
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define EVP_MD_CTX_reset(ctx) EVP_MD_CTX_cleanup(ctx)
+#endif /* OPENSSL_VERSION_NUMBER < 0x10100000L */
+
 /** Context to hold temporary values for iesys_crypto */
-typedef struct _IESYS_CRYPTO_CONTEXT {
+typedef struct ESYS_CRYPTO_CONTEXT_BLOB {
     enum {
         IESYS_CRYPTOSSL_TYPE_HASH = 1,
         IESYS_CRYPTOSSL_TYPE_HMAC,
     } type; /**< The type of context to hold; hash or hmac */
+    int cached; /**< The context is owned by an IESYS_CRYPTO_HMAC_CACHE or
+                     an IESYS_CRYPTO_HASH_CACHE */
     union {
         struct {
             EVP_MD_CTX  *ossl_context;
@@ -70,6 +76,35 @@ typedef struct _IESYS_CRYPTO_CONTEXT {
     };
 } IESYS_CRYPTOSSL_CONTEXT;
 
+/** Keyed HMAC state kept across commands for one session.
+ *
+ * Keying an HMAC context (EVP_PKEY_new_mac_key and EVP_DigestSignInit) costs
+ * far more than hashing the few dozen bytes of a session HMAC. The keyed
+ * context is therefore kept and copied into a reused working context as long
+ * as hash algorithm and key stay the same.
+ */
+struct _IESYS_CRYPTO_HMAC_CACHE {
+    TPM2_ALG_ID hashAlg;            /**< The hash algorithm of keyed */
+    size_t key_size;                /**< The size of key; 0 if keyed is unset */
+    uint8_t key[2 * sizeof(TPMU_HA)]; /**< The HMAC key keyed was created with */
+    EVP_MD_CTX *keyed;              /**< The context right after keying */
+    IESYS_CRYPTOSSL_CONTEXT work;   /**< The context handed out to callers;
+                                         type is 0 while it is not in use */
+};
+
+/** Digest contexts kept across commands for the parameter hashes.
+ *
+ * cpHash and rpHash are computed for every command with sessions. Instead of
+ * creating and destroying an EVP_MD_CTX for each of them, the contexts are
+ * kept here, cleared with EVP_MD_CTX_reset when they are handed back and
+ * initialized again for the next digest.
+ */
+struct _IESYS_CRYPTO_HASH_CACHE {
+    IESYS_CRYPTOSSL_CONTEXT work[HASH_TAB_MAX]; /**< The contexts handed out
+                                         to callers; type is 0 while a context
+                                         is not in use */
+};
+
 const EVP_MD *
 get_ossl_hash_md(TPM2_ALG_ID hashAlg)
 {
@@ -244,8 +279,14 @@ iesys_cryptossl_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
     LOGBLOB_TRACE(buffer, mycontext->hash.hash_len, "read hash result");
 
     *size = mycontext->hash.hash_len;
-    EVP_MD_CTX_destroy(mycontext->hash.ossl_context);
-    free(mycontext);
+    if (mycontext->cached) {
+        /* Hand the context back to its cache */
+        EVP_MD_CTX_reset(mycontext->hash.ossl_context);
+        mycontext->type = 0;
+    } else {
+        EVP_MD_CTX_destroy(mycontext->hash.ossl_context);
+        free(mycontext);
+    }
     *context = NULL;
 
     return TSS2_RC_SUCCESS;
@@ -271,11 +312,112 @@ iesys_cryptossl_hash_abort(IESYS_CRYPTO_CONTEXT_BLOB ** context)
         return;
     }
 
-    EVP_MD_CTX_destroy(mycontext->hash.ossl_context);
-    free(mycontext);
+    if (mycontext->cached) {
+        EVP_MD_CTX_reset(mycontext->hash.ossl_context);
+        mycontext->type = 0;
+    } else {
+        EVP_MD_CTX_destroy(mycontext->hash.ossl_context);
+        free(mycontext);
+    }
     *context = NULL;
 }
 
+/** Provide the context for a hash digest, reusing a context of the cache.
+ *
+ * Behaves like iesys_cryptossl_hash_start but takes the context from *cache.
+ * Its EVP_MD_CTX was reset when it was handed back and is only initialized
+ * for hashAlg, so no memory is allocated once the cache is warm. The returned
+ * context is released as usual by iesys_cryptossl_hash_finish or
+ * iesys_cryptossl_hash_abort. If all contexts of the cache are in use an
+ * uncached context is returned.
+ * @param[out] context The created context.
+ * @param[in,out] cache The cache (created on first use). If NULL no caching
+ *                takes place.
+ * @param[in] hashAlg The hash algorithm for the creation of the context.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_MEMORY Memory cannot be allocated.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED for an unsupported hash algorithm.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_hash_start_cached(IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                                  IESYS_CRYPTO_HASH_CACHE ** cache,
+                                  TPM2_ALG_ID hashAlg)
+{
+    IESYS_CRYPTOSSL_CONTEXT *mycontext = NULL;
+    const EVP_MD *md;
+    size_t hash_len;
+    size_t i;
+
+    LOG_TRACE("called for context-pointer %p, cache %p and hashAlg %d",
+              context, cache, hashAlg);
+    if (cache == NULL) {
+        return iesys_cryptossl_hash_start(context, hashAlg);
+    }
+    return_if_null(context, "Null-Pointer passed for context",
+                   TSS2_ESYS_RC_BAD_REFERENCE);
+
+    if (!(md = get_ossl_hash_md(hashAlg)) ||
+            iesys_crypto_hash_get_digest_size(hashAlg, &hash_len)) {
+        LOG_ERROR("Unsupported hash algorithm (%"PRIu16")", hashAlg);
+        return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+    }
+
+    if (*cache == NULL) {
+        *cache = calloc(1, sizeof(**cache));
+        return_if_null(*cache, "Out of Memory", TSS2_ESYS_RC_MEMORY);
+        for (i = 0; i < HASH_TAB_MAX; i++)
+            (*cache)->work[i].cached = 1;
+    }
+
+    for (i = 0; i < HASH_TAB_MAX; i++) {
+        if ((*cache)->work[i].type == 0) {
+            mycontext = &(*cache)->work[i];
+            break;
+        }
+    }
+    if (mycontext == NULL) {
+        return iesys_cryptossl_hash_start(context, hashAlg);
+    }
+
+    if (mycontext->hash.ossl_context == NULL &&
+            !(mycontext->hash.ossl_context = EVP_MD_CTX_create())) {
+        return_error(TSS2_ESYS_RC_MEMORY, "Error EVP_MD_CTX_create");
+    }
+
+    if (1 != EVP_DigestInit_ex(mycontext->hash.ossl_context, md, NULL)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "Error EVP_DigestInit_ex");
+    }
+
+    mycontext->hash.ossl_hash_alg = md;
+    mycontext->hash.hash_len = hash_len;
+    mycontext->type = IESYS_CRYPTOSSL_TYPE_HASH;
+    *context = (IESYS_CRYPTO_CONTEXT_BLOB *) mycontext;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release a hash context cache.
+ *
+ * The digest contexts are destroyed and *cache is set to NULL.
+ * @param[in,out] cache The cache to be released (may point to NULL).
+ */
+void
+iesys_cryptossl_hash_cache_free(IESYS_CRYPTO_HASH_CACHE ** cache)
+{
+    size_t i;
+
+    if (cache == NULL || *cache == NULL)
+        return;
+
+    for (i = 0; i < HASH_TAB_MAX; i++) {
+        if ((*cache)->work[i].hash.ossl_context)
+            EVP_MD_CTX_destroy((*cache)->work[i].hash.ossl_context);
+    }
+    SAFE_FREE(*cache);
+}
+
 /* HMAC */
 
 /** Provide the context an HMAC digest object from a byte buffer key.
@@ -446,8 +588,13 @@ iesys_cryptossl_hmac_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
     LOGBLOB_TRACE(buffer, *size, "read hmac result");
 
  cleanup:
-    EVP_MD_CTX_destroy(mycontext->hmac.ossl_context);
-    SAFE_FREE(mycontext);
+    if (mycontext->cached) {
+        /* Hand the working context back to its cache */
+        mycontext->type = 0;
+    } else {
+        EVP_MD_CTX_destroy(mycontext->hmac.ossl_context);
+        SAFE_FREE(mycontext);
+    }
     *context = NULL;
     return r;
 }
@@ -497,13 +644,133 @@ iesys_cryptossl_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB ** context)
             return;
         }
 
-        EVP_MD_CTX_destroy(mycontext->hmac.ossl_context);
-
-        free(mycontext);
+        if (mycontext->cached) {
+            mycontext->type = 0;
+        } else {
+            EVP_MD_CTX_destroy(mycontext->hmac.ossl_context);
+            free(mycontext);
+        }
         *context = NULL;
     }
 }
 
+/** Provide an HMAC context from a key, reusing the keying of a former call.
+ *
+ * Behaves like iesys_cryptossl_hmac_start but keeps the keyed OpenSSL context
+ * in *cache. As long as hashAlg and key match the previous call the context is
+ * copied from the cache instead of being keyed again, and no memory is
+ * allocated. The returned context is released as usual by
+ * iesys_cryptossl_hmac_finish or iesys_cryptossl_hmac_abort and must be
+ * released before the cache is used again; otherwise an uncached context is
+ * returned.
+ * @param[out] context The created context.
+ * @param[in,out] cache The cache of the session (created on first use). If
+ *                NULL no caching takes place.
+ * @param[in] hashAlg The hash algorithm for the HMAC computation.
+ * @param[in] key The byte buffer of the HMAC key.
+ * @param[in] size The size of the HMAC key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_MEMORY Memory cannot be allocated.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED for an unsupported hash algorithm.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_hmac_start_cached(IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                                  IESYS_CRYPTO_HMAC_CACHE ** cache,
+                                  TPM2_ALG_ID hashAlg,
+                                  const uint8_t * key, size_t size)
+{
+    IESYS_CRYPTO_HMAC_CACHE *mycache;
+    EVP_PKEY *hkey = NULL;
+    const EVP_MD *md;
+    size_t hmac_len;
+
+    LOG_TRACE("called for context-pointer %p, cache %p and hmacAlg %d",
+              context, cache, hashAlg);
+    if (cache == NULL || size > sizeof(mycache->key) ||
+            (*cache != NULL && (*cache)->work.type != 0)) {
+        return iesys_cryptossl_hmac_start(context, hashAlg, key, size);
+    }
+    if (context == NULL || key == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE,
+                     "Null-Pointer passed in for context");
+    }
+
+    if (!(md = get_ossl_hash_md(hashAlg)) ||
+            iesys_crypto_hash_get_digest_size(hashAlg, &hmac_len)) {
+        LOG_ERROR("Unsupported hash algorithm (%"PRIu16")", hashAlg);
+        return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+    }
+
+    if (*cache == NULL) {
+        mycache = calloc(1, sizeof(*mycache));
+        return_if_null(mycache, "Out of Memory", TSS2_ESYS_RC_MEMORY);
+        mycache->work.cached = 1;
+        mycache->keyed = EVP_MD_CTX_create();
+        mycache->work.hmac.ossl_context = EVP_MD_CTX_create();
+        *cache = mycache;
+        if (!mycache->keyed || !mycache->work.hmac.ossl_context) {
+            iesys_cryptossl_hmac_cache_free(cache);
+            return_error(TSS2_ESYS_RC_MEMORY, "Error EVP_MD_CTX_create");
+        }
+    }
+    mycache = *cache;
+
+    if (mycache->key_size == 0 || mycache->hashAlg != hashAlg ||
+            mycache->key_size != size ||
+            CRYPTO_memcmp(&mycache->key[0], key, size) != 0) {
+        LOG_DEBUG("Keying cached HMAC context");
+        mycache->key_size = 0;
+        EVP_MD_CTX_reset(mycache->keyed);
+
+        if (!(hkey = EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, NULL, key, size))) {
+            return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "EVP_PKEY_new_mac_key");
+        }
+        if (1 != EVP_DigestSignInit(mycache->keyed, NULL, md, NULL, hkey)) {
+            EVP_PKEY_free(hkey);
+            return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "DigestSignInit");
+        }
+        EVP_PKEY_free(hkey);
+
+        memcpy(&mycache->key[0], key, size);
+        mycache->key_size = size;
+        mycache->hashAlg = hashAlg;
+    }
+
+    if (1 != EVP_MD_CTX_copy_ex(mycache->work.hmac.ossl_context,
+                                mycache->keyed)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "EVP_MD_CTX_copy_ex");
+    }
+
+    mycache->work.hmac.ossl_hash_alg = md;
+    mycache->work.hmac.hmac_len = hmac_len;
+    mycache->work.type = IESYS_CRYPTOSSL_TYPE_HMAC;
+    *context = (IESYS_CRYPTO_CONTEXT_BLOB *) &mycache->work;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release an HMAC cache.
+ *
+ * The keyed contexts and the cached key are destroyed and *cache is set to
+ * NULL.
+ * @param[in,out] cache The cache to be released (may point to NULL).
+ */
+void
+iesys_cryptossl_hmac_cache_free(IESYS_CRYPTO_HMAC_CACHE ** cache)
+{
+    if (cache == NULL || *cache == NULL)
+        return;
+
+    if ((*cache)->keyed)
+        EVP_MD_CTX_destroy((*cache)->keyed);
+    if ((*cache)->work.hmac.ossl_context)
+        EVP_MD_CTX_destroy((*cache)->work.hmac.ossl_context);
+    OPENSSL_cleanse(&(*cache)->key[0], sizeof((*cache)->key));
+    SAFE_FREE(*cache);
+}
+
 /** Compute random TPM2B data.
  *
  * The random data will be generated and written to a passed TPM2B structure.
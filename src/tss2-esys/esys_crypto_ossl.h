@@ -8,6 +8,7 @@
 
 #include <stddef.h>
 #include "tss2_tpm2_types.h"
+#include "tss2_esys.h"
 #include "tss2-sys/sysapi_util.h"
 
 #ifdef __cplusplus
@@ -16,7 +17,9 @@ extern "C" {
 
 #define OSSL_FREE(S,TYPE) if((S) != NULL) {TYPE##_free((void*) (S)); (S)=NULL;}
 
-typedef struct _IESYS_CRYPTO_CONTEXT IESYS_CRYPTO_CONTEXT_BLOB;
+typedef ESYS_CRYPTO_CONTEXT_BLOB IESYS_CRYPTO_CONTEXT_BLOB;
+typedef struct _IESYS_CRYPTO_HMAC_CACHE IESYS_CRYPTO_HMAC_CACHE;
+typedef struct _IESYS_CRYPTO_HASH_CACHE IESYS_CRYPTO_HASH_CACHE;
 
 TSS2_RC iesys_cryptossl_hash_start(
     IESYS_CRYPTO_CONTEXT_BLOB **context,
@@ -41,13 +44,20 @@ TSS2_RC iesys_cryptossl_hash_finish2b(
 
 void iesys_cryptossl_hash_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 
-#define iesys_crypto_pk_encrypt iesys_cryptossl_pk_encrypt
-#define iesys_crypto_hash_start iesys_cryptossl_hash_start
-#define iesys_crypto_hash_update iesys_cryptossl_hash_update
-#define iesys_crypto_hash_update2b iesys_cryptossl_hash_update2b
-#define iesys_crypto_hash_finish iesys_cryptossl_hash_finish
-#define iesys_crypto_hash_finish2b iesys_cryptossl_hash_finish2b
-#define iesys_crypto_hash_abort iesys_cryptossl_hash_abort
+TSS2_RC iesys_cryptossl_hash_start_cached(
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    IESYS_CRYPTO_HASH_CACHE **cache,
+    TPM2_ALG_ID hashAlg);
+
+void iesys_cryptossl_hash_cache_free(IESYS_CRYPTO_HASH_CACHE **cache);
+
+#define iesys_crypto_pk_encrypt_internal iesys_cryptossl_pk_encrypt
+#define iesys_crypto_hash_start_internal iesys_cryptossl_hash_start
+#define iesys_crypto_hash_update_internal iesys_cryptossl_hash_update
+#define iesys_crypto_hash_finish_internal iesys_cryptossl_hash_finish
+#define iesys_crypto_hash_abort_internal iesys_cryptossl_hash_abort
+#define iesys_crypto_hash_start_cached iesys_cryptossl_hash_start_cached
+#define iesys_crypto_hash_cache_free iesys_cryptossl_hash_cache_free
 
 TSS2_RC iesys_cryptossl_hmac_start(
     IESYS_CRYPTO_CONTEXT_BLOB **context,
@@ -80,13 +90,21 @@ TSS2_RC iesys_cryptossl_hmac_finish2b(
 
 void iesys_cryptossl_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 
-#define iesys_crypto_hmac_start iesys_cryptossl_hmac_start
-#define iesys_crypto_hmac_start2b iesys_cryptossl_hmac_start2b
-#define iesys_crypto_hmac_update iesys_cryptossl_hmac_update
-#define iesys_crypto_hmac_update2b iesys_cryptossl_hmac_update2b
-#define iesys_crypto_hmac_finish iesys_cryptossl_hmac_finish
-#define iesys_crypto_hmac_finish2b iesys_cryptossl_hmac_finish2b
-#define iesys_crypto_hmac_abort iesys_cryptossl_hmac_abort
+TSS2_RC iesys_cryptossl_hmac_start_cached(
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    IESYS_CRYPTO_HMAC_CACHE **cache,
+    TPM2_ALG_ID hmacAlg,
+    const uint8_t *key,
+    size_t size);
+
+void iesys_cryptossl_hmac_cache_free(IESYS_CRYPTO_HMAC_CACHE **cache);
+
+#define iesys_crypto_hmac_start_internal iesys_cryptossl_hmac_start
+#define iesys_crypto_hmac_update_internal iesys_cryptossl_hmac_update
+#define iesys_crypto_hmac_finish_internal iesys_cryptossl_hmac_finish
+#define iesys_crypto_hmac_abort_internal iesys_cryptossl_hmac_abort
+#define iesys_crypto_hmac_start_cached iesys_cryptossl_hmac_start_cached
+#define iesys_crypto_hmac_cache_free iesys_cryptossl_hmac_cache_free
 
 TSS2_RC iesys_cryptossl_random2b(TPM2B_NONCE *nonce, size_t num_bytes);
 
@@ -126,14 +144,14 @@ TSS2_RC iesys_cryptossl_get_ecdh_point(
     BYTE * out_buffer,
     size_t * out_size);
 
-#define iesys_crypto_random2b iesys_cryptossl_random2b
-#define iesys_crypto_get_ecdh_point iesys_cryptossl_get_ecdh_point
-#define iesys_crypto_sym_aes_encrypt iesys_cryptossl_sym_aes_encrypt
-#define iesys_crypto_sym_aes_decrypt iesys_cryptossl_sym_aes_decrypt
+#define iesys_crypto_random2b_internal iesys_cryptossl_random2b
+#define iesys_crypto_get_ecdh_point_internal iesys_cryptossl_get_ecdh_point
+#define iesys_crypto_sym_aes_encrypt_internal iesys_cryptossl_sym_aes_encrypt
+#define iesys_crypto_sym_aes_decrypt_internal iesys_cryptossl_sym_aes_decrypt
 
 TSS2_RC iesys_cryptossl_init();
 
-#define iesys_crypto_init iesys_cryptossl_init
+#define iesys_crypto_init_internal iesys_cryptossl_init
 
 #ifdef __cplusplus
 } /* extern "C" */
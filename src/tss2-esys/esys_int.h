@@ -13,17 +13,20 @@
 extern "C" {
 #endif
 
-/** Linked list type for object meta data.
+/** Resource table entry type for object meta data.
  *
- * This structure represents a linked list to store meta data information of
- * type IESYS_RESOURCE.
+ * This structure stores meta data information of type IESYS_RESOURCE. The
+ * entries are kept in the hash table of the ESYS_CONTEXT (rsrc_table); entries
+ * whose handles fall into the same bucket are chained via next.
  */
 typedef struct RSRC_NODE_T {
     ESYS_TR esys_handle;        /**< The ESYS_TR handle used by the application
                                      to reference this entry. */
     TPM2B_AUTH auth;            /**< The authValue for this resource object. */
     IESYS_RESOURCE rsrc;        /**< The meta data for this resource object. */
-    struct RSRC_NODE_T * next;  /**< The next object in the linked list. */
+    struct _IESYS_CRYPTO_HMAC_CACHE *hmac_cache; /**< The keyed HMAC context
+                                     of a session, reused across commands. */
+    struct RSRC_NODE_T * next;  /**< The next object in the same bucket. */
 } RSRC_NODE_T;
 
 typedef struct {
@@ -132,6 +135,22 @@ typedef union {
     FlushContext_IN FlushContext;
 } IESYS_CMD_IN_PARAM;
 
+/** The number of distinct block sizes cached by the pool of an ESYS_CONTEXT.
+ */
+#define _ESYS_POOL_LISTS 8
+
+/** Free list of heap blocks of one size cached for reuse.
+ *
+ * The cached blocks are ordinary heap blocks. Each block stores the pointer to
+ * the next cached block in its first bytes.
+ */
+typedef struct {
+    size_t size;                 /**< The size of the cached blocks or 0 if
+                                      this list is unused. */
+    size_t count;                /**< The number of cached blocks. */
+    void *blocks;                /**< The first cached block. */
+} IESYS_POOL_LIST;
+
 /** The states for the ESAPI's internal state machine */
 enum _ESYS_STATE {
     _ESYS_STATE_INIT = 0,     /**< The initial state after creation or after
@@ -156,7 +175,12 @@ struct ESYS_CONTEXT {
     TSS2_SYS_CONTEXT *sys;       /**< The SYS context used internally to talk to
                                       the TPM. */
     ESYS_TR esys_handle_cnt;     /**< The next free ESYS_TR number. */
-    RSRC_NODE_T *rsrc_list;      /**< The linked list of all ESYS_TR objects. */
+    RSRC_NODE_T **rsrc_table;    /**< The hash table of all ESYS_TR objects
+                                      indexed by their esys_handle. */
+    size_t rsrc_table_size;      /**< The number of buckets of rsrc_table.
+                                      Always a power of two or zero. */
+    size_t rsrc_count;           /**< The number of ESYS_TR objects stored in
+                                      rsrc_table. */
     int32_t timeout;             /**< The timeout to be used during
                                       Tss2_Sys_ExecuteFinish. */
     ESYS_TR session_type[3];     /**< The list of TPM session handles in the
@@ -182,6 +206,22 @@ struct ESYS_CONTEXT {
                                       automatically loaded. */
     IESYS_SESSION *enc_session;  /**< Ptr to the enc param session.
                                       Used to restore session attributes */
+    size_t pool_size;            /**< The maximum number of freed blocks per
+                                      size kept for reuse (0 = no pool). */
+    IESYS_POOL_LIST pool[_ESYS_POOL_LISTS];/**< The lists of freed resource
+                                      objects and temporaries for reuse. */
+    ESYS_CRYPTO_CALLBACKS crypto_backend;/**< The crypto callbacks used by
+                                      this context. */
+    struct _IESYS_CRYPTO_HASH_CACHE *hash_cache; /**< The digest contexts
+                                      reused for cpHash and rpHash. */
+    uint8_t shared_cache;        /**< Whether Esys_TR_FromTPMPublic uses the
+                                      process wide metadata cache. */
+    uint8_t cache_hit;           /**< Whether the pending
+                                      Esys_TR_FromTPMPublic was served from the
+                                      cache. */
+    uint64_t cache_generation;   /**< The generation of the shared cache when
+                                      the pending Esys_TR_FromTPMPublic read
+                                      the metadata from the TPM. */
 };
 
 /** The number of authomatic resubmissions.
@@ -191,6 +231,13 @@ struct ESYS_CONTEXT {
  */
 #define _ESYS_MAX_SUBMISSIONS 5
 
+/** The initial number of buckets of the resource table.
+ *
+ * The table is doubled whenever the number of objects exceeds the number of
+ * buckets. Must be a power of two.
+ */
+#define _ESYS_RSRC_TABLE_MIN_SIZE 16
+
 /** Makro testing parameters against null.
  */
 #define _ESYS_ASSERT_NON_NULL(x) \
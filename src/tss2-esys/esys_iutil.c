@@ -136,9 +136,191 @@ init_session_tab(ESYS_CONTEXT *esys_context,
     return r;
 }
 
+/** Allocate a zeroed block from the pool of the esys context.
+ *
+ * If a block of the requested size has been freed before via iesys_pool_free
+ * it is reused, otherwise a new block is allocated from the heap. Blocks are
+ * ordinary heap blocks, so they may also be released with free().
+ * @param[in,out] esys_context The ESYS_CONTEXT
+ * @param[in] size The size of the block.
+ * @retval The zeroed block or NULL if it can not be allocated.
+ */
+void *
+iesys_pool_calloc(ESYS_CONTEXT * esys_context, size_t size)
+{
+    size_t i;
+    void *block;
+
+    for (i = 0; i < _ESYS_POOL_LISTS; i++) {
+        if (esys_context->pool[i].size == size &&
+            esys_context->pool[i].count > 0) {
+            block = esys_context->pool[i].blocks;
+            esys_context->pool[i].blocks = *(void **) block;
+            esys_context->pool[i].count -= 1;
+            /* Pooled blocks are zeroed apart from the list link */
+            *(void **) block = NULL;
+            return block;
+        }
+    }
+    return calloc(1, size);
+}
+
+/** Return a block to the pool of the esys context.
+ *
+ * The block is cached for reuse by iesys_pool_calloc if the pool is enabled
+ * and not full for this size. Otherwise it is freed. A cached block is
+ * zeroed first, so that auth values and session keys of resource objects do
+ * not linger in the pool.
+ * @param[in,out] esys_context The ESYS_CONTEXT
+ * @param[in] block The heap block to release (may be NULL).
+ * @param[in] size The size the block was allocated with.
+ */
+void
+iesys_pool_free(ESYS_CONTEXT * esys_context, void *block, size_t size)
+{
+    size_t i;
+    IESYS_POOL_LIST *list = NULL;
+
+    if (block == NULL)
+        return;
+
+    if (esys_context->pool_size > 0 && size >= sizeof(void *)) {
+        for (i = 0; i < _ESYS_POOL_LISTS; i++) {
+            if (esys_context->pool[i].size == size) {
+                list = &esys_context->pool[i];
+                break;
+            }
+            if (list == NULL && esys_context->pool[i].size == 0)
+                list = &esys_context->pool[i];
+        }
+    }
+    if (list == NULL || list->count >= esys_context->pool_size) {
+        free(block);
+        return;
+    }
+    list->size = size;
+    memset(block, 0, size);
+    *(void **) block = list->blocks;
+    list->blocks = block;
+    list->count += 1;
+}
+
+/** Shrink the pool of the esys context to its configured size.
+ *
+ * Cached blocks exceeding pool_size are freed. If pool_size is 0 all cached
+ * blocks are freed.
+ * @param[in,out] esys_context The ESYS_CONTEXT
+ */
+void
+iesys_pool_trim(ESYS_CONTEXT * esys_context)
+{
+    size_t i;
+    void *block;
+
+    for (i = 0; i < _ESYS_POOL_LISTS; i++) {
+        while (esys_context->pool[i].count > esys_context->pool_size) {
+            block = esys_context->pool[i].blocks;
+            esys_context->pool[i].blocks = *(void **) block;
+            esys_context->pool[i].count -= 1;
+            free(block);
+        }
+        if (esys_context->pool[i].count == 0)
+            esys_context->pool[i].size = 0;
+    }
+}
+
+/** Compute the bucket of the resource table for an esys handle.
+ *
+ * Object handles are handed out sequentially, so folding the upper half onto
+ * the lower half spreads both object handles and the small "global" handles
+ * evenly across the buckets.
+ * @param[in] esys_context The ESYS_CONTEXT
+ * @param[in] esys_handle The esys handle to compute the bucket for.
+ * @retval The index of the bucket within rsrc_table.
+ */
+static size_t
+iesys_rsrc_bucket(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle)
+{
+    return (esys_handle ^ (esys_handle >> 16)) &
+           (esys_context->rsrc_table_size - 1);
+}
+
+/** Resize the resource table of the esys context.
+ *
+ * All resource objects are rehashed into a newly allocated table. The
+ * resource objects themselves are not moved, so pointers to them stay valid.
+ * @param[in,out] esys_context The ESYS_CONTEXT
+ * @param[in] size The new number of buckets (must be a power of two).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if the table can not be allocated.
+ */
+static TSS2_RC
+iesys_rsrc_table_resize(ESYS_CONTEXT * esys_context, size_t size)
+{
+    RSRC_NODE_T **old_table = esys_context->rsrc_table;
+    size_t old_size = esys_context->rsrc_table_size;
+    RSRC_NODE_T *node_rsrc;
+    RSRC_NODE_T *next_node_rsrc;
+    size_t i, bucket;
+
+    esys_context->rsrc_table = calloc(size, sizeof(RSRC_NODE_T *));
+    if (esys_context->rsrc_table == NULL) {
+        esys_context->rsrc_table = old_table;
+        return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
+    }
+    esys_context->rsrc_table_size = size;
+
+    for (i = 0; i < old_size; i++) {
+        for (node_rsrc = old_table[i]; node_rsrc != NULL;
+             node_rsrc = next_node_rsrc) {
+            next_node_rsrc = node_rsrc->next;
+            bucket = iesys_rsrc_bucket(esys_context, node_rsrc->esys_handle);
+            node_rsrc->next = esys_context->rsrc_table[bucket];
+            esys_context->rsrc_table[bucket] = node_rsrc;
+        }
+    }
+    SAFE_FREE(old_table);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Delete a resource object stored in the esys context.
+ *
+ * The resource object is removed from the resource table of the esys context
+ * and returned to the pool.
+ * @param[in,out] esys_context The ESYS_CONTEXT
+ * @param[in] esys_handle The esys handle of the object to be deleted.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_TR if no object with this handle exists.
+ */
+TSS2_RC
+iesys_DeleteResourceObject(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle)
+{
+    RSRC_NODE_T *node_rsrc;
+    RSRC_NODE_T **update_ptr;
+
+    if (esys_context->rsrc_table_size == 0)
+        return TSS2_ESYS_RC_BAD_TR;
+
+    for (update_ptr = &esys_context->rsrc_table[
+                          iesys_rsrc_bucket(esys_context, esys_handle)];
+         *update_ptr != NULL;
+         update_ptr = &node_rsrc->next) {
+        node_rsrc = *update_ptr;
+        if (node_rsrc->esys_handle == esys_handle) {
+            *update_ptr = node_rsrc->next;
+            iesys_crypto_hmac_cache_free(&node_rsrc->hmac_cache);
+            iesys_pool_free(esys_context, node_rsrc, sizeof(RSRC_NODE_T));
+            esys_context->rsrc_count -= 1;
+            return TSS2_RC_SUCCESS;
+        }
+    }
+    return TSS2_ESYS_RC_BAD_TR;
+}
+
 /** Delete all resource objects stored in the esys context.
  *
- * All resource objects stored in a linked list of the esys context are deleted.
+ * All resource objects stored in the resource table of the esys context are
+ * deleted and the table itself is freed.
  * @param[in,out] esys_context The ESYS_CONTEXT
  */
 void
@@ -146,12 +328,19 @@ iesys_DeleteAllResourceObjects(ESYS_CONTEXT * esys_context)
 {
     RSRC_NODE_T *node_rsrc;
     RSRC_NODE_T *next_node_rsrc;
-    for (node_rsrc = esys_context->rsrc_list; node_rsrc != NULL;
-         node_rsrc = next_node_rsrc) {
-        next_node_rsrc = node_rsrc->next;
-        SAFE_FREE(node_rsrc);
+    size_t i;
+
+    for (i = 0; i < esys_context->rsrc_table_size; i++) {
+        for (node_rsrc = esys_context->rsrc_table[i]; node_rsrc != NULL;
+             node_rsrc = next_node_rsrc) {
+            next_node_rsrc = node_rsrc->next;
+            iesys_crypto_hmac_cache_free(&node_rsrc->hmac_cache);
+            iesys_pool_free(esys_context, node_rsrc, sizeof(RSRC_NODE_T));
+        }
     }
-    esys_context->rsrc_list = NULL;
+    SAFE_FREE(esys_context->rsrc_table);
+    esys_context->rsrc_table_size = 0;
+    esys_context->rsrc_count = 0;
 }
 /**  Compute the TPM nonce of the session used for parameter encryption.
  *
@@ -186,6 +375,38 @@ iesys_compute_encrypt_nonce(ESYS_CONTEXT * esys_context,
     return TSS2_RC_SUCCESS;
 }
 
+/** Collect the hash algorithms of the sessions.
+ *
+ * Every hash algorithm used by one of the first sessions_count sessions is
+ * entered once into the table, so that the parameter hash is computed only
+ * once per algorithm.
+ * @param[in] esys_context The ESYS_CONTEXT
+ * @param[in] sessions_count The number of session slots to inspect.
+ * @param[out] hash_tab The table receiving the algorithms.
+ * @param[out] hashNum The number of distinct algorithms.
+ */
+static void
+iesys_collect_hash_algs(ESYS_CONTEXT * esys_context,
+                        int sessions_count,
+                        HASH_TAB_ITEM hash_tab[3], uint8_t * hashNum)
+{
+    *hashNum = 0;
+    for (int i = 0; i < sessions_count && i < 3; i++) {
+        RSRC_NODE_T *session = esys_context->session_tab[i];
+        if (session == NULL)
+            continue;
+        TPM2_ALG_ID authHash = session->rsrc.misc.rsrc_session.authHash;
+        int j;
+        for (j = 0; j < *hashNum; j++)
+            if (hash_tab[j].alg == authHash)
+                break;
+        if (j == *hashNum) {
+            hash_tab[*hashNum].alg = authHash;
+            *hashNum += 1;
+        }
+    }
+}
+
 /** Computation of the command parameter(cp) hashes.
  *
  * The command parameter(cp) hash of the command is computed for every
@@ -193,6 +414,8 @@ iesys_compute_encrypt_nonce(ESYS_CONTEXT * esys_context,
  * hashes must be calculated.
  * The names of objects with an auth index and the command buffer are used
  * to compute the cp hash with the hash algorithm of the corresponding session.
+ * The command buffer is read only once, all cp hashes are computed in the
+ * same pass.
  * The result is stored in table together with the used hash algorithm.
  * @param[in] esys_context The ESYS_CONTEXT
  * @param[in] name1 The name of the first object with an auth index.
@@ -222,36 +445,14 @@ iesys_compute_cp_hashtab(ESYS_CONTEXT * esys_context,
     size_t cpBuffer_size;
     r = Tss2_Sys_GetCpBuffer(esys_context->sys, &cpBuffer_size, &cpBuffer);
     return_if_error(r, "Error: get cp buffer");
-    *cpHashNum = 0;
-    for (int i = 0; i < 3; i++) {
-        RSRC_NODE_T *session = esys_context->session_tab[i];
-        bool cpHashFound = false;
-        if (session != NULL) {
-            /* We do not want to compute cpHashes multiple times for the same
-               algorithm to save time and space */
-            for (int j = 0; j < *cpHashNum; j++)
-                /* Check if cpHash for this algorithm was already computed */
-                if (cp_hash_tab[j].alg ==
-                    session->rsrc.misc.rsrc_session.authHash) {
-                    cpHashFound = true;
-                    break;
-                }
-            /* If not, we compute it and append it to the list */
-            if (!cpHashFound) {
-                cp_hash_tab[*cpHashNum].size = sizeof(TPMU_HA);
-                r = iesys_crypto_cpHash(session->rsrc.misc.rsrc_session.
-                                        authHash, ccBuffer, name1, name2, name3,
-                                        cpBuffer, cpBuffer_size,
-                                        &cp_hash_tab[*cpHashNum].digest[0],
-                                        &cp_hash_tab[*cpHashNum].size);
-                return_if_error(r, "crypto cpHash");
-
-                cp_hash_tab[*cpHashNum].alg =
-                    session->rsrc.misc.rsrc_session.authHash;
-                *cpHashNum += 1;
-            }
-        }
-    }
+
+    iesys_collect_hash_algs(esys_context, 3, cp_hash_tab, cpHashNum);
+    r = iesys_crypto_pHash_tab(&esys_context->crypto_backend,
+                               &esys_context->hash_cache,
+                               NULL, ccBuffer, name1, name2, name3,
+                               cpBuffer, cpBuffer_size,
+                               cp_hash_tab, *cpHashNum);
+    return_if_error(r, "crypto cpHash");
     return r;
 }
 
@@ -259,11 +460,10 @@ iesys_compute_cp_hashtab(ESYS_CONTEXT * esys_context,
  * The response parameter (rp) hash of the response is computed for every
  * session.  If the sessions use different hash algorithms then different rp
  * hashes must be calculated.
- * The names of objects with an auth index and the command buffer are used
- * to compute the cp hash with the hash algorithm of the corresponding session.
+ * The response buffer is read only once, all rp hashes are computed in the
+ * same pass.
  * The result is stored in table together with the used hash algorithm.
  * @param[in] esys_context The ESYS_CONTEXT
- * @param[in] rspAuths List of response
  * @param[in] const uint8_t * rpBuffer The pointer to the response buffer
  * @param[in] size_t rpBuffer_size The size of the response.
  * @param[out] HASH_TAB_ITEM rp_hash_tab[3] An array with all rp hashes.
@@ -287,37 +487,20 @@ iesys_compute_rp_hashtab(ESYS_CONTEXT * esys_context,
     TSS2_RC r = Tss2_Sys_GetCommandCode(esys_context->sys, &ccBuffer[0]);
     return_if_error(r, "Error: get command code");
 
-    for (int i = 0; i < esys_context->authsCount; i++) {
-        RSRC_NODE_T *session = esys_context->session_tab[i];
-        if (session == NULL)
-            continue;
-        bool rpHashFound = false;
-        /* We do not want to compute cpHashes multiple times for the same
-           algorithm to save time and space */
-        for (int j = 0; j < *rpHashNum; j++)
-            if (rp_hash_tab[j].alg == session->rsrc.misc.rsrc_session.authHash) {
-                rpHashFound = true;
-                break;
-            }
-        /* If not, we compute it and append it to the list */
-        if (!rpHashFound) {
-            rp_hash_tab[*rpHashNum].size = sizeof(TPMU_HA);
-            r = iesys_crypto_rpHash(session->rsrc.misc.rsrc_session.authHash,
-                                    rcBuffer, ccBuffer, rpBuffer, rpBuffer_size,
-                                    &rp_hash_tab[*rpHashNum].digest[0],
-                                    &rp_hash_tab[*rpHashNum].size);
-            return_if_error(r, "crypto rpHash");
-            rp_hash_tab[*rpHashNum].alg =
-                session->rsrc.misc.rsrc_session.authHash;
-            *rpHashNum += 1;
-        }
-    }
+    iesys_collect_hash_algs(esys_context, esys_context->authsCount,
+                            rp_hash_tab, rpHashNum);
+    r = iesys_crypto_pHash_tab(&esys_context->crypto_backend,
+                               &esys_context->hash_cache,
+                               rcBuffer, ccBuffer, NULL, NULL, NULL,
+                               rpBuffer, rpBuffer_size,
+                               rp_hash_tab, *rpHashNum);
+    return_if_error(r, "crypto rpHash");
     return TPM2_RC_SUCCESS;
 }
 /** Create an esys resource object corresponding to a TPM object.
  *
- * The esys object is appended to the resource list stored in the esys context
- * (rsrc_list).
+ * The esys object is inserted into the resource table stored in the esys
+ * context (rsrc_table). The table is grown if it becomes too crowded.
  * @param[in] esys_context The ESYS_CONTEXT
  * @param[in] esys_handle The esys handle which will be used for this object.
  * @param[out] esys_object The new resource object.
@@ -328,18 +511,28 @@ TSS2_RC
 esys_CreateResourceObject(ESYS_CONTEXT * esys_context,
                           ESYS_TR esys_handle, RSRC_NODE_T ** esys_object)
 {
-    RSRC_NODE_T *new_esys_object = calloc(1, sizeof(RSRC_NODE_T));
+    TSS2_RC r;
+    size_t bucket;
+    RSRC_NODE_T *new_esys_object;
+
+    if (esys_context->rsrc_count >= esys_context->rsrc_table_size) {
+        r = iesys_rsrc_table_resize(esys_context,
+                                    (esys_context->rsrc_table_size == 0) ?
+                                    _ESYS_RSRC_TABLE_MIN_SIZE :
+                                    esys_context->rsrc_table_size * 2);
+        return_if_error(r, "Resize resource table.");
+    }
+
+    new_esys_object = iesys_pool_calloc(esys_context, sizeof(RSRC_NODE_T));
     if (new_esys_object == NULL)
         return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
-    if (esys_context->rsrc_list == NULL) {
-        /* The first object of the list will be added */
-        esys_context->rsrc_list = new_esys_object;
-        new_esys_object->next = NULL;
-    } else {
-        /* The new object will become the first element of the list */
-        new_esys_object->next = esys_context->rsrc_list;
-        esys_context->rsrc_list = new_esys_object;
-    }
+
+    /* The new object will become the first element of its bucket */
+    bucket = iesys_rsrc_bucket(esys_context, esys_handle);
+    new_esys_object->next = esys_context->rsrc_table[bucket];
+    esys_context->rsrc_table[bucket] = new_esys_object;
+    esys_context->rsrc_count += 1;
+
     *esys_object = new_esys_object;
     new_esys_object->esys_handle = esys_handle;
     return TSS2_RC_SUCCESS;
@@ -437,18 +630,20 @@ iesys_get_handle_type(TPM2_HANDLE handle)
  *
  * A tpm name is computed from a public info structure and compared with a
  * second tpm name.
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in]  publicInfo The public info for name computation.
  * @param[in] name The name used for comparison.
  * @retval bool indicates whether the names are equal.
  */
 bool
-iesys_compare_name(TPM2B_PUBLIC * publicInfo, TPM2B_NAME * name)
+iesys_compare_name(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                   TPM2B_PUBLIC * publicInfo, TPM2B_NAME * name)
 {
     TSS2_RC r = TSS2_RC_SUCCESS;
     TPM2B_NAME public_info_name;
     if (publicInfo == NULL || name == NULL)
         return false;
-    r = iesys_get_name(publicInfo, &public_info_name);
+    r = iesys_get_name(crypto_cb, publicInfo, &public_info_name);
     if (r != TSS2_RC_SUCCESS) {
         LOG_DEBUG("name could not be computed.");
         return false;
@@ -507,13 +702,14 @@ iesys_compute_encrypted_salt(ESYS_CONTEXT * esys_context,
     switch (pub.publicArea.type) {
     case TPM2_ALG_RSA:
 
-        iesys_crypto_random2b((TPM2B_NONCE *) & esys_context->salt,
+        iesys_crypto_random2b(&esys_context->crypto_backend,
+                              (TPM2B_NONCE *) & esys_context->salt,
                               keyHash_size);
 
         /* When encrypting salts, the encryption scheme of a key is ignored and
            TPM2_ALG_OAEP is always used. */
         pub.publicArea.parameters.rsaDetail.scheme.scheme = TPM2_ALG_OAEP;
-        r = iesys_crypto_pk_encrypt(&pub,
+        r = iesys_crypto_pk_encrypt(&esys_context->crypto_backend, &pub,
                                     keyHash_size, &esys_context->salt.buffer[0],
                                     sizeof(TPMU_ENCRYPTED_SECRET),
                                     (BYTE *) &encryptedSalt->secret[0], &cSize,
@@ -523,7 +719,8 @@ iesys_compute_encrypted_salt(ESYS_CONTEXT * esys_context,
         encryptedSalt->size = cSize;
         break;
     case TPM2_ALG_ECC:
-        r = iesys_crypto_get_ecdh_point(&pub, sizeof(TPMU_ENCRYPTED_SECRET),
+        r = iesys_crypto_get_ecdh_point(&esys_context->crypto_backend,
+                                        &pub, sizeof(TPMU_ENCRYPTED_SECRET),
                                         &Z, &Q,
                                         (BYTE *) &encryptedSalt->secret[0],
                                         &cSize);
@@ -531,7 +728,8 @@ iesys_compute_encrypted_salt(ESYS_CONTEXT * esys_context,
         encryptedSalt->size = cSize;
 
         /* Compute salt from Z with KDFe */
-        r = iesys_crypto_KDFe(tpmKeyNode->rsrc.misc.
+        r = iesys_crypto_KDFe(&esys_context->crypto_backend,
+                              tpmKeyNode->rsrc.misc.
                               rsrc_key_pub.publicArea.nameAlg,
                               &Z, "SECRET", &Q.x,
                               &pub.publicArea.unique.ecc.x,
@@ -567,7 +765,8 @@ iesys_gen_caller_nonces(ESYS_CONTEXT * esys_context)
         if (session == NULL)
             continue;
 
-        r = iesys_crypto_random2b(&session->rsrc.misc.rsrc_session.nonceCaller,
+        r = iesys_crypto_random2b(&esys_context->crypto_backend,
+                                  &session->rsrc.misc.rsrc_session.nonceCaller,
                                   session->rsrc.misc.rsrc_session.nonceCaller.size);
         return_if_error(r, "Error: computing caller nonce (%x).");
     }
@@ -721,7 +920,8 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
                     return_error(TSS2_ESYS_RC_BAD_VALUE,
                                  "Invalid symmetric mode (must be CFB)");
                 }
-                r = iesys_crypto_KDFa(rsrc_session->authHash,
+                r = iesys_crypto_KDFa(&esys_context->crypto_backend,
+                                      rsrc_session->authHash,
                                       &rsrc_session->sessionValue[0],
                                       rsrc_session->sizeSessionValue, "CFB",
                                       &rsrc_session->nonceCaller,
@@ -731,7 +931,8 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
                 return_if_error(r, "while computing KDFa");
 
                 size_t aes_off = ( symDef->keyBits.aes + 7) / 8;
-                r = iesys_crypto_sym_aes_encrypt(&symKey[0],
+                r = iesys_crypto_sym_aes_encrypt(&esys_context->crypto_backend,
+                                                 &symKey[0],
                                                  symDef->algorithm,
                                                  symDef->keyBits.aes,
                                                  symDef->mode.aes,
@@ -741,7 +942,8 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
             }
             /* XOR obfuscation of parameter */
             else if (symDef->algorithm == TPM2_ALG_XOR) {
-                r = iesys_xor_parameter_obfuscation(rsrc_session->authHash,
+                r = iesys_xor_parameter_obfuscation(&esys_context->crypto_backend,
+                                                    rsrc_session->authHash,
                                                     &rsrc_session->sessionValue[0],
                                                     rsrc_session->sizeSessionValue,
                                                     &rsrc_session->nonceCaller,
@@ -815,7 +1017,8 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context)
                       rsrc_session->sessionKey.size,
                       "IESYS encrypt session key");
 
-        r = iesys_crypto_KDFa(rsrc_session->authHash,
+        r = iesys_crypto_KDFa(&esys_context->crypto_backend,
+                              rsrc_session->authHash,
                               &rsrc_session->sessionValue[0],
                               rsrc_session->sizeSessionValue,
                               "CFB", &rsrc_session->nonceTPM,
@@ -830,7 +1033,8 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context)
                       "IESYS encrypt KDFa key");
 
         size_t aes_off = ( symDef->keyBits.aes + 7) / 8;
-        r = iesys_crypto_sym_aes_decrypt(&symKey[0],
+        r = iesys_crypto_sym_aes_decrypt(&esys_context->crypto_backend,
+                                         &symKey[0],
                                      symDef->algorithm,
                                      symDef->keyBits.aes,
                                      symDef->mode.aes,
@@ -842,7 +1046,8 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context)
         return_if_error(r, "Setting plaintext");
     } else if (symDef->algorithm == TPM2_ALG_XOR) {
         /* Parameter decryption with XOR obfuscation */
-        r = iesys_xor_parameter_obfuscation(rsrc_session->authHash,
+        r = iesys_xor_parameter_obfuscation(&esys_context->crypto_backend,
+                                            rsrc_session->authHash,
                                             &rsrc_session->sessionValue[0],
                                             rsrc_session->sizeSessionValue,
                                             &rsrc_session->nonceTPM,
@@ -915,7 +1120,9 @@ iesys_check_rp_hmacs(ESYS_CONTEXT * esys_context,
         rsrc_session->nonceTPM = rspAuths->auths[i].nonce;
         rsrc_session->sessionAttributes =
             rspAuths->auths[i].sessionAttributes;
-        r = iesys_crypto_authHmac(rsrc_session->authHash,
+        r = iesys_crypto_authHmac(&esys_context->crypto_backend,
+                                  rsrc_session->authHash,
+                                  &session->hmac_cache,
                                   &rsrc_session->sessionValue[0],
                                   rsrc_session->sizeHmacValue,
                                   &rp_hash_tab[hi].digest[0],
@@ -1077,16 +1284,20 @@ esys_GetResourceObject(ESYS_CONTEXT * esys_context,
     }
 
     /* The typical case is that we have a resource object already within the
-       esys context's linked list. We iterate through the list and search
+       esys context's resource table. We search the bucket of the handle
        for the corresponding object and return it if found.
        If no object is found, this can be an erroneous handle number or it
        can be because of a reference "global" object that does not require
        previous initialization. */
-    for (esys_object_aux = esys_context->rsrc_list; esys_object_aux != NULL;
-         esys_object_aux = esys_object_aux->next) {
-        if (esys_object_aux->esys_handle == esys_handle) {
-            *esys_object = esys_object_aux;
-            return TPM2_RC_SUCCESS;
+    if (esys_context->rsrc_table_size != 0) {
+        for (esys_object_aux = esys_context->rsrc_table[
+                                   iesys_rsrc_bucket(esys_context, esys_handle)];
+             esys_object_aux != NULL;
+             esys_object_aux = esys_object_aux->next) {
+            if (esys_object_aux->esys_handle == esys_handle) {
+                *esys_object = esys_object_aux;
+                return TPM2_RC_SUCCESS;
+            }
         }
     }
 
@@ -1187,6 +1398,7 @@ check_session_feasibility(ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3,
  * The HMAC is computed from the appropriate cp hash, the caller nonce, the TPM
  * nonce and the session attributes. If an encrypt session is not the first
  * session also the encrypt and the decrypt nonce have to be included.
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in] session The session for which the HMAC has to be computed.
  * @param[in] cp_hash_tab The table of computed cp hash values.
  * @param[in] cpHashNum The number of computed cp hash values which depens on
@@ -1205,7 +1417,8 @@ check_session_feasibility(ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3,
  * @retval TSS2_SYS_RC_* for SAPI errors.
  */
 TSS2_RC
-iesys_compute_hmac(RSRC_NODE_T * session,
+iesys_compute_hmac(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                   RSRC_NODE_T * session,
                    HASH_TAB_ITEM cp_hash_tab[3],
                    uint8_t cpHashNum,
                    TPM2B_NONCE * decryptNonce,
@@ -1232,7 +1445,8 @@ iesys_compute_hmac(RSRC_NODE_T * session,
         /* if other than first session is used for for parameter encryption
            the corresponding nonces have to be included into the hmac
            computation of the first session */
-        r = iesys_crypto_authHmac(rsrc_session->authHash,
+        r = iesys_crypto_authHmac(crypto_cb, rsrc_session->authHash,
+                                  &session->hmac_cache,
                                   &rsrc_session->sessionValue[0],
                                   rsrc_session->sizeHmacValue,
                                   &cp_hash_tab[hi].digest[0],
@@ -1344,7 +1558,8 @@ iesys_gen_auths(ESYS_CONTEXT * esys_context,
                 continue;
             }
         }
-        r = iesys_compute_hmac(esys_context->session_tab[session_idx],
+        r = iesys_compute_hmac(&esys_context->crypto_backend,
+                               esys_context->session_tab[session_idx],
                                &cp_hash_tab[0], cpHashNum,
                                (session_idx == 0
                                 && decryptNonceIdx > 0) ? decryptNonce : NULL,
@@ -1439,6 +1654,7 @@ iesys_check_response(ESYS_CONTEXT * esys_context)
  *
  * The name of a NV index is computed as follows:
  *   name =  nameAlg||Hash(nameAlg,marshal(publicArea))
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in] publicInfo The public information of the NV index.
  * @param[out] name The computed name.
  * @retval TSS2_RC_SUCCESS on success.
@@ -1450,7 +1666,8 @@ iesys_check_response(ESYS_CONTEXT * esys_context)
  * @retval TSS2_SYS_RC_* for SAPI errors.
  */
 TSS2_RC
-iesys_nv_get_name(TPM2B_NV_PUBLIC * publicInfo, TPM2B_NAME * name)
+iesys_nv_get_name(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                  TPM2B_NV_PUBLIC * publicInfo, TPM2B_NAME * name)
 {
     BYTE buffer[sizeof(TPMS_NV_PUBLIC)];
     size_t offset = 0;
@@ -1463,7 +1680,8 @@ iesys_nv_get_name(TPM2B_NV_PUBLIC * publicInfo, TPM2B_NAME * name)
         return TSS2_RC_SUCCESS;
     }
     TSS2_RC r;
-    r = iesys_crypto_hash_start(&cryptoContext, publicInfo->nvPublic.nameAlg);
+    r = iesys_crypto_hash_start(crypto_cb,
+                                &cryptoContext, publicInfo->nvPublic.nameAlg);
     return_if_error(r, "Crypto hash start");
 
     r = Tss2_MU_TPMS_NV_PUBLIC_Marshal(&publicInfo->nvPublic,
@@ -1471,10 +1689,11 @@ iesys_nv_get_name(TPM2B_NV_PUBLIC * publicInfo, TPM2B_NAME * name)
                                        &offset);
     goto_if_error(r, "Marshaling TPMS_NV_PUBLIC", error_cleanup);
 
-    r = iesys_crypto_hash_update(cryptoContext, &buffer[0], offset);
+    r = iesys_crypto_hash_update(crypto_cb, cryptoContext, &buffer[0], offset);
     goto_if_error(r, "crypto hash update", error_cleanup);
 
-    r = iesys_crypto_hash_finish(&cryptoContext, &name->name[len_alg_id],
+    r = iesys_crypto_hash_finish(crypto_cb,
+                                 &cryptoContext, &name->name[len_alg_id],
                                      &size);
     goto_if_error(r, "crypto hash finish", error_cleanup);
 
@@ -1489,7 +1708,7 @@ iesys_nv_get_name(TPM2B_NV_PUBLIC * publicInfo, TPM2B_NAME * name)
 
 error_cleanup:
     if (cryptoContext)
-        iesys_crypto_hash_abort(&cryptoContext);
+        iesys_crypto_hash_abort(crypto_cb, &cryptoContext);
     return r;
 }
 
@@ -1497,6 +1716,7 @@ error_cleanup:
  *
  * The name of a NV index is computed as follows:
  *   name = Hash(nameAlg,marshal(publicArea))
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in] publicInfo The public information of the TPM object.
  * @param[out] name The computed name.
  * @retval TPM2_RC_SUCCESS  or one of the possible errors TSS2_ESYS_RC_BAD_VALUE,
@@ -1504,7 +1724,8 @@ error_cleanup:
  * or return codes of SAPI errors.
  */
 TSS2_RC
-iesys_get_name(TPM2B_PUBLIC * publicInfo, TPM2B_NAME * name)
+iesys_get_name(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+               TPM2B_PUBLIC * publicInfo, TPM2B_NAME * name)
 {
     BYTE buffer[sizeof(TPMT_PUBLIC)];
     size_t offset = 0;
@@ -1517,17 +1738,19 @@ iesys_get_name(TPM2B_PUBLIC * publicInfo, TPM2B_NAME * name)
         return TSS2_RC_SUCCESS;
     }
     TSS2_RC r;
-    r = iesys_crypto_hash_start(&cryptoContext, publicInfo->publicArea.nameAlg);
+    r = iesys_crypto_hash_start(crypto_cb,
+                                &cryptoContext, publicInfo->publicArea.nameAlg);
     return_if_error(r, "crypto hash start");
 
     r = Tss2_MU_TPMT_PUBLIC_Marshal(&publicInfo->publicArea,
                                     &buffer[0], sizeof(TPMT_PUBLIC), &offset);
     goto_if_error(r, "Marshaling TPMT_PUBLIC", error_cleanup);
 
-    r = iesys_crypto_hash_update(cryptoContext, &buffer[0], offset);
+    r = iesys_crypto_hash_update(crypto_cb, cryptoContext, &buffer[0], offset);
     goto_if_error(r, "crypto hash update", error_cleanup);
 
-    r = iesys_crypto_hash_finish(&cryptoContext, &name->name[len_alg_id],
+    r = iesys_crypto_hash_finish(crypto_cb,
+                                 &cryptoContext, &name->name[len_alg_id],
                                      &size);
     goto_if_error(r, "crypto hash finish", error_cleanup);
 
@@ -1542,10 +1765,105 @@ iesys_get_name(TPM2B_PUBLIC * publicInfo, TPM2B_NAME * name)
 
 error_cleanup:
     if (cryptoContext)
-        iesys_crypto_hash_abort(&cryptoContext);
+        iesys_crypto_hash_abort(crypto_cb, &cryptoContext);
     return r;
 }
 
+/** Compute the name of a key or NV index resource, memoized in the resource.
+ *
+ * Marshaling and hashing the public area is skipped if the name of the
+ * resource is known to match its current public area. Otherwise the name is
+ * computed and, if it equals the name stored in the resource, remembered as
+ * matching. Code changing the public area of a resource has to reset
+ * rsrc->nameComputed. For other resource types the name is not computed and
+ * TSS2_ESYS_RC_BAD_VALUE is returned.
+ * name may point to rsrc->name to update the stored name.
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[in,out] rsrc The resource.
+ * @param[out] name The computed name.
+ * @retval TPM2_RC_SUCCESS  or one of the possible errors TSS2_ESYS_RC_BAD_VALUE,
+ * TSS2_ESYS_RC_MEMORY, TSS2_ESYS_RC_GENERAL_FAILURE, TSS2_ESYS_RC_NOT_IMPLEMENTED,
+ * or return codes of SAPI errors.
+ */
+TSS2_RC
+iesys_rsrc_get_name(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                    IESYS_RESOURCE * rsrc, TPM2B_NAME * name)
+{
+    TSS2_RC r;
+
+    if (rsrc->nameComputed) {
+        if (name != &rsrc->name)
+            *name = rsrc->name;
+        return TSS2_RC_SUCCESS;
+    }
+
+    if (rsrc->rsrcType == IESYSC_KEY_RSRC) {
+        r = iesys_get_name(crypto_cb, &rsrc->misc.rsrc_key_pub, name);
+    } else if (rsrc->rsrcType == IESYSC_NV_RSRC) {
+        r = iesys_nv_get_name(crypto_cb, &rsrc->misc.rsrc_nv_pub, name);
+    } else {
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Resource has no public area.");
+    }
+    return_if_error(r, "Error get name");
+
+    rsrc->nameComputed = cmp_TPM2B_NAME(name, &rsrc->name);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Compute the flags of the compact record of a resource.
+ *
+ * The name of keys and NV indices is derivable from their public area. It is
+ * omitted from the record if recomputing it yields the stored name; a name
+ * that can not be recomputed (e.g. due to an unsupported hash algorithm) is
+ * kept.
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[in,out] rsrc The resource to be serialized.
+ * @retval The IESYS_COMPACT_* flags for the record of the resource.
+ */
+UINT8
+iesys_rsrc_compact_flags(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                         IESYS_RESOURCE * rsrc)
+{
+    TPM2B_NAME name;
+
+    if (rsrc->rsrcType != IESYSC_KEY_RSRC && rsrc->rsrcType != IESYSC_NV_RSRC)
+        return 0;
+    if (iesys_rsrc_get_name(crypto_cb, rsrc, &name) != TSS2_RC_SUCCESS)
+        return 0;
+    return rsrc->nameComputed ? IESYS_COMPACT_NAME_DERIVED : 0;
+}
+
+/** Unmarshal a resource from its compact record.
+ *
+ * A name omitted from the record is recomputed from the public area.
+ * @param[in] crypto_cb The crypto callbacks.
+ * @param[in] buffer Buffer to read data from.
+ * @param[in] size Size of the buffer.
+ * @param[in,out] offset Offset inside the buffer.
+ * @param[out] rsrc The resource.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by iesys_MU_IESYS_RESOURCE_Compact_Unmarshal and
+ *         iesys_rsrc_get_name.
+ */
+TSS2_RC
+iesys_rsrc_compact_unmarshal(ESYS_CRYPTO_CALLBACKS * crypto_cb,
+                             const uint8_t * buffer, size_t size,
+                             size_t * offset, IESYS_RESOURCE * rsrc)
+{
+    TSS2_RC r;
+    UINT8 flags;
+
+    r = iesys_MU_IESYS_RESOURCE_Compact_Unmarshal(buffer, size, offset, rsrc,
+                                                  &flags);
+    return_if_error(r, "Unmarshal resource");
+
+    if (flags & IESYS_COMPACT_NAME_DERIVED) {
+        r = iesys_rsrc_get_name(crypto_cb, rsrc, &rsrc->name);
+        return_if_error(r, "Compute name");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
 /** Check whether the return code corresponds to an TPM error.
  *
  * if no layer is part of the return code or a layer from the resource manager
@@ -1569,6 +1887,7 @@ iesys_tpm_error(TSS2_RC r)
  * if the size of auth value exceeds hash_size the auth value
  * will be replaced with the hash of the auth value.
  *
+ * @param[in] crypto_cb The crypto callbacks.
  * @param[in,out] auth_value The auth value to be adapted.
  * @param[in] hash_alg The hash alg used for adaption.
  * @retval TSS2_RC_SUCCESS if the function call was a success.
@@ -1579,6 +1898,7 @@ iesys_tpm_error(TSS2_RC r)
  */
 TSS2_RC
 iesys_hash_long_auth_values(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2B_AUTH *auth_value,
     TPMI_ALG_HASH hash_alg)
 {
@@ -1592,14 +1912,16 @@ iesys_hash_long_auth_values(
 
     if (auth_value && auth_value->size > hash_size) {
         /* The auth value has to be adapted. */
-        r = iesys_crypto_hash_start(&cryptoContext, hash_alg);
+        r = iesys_crypto_hash_start(crypto_cb, &cryptoContext, hash_alg);
         return_if_error(r, "crypto hash start");
 
-        r = iesys_crypto_hash_update(cryptoContext, &auth_value->buffer[0],
+        r = iesys_crypto_hash_update(crypto_cb,
+                                     cryptoContext, &auth_value->buffer[0],
                                      auth_value->size);
         goto_if_error(r, "crypto hash update", error_cleanup);
 
-        r = iesys_crypto_hash_finish(&cryptoContext, &hash2b.buffer[0],
+        r = iesys_crypto_hash_finish(crypto_cb,
+                                     &cryptoContext, &hash2b.buffer[0],
                                      &hash_size);
         goto_if_error(r, "crypto hash finish", error_cleanup);
 
@@ -1610,7 +1932,7 @@ iesys_hash_long_auth_values(
 
  error_cleanup:
     if (cryptoContext) {
-        iesys_crypto_hash_abort(&cryptoContext);
+        iesys_crypto_hash_abort(crypto_cb, &cryptoContext);
     }
     return r;
 }
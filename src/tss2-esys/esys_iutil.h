@@ -31,17 +31,26 @@ extern "C" {
  */
 #define ESYS_TR_MIN_OBJECT (TPM2_RH_LAST + 1 + 0x1000)
 
-/** An entry in a cpHash or rpHash table. */
-typedef struct {
-    TPM2_ALG_ID alg;                 /**< The hash algorithm. */
-    size_t size;                     /**< The digest size. */
-    uint8_t digest[sizeof(TPMU_HA)]; /**< The digest. */
-} HASH_TAB_ITEM;
-
 TSS2_RC init_session_tab(
     ESYS_CONTEXT *esysContext,
     ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3);
 
+void *iesys_pool_calloc(
+    ESYS_CONTEXT *esys_context,
+    size_t size);
+
+void iesys_pool_free(
+    ESYS_CONTEXT *esys_context,
+    void *block,
+    size_t size);
+
+void iesys_pool_trim(
+    ESYS_CONTEXT *esys_context);
+
+TSS2_RC iesys_DeleteResourceObject(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR esys_handle);
+
 void iesys_DeleteAllResourceObjects(
     ESYS_CONTEXT *esys_context);
 
@@ -89,6 +98,7 @@ TPM2_HT iesys_get_handle_type(
 TSS2_RC iesys_finalize(ESYS_CONTEXT *context);
 
 bool iesys_compare_name(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2B_PUBLIC *publicInfo,
     TPM2B_NAME *name);
 
@@ -139,6 +149,7 @@ void iesys_compute_session_value(
     const TPM2B_AUTH *auth_value);
 
 TSS2_RC iesys_compute_hmac(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     RSRC_NODE_T *session,
     HASH_TAB_ITEM cp_hash_tab[3],
     uint8_t cpHashNum,
@@ -157,17 +168,36 @@ TSS2_RC iesys_check_response(
     ESYS_CONTEXT * esys_context);
 
 TSS2_RC iesys_nv_get_name(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2B_NV_PUBLIC *publicInfo,
     TPM2B_NAME *name);
 
 TSS2_RC iesys_get_name(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2B_PUBLIC *publicInfo,
     TPM2B_NAME *name);
 
+TSS2_RC iesys_rsrc_get_name(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_RESOURCE *rsrc,
+    TPM2B_NAME *name);
+
+UINT8 iesys_rsrc_compact_flags(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    IESYS_RESOURCE *rsrc);
+
+TSS2_RC iesys_rsrc_compact_unmarshal(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
+    const uint8_t *buffer,
+    size_t size,
+    size_t *offset,
+    IESYS_RESOURCE *rsrc);
+
 bool iesys_tpm_error(
     TSS2_RC r);
 
 TSS2_RC iesys_hash_long_auth_values(
+    ESYS_CRYPTO_CALLBACKS *crypto_cb,
     TPM2B_AUTH *auth_value,
     TPMI_ALG_HASH hash_alg);
 
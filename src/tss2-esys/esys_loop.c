@@ -0,0 +1,560 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#include "tss2_esys.h"
+
+#include "esys_int.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+#ifndef _WIN32
+
+/* Number of events fetched from the kernel per wait. */
+#define LOOP_MAX_EVENTS 64
+
+/* A registered context and the poll handles of its pending command. */
+typedef struct {
+    ESYS_CONTEXT *esys_context; /* NULL once removed */
+    ESYS_LOOP_CALLBACK callback;
+    void *userdata;
+    TSS2_TCTI_POLL_HANDLE *handles;
+    size_t count;
+    int32_t timeout;            /* of the context before it was added */
+    bool ready;
+} loop_entry;
+
+/*
+ * A file descriptor waited on. Several contexts may share one, e.g. all
+ * device TCTI contexts using io_uring, so it is registered once and counted.
+ */
+typedef struct {
+    int fd;
+    size_t refs;
+    bool ready;
+} loop_fd;
+
+struct ESYS_LOOP {
+    loop_entry *entries;
+    size_t num_entries;
+    size_t max_entries;
+    loop_fd *fds;
+    size_t num_fds;
+    size_t max_fds;
+    size_t active;
+    int epoll_fd;
+};
+
+static void *
+loop_grow(void *array, size_t *max, size_t size)
+{
+    size_t new_max = *max ? *max * 2 : 16;
+    void *new_array = realloc(array, new_max * size);
+
+    if (new_array != NULL)
+        *max = new_max;
+    return new_array;
+}
+
+/*
+ * Register 'fd' with the epoll instance. The loop only knows fds by number:
+ * a TCTI may close a connection and open a new one that gets the same
+ * number, and closing removed the old one from the epoll set. So a known fd
+ * is re-armed every time, and added again if the kernel no longer has it.
+ */
+static TSS2_RC
+loop_fd_register(ESYS_LOOP *loop, int fd, bool known)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    /* The responses are read by the callbacks, only wait for input. */
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = fd };
+
+    if (known && epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0)
+        return TSS2_RC_SUCCESS;
+    if (known && errno != ENOENT) {
+        LOG_ERROR("Failed to modify fd %d in epoll: %s", fd, strerror(errno));
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        LOG_ERROR("Failed to add fd %d to epoll: %s", fd, strerror(errno));
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+#else
+    UNUSED(loop);
+    UNUSED(fd);
+    UNUSED(known);
+#endif
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+loop_fd_ref(ESYS_LOOP *loop, const TSS2_TCTI_POLL_HANDLE *handle)
+{
+    loop_fd *fds;
+    size_t i;
+    TSS2_RC r;
+
+    for (i = 0; i < loop->num_fds; i++) {
+        if (loop->fds[i].fd == handle->fd) {
+            r = loop_fd_register(loop, handle->fd, true);
+            return_if_error(r, "Error registering fd.");
+            loop->fds[i].refs++;
+            return TSS2_RC_SUCCESS;
+        }
+    }
+
+    if (loop->num_fds == loop->max_fds) {
+        fds = loop_grow(loop->fds, &loop->max_fds, sizeof(*fds));
+        return_if_null(fds, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+        loop->fds = fds;
+    }
+    r = loop_fd_register(loop, handle->fd, false);
+    return_if_error(r, "Error registering fd.");
+    loop->fds[loop->num_fds].fd = handle->fd;
+    loop->fds[loop->num_fds].refs = 1;
+    loop->fds[loop->num_fds].ready = false;
+    loop->num_fds++;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+loop_fd_unref(ESYS_LOOP *loop, const TSS2_TCTI_POLL_HANDLE *handle)
+{
+    size_t i;
+
+    for (i = 0; i < loop->num_fds; i++) {
+        if (loop->fds[i].fd != handle->fd)
+            continue;
+        if (--loop->fds[i].refs > 0)
+            return;
+#ifdef HAVE_SYS_EPOLL_H
+        /* fails if the TCTI already closed the fd, which removed it anyway */
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, handle->fd, NULL);
+#endif
+        loop->fds[i] = loop->fds[--loop->num_fds];
+        return;
+    }
+}
+
+/*
+ * Drop the poll handles of 'entry' and take the current ones of its context.
+ * The TCTI may use a different connection for the next command.
+ */
+static TSS2_RC
+loop_entry_refresh(ESYS_LOOP *loop, loop_entry *entry)
+{
+    TSS2_TCTI_POLL_HANDLE *handles = NULL;
+    size_t count = 0, i;
+    TSS2_RC r;
+
+    r = Esys_GetPollHandles(entry->esys_context, &handles, &count);
+    if (r != TSS2_RC_SUCCESS) {
+        free(handles);
+        return_error(r, "Error getting poll handles.");
+    }
+    for (i = 0; i < count; i++) {
+        r = loop_fd_ref(loop, &handles[i]);
+        if (r != TSS2_RC_SUCCESS) {
+            while (i-- > 0)
+                loop_fd_unref(loop, &handles[i]);
+            free(handles);
+            return r;
+        }
+    }
+    for (i = 0; i < entry->count; i++)
+        loop_fd_unref(loop, &entry->handles[i]);
+    free(entry->handles);
+    entry->handles = handles;
+    entry->count = count;
+    return TSS2_RC_SUCCESS;
+}
+
+/* Remove 'entry' and give its context back the timeout it had before. */
+static void
+loop_entry_clear(ESYS_LOOP *loop, loop_entry *entry)
+{
+    size_t i;
+
+    Esys_SetTimeout(entry->esys_context, entry->timeout);
+    for (i = 0; i < entry->count; i++)
+        loop_fd_unref(loop, &entry->handles[i]);
+    free(entry->handles);
+    memset(entry, 0, sizeof(*entry));
+    loop->active--;
+}
+
+static loop_entry *
+loop_entry_find(ESYS_LOOP *loop, ESYS_CONTEXT *esys_context)
+{
+    size_t i;
+
+    for (i = 0; i < loop->num_entries; i++) {
+        if (loop->entries[i].esys_context == esys_context)
+            return &loop->entries[i];
+    }
+    return NULL;
+}
+
+/* Close the gaps left by removed entries. */
+static void
+loop_compact(ESYS_LOOP *loop)
+{
+    size_t i, j = 0;
+
+    for (i = 0; i < loop->num_entries; i++) {
+        if (loop->entries[i].esys_context != NULL)
+            loop->entries[j++] = loop->entries[i];
+    }
+    loop->num_entries = j;
+}
+
+/*
+ * Wait for any of the registered file descriptors and flag the ready ones.
+ * Returns the number of ready file descriptors.
+ */
+static int
+loop_wait(ESYS_LOOP *loop, int32_t timeout)
+{
+    size_t i;
+    int ret;
+
+    for (i = 0; i < loop->num_fds; i++)
+        loop->fds[i].ready = false;
+
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event events[LOOP_MAX_EVENTS];
+    int j;
+
+    do {
+        ret = epoll_wait(loop->epoll_fd, events, LOOP_MAX_EVENTS, timeout);
+    } while (ret < 0 && errno == EINTR);
+    for (j = 0; j < ret; j++) {
+        for (i = 0; i < loop->num_fds; i++) {
+            if (loop->fds[i].fd == events[j].data.fd) {
+                loop->fds[i].ready = true;
+                break;
+            }
+        }
+    }
+#else
+    struct pollfd *fds = calloc(loop->num_fds, sizeof(*fds));
+
+    if (fds == NULL) {
+        LOG_ERROR("Out of memory.");
+        return -1;
+    }
+    for (i = 0; i < loop->num_fds; i++) {
+        fds[i].fd = loop->fds[i].fd;
+        fds[i].events = POLLIN;
+    }
+    do {
+        ret = poll(fds, loop->num_fds, timeout);
+    } while (ret < 0 && errno == EINTR);
+    for (i = 0; ret > 0 && i < loop->num_fds; i++)
+        loop->fds[i].ready = fds[i].revents != 0;
+    free(fds);
+#endif
+    if (ret < 0)
+        LOG_ERROR("Failed to wait for poll handles: %s", strerror(errno));
+    return ret;
+}
+
+static bool
+loop_entry_ready(ESYS_LOOP *loop, const loop_entry *entry)
+{
+    size_t i, j;
+
+    for (i = 0; i < entry->count; i++) {
+        for (j = 0; j < loop->num_fds; j++) {
+            if (loop->fds[j].fd == entry->handles[i].fd && loop->fds[j].ready)
+                return true;
+        }
+    }
+    return false;
+}
+
+/** Create an event loop for ESYS_CONTEXTs.
+ *
+ * @param loop [out] The new ESYS_LOOP.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if loop is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the loop cannot be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if the epoll instance cannot be
+ *         created.
+ */
+TSS2_RC
+Esys_Loop_Initialize(ESYS_LOOP **loop)
+{
+    _ESYS_ASSERT_NON_NULL(loop);
+
+    *loop = calloc(1, sizeof(**loop));
+    return_if_null(*loop, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    (*loop)->epoll_fd = -1;
+#ifdef HAVE_SYS_EPOLL_H
+    (*loop)->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if ((*loop)->epoll_fd < 0) {
+        LOG_ERROR("Failed to create epoll instance: %s", strerror(errno));
+        free(*loop);
+        *loop = NULL;
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+#endif
+    return TSS2_RC_SUCCESS;
+}
+
+/** Free an event loop.
+ *
+ * Contexts still registered are removed without calling their callbacks.
+ * Their timeouts are not restored, as they may have been finalized already.
+ * @param loop [in,out] The ESYS_LOOP, set to NULL.
+ */
+void
+Esys_Loop_Finalize(ESYS_LOOP **loop)
+{
+    size_t i;
+
+    if (loop == NULL || *loop == NULL)
+        return;
+
+    for (i = 0; i < (*loop)->num_entries; i++)
+        free((*loop)->entries[i].handles);
+    free((*loop)->entries);
+    free((*loop)->fds);
+    if ((*loop)->epoll_fd >= 0)
+        close((*loop)->epoll_fd);
+    free(*loop);
+    *loop = NULL;
+}
+
+/** Register a context with a pending asynchronous command.
+ *
+ * The callback is called once the poll handles of the context signal. The
+ * timeout of the context is set to 0, so that its Esys_*_Finish functions
+ * return TSS2_ESYS_RC_TRY_AGAIN instead of blocking if the response is not
+ * complete yet. The previous timeout is restored when the context leaves the
+ * loop, so a callback must not finalize its context. Adding a context that is
+ * already registered replaces its callback.
+ * @param loop [in] The ESYS_LOOP.
+ * @param esys_context [in] The ESYS_CONTEXT an Esys_*_Async function was
+ *        called on.
+ * @param callback [in] The function finishing the command.
+ * @param userdata [in] Passed to the callback.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a parameter is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the context cannot be added.
+ * @retval TSS2_RCs produced by Esys_GetPollHandles.
+ */
+TSS2_RC
+Esys_Loop_Add(
+    ESYS_LOOP *loop,
+    ESYS_CONTEXT *esys_context,
+    ESYS_LOOP_CALLBACK callback,
+    void *userdata)
+{
+    loop_entry *entry, *entries;
+    TSS2_RC r;
+
+    _ESYS_ASSERT_NON_NULL(loop);
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(callback);
+
+    entry = loop_entry_find(loop, esys_context);
+    if (entry == NULL) {
+        if (loop->num_entries == loop->max_entries) {
+            entries = loop_grow(loop->entries, &loop->max_entries,
+                                sizeof(*entries));
+            return_if_null(entries, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+            loop->entries = entries;
+        }
+        entry = &loop->entries[loop->num_entries];
+        memset(entry, 0, sizeof(*entry));
+        entry->esys_context = esys_context;
+        entry->timeout = esys_context->timeout;
+        r = loop_entry_refresh(loop, entry);
+        if (r != TSS2_RC_SUCCESS) {
+            memset(entry, 0, sizeof(*entry));
+            return r;
+        }
+        loop->num_entries++;
+        loop->active++;
+    }
+    entry->callback = callback;
+    entry->userdata = userdata;
+    return Esys_SetTimeout(esys_context, 0);
+}
+
+/** Remove a context from the loop without calling its callback.
+ *
+ * @param loop [in] The ESYS_LOOP.
+ * @param esys_context [in] The registered ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the context is not registered.
+ */
+TSS2_RC
+Esys_Loop_Remove(ESYS_LOOP *loop, ESYS_CONTEXT *esys_context)
+{
+    loop_entry *entry;
+
+    _ESYS_ASSERT_NON_NULL(loop);
+    _ESYS_ASSERT_NON_NULL(esys_context);
+
+    entry = loop_entry_find(loop, esys_context);
+    return_if_null(entry, "Context not registered.", TSS2_ESYS_RC_BAD_VALUE);
+    /* the slot is reused after the current dispatch round */
+    loop_entry_clear(loop, entry);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Wait for the registered contexts once and call the ready callbacks.
+ *
+ * Callbacks may add and remove contexts, including their own.
+ * @param loop [in] The ESYS_LOOP.
+ * @param timeout [in] The timeout in ms or -1 to block indefinitely.
+ * @retval TSS2_RC_SUCCESS if callbacks were called or no context is
+ *         registered.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN if the timeout expired.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if loop is NULL.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if waiting failed.
+ */
+TSS2_RC
+Esys_Loop_Dispatch(ESYS_LOOP *loop, int32_t timeout)
+{
+    loop_entry *entry;
+    size_t i, num_entries;
+    TSS2_RC r;
+    int ret;
+
+    _ESYS_ASSERT_NON_NULL(loop);
+
+    if (loop->active == 0)
+        return TSS2_RC_SUCCESS;
+
+    ret = loop_wait(loop, timeout);
+    if (ret < 0)
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    if (ret == 0)
+        return TSS2_ESYS_RC_TRY_AGAIN;
+
+    /* Decide first, callbacks may change the set of ready fds */
+    num_entries = loop->num_entries;
+    for (i = 0; i < num_entries; i++) {
+        entry = &loop->entries[i];
+        entry->ready = entry->esys_context != NULL &&
+                       loop_entry_ready(loop, entry);
+    }
+    for (i = 0; i < num_entries; i++) {
+        /* the entries may have been moved by a callback adding contexts */
+        entry = &loop->entries[i];
+        if (!entry->ready || entry->esys_context == NULL)
+            continue;
+        entry->ready = false;
+        r = entry->callback(entry->esys_context, entry->userdata);
+        entry = &loop->entries[i];
+        if (entry->esys_context == NULL)
+            continue;
+        if (base_rc(r) != TSS2_BASE_RC_TRY_AGAIN) {
+            loop_entry_clear(loop, entry);
+        } else if (loop_entry_refresh(loop, entry) != TSS2_RC_SUCCESS) {
+            LOG_ERROR("Removing context %p from the loop.",
+                      (void *)entry->esys_context);
+            loop_entry_clear(loop, entry);
+        }
+    }
+    loop_compact(loop);
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Dispatch until no context is registered anymore.
+ *
+ * @param loop [in] The ESYS_LOOP.
+ * @retval TSS2_RC_SUCCESS once the last context was removed.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if loop is NULL.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if waiting failed.
+ */
+TSS2_RC
+Esys_Loop_Run(ESYS_LOOP *loop)
+{
+    TSS2_RC r;
+
+    _ESYS_ASSERT_NON_NULL(loop);
+
+    while (loop->active > 0) {
+        r = Esys_Loop_Dispatch(loop, -1);
+        return_if_error(r, "Error dispatching.");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+#else /* _WIN32 */
+
+TSS2_RC
+Esys_Loop_Initialize(ESYS_LOOP **loop)
+{
+    UNUSED(loop);
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+}
+
+void
+Esys_Loop_Finalize(ESYS_LOOP **loop)
+{
+    UNUSED(loop);
+}
+
+TSS2_RC
+Esys_Loop_Add(
+    ESYS_LOOP *loop,
+    ESYS_CONTEXT *esys_context,
+    ESYS_LOOP_CALLBACK callback,
+    void *userdata)
+{
+    UNUSED(loop);
+    UNUSED(esys_context);
+    UNUSED(callback);
+    UNUSED(userdata);
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC
+Esys_Loop_Remove(ESYS_LOOP *loop, ESYS_CONTEXT *esys_context)
+{
+    UNUSED(loop);
+    UNUSED(esys_context);
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC
+Esys_Loop_Dispatch(ESYS_LOOP *loop, int32_t timeout)
+{
+    UNUSED(loop);
+    UNUSED(timeout);
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC
+Esys_Loop_Run(ESYS_LOOP *loop)
+{
+    UNUSED(loop);
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+}
+
+#endif /* _WIN32 */
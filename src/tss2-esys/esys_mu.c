@@ -565,6 +565,63 @@ iesys_MU_IESYS_SESSION_Unmarshal(
     return TSS2_RC_SUCCESS;
 }
 
+/** Compute the marshaled size of a IESYS_SESSION structure.
+ *
+ * @param[in] src variable to be sized.
+ * @param[out] size The number of bytes iesys_MU_IESYS_SESSION_Marshal writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if src==NULL or size==NULL.
+ * @retval TSS2_MU_RC_BAD_SIZE if a contained TPM2B exceeds its buffer.
+ */
+TSS2_RC
+iesys_MU_IESYS_SESSION_Size(
+    const IESYS_SESSION *src,
+    size_t *size)
+{
+    if (src == NULL || size == NULL) {
+        LOG_ERROR("src=%p size=%p", src, size);
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    TSS2_RC ret;
+    size_t member_size, size_loc = 0;
+    ret = Tss2_MU_TPM2B_NAME_Size(&src->bound_entity, &member_size);
+    return_if_error(ret, "Error sizing subfield bound_entity");
+    size_loc += member_size;
+
+    ret = Tss2_MU_TPM2B_ENCRYPTED_SECRET_Size(&src->encryptedSalt, &member_size);
+    return_if_error(ret, "Error sizing subfield encryptedSalt");
+    size_loc += member_size;
+
+    ret = Tss2_MU_TPM2B_DATA_Size(&src->salt, &member_size);
+    return_if_error(ret, "Error sizing subfield salt");
+    size_loc += member_size;
+
+    ret = Tss2_MU_TPMT_SYM_DEF_Size(&src->symmetric, &member_size);
+    return_if_error(ret, "Error sizing subfield symmetric");
+    size_loc += member_size;
+
+    ret = Tss2_MU_TPM2B_DIGEST_Size(&src->sessionKey, &member_size);
+    return_if_error(ret, "Error sizing subfield sessionKey");
+    size_loc += member_size;
+
+    ret = Tss2_MU_TPM2B_NONCE_Size(&src->nonceCaller, &member_size);
+    return_if_error(ret, "Error sizing subfield nonceCaller");
+    size_loc += member_size;
+
+    ret = Tss2_MU_TPM2B_NONCE_Size(&src->nonceTPM, &member_size);
+    return_if_error(ret, "Error sizing subfield nonceTPM");
+    size_loc += member_size;
+
+    /* authHash, sessionType and sessionAttributes as well as the three
+       IESYSC enums (marshaled as UINT32) and the two UINT16 lengths. */
+    size_loc += sizeof(TPMI_ALG_HASH) + sizeof(TPM2_SE) + sizeof(TPMA_SESSION);
+    size_loc += 3 * sizeof(UINT32);
+    size_loc += sizeof(UINT16) + src->sizeSessionValue + sizeof(UINT16);
+
+    *size = size_loc;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Marshal a IESYSC_RESOURCE_TYPE type into a byte buffer.
  *
  * @param[in] src constant to be marshaled.
@@ -731,6 +788,41 @@ iesys_MU_IESYS_RSRC_UNION_Unmarshal(
     };
 }
 
+/** Compute the marshaled size of a IESYS_RSRC_UNION.
+ *
+ * @param[in] src variable to be sized.
+ * @param[in] selector the selector value.
+ * @param[out] size The number of bytes iesys_MU_IESYS_RSRC_UNION_Marshal
+ *             writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if src==NULL or size==NULL.
+ * @retval TSS2_SYS_RC_BAD_VALUE if the selector is unknown.
+ */
+TSS2_RC
+iesys_MU_IESYS_RSRC_UNION_Size(
+    const IESYS_RSRC_UNION *src,
+    UINT32 selector,
+    size_t *size)
+{
+    if (src == NULL || size == NULL) {
+        LOG_ERROR("src=%p size=%p", src, size);
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    switch (selector) {
+    case IESYSC_KEY_RSRC:
+        return Tss2_MU_TPM2B_PUBLIC_Size(&src->rsrc_key_pub, size);
+    case IESYSC_NV_RSRC:
+        return Tss2_MU_TPM2B_NV_PUBLIC_Size(&src->rsrc_nv_pub, size);
+    case IESYSC_SESSION_RSRC:
+        return iesys_MU_IESYS_SESSION_Size(&src->rsrc_session, size);
+    case IESYSC_WITHOUT_MISC_RSRC:
+        return Tss2_MU_TPMS_EMPTY_Size(&src->rsrc_empty, size);
+    default:
+        LOG_ERROR("Selector value %"PRIu32 " not found", selector);
+        return TSS2_SYS_RC_BAD_VALUE;
+    };
+}
+
 /** Marshal a IESYS_RESOURCE structure into a byte buffer.
  *
  * @param[in] src variable to be marshaled.
@@ -827,6 +919,205 @@ iesys_MU_IESYS_RESOURCE_Unmarshal(
     return TSS2_RC_SUCCESS;
 }
 
+/** Compute the marshaled size of a IESYS_RESOURCE structure.
+ *
+ * Used to allocate serialization buffers without a separate marshaling pass.
+ * @param[in] src variable to be sized.
+ * @param[out] size The number of bytes iesys_MU_IESYS_RESOURCE_Marshal writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if src==NULL or size==NULL.
+ * @retval TSS2_SYS_RC_BAD_VALUE if rsrcType is unknown.
+ */
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Size(
+    const IESYS_RESOURCE *src,
+    size_t *size)
+{
+    if (src == NULL || size == NULL) {
+        LOG_ERROR("src=%p size=%p", src, size);
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    TSS2_RC ret;
+    size_t member_size, size_loc = sizeof(TPM2_HANDLE);
+    ret = Tss2_MU_TPM2B_NAME_Size(&src->name, &member_size);
+    return_if_error(ret, "Error sizing subfield name");
+    size_loc += member_size + sizeof(UINT32);
+
+    ret = iesys_MU_IESYS_RSRC_UNION_Size(&src->misc, src->rsrcType,
+        &member_size);
+    return_if_error(ret, "Error sizing subfield misc");
+    size_loc += member_size;
+
+    *size = size_loc;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Marshal a IESYS_RESOURCE structure into the compact record format.
+ *
+ * The compact format is used by Esys_TR_SerializeBatch. It stores the
+ * resource type in a single byte, followed by a byte of flags. If flags
+ * contains IESYS_COMPACT_NAME_DERIVED, the name is not marshaled, since it
+ * can be computed from the public area.
+ * @param[in] src variable to be marshaled.
+ * @param[in] flags The IESYS_COMPACT_* flags of the record.
+ * @param[in,out] buffer Buffer to write result into.
+ * @param[in] size Size of the buffer.
+ * @param[in,out] offset Offset inside the buffer
+ *                (being updated during marshaling).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if src==NULL.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_BUFFER if remaining buffer is insufficient.
+ * @retval TSS2_SYS_RC_BAD_VALUE if rsrcType is unknown.
+ */
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Compact_Marshal(
+    const IESYS_RESOURCE *src,
+    UINT8 flags,
+    uint8_t *buffer,
+    size_t size,
+    size_t *offset)
+{
+    LOG_TRACE("called: src=%p flags=%"PRIx8 " buffer=%p size=%zu offset=%p",
+        src, flags, buffer, size, offset);
+    if (src == NULL) {
+        LOG_ERROR("src=NULL");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    TSS2_RC ret;
+    size_t offset_loc = (offset != NULL)? *offset : 0;
+    ret = iesys_MU_IESYSC_RESOURCE_TYPE_check(&src->rsrcType);
+    return_if_error(ret, "Bad value of subfield rsrcType");
+
+    ret = Tss2_MU_TPM2_HANDLE_Marshal(src->handle, buffer, size, &offset_loc);
+    return_if_error(ret, "Error marshaling subfield handle");
+
+    ret = Tss2_MU_UINT8_Marshal((UINT8) src->rsrcType, buffer, size,
+        &offset_loc);
+    return_if_error(ret, "Error marshaling subfield rsrcType");
+
+    ret = Tss2_MU_UINT8_Marshal(flags, buffer, size, &offset_loc);
+    return_if_error(ret, "Error marshaling flags");
+
+    if (!(flags & IESYS_COMPACT_NAME_DERIVED)) {
+        ret = Tss2_MU_TPM2B_NAME_Marshal(&src->name, buffer, size, &offset_loc);
+        return_if_error(ret, "Error marshaling subfield name");
+    }
+
+    ret = iesys_MU_IESYS_RSRC_UNION_Marshal(&src->misc, src->rsrcType,
+        buffer, size, &offset_loc);
+    return_if_error(ret, "Error marshaling subfield misc");
+
+    if (offset != NULL)
+        *offset = offset_loc;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Unmarshal a IESYS_RESOURCE variable from the compact record format.
+ *
+ * If the returned flags contain IESYS_COMPACT_NAME_DERIVED, the name of dst is
+ * left empty and has to be computed by the caller.
+ * @param[in,out] buffer Buffer to read data from.
+ * @param[in] size Size of the buffer.
+ * @param[in,out] offset Offset inside the buffer
+ *                (being updated during marshaling).
+ * @param[out] dst variable to store the result in.
+ * @param[out] flags The IESYS_COMPACT_* flags of the record.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if buffer==NULL, dst==NULL or
+ *         flags==NULL.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_BUFFER if remaining buffer is insufficient.
+ * @retval TSS2_SYS_RC_BAD_VALUE if rsrcType or flags are unknown.
+ */
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Compact_Unmarshal(
+    const uint8_t *buffer,
+    size_t size,
+    size_t *offset,
+    IESYS_RESOURCE *dst,
+    UINT8 *flags)
+{
+    LOG_TRACE("called: buffer=%p size=%zu offset=%p dst=%p",
+        buffer, size, offset, dst);
+    if (buffer == NULL || dst == NULL || flags == NULL) {
+        LOG_ERROR("buffer=%p dst=%p flags=%p", buffer, dst, flags);
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    TSS2_RC ret;
+    UINT8 rsrcType;
+    size_t offset_loc = (offset != NULL)? *offset : 0;
+    memset(dst, 0, sizeof(*dst));
+    ret = Tss2_MU_TPM2_HANDLE_Unmarshal(buffer, size, &offset_loc,
+            &dst->handle);
+    return_if_error(ret, "Error unmarshaling subfield handle");
+
+    ret = Tss2_MU_UINT8_Unmarshal(buffer, size, &offset_loc, &rsrcType);
+    return_if_error(ret, "Error unmarshaling subfield rsrcType");
+    dst->rsrcType = rsrcType;
+    ret = iesys_MU_IESYSC_RESOURCE_TYPE_check(&dst->rsrcType);
+    if (ret != TSS2_RC_SUCCESS) {
+        LOG_ERROR("Bad value %"PRIx32 "", dst->rsrcType);
+        return ret;
+    }
+
+    ret = Tss2_MU_UINT8_Unmarshal(buffer, size, &offset_loc, flags);
+    return_if_error(ret, "Error unmarshaling flags");
+    if (*flags & ~IESYS_COMPACT_NAME_DERIVED) {
+        LOG_ERROR("Bad flags %"PRIx8 "", *flags);
+        return TSS2_SYS_RC_BAD_VALUE;
+    }
+
+    if (!(*flags & IESYS_COMPACT_NAME_DERIVED)) {
+        ret = Tss2_MU_TPM2B_NAME_Unmarshal(buffer, size, &offset_loc,
+                &dst->name);
+        return_if_error(ret, "Error unmarshaling subfield name");
+    }
+
+    ret = iesys_MU_IESYS_RSRC_UNION_Unmarshal(buffer, size, &offset_loc,
+            dst->rsrcType, &dst->misc);
+    return_if_error(ret, "Error unmarshaling subfield misc");
+
+    if (offset != NULL)
+        *offset = offset_loc;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Compute the size of a IESYS_RESOURCE structure in the compact format.
+ *
+ * @param[in] src variable to be sized.
+ * @param[in] flags The IESYS_COMPACT_* flags of the record.
+ * @param[out] size The number of bytes
+ *             iesys_MU_IESYS_RESOURCE_Compact_Marshal writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if src==NULL or size==NULL.
+ * @retval TSS2_SYS_RC_BAD_VALUE if rsrcType is unknown.
+ */
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Compact_Size(
+    const IESYS_RESOURCE *src,
+    UINT8 flags,
+    size_t *size)
+{
+    if (src == NULL || size == NULL) {
+        LOG_ERROR("src=%p size=%p", src, size);
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    TSS2_RC ret;
+    size_t member_size, size_loc = sizeof(TPM2_HANDLE) + 2 * sizeof(UINT8);
+    if (!(flags & IESYS_COMPACT_NAME_DERIVED)) {
+        ret = Tss2_MU_TPM2B_NAME_Size(&src->name, &member_size);
+        return_if_error(ret, "Error sizing subfield name");
+        size_loc += member_size;
+    }
+
+    ret = iesys_MU_IESYS_RSRC_UNION_Size(&src->misc, src->rsrcType,
+        &member_size);
+    return_if_error(ret, "Error sizing subfield misc");
+    size_loc += member_size;
+
+    *size = size_loc;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Marshal a IESYS_METADATA structure into a byte buffer.
  *
  * @param[in] src variable to be marshaled.
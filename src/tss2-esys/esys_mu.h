@@ -18,6 +18,14 @@
 #endif
 #define ESYS_MAX_SIZE_METADATA 3072
 
+/* Header of the blobs written by Esys_TR_SerializeBatch */
+#define IESYS_BATCH_MAGIC 0x45535452         /* "ESTR" */
+#define IESYS_BATCH_VERSION 2
+#define IESYS_BATCH_HEADER_SIZE 12
+
+/* Flags of a compact resource record */
+#define IESYS_COMPACT_NAME_DERIVED 0x01      /* name omitted, computed from misc */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -89,6 +97,11 @@ iesys_MU_IESYS_SESSION_Unmarshal(const uint8_t *buffer,
     size_t *offset,
     IESYS_SESSION *out);
 
+TSS2_RC
+iesys_MU_IESYS_SESSION_Size(
+    const IESYS_SESSION *in,
+    size_t *size);
+
 
 TSS2_RC
 iesys_MU_IESYSC_RESOURCE_TYPE_Marshal(
@@ -124,6 +137,12 @@ iesys_MU_IESYS_RSRC_UNION_Unmarshal(
     UINT32 selector,
     IESYS_RSRC_UNION *out);
 
+TSS2_RC
+iesys_MU_IESYS_RSRC_UNION_Size(
+    const IESYS_RSRC_UNION *in,
+    UINT32 selector,
+    size_t *size);
+
 
 TSS2_RC
 iesys_MU_IESYS_RESOURCE_Marshal(
@@ -138,6 +157,33 @@ iesys_MU_IESYS_RESOURCE_Unmarshal(const uint8_t *buffer,
     size_t *offset,
     IESYS_RESOURCE *out);
 
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Size(
+    const IESYS_RESOURCE *in,
+    size_t *size);
+
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Compact_Marshal(
+    const IESYS_RESOURCE *in,
+    UINT8 flags,
+    uint8_t *buffer,
+    size_t size,
+    size_t *offset);
+
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Compact_Unmarshal(
+    const uint8_t *buffer,
+    size_t size,
+    size_t *offset,
+    IESYS_RESOURCE *out,
+    UINT8 *flags);
+
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Compact_Size(
+    const IESYS_RESOURCE *in,
+    UINT8 flags,
+    size_t *size);
+
 
 TSS2_RC
 iesys_MU_IESYS_METADATA_Marshal(
@@ -0,0 +1,402 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_esys.h"
+#include "esys_mu.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * A snapshot written by Esys_Context_Save consists of a header
+ *     UINT32 magic, UINT16 version, UINT16 reserved,
+ *     UINT32 esys_handle_cnt, UINT32 count
+ * followed by count entries, sorted by esys_handle,
+ *     UINT32 esys_handle, UINT8 kind, record
+ * where the record is the compact record of the resource (see
+ * Esys_TR_SerializeBatch) for IESYS_SNAPSHOT_METADATA entries and a
+ * TPMS_CONTEXT as returned by Esys_ContextSave for IESYS_SNAPSHOT_TPM_CONTEXT
+ * entries.
+ */
+#define IESYS_SNAPSHOT_MAGIC 0x45534358       /* "ESCX" */
+#define IESYS_SNAPSHOT_VERSION 1
+#define IESYS_SNAPSHOT_HEADER_SIZE 16
+
+#define IESYS_SNAPSHOT_METADATA 0
+#define IESYS_SNAPSHOT_TPM_CONTEXT 1
+
+/** Check whether the TPM has to save the context of an object.
+ *
+ * Transient objects and sessions are bound to the connection to the TPM (or
+ * resource manager) and are lost when the process exits, unless they are
+ * saved with TPM2_ContextSave. All other objects are stored as metadata only.
+ * @param rsrc [in] The resource.
+ * @retval true if the object is a transient object or a session.
+ */
+static bool
+iesys_snapshot_needs_tpm_context(const IESYS_RESOURCE * rsrc)
+{
+    TPM2_HT type = rsrc->handle >> TPM2_HR_SHIFT;
+
+    return type == TPM2_HT_TRANSIENT || type == TPM2_HT_HMAC_SESSION ||
+           type == TPM2_HT_POLICY_SESSION;
+}
+
+/** Compare two ESYS_TRs for qsort.
+ */
+static int
+iesys_snapshot_cmp_handle(const void *a, const void *b)
+{
+    ESYS_TR handle_a = *(const ESYS_TR *) a;
+    ESYS_TR handle_b = *(const ESYS_TR *) b;
+
+    return (handle_a > handle_b) - (handle_a < handle_b);
+}
+
+/** Load a saved TPM context under a given ESYS_TR.
+ *
+ * Esys_ContextLoad creates a new ESYS_TR for the loaded object. The object is
+ * moved to esys_handle, so that handles held by the application stay valid.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param context [in] The context as returned by Esys_ContextSave.
+ * @param esys_handle [in] The ESYS_TR of the object when it was saved.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_MEMORY if the object can not be allocated.
+ * @retval TSS2_RCs produced by Esys_ContextLoad.
+ */
+static TSS2_RC
+iesys_snapshot_load(ESYS_CONTEXT * esys_context, const TPMS_CONTEXT * context,
+                    ESYS_TR esys_handle)
+{
+    TSS2_RC r;
+    ESYS_TR loaded_handle;
+    RSRC_NODE_T *loaded_object, *esys_object;
+
+    r = Esys_ContextLoad(esys_context, context, &loaded_handle);
+    return_if_error(r, "Load context");
+
+    r = esys_GetResourceObject(esys_context, loaded_handle, &loaded_object);
+    goto_if_error(r, "Get resource object", error_cleanup);
+
+    r = esys_CreateResourceObject(esys_context, esys_handle, &esys_object);
+    goto_if_error(r, "Create resource object", error_cleanup);
+
+    esys_object->rsrc = loaded_object->rsrc;
+    iesys_DeleteResourceObject(esys_context, loaded_handle);
+    return TSS2_RC_SUCCESS;
+
+ error_cleanup:
+    Esys_FlushContext(esys_context, loaded_handle);
+    return r;
+}
+
+/** Save the state of an ESYS_CONTEXT into a byte buffer.
+ *
+ * The snapshot allows a new process to resume with the objects and sessions of
+ * esys_context without re-reading metadata from the TPM. It holds the metadata
+ * of all ESYS_TR objects and the ESYS_TR numbers, so that ESYS_TRs stored by
+ * the application remain valid after Esys_Context_Restore. Transient objects
+ * and sessions are saved with TPM2_ContextSave, which preserves the nonces
+ * and attributes of the sessions.
+ * Like a session saved with Esys_ContextSave, the sessions of esys_context are
+ * no longer usable after this call. Transient objects stay loaded. Auth values
+ * set with Esys_TR_SetAuth are not part of the snapshot.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param buffer [out] The snapshot (callee-allocated). Shall be freed using
+ *        free().
+ * @param buffer_size [out] The size of the buffer parameter.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is pending on esys_context.
+ * @retval TSS2_ESYS_RC_MEMORY if the snapshot can not be allocated.
+ * @retval TSS2_RCs produced by Esys_ContextSave and lower layers of the
+ *         software stack.
+ */
+TSS2_RC
+Esys_Context_Save(ESYS_CONTEXT * esys_context,
+                  uint8_t ** buffer, size_t * buffer_size)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *node;
+    ESYS_TR *handles = NULL;
+    UINT8 *flags = NULL;
+    TPMS_CONTEXT **contexts = NULL;
+    size_t i, n = 0, saved = 0, offset = 0, size, record_size;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(buffer);
+    _ESYS_ASSERT_NON_NULL(buffer_size);
+    *buffer = NULL;
+    *buffer_size = 0;
+
+    if (esys_context->state != _ESYS_STATE_INIT) {
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE,
+                     "Context can not be saved while a command is pending.");
+    }
+    if (esys_context->rsrc_count > UINT32_MAX)
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Too many objects.");
+
+    if (esys_context->rsrc_count > 0) {
+        handles = calloc(esys_context->rsrc_count, sizeof(*handles));
+        flags = calloc(esys_context->rsrc_count, sizeof(*flags));
+        contexts = calloc(esys_context->rsrc_count, sizeof(*contexts));
+        if (handles == NULL || flags == NULL || contexts == NULL) {
+            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory.", error_cleanup);
+        }
+    }
+
+    for (i = 0; i < esys_context->rsrc_table_size; i++) {
+        for (node = esys_context->rsrc_table[i]; node != NULL;
+             node = node->next) {
+            if (node->esys_handle >= ESYS_TR_MIN_OBJECT)
+                handles[n++] = node->esys_handle;
+        }
+    }
+    if (n > 0)
+        qsort(handles, n, sizeof(*handles), iesys_snapshot_cmp_handle);
+
+    /* Size the metadata records first, so that no session is saved (and
+       thereby closed) if this fails */
+    size = IESYS_SNAPSHOT_HEADER_SIZE + n * (sizeof(ESYS_TR) + sizeof(UINT8));
+    for (i = 0; i < n; i++) {
+        r = esys_GetResourceObject(esys_context, handles[i], &node);
+        goto_if_error(r, "Get resource object", error_cleanup);
+        if (iesys_snapshot_needs_tpm_context(&node->rsrc))
+            continue;
+        flags[i] = iesys_rsrc_compact_flags(&esys_context->crypto_backend,
+                                            &node->rsrc);
+        r = iesys_MU_IESYS_RESOURCE_Compact_Size(&node->rsrc, flags[i],
+                                                 &record_size);
+        goto_if_error(r, "Size resource object", error_cleanup);
+        size += record_size;
+    }
+
+    for (i = 0; i < n; i++) {
+        r = esys_GetResourceObject(esys_context, handles[i], &node);
+        goto_if_error(r, "Get resource object", error_cleanup);
+        if (!iesys_snapshot_needs_tpm_context(&node->rsrc))
+            continue;
+
+        r = Esys_ContextSave(esys_context, handles[i], &contexts[i]);
+        goto_if_error(r, "Save context", error_cleanup);
+        saved = i + 1;
+        r = Tss2_MU_TPMS_CONTEXT_Size(contexts[i], &record_size);
+        goto_if_error(r, "Size context", error_cleanup);
+        size += record_size;
+    }
+
+    *buffer = malloc(size);
+    goto_if_null(*buffer, "Buffer could not be allocated",
+                 TSS2_ESYS_RC_MEMORY, error_cleanup);
+
+    r = Tss2_MU_UINT32_Marshal(IESYS_SNAPSHOT_MAGIC, *buffer, size, &offset);
+    goto_if_error(r, "Marshal magic", error_cleanup);
+    r = Tss2_MU_UINT16_Marshal(IESYS_SNAPSHOT_VERSION, *buffer, size, &offset);
+    goto_if_error(r, "Marshal version", error_cleanup);
+    r = Tss2_MU_UINT16_Marshal(0, *buffer, size, &offset);
+    goto_if_error(r, "Marshal reserved", error_cleanup);
+    r = Tss2_MU_UINT32_Marshal(esys_context->esys_handle_cnt, *buffer, size,
+                               &offset);
+    goto_if_error(r, "Marshal handle counter", error_cleanup);
+    r = Tss2_MU_UINT32_Marshal((UINT32) n, *buffer, size, &offset);
+    goto_if_error(r, "Marshal count", error_cleanup);
+
+    for (i = 0; i < n; i++) {
+        r = Tss2_MU_UINT32_Marshal(handles[i], *buffer, size, &offset);
+        goto_if_error(r, "Marshal esys handle", error_cleanup);
+        if (contexts[i] != NULL) {
+            r = Tss2_MU_UINT8_Marshal(IESYS_SNAPSHOT_TPM_CONTEXT, *buffer,
+                                      size, &offset);
+            goto_if_error(r, "Marshal kind", error_cleanup);
+            r = Tss2_MU_TPMS_CONTEXT_Marshal(contexts[i], *buffer, size,
+                                             &offset);
+            goto_if_error(r, "Marshal context", error_cleanup);
+        } else {
+            r = Tss2_MU_UINT8_Marshal(IESYS_SNAPSHOT_METADATA, *buffer,
+                                      size, &offset);
+            goto_if_error(r, "Marshal kind", error_cleanup);
+            r = esys_GetResourceObject(esys_context, handles[i], &node);
+            goto_if_error(r, "Get resource object", error_cleanup);
+            r = iesys_MU_IESYS_RESOURCE_Compact_Marshal(&node->rsrc, flags[i],
+                                                        *buffer, size,
+                                                        &offset);
+            goto_if_error(r, "Marshal resource object", error_cleanup);
+        }
+    }
+
+    *buffer_size = size;
+    for (i = 0; i < n; i++)
+        SAFE_FREE(contexts[i]);
+    SAFE_FREE(contexts);
+    SAFE_FREE(handles);
+    SAFE_FREE(flags);
+    return TSS2_RC_SUCCESS;
+
+ error_cleanup:
+    /* Give the sessions saved (and closed) so far back to the context */
+    for (i = 0; i < saved; i++) {
+        if (contexts[i] != NULL &&
+            contexts[i]->savedHandle >> TPM2_HR_SHIFT != TPM2_HT_TRANSIENT)
+            iesys_snapshot_load(esys_context, contexts[i], handles[i]);
+    }
+    for (i = 0; contexts != NULL && i < n; i++)
+        SAFE_FREE(contexts[i]);
+    SAFE_FREE(*buffer);
+    SAFE_FREE(contexts);
+    SAFE_FREE(handles);
+    SAFE_FREE(flags);
+    return r;
+}
+
+/** Restore the state of an ESYS_CONTEXT from a snapshot.
+ *
+ * Recreate the ESYS_TR objects of a snapshot written by Esys_Context_Save
+ * under their original ESYS_TR numbers. Only the saved transient objects and
+ * sessions are sent to the TPM with TPM2_ContextLoad; no metadata is read
+ * from the TPM. The sessions of a snapshot can only be restored once.
+ * esys_context must be freshly initialized and must not hold any objects.
+ * If the snapshot can not be restored completely, no object is created and
+ * the objects already loaded into the TPM are flushed.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param buffer [in] The snapshot.
+ * @param buffer_size [in] The size of the buffer parameter.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is pending on esys_context
+ *         or esys_context already holds objects.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the buffer does not hold a snapshot of a
+ *         supported version, or has trailing data.
+ * @retval TSS2_ESYS_RC_MEMORY if the objects can not be allocated.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_BUFFER if the snapshot is truncated.
+ * @retval TSS2_RCs produced by Esys_ContextLoad and lower layers of the
+ *         software stack.
+ */
+TSS2_RC
+Esys_Context_Restore(ESYS_CONTEXT * esys_context,
+                     uint8_t const *buffer, size_t buffer_size)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *node;
+    ESYS_TR *handles = NULL;
+    TPMS_CONTEXT context;
+    UINT32 magic, handle_cnt, old_handle_cnt, n;
+    UINT16 version, reserved;
+    UINT8 kind;
+    size_t i, restored = 0, offset = 0;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(buffer);
+
+    if (esys_context->state != _ESYS_STATE_INIT) {
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE,
+                     "Context can not be restored while a command is pending.");
+    }
+    for (i = 0; i < esys_context->rsrc_table_size; i++) {
+        for (node = esys_context->rsrc_table[i]; node != NULL;
+             node = node->next) {
+            if (node->esys_handle >= ESYS_TR_MIN_OBJECT) {
+                return_error(TSS2_ESYS_RC_BAD_SEQUENCE,
+                             "Context already holds objects.");
+            }
+        }
+    }
+
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &magic);
+    return_if_error(r, "Unmarshal magic");
+    r = Tss2_MU_UINT16_Unmarshal(buffer, buffer_size, &offset, &version);
+    return_if_error(r, "Unmarshal version");
+    r = Tss2_MU_UINT16_Unmarshal(buffer, buffer_size, &offset, &reserved);
+    return_if_error(r, "Unmarshal reserved");
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &handle_cnt);
+    return_if_error(r, "Unmarshal handle counter");
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &n);
+    return_if_error(r, "Unmarshal count");
+
+    if (magic != IESYS_SNAPSHOT_MAGIC || version != IESYS_SNAPSHOT_VERSION ||
+        reserved != 0 || handle_cnt < ESYS_TR_MIN_OBJECT) {
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Unsupported snapshot format.");
+    }
+    /* Every entry holds at least an esys handle, its kind, a TPM handle, a
+       type and flags */
+    if (n > (buffer_size - offset) / (sizeof(ESYS_TR) + 1 +
+                                      sizeof(TPM2_HANDLE) + 2))
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Bad number of objects.");
+
+    if (n > 0) {
+        handles = calloc(n, sizeof(*handles));
+        return_if_null(handles, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    }
+
+    /* Esys_ContextLoad hands out temporary ESYS_TRs while loading. Start
+       above the snapshot, so that they never collide with restored ones. */
+    old_handle_cnt = esys_context->esys_handle_cnt;
+    esys_context->esys_handle_cnt = handle_cnt;
+
+    for (i = 0; i < n; i++) {
+        r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset,
+                                     &handles[i]);
+        goto_if_error(r, "Unmarshal esys handle", error_cleanup);
+        r = Tss2_MU_UINT8_Unmarshal(buffer, buffer_size, &offset, &kind);
+        goto_if_error(r, "Unmarshal kind", error_cleanup);
+
+        /* Entries are sorted by esys handle, which rules out duplicates */
+        if (handles[i] < ESYS_TR_MIN_OBJECT || handles[i] >= handle_cnt ||
+            (i > 0 && handles[i] <= handles[i - 1])) {
+            goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Bad esys handle %" PRIx32,
+                       error_cleanup, handles[i]);
+        }
+
+        if (kind == IESYS_SNAPSHOT_TPM_CONTEXT) {
+            r = Tss2_MU_TPMS_CONTEXT_Unmarshal(buffer, buffer_size, &offset,
+                                               &context);
+            goto_if_error(r, "Unmarshal context", error_cleanup);
+            r = iesys_snapshot_load(esys_context, &context, handles[i]);
+            goto_if_error(r, "Load context", error_cleanup);
+        } else if (kind == IESYS_SNAPSHOT_METADATA) {
+            r = esys_CreateResourceObject(esys_context, handles[i], &node);
+            goto_if_error(r, "Create resource object", error_cleanup);
+            restored = i + 1;
+            r = iesys_rsrc_compact_unmarshal(&esys_context->crypto_backend,
+                                             buffer, buffer_size, &offset,
+                                             &node->rsrc);
+            goto_if_error(r, "Unmarshal resource object", error_cleanup);
+        } else {
+            goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Bad entry kind %" PRIx8,
+                       error_cleanup, kind);
+        }
+        restored = i + 1;
+    }
+
+    if (offset != buffer_size) {
+        goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Trailing data after objects.",
+                   error_cleanup);
+    }
+
+    SAFE_FREE(handles);
+    return TSS2_RC_SUCCESS;
+
+ error_cleanup:
+    for (i = 0; i < restored; i++) {
+        if (esys_GetResourceObject(esys_context, handles[i], &node) !=
+            TSS2_RC_SUCCESS)
+            continue;
+        if (iesys_snapshot_needs_tpm_context(&node->rsrc))
+            Esys_FlushContext(esys_context, handles[i]);
+        else
+            iesys_DeleteResourceObject(esys_context, handles[i]);
+    }
+    esys_context->esys_handle_cnt = old_handle_cnt;
+    SAFE_FREE(handles);
+    return r;
+}
@@ -11,11 +11,66 @@
 #include "tss2_esys.h"
 #include "esys_mu.h"
 
+#include "esys_cache.h"
 #include "esys_iutil.h"
 #define LOGMODULE esys
 #include "util/log.h"
 #include "util/aux_util.h"
 
+/** Check whether a buffer starts with the header of a batch blob.
+ *
+ * The magic is not a valid TPM handle, so it can not be confused with the
+ * first field of a blob written by Esys_TR_Serialize.
+ * @param buffer [in] The buffer (at least IESYS_BATCH_HEADER_SIZE bytes).
+ * @retval true if buffer holds a blob of Esys_TR_SerializeBatch.
+ */
+static bool
+iesys_batch_is_blob(uint8_t const *buffer)
+{
+    UINT32 magic;
+    size_t offset = 0;
+
+    return Tss2_MU_UINT32_Unmarshal(buffer, IESYS_BATCH_HEADER_SIZE, &offset,
+                                    &magic) == TSS2_RC_SUCCESS &&
+           magic == IESYS_BATCH_MAGIC;
+}
+
+/** Deserialize a batch blob holding exactly one object.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param buffer [in] The blob.
+ * @param buffer_size [in] The size of the blob.
+ * @param esys_handle [out] The new ESYS_TR object.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the blob holds more or less than one
+ *         object.
+ * @retval TSS2_RCs produced by Esys_TR_DeserializeBatch.
+ */
+static TSS2_RC
+iesys_deserialize_single(ESYS_CONTEXT * esys_context,
+                         uint8_t const *buffer, size_t buffer_size,
+                         ESYS_TR * esys_handle)
+{
+    TSS2_RC r;
+    ESYS_TR *esys_handles;
+    size_t count, i;
+
+    r = Esys_TR_DeserializeBatch(esys_context, buffer, buffer_size,
+                                 &esys_handles, &count);
+    return_if_error(r, "Deserialize batch");
+
+    if (count != 1) {
+        for (i = 0; i < count; i++)
+            iesys_DeleteResourceObject(esys_context, esys_handles[i]);
+        SAFE_FREE(esys_handles);
+        LOG_ERROR("Blob holds %zu objects instead of one.", count);
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+    *esys_handle = esys_handles[0];
+    SAFE_FREE(esys_handles);
+    return TSS2_RC_SUCCESS;
+}
+
 /** Serialization of an ESYS_TR into a byte buffer.
  *
  * Serialize the metadata of an ESYS_TR object into a byte buffer such that it
@@ -46,9 +101,8 @@ Esys_TR_Serialize(ESYS_CONTEXT * esys_context,
     r = esys_GetResourceObject(esys_context, esys_handle, &esys_object);
     return_if_error(r, "Get resource object");
 
-    r = iesys_MU_IESYS_RESOURCE_Marshal(&esys_object->rsrc, NULL, SIZE_MAX,
-                                        buffer_size);
-    return_if_error(r, "Marshal resource object");
+    r = iesys_MU_IESYS_RESOURCE_Size(&esys_object->rsrc, buffer_size);
+    return_if_error(r, "Size resource object");
 
     *buffer = malloc(*buffer_size);
     return_if_null(*buffer, "Buffer could not be allocated",
@@ -65,7 +119,8 @@ Esys_TR_Serialize(ESYS_CONTEXT * esys_context,
  *
  * Deserialize the metadata of an ESYS_TR object from a byte buffer that was
  * stored on disk for later use by a different program or context.
- * An object can be serialized suing Esys_TR_Serialize.
+ * An object can be serialized suing Esys_TR_Serialize. A blob of
+ * Esys_TR_SerializeBatch holding a single object is accepted as well.
  * @param esys_context [in,out] The ESYS_CONTEXT.
  * @param esys_handle [in] The ESYS_TR object to serialize.
  * @param buffer [out] The buffer containing the serialized metadata.
@@ -88,6 +143,14 @@ Esys_TR_Deserialize(ESYS_CONTEXT * esys_context,
     size_t offset = 0;
 
     _ESYS_ASSERT_NON_NULL(esys_context);
+
+    /* A blob of Esys_TR_SerializeBatch holding a single object */
+    if (buffer != NULL && buffer_size >= IESYS_BATCH_HEADER_SIZE &&
+        iesys_batch_is_blob(buffer)) {
+        return iesys_deserialize_single(esys_context, buffer, buffer_size,
+                                        esys_handle);
+    }
+
     *esys_handle = esys_context->esys_handle_cnt++;
     r = esys_CreateResourceObject(esys_context, *esys_handle, &esys_object);
     return_if_error(r, "Get resource object");
@@ -99,6 +162,210 @@ Esys_TR_Deserialize(ESYS_CONTEXT * esys_context,
     return TSS2_RC_SUCCESS;
 }
 
+/** Serialization of a set of ESYS_TRs into a single byte buffer.
+ *
+ * Serialize the metadata of several ESYS_TR objects, or of all objects of the
+ * ESYS_CONTEXT, into one versioned blob. Compared to calling
+ * Esys_TR_Serialize for each object, only one buffer is allocated and the
+ * records are more compact: the name of keys and NV indices is omitted, since
+ * it is recomputed from the public area during deserialization.
+ * The blob can be deserialized using Esys_TR_DeserializeBatch. A blob holding
+ * a single object can also be passed to Esys_TR_Deserialize.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param esys_handles [in] The ESYS_TR objects to serialize. If NULL, all
+ *        objects of the ESYS_CONTEXT except for the predefined ESYS_TR
+ *        constants are serialized.
+ * @param count [in] The number of entries of esys_handles.
+ * @param buffer [out] The buffer containing the serialized metadata.
+ *        (caller-callocated) Shall be freed using free().
+ * @param buffer_size [out] The size of the buffer parameter.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esys_context, buffer or buffer_size
+ *         is NULL.
+ * @retval TSS2_ESYS_RC_BAD_TR if an ESYS_TR object is unknown to the
+ *         ESYS_CONTEXT.
+ * @retval TSS2_ESYS_RC_MEMORY if the buffer for marshaling the objects can't
+ *         be allocated.
+ * @retval TSS2_ESYS_RC_BAD_VALUE For invalid ESYS data to be marshaled.
+ * @retval TSS2_RCs produced by lower layers of the software stack.
+ */
+TSS2_RC
+Esys_TR_SerializeBatch(ESYS_CONTEXT * esys_context,
+                       ESYS_TR const *esys_handles, size_t count,
+                       uint8_t ** buffer, size_t * buffer_size)
+{
+    TSS2_RC r;
+    RSRC_NODE_T **nodes = NULL;
+    RSRC_NODE_T *node;
+    UINT8 *flags = NULL;
+    size_t i, n = 0, offset = 0, record_size, size;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(buffer);
+    _ESYS_ASSERT_NON_NULL(buffer_size);
+    *buffer = NULL;
+    *buffer_size = 0;
+
+    if (esys_handles == NULL)
+        count = esys_context->rsrc_count;
+    if (count > UINT32_MAX)
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Too many objects.");
+
+    if (count > 0) {
+        nodes = calloc(count, sizeof(*nodes));
+        flags = calloc(count, sizeof(*flags));
+        if (nodes == NULL || flags == NULL) {
+            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory.", error_cleanup);
+        }
+    }
+
+    if (esys_handles == NULL) {
+        for (i = 0; i < esys_context->rsrc_table_size; i++) {
+            for (node = esys_context->rsrc_table[i]; node != NULL;
+                 node = node->next) {
+                if (node->esys_handle >= ESYS_TR_MIN_OBJECT)
+                    nodes[n++] = node;
+            }
+        }
+    } else {
+        for (n = 0; n < count; n++) {
+            r = esys_GetResourceObject(esys_context, esys_handles[n],
+                                       &nodes[n]);
+            goto_if_error(r, "Get resource object", error_cleanup);
+        }
+    }
+
+    /* Compute the size of the blob, so that it is allocated only once */
+    size = IESYS_BATCH_HEADER_SIZE;
+    for (i = 0; i < n; i++) {
+        flags[i] = iesys_rsrc_compact_flags(&esys_context->crypto_backend,
+                                            &nodes[i]->rsrc);
+        r = iesys_MU_IESYS_RESOURCE_Compact_Size(&nodes[i]->rsrc, flags[i],
+                                                 &record_size);
+        goto_if_error(r, "Size resource object", error_cleanup);
+        size += record_size;
+    }
+
+    *buffer = malloc(size);
+    goto_if_null(*buffer, "Buffer could not be allocated",
+                 TSS2_ESYS_RC_MEMORY, error_cleanup);
+
+    r = Tss2_MU_UINT32_Marshal(IESYS_BATCH_MAGIC, *buffer, size, &offset);
+    goto_if_error(r, "Marshal magic", error_cleanup);
+    r = Tss2_MU_UINT16_Marshal(IESYS_BATCH_VERSION, *buffer, size, &offset);
+    goto_if_error(r, "Marshal version", error_cleanup);
+    r = Tss2_MU_UINT16_Marshal(0, *buffer, size, &offset);
+    goto_if_error(r, "Marshal reserved", error_cleanup);
+    r = Tss2_MU_UINT32_Marshal((UINT32) n, *buffer, size, &offset);
+    goto_if_error(r, "Marshal count", error_cleanup);
+
+    for (i = 0; i < n; i++) {
+        r = iesys_MU_IESYS_RESOURCE_Compact_Marshal(&nodes[i]->rsrc, flags[i],
+                                                    *buffer, size, &offset);
+        goto_if_error(r, "Marshal resource object", error_cleanup);
+    }
+
+    *buffer_size = size;
+    SAFE_FREE(nodes);
+    SAFE_FREE(flags);
+    return TSS2_RC_SUCCESS;
+
+ error_cleanup:
+    SAFE_FREE(*buffer);
+    SAFE_FREE(nodes);
+    SAFE_FREE(flags);
+    return r;
+}
+
+/** Deserialization of a set of ESYS_TRs from a single byte buffer.
+ *
+ * Deserialize all objects of a blob written by Esys_TR_SerializeBatch in one
+ * pass. Names that were omitted from the blob are recomputed from the public
+ * area. If any object can not be deserialized, no object is created.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param buffer [in] The buffer containing the serialized metadata.
+ * @param buffer_size [in] The size of the buffer parameter.
+ * @param esys_handles [out] The new ESYS_TR objects, in the order in which
+ *        they were serialized (callee-allocated). Shall be freed using free().
+ *        NULL if the blob holds no objects.
+ * @param count [out] The number of entries of esys_handles.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the buffer does not hold a blob of a
+ *         supported version, or has trailing data.
+ * @retval TSS2_ESYS_RC_MEMORY if the objects can not be allocated.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_BUFFER if the blob is truncated.
+ * @retval TSS2_RCs produced by lower layers of the software stack.
+ */
+TSS2_RC
+Esys_TR_DeserializeBatch(ESYS_CONTEXT * esys_context,
+                         uint8_t const *buffer, size_t buffer_size,
+                         ESYS_TR ** esys_handles, size_t * count)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *esys_object;
+    UINT32 magic, n;
+    UINT16 version, reserved;
+    size_t i, offset = 0;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(buffer);
+    _ESYS_ASSERT_NON_NULL(esys_handles);
+    _ESYS_ASSERT_NON_NULL(count);
+    *esys_handles = NULL;
+    *count = 0;
+
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &magic);
+    return_if_error(r, "Unmarshal magic");
+    r = Tss2_MU_UINT16_Unmarshal(buffer, buffer_size, &offset, &version);
+    return_if_error(r, "Unmarshal version");
+    r = Tss2_MU_UINT16_Unmarshal(buffer, buffer_size, &offset, &reserved);
+    return_if_error(r, "Unmarshal reserved");
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &n);
+    return_if_error(r, "Unmarshal count");
+
+    if (magic != IESYS_BATCH_MAGIC || version != IESYS_BATCH_VERSION ||
+        reserved != 0) {
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Unsupported blob format.");
+    }
+    /* Every record holds at least a handle, a type and flags */
+    if (n > (buffer_size - offset) / (sizeof(TPM2_HANDLE) + 2))
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Bad number of objects.");
+    if (n == 0)
+        goto done;
+
+    *esys_handles = calloc(n, sizeof(ESYS_TR));
+    return_if_null(*esys_handles, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    for (i = 0; i < n; i++) {
+        (*esys_handles)[i] = esys_context->esys_handle_cnt++;
+        r = esys_CreateResourceObject(esys_context, (*esys_handles)[i],
+                                      &esys_object);
+        goto_if_error(r, "Create resource object", error_cleanup);
+        *count = i + 1;
+
+        r = iesys_rsrc_compact_unmarshal(&esys_context->crypto_backend,
+                                         buffer, buffer_size, &offset,
+                                         &esys_object->rsrc);
+        goto_if_error(r, "Unmarshal resource object", error_cleanup);
+    }
+
+ done:
+    if (offset != buffer_size) {
+        goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Trailing data after objects.",
+                   error_cleanup);
+    }
+    *count = n;
+    return TSS2_RC_SUCCESS;
+
+ error_cleanup:
+    for (i = 0; i < *count; i++)
+        iesys_DeleteResourceObject(esys_context, (*esys_handles)[i]);
+    SAFE_FREE(*esys_handles);
+    *count = 0;
+    return r;
+}
+
 /** Start synchronous creation of an ESYS_TR object from TPM metadata.
  *
  * This function starts the asynchronous retrieval of metadata from the TPM in
@@ -139,6 +406,21 @@ Esys_TR_FromTPMPublic_Async(ESYS_CONTEXT * esys_context,
 
     esysHandleNode->rsrc.handle = tpm_handle;
     esys_context->esys_handle = esys_handle;
+    esys_context->cache_hit = 0;
+
+    /* Metadata without verification by a session may come from the cache */
+    if (esys_context->shared_cache && shandle1 == ESYS_TR_NONE &&
+        shandle2 == ESYS_TR_NONE && shandle3 == ESYS_TR_NONE &&
+        iesys_cache_handle_cacheable(tpm_handle)) {
+        r = iesys_check_sequence_async(esys_context);
+        goto_if_error(r, "Error check sequence", error_cleanup);
+        if (iesys_cache_get(tpm_handle, &esysHandleNode->rsrc)) {
+            esys_context->cache_hit = 1;
+            return TSS2_RC_SUCCESS;
+        }
+    }
+    if (esys_context->shared_cache)
+        esys_context->cache_generation = iesys_cache_generation();
 
     if (tpm_handle >= TPM2_NV_INDEX_FIRST && tpm_handle <= TPM2_NV_INDEX_LAST) {
         r = Esys_NV_ReadPublic_Async(esys_context, esys_handle, shandle1,
@@ -197,6 +479,12 @@ Esys_TR_FromTPMPublic_Finish(ESYS_CONTEXT * esys_context, ESYS_TR * object)
     r = esys_GetResourceObject(esys_context, objectHandle, &objectHandleNode);
     goto_if_error(r, "get resource", error_cleanup);
 
+    if (esys_context->cache_hit) {
+        esys_context->cache_hit = 0;
+        *object = objectHandle;
+        return TSS2_RC_SUCCESS;
+    }
+
     if (objectHandleNode->rsrc.handle >= TPM2_NV_INDEX_FIRST
         && objectHandleNode->rsrc.handle <= TPM2_NV_INDEX_LAST) {
         TPM2B_NV_PUBLIC *nvPublic;
@@ -237,6 +525,9 @@ Esys_TR_FromTPMPublic_Finish(ESYS_CONTEXT * esys_context, ESYS_TR * object)
         SAFE_FREE(name);
         SAFE_FREE(qualifiedName);
     }
+    if (esys_context->shared_cache)
+        iesys_cache_put(&objectHandleNode->rsrc,
+                        esys_context->cache_generation);
     *object = objectHandle;
     return TSS2_RC_SUCCESS;
 
@@ -255,6 +546,9 @@ Esys_TR_FromTPMPublic_Finish(ESYS_CONTEXT * esys_context, ESYS_TR * object)
  * Note: If a session is provided the TPM is queried for the metadata twice.
  * First without a session to retrieve some metadata then with the session where
  * this metadata is used in the session HMAC calculation and thereby verified.
+ * Note: If the shared cache is enabled with Esys_SetSharedCache and no session
+ * is provided, persistent objects and NV indices already known to the cache are
+ * created without querying the TPM.
  *
  * Since man in the middle attacks should be prevented as much as possible it is
  * recommended to pass a session.
@@ -339,20 +633,10 @@ Esys_TR_FromTPMPublic(ESYS_CONTEXT * esys_context,
 TSS2_RC
 Esys_TR_Close(ESYS_CONTEXT * esys_context, ESYS_TR * object)
 {
-    RSRC_NODE_T *node;
-    RSRC_NODE_T **update_ptr;
-
     _ESYS_ASSERT_NON_NULL(esys_context);
-    for (node = esys_context->rsrc_list,
-         update_ptr = &esys_context->rsrc_list;
-         node != NULL;
-         update_ptr = &node->next, node = node->next) {
-        if (node->esys_handle == *object) {
-            *update_ptr = node->next;
-            SAFE_FREE(node);
-            *object = ESYS_TR_NONE;
-            return TSS2_RC_SUCCESS;
-        }
+    if (iesys_DeleteResourceObject(esys_context, *object) == TSS2_RC_SUCCESS) {
+        *object = ESYS_TR_NONE;
+        return TSS2_RC_SUCCESS;
     }
     LOG_ERROR("Error: Esys handle does not exist (%x).", TSS2_ESYS_RC_BAD_TR);
     return TSS2_ESYS_RC_BAD_TR;
@@ -403,7 +687,8 @@ Esys_TR_SetAuth(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle,
         esys_object->auth = *authValue;
         /* Adapt auth value to hash for large auth values. */
         if (name_alg != TPM2_ALG_NULL) {
-            r = iesys_hash_long_auth_values(&esys_object->auth, name_alg);
+            r = iesys_hash_long_auth_values(&esys_context->crypto_backend,
+                                            &esys_object->auth, name_alg);
             return_if_error(r, "Hashing overlength authValue failed.");
         }
     }
@@ -439,23 +724,19 @@ Esys_TR_GetName(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle,
         LOG_ERROR("Error: out of memory");
         return TSS2_ESYS_RC_MEMORY;
     }
-    if (esys_object->rsrc.rsrcType == IESYSC_KEY_RSRC) {
-        r = iesys_get_name(&esys_object->rsrc.misc.rsrc_key_pub, *name);
+    if (esys_object->rsrc.rsrcType == IESYSC_KEY_RSRC ||
+        esys_object->rsrc.rsrcType == IESYSC_NV_RSRC) {
+        r = iesys_rsrc_get_name(&esys_context->crypto_backend,
+                                &esys_object->rsrc, *name);
         goto_if_error(r, "Error get name", error_cleanup);
 
     } else {
-        if (esys_object->rsrc.rsrcType == IESYSC_NV_RSRC) {
-            r = iesys_nv_get_name(&esys_object->rsrc.misc.rsrc_nv_pub, *name);
-            goto_if_error(r, "Error get name", error_cleanup);
-
-        } else {
-            size_t offset = 0;
-            r = Tss2_MU_TPM2_HANDLE_Marshal(esys_object->rsrc.handle,
-                                            &(*name)->name[0], sizeof(TPM2_HANDLE),
-                                            &offset);
-            goto_if_error(r, "Error get name", error_cleanup);
-            (*name)->size = offset;
-        }
+        size_t offset = 0;
+        r = Tss2_MU_TPM2_HANDLE_Marshal(esys_object->rsrc.handle,
+                                        &(*name)->name[0], sizeof(TPM2_HANDLE),
+                                        &offset);
+        goto_if_error(r, "Error get name", error_cleanup);
+        (*name)->size = offset;
     }
     return r;
  error_cleanup:
@@ -88,6 +88,8 @@ typedef struct {
     TPM2B_NAME                                     name;    /**< TPM name of the object */
     IESYSC_RESOURCE_TYPE                       rsrcType;    /**< Selector for resource type */
     IESYS_RSRC_UNION                               misc;    /**< Resource specific information */
+    UINT8                                  nameComputed;    /**< Whether name is known to be computed from
+                                                                 the current public area in misc */
 } IESYS_RESOURCE;
 
 /**  Esys resource with size field
@@ -320,10 +320,8 @@ Fapi_GetEsysBlob_Finish(
             return_try_again(r);
             goto_if_error(r, "Error esys context save", error_cleanup);
 
-            command->length = 0;
-            r = Tss2_MU_TPMS_CONTEXT_Marshal(key_context, NULL, SIZE_MAX,
-                                             &command->length);
-            goto_if_error(r, "Marshaling context", error_cleanup);
+            r = Tss2_MU_TPMS_CONTEXT_Size(key_context, &command->length);
+            goto_if_error(r, "Sizing context", error_cleanup);
 
             command->data = malloc(command->length);
             goto_if_null2(command->data, "Out of memory", r, TSS2_FAPI_RC_MEMORY,
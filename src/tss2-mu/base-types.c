@@ -152,37 +152,69 @@ Tss2_MU_##type##_Unmarshal ( \
     return TSS2_RC_SUCCESS; \
 }
 
+#define BASE_SIZE(type) \
+TSS2_RC \
+Tss2_MU_##type##_Size ( \
+    type           src, \
+    size_t        *size) \
+{ \
+    UNUSED(src); \
+\
+    if (size == NULL) { \
+        LOG_ERROR("size parameter is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+    *size = sizeof (type); \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
 /*
- * These macros expand to (un)marshal functions for each of the base types
- * the specification part 2, table 3: Definition of Base Types.
+ * These macros expand to (un)marshal and size functions for each of the base
+ * types the specification part 2, table 3: Definition of Base Types.
  */
 BASE_MARSHAL  (BYTE)
 BASE_UNMARSHAL(BYTE)
+BASE_SIZE     (BYTE)
 BASE_MARSHAL  (INT8)
 BASE_UNMARSHAL(INT8)
+BASE_SIZE     (INT8)
 BASE_MARSHAL  (INT16)
 BASE_UNMARSHAL(INT16)
+BASE_SIZE     (INT16)
 BASE_MARSHAL  (INT32)
 BASE_UNMARSHAL(INT32)
+BASE_SIZE     (INT32)
 BASE_MARSHAL  (INT64)
 BASE_UNMARSHAL(INT64)
+BASE_SIZE     (INT64)
 BASE_MARSHAL  (UINT8)
 BASE_UNMARSHAL(UINT8)
+BASE_SIZE     (UINT8)
 BASE_MARSHAL  (UINT16)
 BASE_UNMARSHAL(UINT16)
+BASE_SIZE     (UINT16)
 BASE_MARSHAL  (UINT32)
 BASE_UNMARSHAL(UINT32)
+BASE_SIZE     (UINT32)
 BASE_MARSHAL  (UINT64)
 BASE_UNMARSHAL(UINT64)
+BASE_SIZE     (UINT64)
 BASE_MARSHAL  (TPM2_CC)
 BASE_UNMARSHAL(TPM2_CC)
+BASE_SIZE     (TPM2_CC)
 BASE_MARSHAL  (TPM2_ST)
 BASE_UNMARSHAL(TPM2_ST)
+BASE_SIZE     (TPM2_ST)
 BASE_MARSHAL  (TPM2_SE)
 BASE_UNMARSHAL(TPM2_SE)
+BASE_SIZE     (TPM2_SE)
 BASE_MARSHAL  (TPM2_NT)
 BASE_UNMARSHAL(TPM2_NT)
+BASE_SIZE     (TPM2_NT)
 BASE_MARSHAL  (TPM2_HANDLE)
 BASE_UNMARSHAL(TPM2_HANDLE)
+BASE_SIZE     (TPM2_HANDLE)
 BASE_MARSHAL  (TPMI_ALG_HASH)
 BASE_UNMARSHAL(TPMI_ALG_HASH)
+BASE_SIZE     (TPMI_ALG_HASH)
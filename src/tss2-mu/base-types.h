@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright 2026, agent
+ * All rights reserved.
+ */
+#ifndef BASE_TYPES_H
+#define BASE_TYPES_H
+
+#include <string.h>
+
+#include "tss2_mu.h"
+
+#include "util/tss2_endian.h"
+
+/*
+ * Inline versions of the base type (un)marshal functions from base-types.c
+ * for use by the composite marshallers. They return the same response codes
+ * as the exported functions but do not log anything: a TPM2B or TPMS structure
+ * fans out into dozens of base type calls, so logging is left to the
+ * composite level, which reports the failing member anyway.
+ */
+#define BASE_MARSHAL_INLINE(type) \
+static inline TSS2_RC \
+mu_##type##_Marshal ( \
+    type           src, \
+    uint8_t        buffer [], \
+    size_t         buffer_size, \
+    size_t        *offset) \
+{ \
+    size_t  local_offset = offset != NULL ? *offset : 0; \
+\
+    if (buffer == NULL) { \
+        if (offset == NULL) \
+            return TSS2_MU_RC_BAD_REFERENCE; \
+        *offset += sizeof (src); \
+        return TSS2_RC_SUCCESS; \
+    } \
+    if (buffer_size < local_offset || \
+        buffer_size - local_offset < sizeof (src)) \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+\
+    switch (sizeof (type)) { \
+        case 2: \
+            src = HOST_TO_BE_16(src); \
+            break; \
+        case 4: \
+            src = HOST_TO_BE_32(src); \
+            break; \
+        case 8: \
+            src = HOST_TO_BE_64(src); \
+            break; \
+    } \
+    memcpy (&buffer [local_offset], &src, sizeof (src)); \
+    if (offset != NULL) \
+        *offset = local_offset + sizeof (src); \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+#define BASE_UNMARSHAL_INLINE(type) \
+static inline TSS2_RC \
+mu_##type##_Unmarshal ( \
+    uint8_t const buffer[], \
+    size_t        buffer_size, \
+    size_t       *offset, \
+    type         *dest) \
+{ \
+    size_t  local_offset = offset != NULL ? *offset : 0; \
+    type tmp; \
+\
+    if (buffer == NULL || (dest == NULL && offset == NULL)) \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    if (buffer_size < local_offset || \
+        sizeof (type) > buffer_size - local_offset) \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+    if (dest == NULL) { \
+        *offset += sizeof (type); \
+        return TSS2_RC_SUCCESS; \
+    } \
+\
+    memcpy (&tmp, &buffer [local_offset], sizeof (tmp)); \
+\
+    switch (sizeof (type)) { \
+        case 1: \
+            *dest = tmp; \
+            break; \
+        case 2: \
+            *dest = BE_TO_HOST_16(tmp); \
+            break; \
+        case 4: \
+            *dest = BE_TO_HOST_32(tmp); \
+            break; \
+        case 8: \
+            *dest = BE_TO_HOST_64(tmp); \
+            break; \
+    } \
+\
+    if (offset != NULL) \
+        *offset = local_offset + sizeof (type); \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * The wire size of a base type is its in-memory size, so sizing one never
+ * depends on the value.
+ */
+#define BASE_SIZE_INLINE(type) \
+static inline TSS2_RC \
+mu_##type##_Size ( \
+    type          src, \
+    size_t       *size) \
+{ \
+    (void)src; \
+    *size = sizeof (type); \
+    return TSS2_RC_SUCCESS; \
+}
+
+BASE_MARSHAL_INLINE  (BYTE)
+BASE_UNMARSHAL_INLINE(BYTE)
+BASE_MARSHAL_INLINE  (UINT8)
+BASE_UNMARSHAL_INLINE(UINT8)
+BASE_MARSHAL_INLINE  (UINT16)
+BASE_UNMARSHAL_INLINE(UINT16)
+BASE_MARSHAL_INLINE  (UINT32)
+BASE_UNMARSHAL_INLINE(UINT32)
+BASE_MARSHAL_INLINE  (UINT64)
+BASE_UNMARSHAL_INLINE(UINT64)
+BASE_MARSHAL_INLINE  (TPM2_CC)
+BASE_UNMARSHAL_INLINE(TPM2_CC)
+BASE_MARSHAL_INLINE  (TPM2_ST)
+BASE_UNMARSHAL_INLINE(TPM2_ST)
+BASE_MARSHAL_INLINE  (TPM2_HANDLE)
+BASE_UNMARSHAL_INLINE(TPM2_HANDLE)
+BASE_MARSHAL_INLINE  (TPMI_ALG_HASH)
+BASE_UNMARSHAL_INLINE(TPMI_ALG_HASH)
+BASE_SIZE_INLINE     (UINT8)
+BASE_SIZE_INLINE     (UINT16)
+BASE_SIZE_INLINE     (UINT32)
+BASE_SIZE_INLINE     (UINT64)
+BASE_SIZE_INLINE     (TPM2_ST)
+BASE_SIZE_INLINE     (TPM2_HANDLE)
+
+/*
+ * Statements for the bodies of the composite Tss2_MU_*_Size functions. They
+ * expect a 'src' pointer to the structure and accumulate into 'local_size'.
+ * The op / fn arguments mirror the ones given to the marshal macros, with fn
+ * being the _Size function of the member type. SIZE_MEMBER_U is used for
+ * union members whose selector is another member of the same structure.
+ */
+#define SIZE_MEMBER(m, op, fn) \
+    { \
+        size_t member_size = 0; \
+        TSS2_RC member_rc = fn(op src->m, &member_size); \
+        if (member_rc != TSS2_RC_SUCCESS) \
+            return member_rc; \
+        local_size += member_size; \
+    }
+
+#define SIZE_MEMBER_U(m, op, sel, fn) \
+    { \
+        size_t member_size = 0; \
+        TSS2_RC member_rc = fn(op src->m, src->sel, &member_size); \
+        if (member_rc != TSS2_RC_SUCCESS) \
+            return member_rc; \
+        local_size += member_size; \
+    }
+
+#endif /* BASE_TYPES_H */
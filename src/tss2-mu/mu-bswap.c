@@ -0,0 +1,227 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mu-bswap.h"
+#include "util/tss2_endian.h"
+
+/*
+ * Portable kernels. These are also the reference the vector kernels are
+ * tested against and handle the tails the vector kernels leave behind.
+ * On big-endian hosts HOST_TO_BE_* is the identity and they degrade to a
+ * plain copy.
+ */
+static int
+scalar_supported(void)
+{
+    return 1;
+}
+
+static void
+bswap16_scalar(void *dst, const void *src, size_t count)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    uint16_t v;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        memcpy(&v, &s[i * sizeof(v)], sizeof(v));
+        v = HOST_TO_BE_16(v);
+        memcpy(&d[i * sizeof(v)], &v, sizeof(v));
+    }
+}
+
+static void
+bswap32_scalar(void *dst, const void *src, size_t count)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    uint32_t v;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        memcpy(&v, &s[i * sizeof(v)], sizeof(v));
+        v = HOST_TO_BE_32(v);
+        memcpy(&d[i * sizeof(v)], &v, sizeof(v));
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MU_BSWAP_X86 1
+#include <immintrin.h>
+
+#define SHUF16 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+#define SHUF32 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+
+static int
+ssse3_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+static int
+avx2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+/* Swap whole 16 byte blocks and return the number of bytes processed. */
+__attribute__((target("ssse3")))
+static size_t
+shuffle_ssse3(uint8_t *d, const uint8_t *s, size_t bytes, size_t width)
+{
+    const __m128i mask = (width == 2) ? _mm_setr_epi8(SHUF16) :
+                                        _mm_setr_epi8(SHUF32);
+    size_t i;
+
+    for (i = 0; bytes - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&s[i]);
+        _mm_storeu_si128((__m128i *)&d[i], _mm_shuffle_epi8(v, mask));
+    }
+    return i;
+}
+
+/* Swap whole 32 byte blocks and return the number of bytes processed. */
+__attribute__((target("avx2")))
+static size_t
+shuffle_avx2(uint8_t *d, const uint8_t *s, size_t bytes, size_t width)
+{
+    const __m256i mask = (width == 2) ? _mm256_setr_epi8(SHUF16, SHUF16) :
+                                        _mm256_setr_epi8(SHUF32, SHUF32);
+    size_t i;
+
+    for (i = 0; bytes - i >= 32; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&s[i]);
+        _mm256_storeu_si256((__m256i *)&d[i], _mm256_shuffle_epi8(v, mask));
+    }
+    return i;
+}
+
+static void
+bswap16_ssse3(void *dst, const void *src, size_t count)
+{
+    size_t done = shuffle_ssse3(dst, src, count * 2, 2);
+
+    bswap16_scalar((uint8_t *)dst + done, (const uint8_t *)src + done,
+                   count - done / 2);
+}
+
+static void
+bswap32_ssse3(void *dst, const void *src, size_t count)
+{
+    size_t done = shuffle_ssse3(dst, src, count * 4, 4);
+
+    bswap32_scalar((uint8_t *)dst + done, (const uint8_t *)src + done,
+                   count - done / 4);
+}
+
+/* AVX2 implies SSSE3, so the 16 byte kernel picks up what is left. */
+static void
+bswap16_avx2(void *dst, const void *src, size_t count)
+{
+    size_t done = shuffle_avx2(dst, src, count * 2, 2);
+
+    bswap16_ssse3((uint8_t *)dst + done, (const uint8_t *)src + done,
+                  count - done / 2);
+}
+
+static void
+bswap32_avx2(void *dst, const void *src, size_t count)
+{
+    size_t done = shuffle_avx2(dst, src, count * 4, 4);
+
+    bswap32_ssse3((uint8_t *)dst + done, (const uint8_t *)src + done,
+                  count - done / 4);
+}
+#endif /* x86 */
+
+#if defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#define MU_BSWAP_NEON 1
+#include <arm_neon.h>
+
+/* NEON is part of the baseline wherever the compiler defines __ARM_NEON. */
+static int
+neon_supported(void)
+{
+    return 1;
+}
+
+static void
+bswap16_neon(void *dst, const void *src, size_t count)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    size_t i, bytes = count * 2;
+
+    for (i = 0; bytes - i >= 16; i += 16)
+        vst1q_u8(&d[i], vrev16q_u8(vld1q_u8(&s[i])));
+    bswap16_scalar(&d[i], &s[i], (bytes - i) / 2);
+}
+
+static void
+bswap32_neon(void *dst, const void *src, size_t count)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    size_t i, bytes = count * 4;
+
+    for (i = 0; bytes - i >= 16; i += 16)
+        vst1q_u8(&d[i], vrev32q_u8(vld1q_u8(&s[i])));
+    bswap32_scalar(&d[i], &s[i], (bytes - i) / 4);
+}
+#endif /* NEON */
+
+const MU_BSWAP_IMPL mu_bswap_impls[] = {
+#ifdef MU_BSWAP_X86
+    { "avx2", avx2_supported, bswap16_avx2, bswap32_avx2 },
+    { "ssse3", ssse3_supported, bswap16_ssse3, bswap32_ssse3 },
+#endif
+#ifdef MU_BSWAP_NEON
+    { "neon", neon_supported, bswap16_neon, bswap32_neon },
+#endif
+    { "scalar", scalar_supported, bswap16_scalar, bswap32_scalar },
+    { NULL, NULL, NULL, NULL }
+};
+
+/*
+ * Pick the best supported kernel on first use. Concurrent first calls may
+ * each run the detection, but they all store the same pointer.
+ */
+static const MU_BSWAP_IMPL *
+bswap_impl(void)
+{
+    static const MU_BSWAP_IMPL *selected;
+    const MU_BSWAP_IMPL *impl = selected;
+
+    if (impl == NULL) {
+        for (impl = mu_bswap_impls; !impl->supported(); impl++)
+            ;
+        selected = impl;
+    }
+    return impl;
+}
+
+void
+mu_bswap16(void *dst, const void *src, size_t count)
+{
+    bswap_impl()->swap16(dst, src, count);
+}
+
+void
+mu_bswap32(void *dst, const void *src, size_t count)
+{
+    bswap_impl()->swap32(dst, src, count);
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright 2026, agent
+ * All rights reserved.
+ */
+#ifndef MU_BSWAP_H
+#define MU_BSWAP_H
+
+#include <stddef.h>
+
+/*
+ * Bulk conversion of contiguous UINT16 / UINT32 arrays between host byte
+ * order and the big-endian TPM wire format. Conversion is symmetric, so the
+ * same function serves marshalling and unmarshalling. dst and src may be
+ * unaligned but must not overlap.
+ */
+typedef void (*mu_bswap_func)(void *dst, const void *src, size_t count);
+
+typedef struct {
+    const char     *name;
+    int           (*supported)(void);
+    mu_bswap_func   swap16;
+    mu_bswap_func   swap32;
+} MU_BSWAP_IMPL;
+
+/*
+ * All kernels compiled into the library, best first, terminated by an entry
+ * with name == NULL. The last real entry is the portable scalar kernel,
+ * which is always supported.
+ */
+extern const MU_BSWAP_IMPL mu_bswap_impls[];
+
+void
+mu_bswap16(void *dst, const void *src, size_t count);
+
+void
+mu_bswap32(void *dst, const void *src, size_t count);
+
+#endif /* MU_BSWAP_H */
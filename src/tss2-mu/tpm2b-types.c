@@ -15,6 +15,7 @@
 #include "tss2_mu.h"
 
 #include "util/tpm2b.h"
+#include "base-types.h"
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
 #include "util/log.h"
@@ -69,7 +70,7 @@ TSS2_RC Tss2_MU_##type##_Marshal(type const *src, uint8_t buffer[], \
          buffer_size, \
          src->size); \
 \
-    rc = Tss2_MU_UINT16_Marshal(src->size, buffer, buffer_size, &local_offset); \
+    rc = mu_UINT16_Marshal(src->size, buffer, buffer_size, &local_offset); \
     if (rc) \
         return rc; \
 \
@@ -114,7 +115,7 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
         return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
     } \
 \
-    rc = Tss2_MU_UINT16_Unmarshal(buffer, buffer_size, &local_offset, &size); \
+    rc = mu_UINT16_Unmarshal(buffer, buffer_size, &local_offset, &size); \
     if (rc) \
         return rc; \
 \
@@ -199,7 +200,7 @@ TSS2_RC Tss2_MU_##type##_Marshal(type const *src, uint8_t buffer[], \
          buffer_size, \
          src->size); \
 \
-    rc = Tss2_MU_UINT16_Marshal(src->size, buffer, buffer_size, &local_offset); \
+    rc = mu_UINT16_Marshal(src->size, buffer, buffer_size, &local_offset); \
     if (rc) \
         return rc; \
 \
@@ -251,7 +252,7 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
         return TSS2_SYS_RC_BAD_VALUE; \
     } \
 \
-    rc = Tss2_MU_UINT16_Unmarshal(buffer, buffer_size, &local_offset, &size); \
+    rc = mu_UINT16_Unmarshal(buffer, buffer_size, &local_offset, &size); \
     if (rc) \
         return rc; \
     LOG_DEBUG(\
@@ -295,67 +296,139 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
     return TSS2_RC_SUCCESS; \
 }
 
+#define TPM2B_SIZE(type) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    if (src == NULL || size == NULL) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+    if ((sizeof(type) - sizeof(src->size)) < src->size) { \
+        LOG_WARNING(\
+             "size: %u for buffer of " #type " is larger than max length" \
+             " of buffer: %zu", \
+             src->size, \
+             (sizeof(type) - sizeof(src->size))); \
+        return TSS2_MU_RC_BAD_SIZE; \
+    } \
+\
+    *size = sizeof(src->size) + src->size; \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * The size field of these TPM2B types is recomputed when marshalling, so
+ * the wire size is derived from the wrapped structure, not from src->size.
+ */
+#define TPM2B_SIZE_SUBTYPE(type, subtype, member) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    size_t local_size = sizeof(src->size); \
+\
+    if (src == NULL || size == NULL) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    SIZE_MEMBER(member, &, Tss2_MU_##subtype##_Size) \
+\
+    *size = local_size; \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
 /*
- * These macros expand to (un)marshal functions for each of the TPM2B types
- * the specification part 2.
+ * These macros expand to (un)marshal and size functions for each of the
+ * TPM2B types the specification part 2.
  */
 TPM2B_MARSHAL  (TPM2B_DIGEST);
 TPM2B_UNMARSHAL(TPM2B_DIGEST, buffer);
+TPM2B_SIZE     (TPM2B_DIGEST);
 TPM2B_MARSHAL  (TPM2B_DATA);
 TPM2B_UNMARSHAL(TPM2B_DATA, buffer);
+TPM2B_SIZE     (TPM2B_DATA);
 TPM2B_MARSHAL  (TPM2B_EVENT);
 TPM2B_UNMARSHAL(TPM2B_EVENT, buffer);
+TPM2B_SIZE     (TPM2B_EVENT);
 TPM2B_MARSHAL  (TPM2B_MAX_BUFFER);
 TPM2B_UNMARSHAL(TPM2B_MAX_BUFFER, buffer);
+TPM2B_SIZE     (TPM2B_MAX_BUFFER);
 TPM2B_MARSHAL  (TPM2B_MAX_NV_BUFFER);
 TPM2B_UNMARSHAL(TPM2B_MAX_NV_BUFFER, buffer);
+TPM2B_SIZE     (TPM2B_MAX_NV_BUFFER);
 TPM2B_MARSHAL  (TPM2B_IV);
 TPM2B_UNMARSHAL(TPM2B_IV, buffer);
+TPM2B_SIZE     (TPM2B_IV);
 TPM2B_MARSHAL  (TPM2B_NAME);
 TPM2B_UNMARSHAL(TPM2B_NAME, name);
+TPM2B_SIZE     (TPM2B_NAME);
 TPM2B_MARSHAL  (TPM2B_ATTEST);
 TPM2B_UNMARSHAL(TPM2B_ATTEST, attestationData);
+TPM2B_SIZE     (TPM2B_ATTEST);
 TPM2B_MARSHAL  (TPM2B_SYM_KEY);
 TPM2B_UNMARSHAL(TPM2B_SYM_KEY, buffer);
+TPM2B_SIZE     (TPM2B_SYM_KEY);
 TPM2B_MARSHAL  (TPM2B_SENSITIVE_DATA);
 TPM2B_UNMARSHAL(TPM2B_SENSITIVE_DATA, buffer);
+TPM2B_SIZE     (TPM2B_SENSITIVE_DATA);
 TPM2B_MARSHAL  (TPM2B_PUBLIC_KEY_RSA);
 TPM2B_UNMARSHAL(TPM2B_PUBLIC_KEY_RSA, buffer);
+TPM2B_SIZE     (TPM2B_PUBLIC_KEY_RSA);
 TPM2B_MARSHAL  (TPM2B_PRIVATE_KEY_RSA);
 TPM2B_UNMARSHAL(TPM2B_PRIVATE_KEY_RSA, buffer);
+TPM2B_SIZE     (TPM2B_PRIVATE_KEY_RSA);
 TPM2B_MARSHAL  (TPM2B_ECC_PARAMETER);
 TPM2B_UNMARSHAL(TPM2B_ECC_PARAMETER, buffer);
+TPM2B_SIZE     (TPM2B_ECC_PARAMETER);
 TPM2B_MARSHAL  (TPM2B_ENCRYPTED_SECRET);
 TPM2B_UNMARSHAL(TPM2B_ENCRYPTED_SECRET, secret);
+TPM2B_SIZE     (TPM2B_ENCRYPTED_SECRET);
 TPM2B_MARSHAL  (TPM2B_PRIVATE_VENDOR_SPECIFIC);
 TPM2B_UNMARSHAL(TPM2B_PRIVATE_VENDOR_SPECIFIC, buffer);
+TPM2B_SIZE     (TPM2B_PRIVATE_VENDOR_SPECIFIC);
 TPM2B_MARSHAL  (TPM2B_PRIVATE);
 TPM2B_UNMARSHAL(TPM2B_PRIVATE, buffer);
+TPM2B_SIZE     (TPM2B_PRIVATE);
 TPM2B_MARSHAL  (TPM2B_ID_OBJECT);
 TPM2B_UNMARSHAL(TPM2B_ID_OBJECT, credential);
+TPM2B_SIZE     (TPM2B_ID_OBJECT);
 TPM2B_MARSHAL  (TPM2B_CONTEXT_SENSITIVE);
 TPM2B_UNMARSHAL(TPM2B_CONTEXT_SENSITIVE, buffer);
+TPM2B_SIZE     (TPM2B_CONTEXT_SENSITIVE);
 TPM2B_MARSHAL  (TPM2B_CONTEXT_DATA);
 TPM2B_UNMARSHAL(TPM2B_CONTEXT_DATA, buffer);
+TPM2B_SIZE     (TPM2B_CONTEXT_DATA);
 TPM2B_MARSHAL  (TPM2B_NONCE);
 TPM2B_UNMARSHAL(TPM2B_NONCE, buffer);
+TPM2B_SIZE     (TPM2B_NONCE);
 TPM2B_MARSHAL  (TPM2B_TIMEOUT);
 TPM2B_UNMARSHAL(TPM2B_TIMEOUT, buffer);
+TPM2B_SIZE     (TPM2B_TIMEOUT);
 TPM2B_MARSHAL  (TPM2B_AUTH);
 TPM2B_UNMARSHAL(TPM2B_AUTH, buffer);
+TPM2B_SIZE     (TPM2B_AUTH);
 TPM2B_MARSHAL  (TPM2B_OPERAND);
 TPM2B_UNMARSHAL(TPM2B_OPERAND, buffer);
+TPM2B_SIZE     (TPM2B_OPERAND);
 TPM2B_MARSHAL  (TPM2B_TEMPLATE);
 TPM2B_UNMARSHAL(TPM2B_TEMPLATE, buffer);
+TPM2B_SIZE     (TPM2B_TEMPLATE);
 TPM2B_MARSHAL_SUBTYPE(TPM2B_ECC_POINT, TPMS_ECC_POINT, point);
 TPM2B_UNMARSHAL_SUBTYPE(TPM2B_ECC_POINT, TPMS_ECC_POINT, point);
+TPM2B_SIZE_SUBTYPE(TPM2B_ECC_POINT, TPMS_ECC_POINT, point);
 TPM2B_MARSHAL_SUBTYPE(TPM2B_NV_PUBLIC, TPMS_NV_PUBLIC, nvPublic);
 TPM2B_UNMARSHAL_SUBTYPE(TPM2B_NV_PUBLIC, TPMS_NV_PUBLIC, nvPublic);
+TPM2B_SIZE_SUBTYPE(TPM2B_NV_PUBLIC, TPMS_NV_PUBLIC, nvPublic);
 TPM2B_MARSHAL_SUBTYPE(TPM2B_SENSITIVE, TPMT_SENSITIVE, sensitiveArea);
 TPM2B_UNMARSHAL_SUBTYPE(TPM2B_SENSITIVE, TPMT_SENSITIVE, sensitiveArea);
+TPM2B_SIZE_SUBTYPE(TPM2B_SENSITIVE, TPMT_SENSITIVE, sensitiveArea);
 TPM2B_MARSHAL_SUBTYPE(TPM2B_SENSITIVE_CREATE, TPMS_SENSITIVE_CREATE, sensitive);
 TPM2B_UNMARSHAL_SUBTYPE(TPM2B_SENSITIVE_CREATE, TPMS_SENSITIVE_CREATE, sensitive);
+TPM2B_SIZE_SUBTYPE(TPM2B_SENSITIVE_CREATE, TPMS_SENSITIVE_CREATE, sensitive);
 TPM2B_MARSHAL_SUBTYPE(TPM2B_CREATION_DATA, TPMS_CREATION_DATA, creationData);
 TPM2B_UNMARSHAL_SUBTYPE(TPM2B_CREATION_DATA, TPMS_CREATION_DATA, creationData);
+TPM2B_SIZE_SUBTYPE(TPM2B_CREATION_DATA, TPMS_CREATION_DATA, creationData);
 TPM2B_MARSHAL_SUBTYPE(TPM2B_PUBLIC, TPMT_PUBLIC, publicArea);
 TPM2B_UNMARSHAL_SUBTYPE(TPM2B_PUBLIC, TPMT_PUBLIC, publicArea);
+TPM2B_SIZE_SUBTYPE(TPM2B_PUBLIC, TPMT_PUBLIC, publicArea);
@@ -144,23 +144,45 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
     return TSS2_RC_SUCCESS; \
 }
 
+#define TPMA_SIZE(type) \
+TSS2_RC Tss2_MU_##type##_Size(type src, size_t *size) \
+{ \
+    UNUSED(src); \
+\
+    if (size == NULL) { \
+        LOG_ERROR("size parameter is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+    *size = sizeof(type); \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
 /*
- * These macros expand to (un)marshal functions for each of the TPMA types
- * the specification part 2.
+ * These macros expand to (un)marshal and size functions for each of the TPMA
+ * types the specification part 2.
  */
 TPMA_MARSHAL  (TPMA_ALGORITHM);
 TPMA_UNMARSHAL(TPMA_ALGORITHM);
+TPMA_SIZE     (TPMA_ALGORITHM);
 TPMA_MARSHAL  (TPMA_CC);
 TPMA_UNMARSHAL(TPMA_CC);
+TPMA_SIZE     (TPMA_CC);
 TPMA_MARSHAL  (TPMA_LOCALITY);
 TPMA_UNMARSHAL(TPMA_LOCALITY);
+TPMA_SIZE     (TPMA_LOCALITY);
 TPMA_MARSHAL  (TPMA_NV);
 TPMA_UNMARSHAL(TPMA_NV);
+TPMA_SIZE     (TPMA_NV);
 TPMA_MARSHAL  (TPMA_OBJECT);
 TPMA_UNMARSHAL(TPMA_OBJECT);
+TPMA_SIZE     (TPMA_OBJECT);
 TPMA_MARSHAL  (TPMA_PERMANENT);
 TPMA_UNMARSHAL(TPMA_PERMANENT);
+TPMA_SIZE     (TPMA_PERMANENT);
 TPMA_MARSHAL  (TPMA_SESSION);
 TPMA_UNMARSHAL(TPMA_SESSION);
+TPMA_SIZE     (TPMA_SESSION);
 TPMA_MARSHAL  (TPMA_STARTUP_CLEAR);
 TPMA_UNMARSHAL(TPMA_STARTUP_CLEAR);
+TPMA_SIZE     (TPMA_STARTUP_CLEAR);
@@ -14,6 +14,8 @@
 
 #include "tss2_mu.h"
 
+#include "base-types.h"
+#include "mu-bswap.h"
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
 #include "util/log.h"
@@ -66,7 +68,7 @@ TSS2_RC Tss2_MU_##type##_Marshal(type const *src, uint8_t buffer[], \
          (uintptr_t)buffer, \
          local_offset); \
 \
-    ret = Tss2_MU_UINT32_Marshal(src->count, buffer, buffer_size, &local_offset); \
+    ret = mu_UINT32_Marshal(src->count, buffer, buffer_size, &local_offset); \
     if (ret) \
         return ret; \
 \
@@ -119,7 +121,7 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
          (uintptr_t)dest, \
          local_offset); \
 \
-    ret = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &local_offset, &count); \
+    ret = mu_UINT32_Unmarshal(buffer, buffer_size, &local_offset, &count); \
     if (ret) \
         return ret; \
 \
@@ -150,36 +152,243 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
 }
 
 /*
- * These macros expand to (un)marshal functions for each of the TPML types
- * the specification part 2.
+ * Lists of UINT16 / UINT32 based types are stored contiguously on the wire,
+ * so the whole array is converted with a single bulk byte-swap instead of
+ * one marshal call per element.
  */
-TPML_MARSHAL(TPML_CC, Tss2_MU_TPM2_CC_Marshal, commandCodes, VAL)
-TPML_UNMARSHAL(TPML_CC, Tss2_MU_TPM2_CC_Unmarshal, commandCodes)
-TPML_MARSHAL(TPML_CCA, Tss2_MU_TPMA_CC_Marshal, commandAttributes, VAL)
-TPML_UNMARSHAL(TPML_CCA, Tss2_MU_TPMA_CC_Unmarshal, commandAttributes)
-TPML_MARSHAL(TPML_ALG, Tss2_MU_UINT16_Marshal, algorithms, VAL)
-TPML_UNMARSHAL(TPML_ALG, Tss2_MU_UINT16_Unmarshal, algorithms)
-TPML_MARSHAL(TPML_HANDLE, Tss2_MU_UINT32_Marshal, handle, VAL)
-TPML_UNMARSHAL(TPML_HANDLE, Tss2_MU_UINT32_Unmarshal, handle)
+#define TPML_MARSHAL_BULK(type, buf_name, bits) \
+TSS2_RC Tss2_MU_##type##_Marshal(type const *src, uint8_t buffer[], \
+                                 size_t buffer_size, size_t *offset) \
+{ \
+    size_t  local_offset = 0, list_size; \
+    UINT32 count = 0; \
+    TSS2_RC ret = TSS2_RC_SUCCESS; \
+\
+    if (offset != NULL) { \
+        LOG_TRACE("offset non-NULL, initial value: %zu", *offset); \
+        local_offset = *offset; \
+    } \
+\
+    if (src == NULL) { \
+        LOG_ERROR("src is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (buffer == NULL && offset == NULL) { \
+        LOG_ERROR("buffer and offset parameter are NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } else if (buffer_size < local_offset || \
+               buffer_size - local_offset < sizeof(count)) { \
+        LOG_DEBUG( \
+             "buffer_size: %zu with offset: %zu are insufficient for object " \
+             "of size %zu", \
+             buffer_size, \
+             local_offset, \
+             sizeof(count)); \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+    } \
+\
+    if (src->count > TAB_SIZE(src->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    LOG_DEBUG(\
+         "Marshalling " #type " from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR \
+         " at index 0x%zx", \
+         (uintptr_t)&src, \
+         (uintptr_t)buffer, \
+         local_offset); \
+\
+    ret = mu_UINT32_Marshal(src->count, buffer, buffer_size, &local_offset); \
+    if (ret) \
+        return ret; \
+\
+    list_size = src->count * sizeof(src->buf_name[0]); \
+    if (buffer != NULL) { \
+        if (buffer_size - local_offset < list_size) { \
+            LOG_DEBUG( \
+                 "buffer_size: %zu with offset: %zu are insufficient for " \
+                 "list of size %zu", \
+                 buffer_size, \
+                 local_offset, \
+                 list_size); \
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+        } \
+        mu_bswap##bits(&buffer[local_offset], src->buf_name, src->count); \
+    } \
+    local_offset += list_size; \
+\
+    if (offset != NULL) { \
+        *offset = local_offset; \
+        LOG_DEBUG("offset parameter non-NULL updated to %zu", *offset); \
+    } \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+#define TPML_UNMARSHAL_BULK(type, buf_name, bits) \
+TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
+                                   size_t *offset, type *dest) \
+{ \
+    size_t  local_offset = 0, list_size; \
+    UINT32 count = 0; \
+    TSS2_RC ret = TSS2_RC_SUCCESS; \
+\
+    if (offset != NULL) { \
+        LOG_TRACE("offset non-NULL, initial value: %zu", *offset); \
+        local_offset = *offset; \
+    } \
+\
+    if (buffer == NULL || (dest == NULL && offset == NULL)) { \
+        LOG_ERROR("buffer or dest and offset parameter are NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } else if (buffer_size < local_offset || \
+               sizeof(count) > buffer_size - local_offset) \
+    { \
+        LOG_DEBUG( \
+             "buffer_size: %zu with offset: %zu are insufficient for object " \
+             "of size %zu", \
+             buffer_size, \
+             local_offset, \
+             sizeof(count)); \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+    } \
+\
+    LOG_DEBUG(\
+         "Unmarshaling " #type " from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR \
+         " at index 0x%zx", \
+         (uintptr_t)buffer, \
+         (uintptr_t)dest, \
+         local_offset); \
+\
+    ret = mu_UINT32_Unmarshal(buffer, buffer_size, &local_offset, &count); \
+    if (ret) \
+        return ret; \
+\
+    if (count > TAB_SIZE(dest->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_MALFORMED_RESPONSE; \
+    } \
+\
+    list_size = count * sizeof(dest->buf_name[0]); \
+    if (buffer_size - local_offset < list_size) { \
+        LOG_DEBUG( \
+             "buffer_size: %zu with offset: %zu are insufficient for " \
+             "list of size %zu", \
+             buffer_size, \
+             local_offset, \
+             list_size); \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+    } \
+\
+    if (dest != NULL) { \
+        memset(dest, 0, sizeof(*dest)); \
+        dest->count = count; \
+        mu_bswap##bits(dest->buf_name, &buffer[local_offset], count); \
+    } \
+    local_offset += list_size; \
+\
+    if (offset != NULL) { \
+        *offset = local_offset; \
+        LOG_DEBUG("offset parameter non-NULL, updated to %zu", *offset); \
+    } \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+#define TPML_SIZE(type, size_func, buf_name, op) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    size_t local_size = sizeof(src->count); \
+    UINT32 i; \
+\
+    if (src == NULL || size == NULL) { \
+        LOG_ERROR("src or size is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (src->count > TAB_SIZE(src->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    for (i = 0; i < src->count; i++) \
+        SIZE_MEMBER(buf_name[i], op, size_func) \
+\
+    *size = local_size; \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * Lists of base types and TPMA bit fields have a fixed element size, so their
+ * wire size is computed from the count alone.
+ */
+#define TPML_SIZE_FIXED(type, buf_name) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    if (src == NULL || size == NULL) { \
+        LOG_ERROR("src or size is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (src->count > TAB_SIZE(src->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    *size = sizeof(src->count) + src->count * sizeof(src->buf_name[0]); \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * These macros expand to (un)marshal and size functions for each of the TPML
+ * types the specification part 2.
+ */
+TPML_MARSHAL_BULK(TPML_CC, commandCodes, 32)
+TPML_UNMARSHAL_BULK(TPML_CC, commandCodes, 32)
+TPML_SIZE_FIXED(TPML_CC, commandCodes)
+TPML_MARSHAL_BULK(TPML_CCA, commandAttributes, 32)
+TPML_UNMARSHAL_BULK(TPML_CCA, commandAttributes, 32)
+TPML_SIZE_FIXED(TPML_CCA, commandAttributes)
+TPML_MARSHAL_BULK(TPML_ALG, algorithms, 16)
+TPML_UNMARSHAL_BULK(TPML_ALG, algorithms, 16)
+TPML_SIZE_FIXED(TPML_ALG, algorithms)
+TPML_MARSHAL_BULK(TPML_HANDLE, handle, 32)
+TPML_UNMARSHAL_BULK(TPML_HANDLE, handle, 32)
+TPML_SIZE_FIXED(TPML_HANDLE, handle)
 TPML_MARSHAL(TPML_DIGEST, Tss2_MU_TPM2B_DIGEST_Marshal, digests, ADDR)
 TPML_UNMARSHAL(TPML_DIGEST, Tss2_MU_TPM2B_DIGEST_Unmarshal, digests)
+TPML_SIZE(TPML_DIGEST, Tss2_MU_TPM2B_DIGEST_Size, digests, ADDR)
 TPML_MARSHAL(TPML_ALG_PROPERTY, Tss2_MU_TPMS_ALG_PROPERTY_Marshal, algProperties, ADDR)
 TPML_UNMARSHAL(TPML_ALG_PROPERTY, Tss2_MU_TPMS_ALG_PROPERTY_Unmarshal, algProperties)
-TPML_MARSHAL(TPML_ECC_CURVE, Tss2_MU_UINT16_Marshal, eccCurves, VAL)
-TPML_UNMARSHAL(TPML_ECC_CURVE, Tss2_MU_UINT16_Unmarshal, eccCurves)
+TPML_SIZE(TPML_ALG_PROPERTY, Tss2_MU_TPMS_ALG_PROPERTY_Size, algProperties, ADDR)
+TPML_MARSHAL_BULK(TPML_ECC_CURVE, eccCurves, 16)
+TPML_UNMARSHAL_BULK(TPML_ECC_CURVE, eccCurves, 16)
+TPML_SIZE_FIXED(TPML_ECC_CURVE, eccCurves)
 TPML_MARSHAL(TPML_TAGGED_TPM_PROPERTY, Tss2_MU_TPMS_TAGGED_PROPERTY_Marshal, tpmProperty, ADDR)
 TPML_UNMARSHAL(TPML_TAGGED_TPM_PROPERTY, Tss2_MU_TPMS_TAGGED_PROPERTY_Unmarshal, tpmProperty)
+TPML_SIZE(TPML_TAGGED_TPM_PROPERTY, Tss2_MU_TPMS_TAGGED_PROPERTY_Size, tpmProperty, ADDR)
 TPML_MARSHAL(TPML_TAGGED_PCR_PROPERTY, Tss2_MU_TPMS_TAGGED_PCR_SELECT_Marshal, pcrProperty, ADDR)
 TPML_UNMARSHAL(TPML_TAGGED_PCR_PROPERTY, Tss2_MU_TPMS_TAGGED_PCR_SELECT_Unmarshal, pcrProperty)
+TPML_SIZE(TPML_TAGGED_PCR_PROPERTY, Tss2_MU_TPMS_TAGGED_PCR_SELECT_Size, pcrProperty, ADDR)
 TPML_MARSHAL(TPML_PCR_SELECTION, Tss2_MU_TPMS_PCR_SELECTION_Marshal, pcrSelections, ADDR)
 TPML_UNMARSHAL(TPML_PCR_SELECTION, Tss2_MU_TPMS_PCR_SELECTION_Unmarshal, pcrSelections)
+TPML_SIZE(TPML_PCR_SELECTION, Tss2_MU_TPMS_PCR_SELECTION_Size, pcrSelections, ADDR)
 TPML_MARSHAL(TPML_DIGEST_VALUES, Tss2_MU_TPMT_HA_Marshal, digests, ADDR)
 TPML_UNMARSHAL(TPML_DIGEST_VALUES, Tss2_MU_TPMT_HA_Unmarshal, digests)
-TPML_MARSHAL(TPML_INTEL_PTT_PROPERTY, Tss2_MU_UINT32_Marshal, property, VAL)
-TPML_UNMARSHAL(TPML_INTEL_PTT_PROPERTY, Tss2_MU_UINT32_Unmarshal, property)
+TPML_SIZE(TPML_DIGEST_VALUES, Tss2_MU_TPMT_HA_Size, digests, ADDR)
+TPML_MARSHAL_BULK(TPML_INTEL_PTT_PROPERTY, property, 32)
+TPML_UNMARSHAL_BULK(TPML_INTEL_PTT_PROPERTY, property, 32)
+TPML_SIZE_FIXED(TPML_INTEL_PTT_PROPERTY, property)
 TPML_MARSHAL(TPML_AC_CAPABILITIES, Tss2_MU_TPMS_AC_OUTPUT_Marshal, acCapabilities, ADDR)
 TPML_UNMARSHAL(TPML_AC_CAPABILITIES, Tss2_MU_TPMS_AC_OUTPUT_Unmarshal, acCapabilities)
+TPML_SIZE(TPML_AC_CAPABILITIES, Tss2_MU_TPMS_AC_OUTPUT_Size, acCapabilities, ADDR)
 TPML_MARSHAL(TPML_TAGGED_POLICY, Tss2_MU_TPMS_TAGGED_POLICY_Marshal, policies, ADDR)
 TPML_UNMARSHAL(TPML_TAGGED_POLICY, Tss2_MU_TPMS_TAGGED_POLICY_Unmarshal, policies)
+TPML_SIZE(TPML_TAGGED_POLICY, Tss2_MU_TPMS_TAGGED_POLICY_Size, policies, ADDR)
 TPML_MARSHAL(TPML_ACT_DATA, Tss2_MU_TPMS_ACT_DATA_Marshal, actData, ADDR)
 TPML_UNMARSHAL(TPML_ACT_DATA, Tss2_MU_TPMS_ACT_DATA_Unmarshal, actData)
+TPML_SIZE(TPML_ACT_DATA, Tss2_MU_TPMS_ACT_DATA_Size, actData, ADDR)
@@ -14,6 +14,7 @@
 
 #include "tss2_mu.h"
 
+#include "base-types.h"
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
 #include "util/log.h"
@@ -57,12 +58,12 @@ Tss2_MU_##type##_Marshal(const type *src, uint8_t buffer[], \
     if (ret != TSS2_RC_SUCCESS) \
         return ret; \
 \
-    ret = Tss2_MU_UINT8_Marshal(src->sizeofSelect, buffer, buffer_size, &local_offset); \
+    ret = mu_UINT8_Marshal(src->sizeofSelect, buffer, buffer_size, &local_offset); \
     if (ret != TSS2_RC_SUCCESS) \
         return ret; \
 \
     for (i = 0; i < src->sizeofSelect; i++) { \
-        ret = Tss2_MU_BYTE_Marshal(src->pcrSelect[i], buffer, buffer_size, \
+        ret = mu_BYTE_Marshal(src->pcrSelect[i], buffer, buffer_size, \
                                     &local_offset); \
         if (ret != TSS2_RC_SUCCESS) \
             return ret; \
@@ -78,10 +79,10 @@ Tss2_MU_##type##_Marshal(const type *src, uint8_t buffer[], \
 TPMS_PCR_MARSHAL(TPMS_PCR_SELECT, TSS2_RC_SUCCESS)
 
 TPMS_PCR_MARSHAL(TPMS_PCR_SELECTION, \
-    Tss2_MU_TPMI_ALG_HASH_Marshal(src->hash, buffer, buffer_size, &local_offset))
+    mu_TPMI_ALG_HASH_Marshal(src->hash, buffer, buffer_size, &local_offset))
 
 TPMS_PCR_MARSHAL(TPMS_TAGGED_PCR_SELECT, \
-    Tss2_MU_UINT32_Marshal(src->tag, buffer, buffer_size, &local_offset))
+    mu_UINT32_Marshal(src->tag, buffer, buffer_size, &local_offset))
 
 #define TPMS_PCR_UNMARSHAL(type, firstFieldUnmarshal) \
 TSS2_RC \
@@ -90,7 +91,7 @@ Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
 { \
     TSS2_RC ret = TSS2_RC_SUCCESS; \
     size_t local_offset = 0; \
-    UINT8 i, tmp; \
+    UINT8 i, tmp = 0; \
 \
     LOG_DEBUG( \
          "Unmarshaling " #type " from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR \
@@ -110,8 +111,8 @@ Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
     if (ret != TSS2_RC_SUCCESS) \
         return ret; \
 \
-    ret = Tss2_MU_UINT8_Unmarshal(buffer, buffer_size, &local_offset, \
-                                  dest? &dest->sizeofSelect : &tmp); \
+    ret = mu_UINT8_Unmarshal(buffer, buffer_size, &local_offset, \
+                             dest? &dest->sizeofSelect : &tmp); \
     if (ret) \
         return ret; \
 \
@@ -123,8 +124,8 @@ Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
 \
     for (i = 0; i < (dest? dest->sizeofSelect : tmp); i++) \
     { \
-        ret = Tss2_MU_UINT8_Unmarshal(buffer, buffer_size, &local_offset, \
-                                      dest? &dest->pcrSelect[i] : NULL); \
+        ret = mu_UINT8_Unmarshal(buffer, buffer_size, &local_offset, \
+                                 dest? &dest->pcrSelect[i] : NULL); \
         if (ret != TSS2_RC_SUCCESS) \
             return ret; \
     } \
@@ -139,12 +140,38 @@ Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
 TPMS_PCR_UNMARSHAL(TPMS_PCR_SELECT, TSS2_RC_SUCCESS)
 
 TPMS_PCR_UNMARSHAL(TPMS_PCR_SELECTION, \
-    Tss2_MU_TPMI_ALG_HASH_Unmarshal(buffer, buffer_size, &local_offset, \
-                                    dest? &dest->hash : NULL))
+    mu_TPMI_ALG_HASH_Unmarshal(buffer, buffer_size, &local_offset, \
+                               dest? &dest->hash : NULL))
 
 TPMS_PCR_UNMARSHAL(TPMS_TAGGED_PCR_SELECT, \
-    Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &local_offset, \
-                             dest? &dest->tag : NULL))
+    mu_UINT32_Unmarshal(buffer, buffer_size, &local_offset, \
+                        dest? &dest->tag : NULL))
+
+#define TPMS_PCR_SIZE(type, firstFieldSize) \
+TSS2_RC \
+Tss2_MU_##type##_Size(const type *src, size_t *size) \
+{ \
+    if (!src || !size) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (src->sizeofSelect > TAB_SIZE(src->pcrSelect)) { \
+        LOG_ERROR("sizeofSelect value %"PRIu8"/%zi too big", src->sizeofSelect, \
+                  TAB_SIZE(src->pcrSelect)); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    *size = firstFieldSize + sizeof(src->sizeofSelect) + src->sizeofSelect; \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+TPMS_PCR_SIZE(TPMS_PCR_SELECT, 0)
+
+TPMS_PCR_SIZE(TPMS_PCR_SELECTION, sizeof(src->hash))
+
+TPMS_PCR_SIZE(TPMS_TAGGED_PCR_SELECT, sizeof(src->tag))
 
 #define TPMS_MARSHAL_0(type) \
 TSS2_RC Tss2_MU_##type##_Marshal(type const *src, \
@@ -950,68 +977,119 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
 }
 
 /*
- * These macros expand to (un)marshal functions for each of the TPMS types
- * the specification part 2.
+ * The size function of a TPMS type is the sum of the sizes of its members.
+ * The members are given as a list of SIZE_MEMBER / SIZE_MEMBER_U statements
+ * (see base-types.h) in the order they appear on the wire.
+ */
+#define TPMS_SIZE(type, ...) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    size_t local_size = 0; \
+\
+    if (!src || !size) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    __VA_ARGS__ \
+\
+    *size = local_size; \
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * These macros expand to (un)marshal and size functions for each of the TPMS
+ * types the specification part 2.
  */
 TPMS_MARSHAL_2(TPMS_ALG_PROPERTY,
-               alg, VAL, Tss2_MU_UINT16_Marshal,
+               alg, VAL, mu_UINT16_Marshal,
                algProperties, VAL, Tss2_MU_TPMA_ALGORITHM_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_ALG_PROPERTY,
-                 alg, Tss2_MU_UINT16_Unmarshal,
+                 alg, mu_UINT16_Unmarshal,
                  algProperties, Tss2_MU_TPMA_ALGORITHM_Unmarshal)
 
+TPMS_SIZE(TPMS_ALG_PROPERTY,
+          SIZE_MEMBER(alg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(algProperties, VAL, Tss2_MU_TPMA_ALGORITHM_Size))
+
 TPMS_MARSHAL_2(TPMS_ALGORITHM_DESCRIPTION,
-               alg, VAL, Tss2_MU_UINT16_Marshal,
+               alg, VAL, mu_UINT16_Marshal,
                attributes, VAL, Tss2_MU_TPMA_ALGORITHM_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_ALGORITHM_DESCRIPTION,
-                 alg, Tss2_MU_UINT16_Unmarshal,
+                 alg, mu_UINT16_Unmarshal,
                  attributes, Tss2_MU_TPMA_ALGORITHM_Unmarshal)
 
+TPMS_SIZE(TPMS_ALGORITHM_DESCRIPTION,
+          SIZE_MEMBER(alg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(attributes, VAL, Tss2_MU_TPMA_ALGORITHM_Size))
+
 TPMS_MARSHAL_2(TPMS_TAGGED_PROPERTY,
-               property, VAL, Tss2_MU_UINT32_Marshal,
-               value, VAL, Tss2_MU_UINT32_Marshal)
+               property, VAL, mu_UINT32_Marshal,
+               value, VAL, mu_UINT32_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_TAGGED_PROPERTY,
-                 property, Tss2_MU_UINT32_Unmarshal,
-                 value, Tss2_MU_UINT32_Unmarshal)
+                 property, mu_UINT32_Unmarshal,
+                 value, mu_UINT32_Unmarshal)
+
+TPMS_SIZE(TPMS_TAGGED_PROPERTY,
+          SIZE_MEMBER(property, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(value, VAL, mu_UINT32_Size))
 
 TPMS_MARSHAL_2(TPMS_TAGGED_POLICY,
-               handle, VAL, Tss2_MU_UINT32_Marshal,
+               handle, VAL, mu_UINT32_Marshal,
                policyHash, ADDR, Tss2_MU_TPMT_HA_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_TAGGED_POLICY,
-                 handle, Tss2_MU_UINT32_Unmarshal,
+                 handle, mu_UINT32_Unmarshal,
                  policyHash, Tss2_MU_TPMT_HA_Unmarshal)
 
+TPMS_SIZE(TPMS_TAGGED_POLICY,
+          SIZE_MEMBER(handle, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(policyHash, ADDR, Tss2_MU_TPMT_HA_Size))
+
 TPMS_MARSHAL_4(TPMS_CLOCK_INFO,
-               clock, VAL, Tss2_MU_UINT64_Marshal,
-               resetCount, VAL, Tss2_MU_UINT32_Marshal,
-               restartCount, VAL, Tss2_MU_UINT32_Marshal,
-               safe, VAL, Tss2_MU_UINT8_Marshal)
+               clock, VAL, mu_UINT64_Marshal,
+               resetCount, VAL, mu_UINT32_Marshal,
+               restartCount, VAL, mu_UINT32_Marshal,
+               safe, VAL, mu_UINT8_Marshal)
 
 TPMS_UNMARSHAL_4(TPMS_CLOCK_INFO,
-                 clock, Tss2_MU_UINT64_Unmarshal,
-                 resetCount, Tss2_MU_UINT32_Unmarshal,
-                 restartCount, Tss2_MU_UINT32_Unmarshal,
-                 safe, Tss2_MU_UINT8_Unmarshal)
+                 clock, mu_UINT64_Unmarshal,
+                 resetCount, mu_UINT32_Unmarshal,
+                 restartCount, mu_UINT32_Unmarshal,
+                 safe, mu_UINT8_Unmarshal)
+
+TPMS_SIZE(TPMS_CLOCK_INFO,
+          SIZE_MEMBER(clock, VAL, mu_UINT64_Size)
+          SIZE_MEMBER(resetCount, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(restartCount, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(safe, VAL, mu_UINT8_Size))
 
 TPMS_MARSHAL_2(TPMS_TIME_INFO,
-               time, VAL, Tss2_MU_UINT64_Marshal,
+               time, VAL, mu_UINT64_Marshal,
                clockInfo, ADDR, Tss2_MU_TPMS_CLOCK_INFO_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_TIME_INFO,
-                 time, Tss2_MU_UINT64_Unmarshal,
+                 time, mu_UINT64_Unmarshal,
                  clockInfo, Tss2_MU_TPMS_CLOCK_INFO_Unmarshal)
 
+TPMS_SIZE(TPMS_TIME_INFO,
+          SIZE_MEMBER(time, VAL, mu_UINT64_Size)
+          SIZE_MEMBER(clockInfo, ADDR, Tss2_MU_TPMS_CLOCK_INFO_Size))
+
 TPMS_MARSHAL_2(TPMS_TIME_ATTEST_INFO,
                time, ADDR, Tss2_MU_TPMS_TIME_INFO_Marshal,
-               firmwareVersion, VAL, Tss2_MU_UINT64_Marshal)
+               firmwareVersion, VAL, mu_UINT64_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_TIME_ATTEST_INFO,
                  time, Tss2_MU_TPMS_TIME_INFO_Unmarshal,
-                 firmwareVersion, Tss2_MU_UINT64_Unmarshal)
+                 firmwareVersion, mu_UINT64_Unmarshal)
+
+TPMS_SIZE(TPMS_TIME_ATTEST_INFO,
+          SIZE_MEMBER(time, ADDR, Tss2_MU_TPMS_TIME_INFO_Size)
+          SIZE_MEMBER(firmwareVersion, VAL, mu_UINT64_Size))
 
 TPMS_MARSHAL_2(TPMS_CERTIFY_INFO,
                name, ADDR, Tss2_MU_TPM2B_NAME_Marshal,
@@ -1021,26 +1099,40 @@ TPMS_UNMARSHAL_2(TPMS_CERTIFY_INFO,
                  name, Tss2_MU_TPM2B_NAME_Unmarshal,
                  qualifiedName, Tss2_MU_TPM2B_NAME_Unmarshal)
 
+TPMS_SIZE(TPMS_CERTIFY_INFO,
+          SIZE_MEMBER(name, ADDR, Tss2_MU_TPM2B_NAME_Size)
+          SIZE_MEMBER(qualifiedName, ADDR, Tss2_MU_TPM2B_NAME_Size))
+
 TPMS_MARSHAL_4(TPMS_COMMAND_AUDIT_INFO,
-               auditCounter, VAL, Tss2_MU_UINT64_Marshal,
-               digestAlg, VAL, Tss2_MU_UINT16_Marshal,
+               auditCounter, VAL, mu_UINT64_Marshal,
+               digestAlg, VAL, mu_UINT16_Marshal,
                auditDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                commandDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal)
 
 TPMS_UNMARSHAL_4(TPMS_COMMAND_AUDIT_INFO,
-                 auditCounter, Tss2_MU_UINT64_Unmarshal,
-                 digestAlg, Tss2_MU_UINT16_Unmarshal,
+                 auditCounter, mu_UINT64_Unmarshal,
+                 digestAlg, mu_UINT16_Unmarshal,
                  auditDigest, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  commandDigest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_COMMAND_AUDIT_INFO,
+          SIZE_MEMBER(auditCounter, VAL, mu_UINT64_Size)
+          SIZE_MEMBER(digestAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(auditDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(commandDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_2(TPMS_SESSION_AUDIT_INFO,
-               exclusiveSession, VAL, Tss2_MU_UINT8_Marshal,
+               exclusiveSession, VAL, mu_UINT8_Marshal,
                sessionDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_SESSION_AUDIT_INFO,
-                 exclusiveSession, Tss2_MU_UINT8_Unmarshal,
+                 exclusiveSession, mu_UINT8_Unmarshal,
                  sessionDigest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_SESSION_AUDIT_INFO,
+          SIZE_MEMBER(exclusiveSession, VAL, mu_UINT8_Size)
+          SIZE_MEMBER(sessionDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_2(TPMS_CREATION_INFO,
                objectName, ADDR, Tss2_MU_TPM2B_NAME_Marshal,
                creationHash, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal)
@@ -1049,28 +1141,43 @@ TPMS_UNMARSHAL_2(TPMS_CREATION_INFO,
                  objectName, Tss2_MU_TPM2B_NAME_Unmarshal,
                  creationHash, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_CREATION_INFO,
+          SIZE_MEMBER(objectName, ADDR, Tss2_MU_TPM2B_NAME_Size)
+          SIZE_MEMBER(creationHash, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_3(TPMS_NV_CERTIFY_INFO,
                indexName, ADDR, Tss2_MU_TPM2B_NAME_Marshal,
-               offset, VAL, Tss2_MU_UINT16_Marshal,
+               offset, VAL, mu_UINT16_Marshal,
                nvContents, ADDR, Tss2_MU_TPM2B_MAX_NV_BUFFER_Marshal)
 
 TPMS_UNMARSHAL_3(TPMS_NV_CERTIFY_INFO,
                  indexName, Tss2_MU_TPM2B_NAME_Unmarshal,
-                 offset, Tss2_MU_UINT16_Unmarshal,
+                 offset, mu_UINT16_Unmarshal,
                  nvContents, Tss2_MU_TPM2B_MAX_NV_BUFFER_Unmarshal)
 
+TPMS_SIZE(TPMS_NV_CERTIFY_INFO,
+          SIZE_MEMBER(indexName, ADDR, Tss2_MU_TPM2B_NAME_Size)
+          SIZE_MEMBER(offset, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(nvContents, ADDR, Tss2_MU_TPM2B_MAX_NV_BUFFER_Size))
+
 TPMS_MARSHAL_4(TPMS_AUTH_COMMAND,
-               sessionHandle, VAL, Tss2_MU_UINT32_Marshal,
+               sessionHandle, VAL, mu_UINT32_Marshal,
                nonce, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                sessionAttributes, VAL, Tss2_MU_TPMA_SESSION_Marshal,
                hmac, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal)
 
 TPMS_UNMARSHAL_4(TPMS_AUTH_COMMAND,
-                 sessionHandle, Tss2_MU_UINT32_Unmarshal,
+                 sessionHandle, mu_UINT32_Unmarshal,
                  nonce, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  sessionAttributes, Tss2_MU_TPMA_SESSION_Unmarshal,
                  hmac, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_AUTH_COMMAND,
+          SIZE_MEMBER(sessionHandle, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(nonce, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(sessionAttributes, VAL, Tss2_MU_TPMA_SESSION_Size)
+          SIZE_MEMBER(hmac, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_3(TPMS_AUTH_RESPONSE,
                nonce, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                sessionAttributes, VAL, Tss2_MU_TPMA_SESSION_Marshal,
@@ -1081,6 +1188,11 @@ TPMS_UNMARSHAL_3(TPMS_AUTH_RESPONSE,
                  sessionAttributes, Tss2_MU_TPMA_SESSION_Unmarshal,
                  hmac, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_AUTH_RESPONSE,
+          SIZE_MEMBER(nonce, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(sessionAttributes, VAL, Tss2_MU_TPMA_SESSION_Size)
+          SIZE_MEMBER(hmac, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_2(TPMS_SENSITIVE_CREATE,
                userAuth, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                data, ADDR, Tss2_MU_TPM2B_SENSITIVE_DATA_Marshal)
@@ -1089,27 +1201,42 @@ TPMS_UNMARSHAL_2(TPMS_SENSITIVE_CREATE,
                  userAuth, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  data, Tss2_MU_TPM2B_SENSITIVE_DATA_Unmarshal)
 
+TPMS_SIZE(TPMS_SENSITIVE_CREATE,
+          SIZE_MEMBER(userAuth, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(data, ADDR, Tss2_MU_TPM2B_SENSITIVE_DATA_Size))
+
 TPMS_MARSHAL_1(TPMS_SCHEME_HASH,
-               hashAlg, VAL, Tss2_MU_UINT16_Marshal)
+               hashAlg, VAL, mu_UINT16_Marshal)
 
 TPMS_UNMARSHAL_1(TPMS_SCHEME_HASH,
-                 hashAlg, Tss2_MU_UINT16_Unmarshal)
+                 hashAlg, mu_UINT16_Unmarshal)
+
+TPMS_SIZE(TPMS_SCHEME_HASH,
+          SIZE_MEMBER(hashAlg, VAL, mu_UINT16_Size))
 
 TPMS_MARSHAL_2(TPMS_SCHEME_ECDAA,
-               hashAlg, VAL, Tss2_MU_UINT16_Marshal,
-               count, VAL, Tss2_MU_UINT16_Marshal)
+               hashAlg, VAL, mu_UINT16_Marshal,
+               count, VAL, mu_UINT16_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_SCHEME_ECDAA,
-                 hashAlg, Tss2_MU_UINT16_Unmarshal,
-                 count, Tss2_MU_UINT16_Unmarshal)
+                 hashAlg, mu_UINT16_Unmarshal,
+                 count, mu_UINT16_Unmarshal)
+
+TPMS_SIZE(TPMS_SCHEME_ECDAA,
+          SIZE_MEMBER(hashAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(count, VAL, mu_UINT16_Size))
 
 TPMS_MARSHAL_2(TPMS_SCHEME_XOR,
-               hashAlg, VAL, Tss2_MU_UINT16_Marshal,
-               kdf, VAL, Tss2_MU_UINT16_Marshal)
+               hashAlg, VAL, mu_UINT16_Marshal,
+               kdf, VAL, mu_UINT16_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_SCHEME_XOR,
-                 hashAlg, Tss2_MU_UINT16_Unmarshal,
-                 kdf, Tss2_MU_UINT16_Unmarshal)
+                 hashAlg, mu_UINT16_Unmarshal,
+                 kdf, mu_UINT16_Unmarshal)
+
+TPMS_SIZE(TPMS_SCHEME_XOR,
+          SIZE_MEMBER(hashAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(kdf, VAL, mu_UINT16_Size))
 
 TPMS_MARSHAL_2(TPMS_ECC_POINT,
                x, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Marshal,
@@ -1119,45 +1246,69 @@ TPMS_UNMARSHAL_2(TPMS_ECC_POINT,
                  x, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal,
                  y, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal)
 
+TPMS_SIZE(TPMS_ECC_POINT,
+          SIZE_MEMBER(x, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(y, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size))
+
 TPMS_MARSHAL_2(TPMS_SIGNATURE_RSA,
-               hash, VAL, Tss2_MU_UINT16_Marshal,
+               hash, VAL, mu_UINT16_Marshal,
                sig, ADDR, Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_SIGNATURE_RSA,
-                 hash, Tss2_MU_UINT16_Unmarshal,
+                 hash, mu_UINT16_Unmarshal,
                  sig, Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Unmarshal)
 
+TPMS_SIZE(TPMS_SIGNATURE_RSA,
+          SIZE_MEMBER(hash, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(sig, ADDR, Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Size))
+
 TPMS_MARSHAL_3(TPMS_SIGNATURE_ECC,
-               hash, VAL, Tss2_MU_UINT16_Marshal,
+               hash, VAL, mu_UINT16_Marshal,
                signatureR, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Marshal,
                signatureS, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Marshal)
 
 TPMS_UNMARSHAL_3(TPMS_SIGNATURE_ECC,
-                 hash, Tss2_MU_UINT16_Unmarshal,
+                 hash, mu_UINT16_Unmarshal,
                  signatureR, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal,
                  signatureS, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal)
 
+TPMS_SIZE(TPMS_SIGNATURE_ECC,
+          SIZE_MEMBER(hash, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(signatureR, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(signatureS, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size))
+
 TPMS_MARSHAL_2(TPMS_NV_PIN_COUNTER_PARAMETERS,
-               pinCount, VAL, Tss2_MU_UINT32_Marshal,
-               pinLimit, VAL, Tss2_MU_UINT32_Marshal)
+               pinCount, VAL, mu_UINT32_Marshal,
+               pinLimit, VAL, mu_UINT32_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_NV_PIN_COUNTER_PARAMETERS,
-                 pinCount, Tss2_MU_UINT32_Unmarshal,
-                 pinLimit, Tss2_MU_UINT32_Unmarshal)
+                 pinCount, mu_UINT32_Unmarshal,
+                 pinLimit, mu_UINT32_Unmarshal)
+
+TPMS_SIZE(TPMS_NV_PIN_COUNTER_PARAMETERS,
+          SIZE_MEMBER(pinCount, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(pinLimit, VAL, mu_UINT32_Size))
 
 TPMS_MARSHAL_5(TPMS_NV_PUBLIC,
-               nvIndex, VAL, Tss2_MU_UINT32_Marshal,
-               nameAlg, VAL, Tss2_MU_UINT16_Marshal,
+               nvIndex, VAL, mu_UINT32_Marshal,
+               nameAlg, VAL, mu_UINT16_Marshal,
                attributes, VAL, Tss2_MU_TPMA_NV_Marshal,
                authPolicy, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
-               dataSize, VAL, Tss2_MU_UINT16_Marshal)
+               dataSize, VAL, mu_UINT16_Marshal)
 
 TPMS_UNMARSHAL_5(TPMS_NV_PUBLIC,
-                 nvIndex, Tss2_MU_UINT32_Unmarshal,
-                 nameAlg, Tss2_MU_UINT16_Unmarshal,
+                 nvIndex, mu_UINT32_Unmarshal,
+                 nameAlg, mu_UINT16_Unmarshal,
                  attributes, Tss2_MU_TPMA_NV_Unmarshal,
                  authPolicy, Tss2_MU_TPM2B_DIGEST_Unmarshal,
-                 dataSize, Tss2_MU_UINT16_Unmarshal)
+                 dataSize, mu_UINT16_Unmarshal)
+
+TPMS_SIZE(TPMS_NV_PUBLIC,
+          SIZE_MEMBER(nvIndex, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(nameAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(attributes, VAL, Tss2_MU_TPMA_NV_Size)
+          SIZE_MEMBER(authPolicy, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(dataSize, VAL, mu_UINT16_Size))
 
 TPMS_MARSHAL_2(TPMS_CONTEXT_DATA,
                integrity, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
@@ -1167,18 +1318,28 @@ TPMS_UNMARSHAL_2(TPMS_CONTEXT_DATA,
                  integrity, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  encrypted, Tss2_MU_TPM2B_CONTEXT_SENSITIVE_Unmarshal)
 
+TPMS_SIZE(TPMS_CONTEXT_DATA,
+          SIZE_MEMBER(integrity, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(encrypted, ADDR, Tss2_MU_TPM2B_CONTEXT_SENSITIVE_Size))
+
 TPMS_MARSHAL_4(TPMS_CONTEXT,
-               sequence, VAL, Tss2_MU_UINT64_Marshal,
-               savedHandle, VAL, Tss2_MU_UINT32_Marshal,
-               hierarchy, VAL, Tss2_MU_UINT32_Marshal,
+               sequence, VAL, mu_UINT64_Marshal,
+               savedHandle, VAL, mu_UINT32_Marshal,
+               hierarchy, VAL, mu_UINT32_Marshal,
                contextBlob, ADDR, Tss2_MU_TPM2B_CONTEXT_DATA_Marshal)
 
 TPMS_UNMARSHAL_4(TPMS_CONTEXT,
-                 sequence, Tss2_MU_UINT64_Unmarshal,
-                 savedHandle, Tss2_MU_UINT32_Unmarshal,
-                 hierarchy, Tss2_MU_UINT32_Unmarshal,
+                 sequence, mu_UINT64_Unmarshal,
+                 savedHandle, mu_UINT32_Unmarshal,
+                 hierarchy, mu_UINT32_Unmarshal,
                  contextBlob, Tss2_MU_TPM2B_CONTEXT_DATA_Unmarshal)
 
+TPMS_SIZE(TPMS_CONTEXT,
+          SIZE_MEMBER(sequence, VAL, mu_UINT64_Size)
+          SIZE_MEMBER(savedHandle, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(hierarchy, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(contextBlob, ADDR, Tss2_MU_TPM2B_CONTEXT_DATA_Size))
+
 TPMS_MARSHAL_2(TPMS_QUOTE_INFO,
                pcrSelect, ADDR, Tss2_MU_TPML_PCR_SELECTION_Marshal,
                pcrDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal)
@@ -1187,11 +1348,15 @@ TPMS_UNMARSHAL_2(TPMS_QUOTE_INFO,
                  pcrSelect, Tss2_MU_TPML_PCR_SELECTION_Unmarshal,
                  pcrDigest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_QUOTE_INFO,
+          SIZE_MEMBER(pcrSelect, ADDR, Tss2_MU_TPML_PCR_SELECTION_Size)
+          SIZE_MEMBER(pcrDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_7(TPMS_CREATION_DATA,
                pcrSelect, ADDR, Tss2_MU_TPML_PCR_SELECTION_Marshal,
                pcrDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                locality, VAL, Tss2_MU_TPMA_LOCALITY_Marshal,
-               parentNameAlg, VAL, Tss2_MU_UINT16_Marshal,
+               parentNameAlg, VAL, mu_UINT16_Marshal,
                parentName, ADDR, Tss2_MU_TPM2B_NAME_Marshal,
                parentQualifiedName, ADDR, Tss2_MU_TPM2B_NAME_Marshal,
                outsideInfo, ADDR, Tss2_MU_TPM2B_DATA_Marshal)
@@ -1200,44 +1365,68 @@ TPMS_UNMARSHAL_7(TPMS_CREATION_DATA,
                  pcrSelect, Tss2_MU_TPML_PCR_SELECTION_Unmarshal,
                  pcrDigest, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  locality, Tss2_MU_TPMA_LOCALITY_Unmarshal,
-                 parentNameAlg, Tss2_MU_UINT16_Unmarshal,
+                 parentNameAlg, mu_UINT16_Unmarshal,
                  parentName, Tss2_MU_TPM2B_NAME_Unmarshal,
                  parentQualifiedName, Tss2_MU_TPM2B_NAME_Unmarshal,
                  outsideInfo, Tss2_MU_TPM2B_DATA_Unmarshal)
 
+TPMS_SIZE(TPMS_CREATION_DATA,
+          SIZE_MEMBER(pcrSelect, ADDR, Tss2_MU_TPML_PCR_SELECTION_Size)
+          SIZE_MEMBER(pcrDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(locality, VAL, Tss2_MU_TPMA_LOCALITY_Size)
+          SIZE_MEMBER(parentNameAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(parentName, ADDR, Tss2_MU_TPM2B_NAME_Size)
+          SIZE_MEMBER(parentQualifiedName, ADDR, Tss2_MU_TPM2B_NAME_Size)
+          SIZE_MEMBER(outsideInfo, ADDR, Tss2_MU_TPM2B_DATA_Size))
+
 TPMS_MARSHAL_4(TPMS_ECC_PARMS,
                symmetric, ADDR, Tss2_MU_TPMT_SYM_DEF_OBJECT_Marshal,
                scheme, ADDR, Tss2_MU_TPMT_ECC_SCHEME_Marshal,
-               curveID, VAL, Tss2_MU_UINT16_Marshal,
+               curveID, VAL, mu_UINT16_Marshal,
                kdf, ADDR, Tss2_MU_TPMT_KDF_SCHEME_Marshal)
 
 TPMS_UNMARSHAL_4(TPMS_ECC_PARMS,
                  symmetric, Tss2_MU_TPMT_SYM_DEF_OBJECT_Unmarshal,
                  scheme, Tss2_MU_TPMT_ECC_SCHEME_Unmarshal,
-                 curveID, Tss2_MU_UINT16_Unmarshal,
+                 curveID, mu_UINT16_Unmarshal,
                  kdf, Tss2_MU_TPMT_KDF_SCHEME_Unmarshal)
 
+TPMS_SIZE(TPMS_ECC_PARMS,
+          SIZE_MEMBER(symmetric, ADDR, Tss2_MU_TPMT_SYM_DEF_OBJECT_Size)
+          SIZE_MEMBER(scheme, ADDR, Tss2_MU_TPMT_ECC_SCHEME_Size)
+          SIZE_MEMBER(curveID, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(kdf, ADDR, Tss2_MU_TPMT_KDF_SCHEME_Size))
+
 TPMS_MARSHAL_7_U(TPMS_ATTEST,
-                 magic, VAL, Tss2_MU_UINT32_Marshal,
-                 type, VAL, Tss2_MU_TPM2_ST_Marshal,
+                 magic, VAL, mu_UINT32_Marshal,
+                 type, VAL, mu_TPM2_ST_Marshal,
                  qualifiedSigner, ADDR, Tss2_MU_TPM2B_NAME_Marshal,
                  extraData, ADDR, Tss2_MU_TPM2B_DATA_Marshal,
                  clockInfo, ADDR, Tss2_MU_TPMS_CLOCK_INFO_Marshal,
-                 firmwareVersion, VAL, Tss2_MU_UINT64_Marshal,
+                 firmwareVersion, VAL, mu_UINT64_Marshal,
                  attested, ADDR, Tss2_MU_TPMU_ATTEST_Marshal)
 
 TPMS_UNMARSHAL_7_U(TPMS_ATTEST,
-                   magic, Tss2_MU_UINT32_Unmarshal,
-                   type, Tss2_MU_TPM2_ST_Unmarshal,
+                   magic, mu_UINT32_Unmarshal,
+                   type, mu_TPM2_ST_Unmarshal,
                    qualifiedSigner, Tss2_MU_TPM2B_NAME_Unmarshal,
                    extraData, Tss2_MU_TPM2B_DATA_Unmarshal,
                    clockInfo, Tss2_MU_TPMS_CLOCK_INFO_Unmarshal,
-                   firmwareVersion, Tss2_MU_UINT64_Unmarshal,
+                   firmwareVersion, mu_UINT64_Unmarshal,
                    attested, Tss2_MU_TPMU_ATTEST_Unmarshal)
 
+TPMS_SIZE(TPMS_ATTEST,
+          SIZE_MEMBER(magic, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(type, VAL, mu_TPM2_ST_Size)
+          SIZE_MEMBER(qualifiedSigner, ADDR, Tss2_MU_TPM2B_NAME_Size)
+          SIZE_MEMBER(extraData, ADDR, Tss2_MU_TPM2B_DATA_Size)
+          SIZE_MEMBER(clockInfo, ADDR, Tss2_MU_TPMS_CLOCK_INFO_Size)
+          SIZE_MEMBER(firmwareVersion, VAL, mu_UINT64_Size)
+          SIZE_MEMBER_U(attested, ADDR, type, Tss2_MU_TPMU_ATTEST_Size))
+
 TPMS_MARSHAL_11(TPMS_ALGORITHM_DETAIL_ECC,
-                curveID, VAL, Tss2_MU_UINT16_Marshal,
-                keySize, VAL, Tss2_MU_UINT16_Marshal,
+                curveID, VAL, mu_UINT16_Marshal,
+                keySize, VAL, mu_UINT16_Marshal,
                 kdf, ADDR, Tss2_MU_TPMT_KDF_SCHEME_Marshal,
                 sign, ADDR, Tss2_MU_TPMT_ECC_SCHEME_Marshal,
                 p, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Marshal,
@@ -1249,8 +1438,8 @@ TPMS_MARSHAL_11(TPMS_ALGORITHM_DETAIL_ECC,
                 h, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Marshal)
 
 TPMS_UNMARSHAL_11(TPMS_ALGORITHM_DETAIL_ECC,
-                  curveID, Tss2_MU_UINT16_Unmarshal,
-                  keySize, Tss2_MU_UINT16_Unmarshal,
+                  curveID, mu_UINT16_Unmarshal,
+                  keySize, mu_UINT16_Unmarshal,
                   kdf, Tss2_MU_TPMT_KDF_SCHEME_Unmarshal,
                   sign, Tss2_MU_TPMT_ECC_SCHEME_Unmarshal,
                   p, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal,
@@ -1261,31 +1450,57 @@ TPMS_UNMARSHAL_11(TPMS_ALGORITHM_DETAIL_ECC,
                   n, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal,
                   h, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal)
 
+TPMS_SIZE(TPMS_ALGORITHM_DETAIL_ECC,
+          SIZE_MEMBER(curveID, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(keySize, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(kdf, ADDR, Tss2_MU_TPMT_KDF_SCHEME_Size)
+          SIZE_MEMBER(sign, ADDR, Tss2_MU_TPMT_ECC_SCHEME_Size)
+          SIZE_MEMBER(p, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(a, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(b, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(gX, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(gY, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(n, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+          SIZE_MEMBER(h, ADDR, Tss2_MU_TPM2B_ECC_PARAMETER_Size))
+
 TPMS_MARSHAL_2_U(TPMS_CAPABILITY_DATA,
-                 capability, VAL, Tss2_MU_UINT32_Marshal,
+                 capability, VAL, mu_UINT32_Marshal,
                  data, ADDR, Tss2_MU_TPMU_CAPABILITIES_Marshal)
 
 TPMS_UNMARSHAL_2_U(TPMS_CAPABILITY_DATA,
-                   capability, Tss2_MU_UINT32_Unmarshal,
+                   capability, mu_UINT32_Unmarshal,
                    data, Tss2_MU_TPMU_CAPABILITIES_Unmarshal)
 
+TPMS_SIZE(TPMS_CAPABILITY_DATA,
+          SIZE_MEMBER(capability, VAL, mu_UINT32_Size)
+          SIZE_MEMBER_U(data, ADDR, capability, Tss2_MU_TPMU_CAPABILITIES_Size))
+
 TPMS_MARSHAL_1(TPMS_KEYEDHASH_PARMS,
                scheme, ADDR, Tss2_MU_TPMT_KEYEDHASH_SCHEME_Marshal)
 
 TPMS_UNMARSHAL_1(TPMS_KEYEDHASH_PARMS,
                  scheme, Tss2_MU_TPMT_KEYEDHASH_SCHEME_Unmarshal)
 
+TPMS_SIZE(TPMS_KEYEDHASH_PARMS,
+          SIZE_MEMBER(scheme, ADDR, Tss2_MU_TPMT_KEYEDHASH_SCHEME_Size))
+
 TPMS_MARSHAL_4(TPMS_RSA_PARMS,
                symmetric, ADDR, Tss2_MU_TPMT_SYM_DEF_OBJECT_Marshal,
                scheme, ADDR, Tss2_MU_TPMT_RSA_SCHEME_Marshal,
-               keyBits, VAL, Tss2_MU_UINT16_Marshal,
-               exponent, VAL, Tss2_MU_UINT32_Marshal)
+               keyBits, VAL, mu_UINT16_Marshal,
+               exponent, VAL, mu_UINT32_Marshal)
 
 TPMS_UNMARSHAL_4(TPMS_RSA_PARMS,
                  symmetric, Tss2_MU_TPMT_SYM_DEF_OBJECT_Unmarshal,
                  scheme, Tss2_MU_TPMT_RSA_SCHEME_Unmarshal,
-                 keyBits, Tss2_MU_UINT16_Unmarshal,
-                 exponent, Tss2_MU_UINT32_Unmarshal)
+                 keyBits, mu_UINT16_Unmarshal,
+                 exponent, mu_UINT32_Unmarshal)
+
+TPMS_SIZE(TPMS_RSA_PARMS,
+          SIZE_MEMBER(symmetric, ADDR, Tss2_MU_TPMT_SYM_DEF_OBJECT_Size)
+          SIZE_MEMBER(scheme, ADDR, Tss2_MU_TPMT_RSA_SCHEME_Size)
+          SIZE_MEMBER(keyBits, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(exponent, VAL, mu_UINT32_Size))
 
 TPMS_MARSHAL_1(TPMS_SYMCIPHER_PARMS,
                sym, ADDR, Tss2_MU_TPMT_SYM_DEF_OBJECT_Marshal)
@@ -1293,17 +1508,26 @@ TPMS_MARSHAL_1(TPMS_SYMCIPHER_PARMS,
 TPMS_UNMARSHAL_1(TPMS_SYMCIPHER_PARMS,
                  sym, Tss2_MU_TPMT_SYM_DEF_OBJECT_Unmarshal)
 
+TPMS_SIZE(TPMS_SYMCIPHER_PARMS,
+          SIZE_MEMBER(sym, ADDR, Tss2_MU_TPMT_SYM_DEF_OBJECT_Size))
+
 TPMS_MARSHAL_0(TPMS_EMPTY);
 
 TPMS_UNMARSHAL_0(TPMS_EMPTY);
 
+TPMS_SIZE(TPMS_EMPTY, )
+
 TPMS_MARSHAL_2(TPMS_AC_OUTPUT,
-               tag, VAL, Tss2_MU_UINT32_Marshal,
-               data, VAL, Tss2_MU_UINT32_Marshal)
+               tag, VAL, mu_UINT32_Marshal,
+               data, VAL, mu_UINT32_Marshal)
 
 TPMS_UNMARSHAL_2(TPMS_AC_OUTPUT,
-                 tag, Tss2_MU_UINT32_Unmarshal,
-                 data, Tss2_MU_UINT32_Unmarshal)
+                 tag, mu_UINT32_Unmarshal,
+                 data, mu_UINT32_Unmarshal)
+
+TPMS_SIZE(TPMS_AC_OUTPUT,
+          SIZE_MEMBER(tag, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(data, VAL, mu_UINT32_Size))
 
 TPMS_MARSHAL_2(TPMS_ID_OBJECT,
                integrityHMAC, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
@@ -1313,6 +1537,10 @@ TPMS_UNMARSHAL_2(TPMS_ID_OBJECT,
                  integrityHMAC, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  encIdentity, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_ID_OBJECT,
+          SIZE_MEMBER(integrityHMAC, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(encIdentity, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_2(TPMS_NV_DIGEST_CERTIFY_INFO,
                indexName, ADDR, Tss2_MU_TPM2B_NAME_Marshal,
                nvDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal)
@@ -1321,12 +1549,21 @@ TPMS_UNMARSHAL_2(TPMS_NV_DIGEST_CERTIFY_INFO,
                  indexName, Tss2_MU_TPM2B_NAME_Unmarshal,
                  nvDigest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
+TPMS_SIZE(TPMS_NV_DIGEST_CERTIFY_INFO,
+          SIZE_MEMBER(indexName, ADDR, Tss2_MU_TPM2B_NAME_Size)
+          SIZE_MEMBER(nvDigest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
 TPMS_MARSHAL_3(TPMS_ACT_DATA,
-               handle, VAL, Tss2_MU_TPM2_HANDLE_Marshal,
-               timeout, VAL, Tss2_MU_UINT32_Marshal,
-               attributes, VAL, Tss2_MU_UINT32_Marshal)
+               handle, VAL, mu_TPM2_HANDLE_Marshal,
+               timeout, VAL, mu_UINT32_Marshal,
+               attributes, VAL, mu_UINT32_Marshal)
 
 TPMS_UNMARSHAL_3(TPMS_ACT_DATA,
-                 handle, Tss2_MU_TPM2_HANDLE_Unmarshal,
-                 timeout, Tss2_MU_UINT32_Unmarshal,
-                 attributes, Tss2_MU_UINT32_Unmarshal)
+                 handle, mu_TPM2_HANDLE_Unmarshal,
+                 timeout, mu_UINT32_Unmarshal,
+                 attributes, mu_UINT32_Unmarshal)
+
+TPMS_SIZE(TPMS_ACT_DATA,
+          SIZE_MEMBER(handle, VAL, mu_TPM2_HANDLE_Size)
+          SIZE_MEMBER(timeout, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(attributes, VAL, mu_UINT32_Size))
@@ -14,6 +14,7 @@
 
 #include "tss2_mu.h"
 
+#include "base-types.h"
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
 #include "util/log.h"
@@ -491,129 +492,231 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
 }
 
 /*
- * These macros expand to (un)marshal functions for each of the TPMT types
- * the specification part 2.
+ * The size function of a TPMT type is the sum of the sizes of its members,
+ * given as SIZE_MEMBER / SIZE_MEMBER_U statements (see base-types.h).
  */
-TPMT_MARSHAL_2(TPMT_HA, hashAlg, VAL, Tss2_MU_UINT16_Marshal,
+#define TPMT_SIZE(type, ...) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    size_t local_size = 0; \
+\
+    if (!src || !size) \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+\
+    __VA_ARGS__ \
+\
+    *size = local_size; \
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * These macros expand to (un)marshal and size functions for each of the TPMT
+ * types the specification part 2.
+ */
+TPMT_MARSHAL_2(TPMT_HA, hashAlg, VAL, mu_UINT16_Marshal,
                digest, ADDR, hashAlg, Tss2_MU_TPMU_HA_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_HA, hashAlg, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_HA, hashAlg, mu_UINT16_Unmarshal,
                  digest, hashAlg, Tss2_MU_TPMU_HA_Unmarshal)
 
-TPMT_MARSHAL_3(TPMT_SYM_DEF, algorithm, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_HA,
+          SIZE_MEMBER(hashAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(digest, ADDR, hashAlg, Tss2_MU_TPMU_HA_Size))
+
+TPMT_MARSHAL_3(TPMT_SYM_DEF, algorithm, VAL, mu_UINT16_Marshal,
                keyBits, ADDR, algorithm, Tss2_MU_TPMU_SYM_KEY_BITS_Marshal,
                mode, ADDR, algorithm, Tss2_MU_TPMU_SYM_MODE_Marshal)
 
-TPMT_UNMARSHAL_3(TPMT_SYM_DEF, algorithm, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_3(TPMT_SYM_DEF, algorithm, mu_UINT16_Unmarshal,
                  keyBits, algorithm, Tss2_MU_TPMU_SYM_KEY_BITS_Unmarshal,
                  mode, algorithm, Tss2_MU_TPMU_SYM_MODE_Unmarshal)
 
-TPMT_MARSHAL_3(TPMT_SYM_DEF_OBJECT, algorithm, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_SYM_DEF,
+          SIZE_MEMBER(algorithm, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(keyBits, ADDR, algorithm, Tss2_MU_TPMU_SYM_KEY_BITS_Size)
+          SIZE_MEMBER_U(mode, ADDR, algorithm, Tss2_MU_TPMU_SYM_MODE_Size))
+
+TPMT_MARSHAL_3(TPMT_SYM_DEF_OBJECT, algorithm, VAL, mu_UINT16_Marshal,
                keyBits, ADDR, algorithm, Tss2_MU_TPMU_SYM_KEY_BITS_Marshal,
                mode, ADDR, algorithm, Tss2_MU_TPMU_SYM_MODE_Marshal)
 
-TPMT_UNMARSHAL_3(TPMT_SYM_DEF_OBJECT, algorithm, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_3(TPMT_SYM_DEF_OBJECT, algorithm, mu_UINT16_Unmarshal,
                  keyBits, algorithm, Tss2_MU_TPMU_SYM_KEY_BITS_Unmarshal,
                  mode, algorithm, Tss2_MU_TPMU_SYM_MODE_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_KEYEDHASH_SCHEME, scheme, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_SYM_DEF_OBJECT,
+          SIZE_MEMBER(algorithm, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(keyBits, ADDR, algorithm, Tss2_MU_TPMU_SYM_KEY_BITS_Size)
+          SIZE_MEMBER_U(mode, ADDR, algorithm, Tss2_MU_TPMU_SYM_MODE_Size))
+
+TPMT_MARSHAL_2(TPMT_KEYEDHASH_SCHEME, scheme, VAL, mu_UINT16_Marshal,
                details, ADDR, scheme, Tss2_MU_TPMU_SCHEME_KEYEDHASH_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_KEYEDHASH_SCHEME, scheme, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_KEYEDHASH_SCHEME, scheme, mu_UINT16_Unmarshal,
                  details, scheme, Tss2_MU_TPMU_SCHEME_KEYEDHASH_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_SIG_SCHEME, scheme, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_KEYEDHASH_SCHEME,
+          SIZE_MEMBER(scheme, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(details, ADDR, scheme, Tss2_MU_TPMU_SCHEME_KEYEDHASH_Size))
+
+TPMT_MARSHAL_2(TPMT_SIG_SCHEME, scheme, VAL, mu_UINT16_Marshal,
                details, ADDR, scheme, Tss2_MU_TPMU_SIG_SCHEME_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_SIG_SCHEME, scheme, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_SIG_SCHEME, scheme, mu_UINT16_Unmarshal,
                  details, scheme, Tss2_MU_TPMU_SIG_SCHEME_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_KDF_SCHEME, scheme, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_SIG_SCHEME,
+          SIZE_MEMBER(scheme, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(details, ADDR, scheme, Tss2_MU_TPMU_SIG_SCHEME_Size))
+
+TPMT_MARSHAL_2(TPMT_KDF_SCHEME, scheme, VAL, mu_UINT16_Marshal,
                details, ADDR, scheme, Tss2_MU_TPMU_KDF_SCHEME_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_KDF_SCHEME, scheme, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_KDF_SCHEME, scheme, mu_UINT16_Unmarshal,
                  details, scheme, Tss2_MU_TPMU_KDF_SCHEME_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_ASYM_SCHEME, scheme, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_KDF_SCHEME,
+          SIZE_MEMBER(scheme, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(details, ADDR, scheme, Tss2_MU_TPMU_KDF_SCHEME_Size))
+
+TPMT_MARSHAL_2(TPMT_ASYM_SCHEME, scheme, VAL, mu_UINT16_Marshal,
                details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_ASYM_SCHEME, scheme, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_ASYM_SCHEME, scheme, mu_UINT16_Unmarshal,
                  details, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_RSA_SCHEME, scheme, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_ASYM_SCHEME,
+          SIZE_MEMBER(scheme, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Size))
+
+TPMT_MARSHAL_2(TPMT_RSA_SCHEME, scheme, VAL, mu_UINT16_Marshal,
                details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_RSA_SCHEME, scheme, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_RSA_SCHEME, scheme, mu_UINT16_Unmarshal,
                  details, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_RSA_DECRYPT, scheme, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_RSA_SCHEME,
+          SIZE_MEMBER(scheme, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Size))
+
+TPMT_MARSHAL_2(TPMT_RSA_DECRYPT, scheme, VAL, mu_UINT16_Marshal,
                details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_RSA_DECRYPT, scheme, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_RSA_DECRYPT, scheme, mu_UINT16_Unmarshal,
                  details, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_ECC_SCHEME, scheme, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_RSA_DECRYPT,
+          SIZE_MEMBER(scheme, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Size))
+
+TPMT_MARSHAL_2(TPMT_ECC_SCHEME, scheme, VAL, mu_UINT16_Marshal,
                details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_ECC_SCHEME, scheme, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_ECC_SCHEME, scheme, mu_UINT16_Unmarshal,
                  details, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_SIGNATURE, sigAlg, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_ECC_SCHEME,
+          SIZE_MEMBER(scheme, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(details, ADDR, scheme, Tss2_MU_TPMU_ASYM_SCHEME_Size))
+
+TPMT_MARSHAL_2(TPMT_SIGNATURE, sigAlg, VAL, mu_UINT16_Marshal,
                signature, ADDR, sigAlg, Tss2_MU_TPMU_SIGNATURE_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_SIGNATURE, sigAlg, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_SIGNATURE, sigAlg, mu_UINT16_Unmarshal,
                  signature, sigAlg, Tss2_MU_TPMU_SIGNATURE_Unmarshal)
 
-TPMT_MARSHAL_4(TPMT_SENSITIVE, sensitiveType, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_SIGNATURE,
+          SIZE_MEMBER(sigAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(signature, ADDR, sigAlg, Tss2_MU_TPMU_SIGNATURE_Size))
+
+TPMT_MARSHAL_4(TPMT_SENSITIVE, sensitiveType, VAL, mu_UINT16_Marshal,
                authValue, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                seedValue, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                sensitive, sensitiveType, ADDR, Tss2_MU_TPMU_SENSITIVE_COMPOSITE_Marshal)
 
-TPMT_UNMARSHAL_4(TPMT_SENSITIVE, sensitiveType, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_4(TPMT_SENSITIVE, sensitiveType, mu_UINT16_Unmarshal,
                  authValue, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  seedValue, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  sensitive, sensitiveType, Tss2_MU_TPMU_SENSITIVE_COMPOSITE_Unmarshal)
 
-TPMT_MARSHAL_6(TPMT_PUBLIC, type, VAL, Tss2_MU_UINT16_Marshal,
-               nameAlg, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_SENSITIVE,
+          SIZE_MEMBER(sensitiveType, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(authValue, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER(seedValue, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER_U(sensitive, ADDR, sensitiveType, Tss2_MU_TPMU_SENSITIVE_COMPOSITE_Size))
+
+TPMT_MARSHAL_6(TPMT_PUBLIC, type, VAL, mu_UINT16_Marshal,
+               nameAlg, VAL, mu_UINT16_Marshal,
                objectAttributes, VAL, Tss2_MU_TPMA_OBJECT_Marshal,
                authPolicy, ADDR, Tss2_MU_TPM2B_DIGEST_Marshal,
                parameters, ADDR, type, Tss2_MU_TPMU_PUBLIC_PARMS_Marshal,
                unique, ADDR, type, Tss2_MU_TPMU_PUBLIC_ID_Marshal)
 
-TPMT_UNMARSHAL_6(TPMT_PUBLIC, type, Tss2_MU_UINT16_Unmarshal,
-                 nameAlg, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_6(TPMT_PUBLIC, type, mu_UINT16_Unmarshal,
+                 nameAlg, mu_UINT16_Unmarshal,
                  objectAttributes, Tss2_MU_TPMA_OBJECT_Unmarshal,
                  authPolicy, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  parameters, type, Tss2_MU_TPMU_PUBLIC_PARMS_Unmarshal,
                  unique, type, Tss2_MU_TPMU_PUBLIC_ID_Unmarshal)
 
-TPMT_MARSHAL_2(TPMT_PUBLIC_PARMS, type, VAL, Tss2_MU_UINT16_Marshal,
+TPMT_SIZE(TPMT_PUBLIC,
+          SIZE_MEMBER(type, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(nameAlg, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(objectAttributes, VAL, Tss2_MU_TPMA_OBJECT_Size)
+          SIZE_MEMBER(authPolicy, ADDR, Tss2_MU_TPM2B_DIGEST_Size)
+          SIZE_MEMBER_U(parameters, ADDR, type, Tss2_MU_TPMU_PUBLIC_PARMS_Size)
+          SIZE_MEMBER_U(unique, ADDR, type, Tss2_MU_TPMU_PUBLIC_ID_Size))
+
+TPMT_MARSHAL_2(TPMT_PUBLIC_PARMS, type, VAL, mu_UINT16_Marshal,
                parameters, ADDR, type, Tss2_MU_TPMU_PUBLIC_PARMS_Marshal)
 
-TPMT_UNMARSHAL_2(TPMT_PUBLIC_PARMS, type, Tss2_MU_UINT16_Unmarshal,
+TPMT_UNMARSHAL_2(TPMT_PUBLIC_PARMS, type, mu_UINT16_Unmarshal,
                  parameters, type, Tss2_MU_TPMU_PUBLIC_PARMS_Unmarshal)
 
-TPMT_MARSHAL_TK(TPMT_TK_CREATION, tag, Tss2_MU_UINT16_Marshal,
-                hierarchy, Tss2_MU_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
+TPMT_SIZE(TPMT_PUBLIC_PARMS,
+          SIZE_MEMBER(type, VAL, mu_UINT16_Size)
+          SIZE_MEMBER_U(parameters, ADDR, type, Tss2_MU_TPMU_PUBLIC_PARMS_Size))
+
+TPMT_MARSHAL_TK(TPMT_TK_CREATION, tag, mu_UINT16_Marshal,
+                hierarchy, mu_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
+
+TPMT_UNMARSHAL_TK(TPMT_TK_CREATION, tag, mu_UINT16_Unmarshal,
+                  hierarchy, mu_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
+
+TPMT_SIZE(TPMT_TK_CREATION,
+          SIZE_MEMBER(tag, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(hierarchy, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(digest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
+
+TPMT_MARSHAL_TK(TPMT_TK_VERIFIED, tag, mu_UINT16_Marshal,
+                hierarchy, mu_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
+
+TPMT_UNMARSHAL_TK(TPMT_TK_VERIFIED, tag, mu_UINT16_Unmarshal,
+                  hierarchy, mu_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
-TPMT_UNMARSHAL_TK(TPMT_TK_CREATION, tag, Tss2_MU_UINT16_Unmarshal,
-                  hierarchy, Tss2_MU_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
+TPMT_SIZE(TPMT_TK_VERIFIED,
+          SIZE_MEMBER(tag, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(hierarchy, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(digest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
 
-TPMT_MARSHAL_TK(TPMT_TK_VERIFIED, tag, Tss2_MU_UINT16_Marshal,
-                hierarchy, Tss2_MU_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
+TPMT_MARSHAL_TK(TPMT_TK_AUTH, tag, mu_UINT16_Marshal,
+                hierarchy, mu_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
 
-TPMT_UNMARSHAL_TK(TPMT_TK_VERIFIED, tag, Tss2_MU_UINT16_Unmarshal,
-                  hierarchy, Tss2_MU_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
+TPMT_UNMARSHAL_TK(TPMT_TK_AUTH, tag, mu_UINT16_Unmarshal,
+                  hierarchy, mu_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
-TPMT_MARSHAL_TK(TPMT_TK_AUTH, tag, Tss2_MU_UINT16_Marshal,
-                hierarchy, Tss2_MU_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
+TPMT_SIZE(TPMT_TK_AUTH,
+          SIZE_MEMBER(tag, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(hierarchy, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(digest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
 
-TPMT_UNMARSHAL_TK(TPMT_TK_AUTH, tag, Tss2_MU_UINT16_Unmarshal,
-                  hierarchy, Tss2_MU_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
+TPMT_MARSHAL_TK(TPMT_TK_HASHCHECK, tag, mu_UINT16_Marshal,
+                hierarchy, mu_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
 
-TPMT_MARSHAL_TK(TPMT_TK_HASHCHECK, tag, Tss2_MU_UINT16_Marshal,
-                hierarchy, Tss2_MU_UINT32_Marshal, digest, Tss2_MU_TPM2B_DIGEST_Marshal)
+TPMT_UNMARSHAL_TK(TPMT_TK_HASHCHECK, tag, mu_UINT16_Unmarshal,
+                  hierarchy, mu_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
 
-TPMT_UNMARSHAL_TK(TPMT_TK_HASHCHECK, tag, Tss2_MU_UINT16_Unmarshal,
-                  hierarchy, Tss2_MU_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
+TPMT_SIZE(TPMT_TK_HASHCHECK,
+          SIZE_MEMBER(tag, VAL, mu_UINT16_Size)
+          SIZE_MEMBER(hierarchy, VAL, mu_UINT32_Size)
+          SIZE_MEMBER(digest, ADDR, Tss2_MU_TPM2B_DIGEST_Size))
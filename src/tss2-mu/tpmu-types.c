@@ -14,6 +14,7 @@
 
 #include "tss2_mu.h"
 
+#include "base-types.h"
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
 #include "util/log.h"
@@ -231,6 +232,34 @@ static TSS2_RC unmarshal_null(uint8_t const buffer[], size_t buffer_size,
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * Union members that are marshaled as raw tables have a constant wire size.
+ */
+#define TPMU_TAB_SIZE(name, tab_size) \
+static TSS2_RC name(BYTE const *src, size_t *size) \
+{ \
+    UNUSED(src); \
+    *size = tab_size; \
+    return TSS2_RC_SUCCESS; \
+}
+
+TPMU_TAB_SIZE(size_hash_sha, TPM2_SHA1_DIGEST_SIZE)
+TPMU_TAB_SIZE(size_hash_sha256, TPM2_SHA256_DIGEST_SIZE)
+TPMU_TAB_SIZE(size_hash_sha384, TPM2_SHA384_DIGEST_SIZE)
+TPMU_TAB_SIZE(size_hash_sha512, TPM2_SHA512_DIGEST_SIZE)
+TPMU_TAB_SIZE(size_sm3_256, TPM2_SM3_256_DIGEST_SIZE)
+TPMU_TAB_SIZE(size_ecc, sizeof(TPMS_ECC_POINT))
+TPMU_TAB_SIZE(size_rsa, TPM2_MAX_RSA_KEY_BYTES)
+TPMU_TAB_SIZE(size_symmetric, sizeof(TPM2B_DIGEST))
+TPMU_TAB_SIZE(size_keyedhash, sizeof(TPM2B_DIGEST))
+
+static TSS2_RC size_null(void const *src, size_t *size)
+{
+    UNUSED(src);
+    *size = 0;
+    return TSS2_RC_SUCCESS;
+}
+
 /*
  * The TPMU_* types are unions with some number of members. The marshal
  * function for each union uses the provided selector value to identify the
@@ -434,12 +463,90 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
             -8, m, unmarshal_null, -9, m, unmarshal_null)
 
 /*
- * Following are invocations of the TPMU_MARSHAL2 and TPMU_UNMARSHAL2 macros.
- * These generate the marshaling and unmarshaling functions for the TPMU_*
- * types. They are grouped by TPMU_* with the TPMU_* being the first parameter
- * to each and on the first line with the macro name. The remaining parameters
- * are grouped, one 4-tuple per line for the TPMU_MARSHAL2 macro and one
- * 3-tuple per line for the TPMU_UNMARSHAL2 macro.
+ * The TPMU_SIZE macro works like TPMU_MARSHAL but generates a function that
+ * reports the number of bytes the selected member occupies on the wire. The
+ * function element of each 4-tuple is the _Size function of the member. The
+ * result is written to 'size' instead of being accumulated: a selector of
+ * TPM2_ALG_NULL yields a size of 0, an unknown selector TSS2_MU_RC_BAD_VALUE,
+ * exactly like the corresponding marshal function.
+ */
+#define TPMU_SIZE(type, sel, op, m, fn, sel2, op2, m2, fn2, sel3, op3, m3, fn3, \
+                  sel4, op4, m4, fn4, sel5, op5, m5, fn5, sel6, op6, m6, fn6, \
+                  sel7, op7, m7, fn7, sel8, op8, m8, fn8, sel9, op9, m9, fn9, \
+                  sel10, op10, m10, fn10, sel11, op11, m11, fn11, ...) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, uint32_t selector, size_t *size) \
+{ \
+    TSS2_RC ret = TSS2_MU_RC_BAD_VALUE; \
+\
+    if (src == NULL || size == NULL) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    switch (selector) { \
+    case sel: \
+    ret = fn(op src->m, size); \
+    break; \
+    case sel2: \
+    ret = fn2(op2 src->m2, size); \
+    break; \
+    case sel3: \
+    ret = fn3(op3 src->m3, size); \
+    break; \
+    case sel4: \
+    ret = fn4(op4 src->m4, size); \
+    break; \
+    case sel5: \
+    ret = fn5(op5 src->m5, size); \
+    break; \
+    case sel6: \
+    ret = fn6(op6 src->m6, size); \
+    break; \
+    case sel7: \
+    ret = fn7(op7 src->m7, size); \
+    break; \
+    case sel8: \
+    ret = fn8(op8 src->m8, size); \
+    break; \
+    case sel9: \
+    ret = fn9(op9 src->m9, size); \
+    break; \
+    case sel10: \
+    ret = fn10(op10 src->m10, size); \
+    break; \
+    case sel11: \
+    ret = fn11(op11 src->m11, size); \
+    break; \
+    case TPM2_ALG_NULL: \
+    *size = 0; \
+    ret = TSS2_RC_SUCCESS; \
+    break; \
+    default: \
+    LOG_DEBUG("wrong selector %x return error", selector); \
+    break; \
+    } \
+    return ret; \
+}
+
+/*
+ * The TPMU_SIZE2 macro pads TPMU_SIZE with no-op tuples the same way
+ * TPMU_MARSHAL2 does for TPMU_MARSHAL.
+ */
+#define TPMU_SIZE2(type, sel, op, m, fn, ...) \
+    TPMU_SIZE(type, sel, op, m, fn, __VA_ARGS__, -1, ADDR, m, size_null, \
+              -2, ADDR, m, size_null, -3, ADDR, m, size_null, \
+              -4, ADDR, m, size_null, -5, ADDR, m, size_null, \
+              -6, ADDR, m, size_null, -7, ADDR, m, size_null, \
+              -8, ADDR, m, size_null, -9, ADDR, m, size_null)
+
+/*
+ * Following are invocations of the TPMU_MARSHAL2, TPMU_UNMARSHAL2 and
+ * TPMU_SIZE2 macros.
+ * These generate the marshaling, unmarshaling and size functions for the
+ * TPMU_* types. They are grouped by TPMU_* with the TPMU_* being the first
+ * parameter to each and on the first line with the macro name. The remaining
+ * parameters are grouped, one 4-tuple per line for the TPMU_MARSHAL2 and
+ * TPMU_SIZE2 macros and one 3-tuple per line for the TPMU_UNMARSHAL2 macro.
  */
 TPMU_MARSHAL2(TPMU_HA,
     TPM2_ALG_SHA1, ADDR, sha1[0], marshal_hash_sha,
@@ -453,6 +560,12 @@ TPMU_UNMARSHAL2(TPMU_HA,
     TPM2_ALG_SHA384, sha384[0], unmarshal_hash_sha384,
     TPM2_ALG_SHA512, sha512[0], unmarshal_hash_sha512,
     TPM2_ALG_SM3_256, sm3_256[0], unmarshal_sm3_256)
+TPMU_SIZE2(TPMU_HA,
+    TPM2_ALG_SHA1, ADDR, sha1[0], size_hash_sha,
+    TPM2_ALG_SHA256, ADDR, sha256[0], size_hash_sha256,
+    TPM2_ALG_SHA384, ADDR, sha384[0], size_hash_sha384,
+    TPM2_ALG_SHA512, ADDR, sha512[0], size_hash_sha512,
+    TPM2_ALG_SM3_256, ADDR, sm3_256[0], size_sm3_256)
 
 TPMU_MARSHAL2(TPMU_CAPABILITIES,
     TPM2_CAP_ALGS, ADDR, algorithms, Tss2_MU_TPML_ALG_PROPERTY_Marshal,
@@ -476,6 +589,17 @@ TPMU_UNMARSHAL2(TPMU_CAPABILITIES,
     TPM2_CAP_PCR_PROPERTIES, pcrProperties, Tss2_MU_TPML_TAGGED_PCR_PROPERTY_Unmarshal,
     TPM2_CAP_ECC_CURVES, eccCurves, Tss2_MU_TPML_ECC_CURVE_Unmarshal,
     TPM2_CAP_VENDOR_PROPERTY, intelPttProperty, Tss2_MU_TPML_INTEL_PTT_PROPERTY_Unmarshal)
+TPMU_SIZE2(TPMU_CAPABILITIES,
+    TPM2_CAP_ALGS, ADDR, algorithms, Tss2_MU_TPML_ALG_PROPERTY_Size,
+    TPM2_CAP_HANDLES, ADDR, handles, Tss2_MU_TPML_HANDLE_Size,
+    TPM2_CAP_COMMANDS, ADDR, command, Tss2_MU_TPML_CCA_Size,
+    TPM2_CAP_PP_COMMANDS, ADDR, ppCommands, Tss2_MU_TPML_CC_Size,
+    TPM2_CAP_AUDIT_COMMANDS, ADDR, auditCommands, Tss2_MU_TPML_CC_Size,
+    TPM2_CAP_PCRS, ADDR, assignedPCR, Tss2_MU_TPML_PCR_SELECTION_Size,
+    TPM2_CAP_TPM_PROPERTIES, ADDR, tpmProperties, Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Size,
+    TPM2_CAP_PCR_PROPERTIES, ADDR, pcrProperties, Tss2_MU_TPML_TAGGED_PCR_PROPERTY_Size,
+    TPM2_CAP_ECC_CURVES, ADDR, eccCurves, Tss2_MU_TPML_ECC_CURVE_Size,
+    TPM2_CAP_VENDOR_PROPERTY, ADDR, intelPttProperty, Tss2_MU_TPML_INTEL_PTT_PROPERTY_Size)
 
 TPMU_MARSHAL2(TPMU_ATTEST,
     TPM2_ST_ATTEST_CERTIFY, ADDR, certify, Tss2_MU_TPMS_CERTIFY_INFO_Marshal,
@@ -493,32 +617,52 @@ TPMU_UNMARSHAL2(TPMU_ATTEST,
     TPM2_ST_ATTEST_SESSION_AUDIT, sessionAudit, Tss2_MU_TPMS_SESSION_AUDIT_INFO_Unmarshal,
     TPM2_ST_ATTEST_TIME, time, Tss2_MU_TPMS_TIME_ATTEST_INFO_Unmarshal,
     TPM2_ST_ATTEST_NV, nv, Tss2_MU_TPMS_NV_CERTIFY_INFO_Unmarshal)
+TPMU_SIZE2(TPMU_ATTEST,
+    TPM2_ST_ATTEST_CERTIFY, ADDR, certify, Tss2_MU_TPMS_CERTIFY_INFO_Size,
+    TPM2_ST_ATTEST_CREATION, ADDR, creation, Tss2_MU_TPMS_CREATION_INFO_Size,
+    TPM2_ST_ATTEST_QUOTE, ADDR, quote, Tss2_MU_TPMS_QUOTE_INFO_Size,
+    TPM2_ST_ATTEST_COMMAND_AUDIT, ADDR, commandAudit, Tss2_MU_TPMS_COMMAND_AUDIT_INFO_Size,
+    TPM2_ST_ATTEST_SESSION_AUDIT, ADDR, sessionAudit, Tss2_MU_TPMS_SESSION_AUDIT_INFO_Size,
+    TPM2_ST_ATTEST_TIME, ADDR, time, Tss2_MU_TPMS_TIME_ATTEST_INFO_Size,
+    TPM2_ST_ATTEST_NV, ADDR, nv, Tss2_MU_TPMS_NV_CERTIFY_INFO_Size)
 
 TPMU_MARSHAL2(TPMU_SYM_KEY_BITS,
-    TPM2_ALG_AES, VAL, aes, Tss2_MU_UINT16_Marshal,
-    TPM2_ALG_SM4, VAL, sm4, Tss2_MU_UINT16_Marshal,
-    TPM2_ALG_CAMELLIA, VAL, camellia, Tss2_MU_UINT16_Marshal,
-    TPM2_ALG_XOR, VAL, exclusiveOr, Tss2_MU_UINT16_Marshal,
-    TPM2_ALG_SYMCIPHER, VAL, sym, Tss2_MU_UINT16_Marshal)
+    TPM2_ALG_AES, VAL, aes, mu_UINT16_Marshal,
+    TPM2_ALG_SM4, VAL, sm4, mu_UINT16_Marshal,
+    TPM2_ALG_CAMELLIA, VAL, camellia, mu_UINT16_Marshal,
+    TPM2_ALG_XOR, VAL, exclusiveOr, mu_UINT16_Marshal,
+    TPM2_ALG_SYMCIPHER, VAL, sym, mu_UINT16_Marshal)
 TPMU_UNMARSHAL2(TPMU_SYM_KEY_BITS,
-    TPM2_ALG_AES, aes, Tss2_MU_UINT16_Unmarshal,
-    TPM2_ALG_SM4, sm4, Tss2_MU_UINT16_Unmarshal,
-    TPM2_ALG_CAMELLIA, camellia, Tss2_MU_UINT16_Unmarshal,
-    TPM2_ALG_XOR, exclusiveOr, Tss2_MU_UINT16_Unmarshal,
-    TPM2_ALG_SYMCIPHER, sym, Tss2_MU_UINT16_Unmarshal)
+    TPM2_ALG_AES, aes, mu_UINT16_Unmarshal,
+    TPM2_ALG_SM4, sm4, mu_UINT16_Unmarshal,
+    TPM2_ALG_CAMELLIA, camellia, mu_UINT16_Unmarshal,
+    TPM2_ALG_XOR, exclusiveOr, mu_UINT16_Unmarshal,
+    TPM2_ALG_SYMCIPHER, sym, mu_UINT16_Unmarshal)
+TPMU_SIZE2(TPMU_SYM_KEY_BITS,
+    TPM2_ALG_AES, VAL, aes, mu_UINT16_Size,
+    TPM2_ALG_SM4, VAL, sm4, mu_UINT16_Size,
+    TPM2_ALG_CAMELLIA, VAL, camellia, mu_UINT16_Size,
+    TPM2_ALG_XOR, VAL, exclusiveOr, mu_UINT16_Size,
+    TPM2_ALG_SYMCIPHER, VAL, sym, mu_UINT16_Size)
 
 TPMU_MARSHAL2(TPMU_SYM_MODE,
-    TPM2_ALG_AES, VAL, aes, Tss2_MU_UINT16_Marshal,
-    TPM2_ALG_SM4, VAL, sm4, Tss2_MU_UINT16_Marshal,
-    TPM2_ALG_CAMELLIA, VAL, camellia, Tss2_MU_UINT16_Marshal,
+    TPM2_ALG_AES, VAL, aes, mu_UINT16_Marshal,
+    TPM2_ALG_SM4, VAL, sm4, mu_UINT16_Marshal,
+    TPM2_ALG_CAMELLIA, VAL, camellia, mu_UINT16_Marshal,
     TPM2_ALG_XOR, ADDR, sym, marshal_null,
-    TPM2_ALG_SYMCIPHER, VAL, sym, Tss2_MU_UINT16_Marshal)
+    TPM2_ALG_SYMCIPHER, VAL, sym, mu_UINT16_Marshal)
 TPMU_UNMARSHAL2(TPMU_SYM_MODE,
-    TPM2_ALG_AES, aes, Tss2_MU_UINT16_Unmarshal,
-    TPM2_ALG_SM4, sm4, Tss2_MU_UINT16_Unmarshal,
-    TPM2_ALG_CAMELLIA, camellia, Tss2_MU_UINT16_Unmarshal,
+    TPM2_ALG_AES, aes, mu_UINT16_Unmarshal,
+    TPM2_ALG_SM4, sm4, mu_UINT16_Unmarshal,
+    TPM2_ALG_CAMELLIA, camellia, mu_UINT16_Unmarshal,
     TPM2_ALG_XOR, sym, unmarshal_null,
-    TPM2_ALG_SYMCIPHER, sym, Tss2_MU_UINT16_Unmarshal)
+    TPM2_ALG_SYMCIPHER, sym, mu_UINT16_Unmarshal)
+TPMU_SIZE2(TPMU_SYM_MODE,
+    TPM2_ALG_AES, VAL, aes, mu_UINT16_Size,
+    TPM2_ALG_SM4, VAL, sm4, mu_UINT16_Size,
+    TPM2_ALG_CAMELLIA, VAL, camellia, mu_UINT16_Size,
+    TPM2_ALG_XOR, ADDR, sym, size_null,
+    TPM2_ALG_SYMCIPHER, VAL, sym, mu_UINT16_Size)
 
 TPMU_MARSHAL2(TPMU_SIG_SCHEME,
     TPM2_ALG_RSASSA, ADDR, rsassa, Tss2_MU_TPMS_SCHEME_HASH_Marshal,
@@ -536,6 +680,14 @@ TPMU_UNMARSHAL2(TPMU_SIG_SCHEME,
     TPM2_ALG_SM2, sm2, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal,
     TPM2_ALG_ECSCHNORR, ecschnorr, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal,
     TPM2_ALG_HMAC, hmac, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal)
+TPMU_SIZE2(TPMU_SIG_SCHEME,
+    TPM2_ALG_RSASSA, ADDR, rsassa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_RSAPSS, ADDR, rsapss, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDSA, ADDR, ecdsa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDAA, ADDR, ecdaa, Tss2_MU_TPMS_SCHEME_ECDAA_Size,
+    TPM2_ALG_SM2, ADDR, sm2, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECSCHNORR, ADDR, ecschnorr, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_HMAC, ADDR, hmac, Tss2_MU_TPMS_SCHEME_HASH_Size)
 
 TPMU_MARSHAL2(TPMU_KDF_SCHEME,
     TPM2_ALG_MGF1, ADDR, mgf1, Tss2_MU_TPMS_SCHEME_HASH_Marshal,
@@ -545,6 +697,10 @@ TPMU_UNMARSHAL2(TPMU_KDF_SCHEME,
     TPM2_ALG_MGF1, mgf1, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal,
     TPM2_ALG_KDF1_SP800_56A, kdf1_sp800_56a, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal,
     TPM2_ALG_KDF1_SP800_108, kdf1_sp800_108, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal)
+TPMU_SIZE2(TPMU_KDF_SCHEME,
+    TPM2_ALG_MGF1, ADDR, mgf1, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_KDF1_SP800_56A, ADDR, kdf1_sp800_56a, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_KDF1_SP800_108, ADDR, kdf1_sp800_108, Tss2_MU_TPMS_SCHEME_HASH_Size)
 
 TPMU_MARSHAL2(TPMU_ASYM_SCHEME,
     TPM2_ALG_ECDH, ADDR, ecdh, Tss2_MU_TPMS_SCHEME_HASH_Marshal,
@@ -568,6 +724,17 @@ TPMU_UNMARSHAL2(TPMU_ASYM_SCHEME,
     TPM2_ALG_ECSCHNORR, ecschnorr, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal,
     TPM2_ALG_RSAES, rsaes, unmarshal_null,
     TPM2_ALG_OAEP, oaep, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal)
+TPMU_SIZE2(TPMU_ASYM_SCHEME,
+    TPM2_ALG_ECDH, ADDR, ecdh, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECMQV, ADDR, ecmqv, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_RSASSA, ADDR, rsassa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_RSAPSS, ADDR, rsapss, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDSA, ADDR, ecdsa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDAA, ADDR, ecdaa, Tss2_MU_TPMS_SCHEME_ECDAA_Size,
+    TPM2_ALG_SM2, ADDR, sm2, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECSCHNORR, ADDR, ecschnorr, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_RSAES, ADDR, rsaes, size_null,
+    TPM2_ALG_OAEP, ADDR, oaep, Tss2_MU_TPMS_SCHEME_HASH_Size)
 
 TPMU_MARSHAL2(TPMU_SCHEME_KEYEDHASH,
     TPM2_ALG_HMAC, ADDR, hmac, Tss2_MU_TPMS_SCHEME_HASH_Marshal,
@@ -575,6 +742,9 @@ TPMU_MARSHAL2(TPMU_SCHEME_KEYEDHASH,
 TPMU_UNMARSHAL2(TPMU_SCHEME_KEYEDHASH,
     TPM2_ALG_HMAC, hmac, Tss2_MU_TPMS_SCHEME_HASH_Unmarshal,
     TPM2_ALG_XOR, exclusiveOr, Tss2_MU_TPMS_SCHEME_XOR_Unmarshal)
+TPMU_SIZE2(TPMU_SCHEME_KEYEDHASH,
+    TPM2_ALG_HMAC, ADDR, hmac, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_XOR, ADDR, exclusiveOr, Tss2_MU_TPMS_SCHEME_XOR_Size)
 
 TPMU_MARSHAL2(TPMU_SIGNATURE,
     TPM2_ALG_RSASSA, ADDR, rsassa, Tss2_MU_TPMS_SIGNATURE_RSA_Marshal,
@@ -592,6 +762,14 @@ TPMU_UNMARSHAL2(TPMU_SIGNATURE,
     TPM2_ALG_SM2, sm2, Tss2_MU_TPMS_SIGNATURE_ECC_Unmarshal,
     TPM2_ALG_ECSCHNORR, ecschnorr, Tss2_MU_TPMS_SIGNATURE_ECC_Unmarshal,
     TPM2_ALG_HMAC, hmac, Tss2_MU_TPMT_HA_Unmarshal)
+TPMU_SIZE2(TPMU_SIGNATURE,
+    TPM2_ALG_RSASSA, ADDR, rsassa, Tss2_MU_TPMS_SIGNATURE_RSA_Size,
+    TPM2_ALG_RSAPSS, ADDR, rsapss, Tss2_MU_TPMS_SIGNATURE_RSA_Size,
+    TPM2_ALG_ECDSA, ADDR, ecdsa, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_ECDAA, ADDR, ecdaa, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_SM2, ADDR, sm2, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_ECSCHNORR, ADDR, ecschnorr, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_HMAC, ADDR, hmac, Tss2_MU_TPMT_HA_Size)
 
 TPMU_MARSHAL2(TPMU_SENSITIVE_COMPOSITE,
     TPM2_ALG_RSA, ADDR, rsa, Tss2_MU_TPM2B_PRIVATE_KEY_RSA_Marshal,
@@ -603,6 +781,11 @@ TPMU_UNMARSHAL2(TPMU_SENSITIVE_COMPOSITE,
     TPM2_ALG_ECC, ecc, Tss2_MU_TPM2B_ECC_PARAMETER_Unmarshal,
     TPM2_ALG_KEYEDHASH, bits, Tss2_MU_TPM2B_SENSITIVE_DATA_Unmarshal,
     TPM2_ALG_SYMCIPHER, sym, Tss2_MU_TPM2B_SYM_KEY_Unmarshal)
+TPMU_SIZE2(TPMU_SENSITIVE_COMPOSITE,
+    TPM2_ALG_RSA, ADDR, rsa, Tss2_MU_TPM2B_PRIVATE_KEY_RSA_Size,
+    TPM2_ALG_ECC, ADDR, ecc, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+    TPM2_ALG_KEYEDHASH, ADDR, bits, Tss2_MU_TPM2B_SENSITIVE_DATA_Size,
+    TPM2_ALG_SYMCIPHER, ADDR, sym, Tss2_MU_TPM2B_SYM_KEY_Size)
 
 TPMU_MARSHAL2(TPMU_ENCRYPTED_SECRET,
     TPM2_ALG_ECC, ADDR, ecc[0], marshal_ecc,
@@ -614,6 +797,11 @@ TPMU_UNMARSHAL2(TPMU_ENCRYPTED_SECRET,
     TPM2_ALG_RSA, rsa[0], unmarshal_rsa,
     TPM2_ALG_SYMCIPHER, symmetric[0], unmarshal_symmetric,
     TPM2_ALG_KEYEDHASH, keyedHash[0], unmarshal_keyedhash)
+TPMU_SIZE2(TPMU_ENCRYPTED_SECRET,
+    TPM2_ALG_ECC, ADDR, ecc[0], size_ecc,
+    TPM2_ALG_RSA, ADDR, rsa[0], size_rsa,
+    TPM2_ALG_SYMCIPHER, ADDR, symmetric[0], size_symmetric,
+    TPM2_ALG_KEYEDHASH, ADDR, keyedHash[0], size_keyedhash)
 
 TPMU_MARSHAL2(TPMU_PUBLIC_ID,
     TPM2_ALG_KEYEDHASH, ADDR, keyedHash, Tss2_MU_TPM2B_DIGEST_Marshal,
@@ -625,6 +813,11 @@ TPMU_UNMARSHAL2(TPMU_PUBLIC_ID,
     TPM2_ALG_SYMCIPHER, sym, Tss2_MU_TPM2B_DIGEST_Unmarshal,
     TPM2_ALG_RSA, rsa, Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Unmarshal,
     TPM2_ALG_ECC, ecc, Tss2_MU_TPMS_ECC_POINT_Unmarshal)
+TPMU_SIZE2(TPMU_PUBLIC_ID,
+    TPM2_ALG_KEYEDHASH, ADDR, keyedHash, Tss2_MU_TPM2B_DIGEST_Size,
+    TPM2_ALG_SYMCIPHER, ADDR, sym, Tss2_MU_TPM2B_DIGEST_Size,
+    TPM2_ALG_RSA, ADDR, rsa, Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Size,
+    TPM2_ALG_ECC, ADDR, ecc, Tss2_MU_TPMS_ECC_POINT_Size)
 
 TPMU_MARSHAL2(TPMU_PUBLIC_PARMS,
     TPM2_ALG_KEYEDHASH, ADDR, keyedHashDetail, Tss2_MU_TPMS_KEYEDHASH_PARMS_Marshal,
@@ -636,16 +829,27 @@ TPMU_UNMARSHAL2(TPMU_PUBLIC_PARMS,
     TPM2_ALG_SYMCIPHER, symDetail, Tss2_MU_TPMS_SYMCIPHER_PARMS_Unmarshal,
     TPM2_ALG_RSA, rsaDetail, Tss2_MU_TPMS_RSA_PARMS_Unmarshal,
     TPM2_ALG_ECC, eccDetail, Tss2_MU_TPMS_ECC_PARMS_Unmarshal)
+TPMU_SIZE2(TPMU_PUBLIC_PARMS,
+    TPM2_ALG_KEYEDHASH, ADDR, keyedHashDetail, Tss2_MU_TPMS_KEYEDHASH_PARMS_Size,
+    TPM2_ALG_SYMCIPHER, ADDR, symDetail, Tss2_MU_TPMS_SYMCIPHER_PARMS_Size,
+    TPM2_ALG_RSA, ADDR, rsaDetail, Tss2_MU_TPMS_RSA_PARMS_Size,
+    TPM2_ALG_ECC, ADDR, eccDetail, Tss2_MU_TPMS_ECC_PARMS_Size)
 
 TPMU_MARSHAL2(TPMU_NAME,
-    sizeof(TPM2_HANDLE), VAL, handle, Tss2_MU_UINT32_Marshal,
+    sizeof(TPM2_HANDLE), VAL, handle, mu_UINT32_Marshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA1_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Marshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA256_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Marshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA384_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Marshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA512_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Marshal)
 TPMU_UNMARSHAL2(TPMU_NAME,
-    sizeof(TPM2_HANDLE), handle, Tss2_MU_UINT32_Unmarshal,
+    sizeof(TPM2_HANDLE), handle, mu_UINT32_Unmarshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA1_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Unmarshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA256_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Unmarshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA384_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Unmarshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA512_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Unmarshal)
+TPMU_SIZE2(TPMU_NAME,
+    sizeof(TPM2_HANDLE), VAL, handle, mu_UINT32_Size,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA1_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Size,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA256_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Size,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA384_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Size,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA512_DIGEST_SIZE, ADDR, digest, Tss2_MU_TPMT_HA_Size)
@@ -35,6 +35,9 @@ TSS2_RC Tss2_Sys_ExecuteAsync(TSS2_SYS_CONTEXT *sysContext)
     if (rval)
         return rval;
 
+    if (ctx->metrics)
+        SysMetricsCommandSent(ctx, GetCommandSize(ctx));
+
     /* Keep a copy of the cmd header to be able reissue the command
      * after receiving a TPM error
      */
@@ -147,6 +150,9 @@ TSS2_RC Tss2_Sys_ExecuteFinish(TSS2_SYS_CONTEXT *sysContext, int32_t timeout)
         return TSS2_SYS_RC_INSUFFICIENT_RESPONSE;
     }
 
+    if (ctx->metrics)
+        SysMetricsResponseReceived(ctx, response_size);
+
     /* If we received a TPM error then reset SAPI state machine to
      * CMD_STAGE_PREPARE, and restore the command header so the command
      * can be reissued without going through the usual *_prepare stage.
@@ -174,3 +180,112 @@ TSS2_RC Tss2_Sys_Execute(TSS2_SYS_CONTEXT *sysContext)
 
     return Tss2_Sys_ExecuteFinish(sysContext, TSS2_TCTI_TIMEOUT_BLOCK);
 }
+
+TSS2_RC Tss2_Sys_ExecuteBatch(
+    TSS2_SYS_CONTEXT **sysContexts,
+    size_t count,
+    TSS2_RC *rcs)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    TSS2_RC rval = TSS2_RC_SUCCESS;
+    size_t depth = SYS_BATCH_PIPELINE_DEPTH;
+    size_t sent = 0, received = 0, i;
+
+    if (!sysContexts || !rcs)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (count == 0)
+        return TSS2_RC_SUCCESS;
+
+    for (i = 0; i < count; i++) {
+        if (!sysContexts[i])
+            return TSS2_SYS_RC_BAD_REFERENCE;
+        if (syscontext_cast(sysContexts[i])->tctiContext !=
+            syscontext_cast(sysContexts[0])->tctiContext) {
+            LOG_ERROR("All contexts of a batch must use the same TCTI.");
+            return TSS2_SYS_RC_BAD_VALUE;
+        }
+        if (syscontext_cast(sysContexts[i])->previousStage != CMD_STAGE_PREPARE)
+            return TSS2_SYS_RC_BAD_SEQUENCE;
+    }
+    tcti = syscontext_cast(sysContexts[0])->tctiContext;
+
+    /*
+     * Use the deepest pipeline the TCTI accepts. A depth of 1 is the normal
+     * transmit / receive sequence, so TCTIs without pipelining support
+     * execute the batch one command after the other.
+     */
+    if (depth > count)
+        depth = count;
+    while (depth > 1 &&
+           Tss2_Tcti_SetPipelineDepth(tcti, depth) != TSS2_RC_SUCCESS) {
+        depth /= 2;
+    }
+    LOG_DEBUG("Executing %zu commands with pipeline depth %zu", count, depth);
+
+    for (i = 0; i < count; i++)
+        rcs[i] = TSS2_SYS_RC_BAD_SEQUENCE;
+
+    while (received < count) {
+        while (sent < count && sent - received < depth) {
+            rval = Tss2_Sys_ExecuteAsync(sysContexts[sent]);
+            if (rval) {
+                rcs[sent] = rval;
+                LOG_ERROR("Transmitting command %zu of batch failed: 0x%"
+                          PRIx32, sent, rval);
+                goto drain;
+            }
+            sent++;
+        }
+
+        rval = Tss2_Sys_ExecuteFinish(sysContexts[received],
+                                      TSS2_TCTI_TIMEOUT_BLOCK);
+        rcs[received] = rval;
+        /*
+         * TPM response codes are per command. Any other error means the
+         * response stream can not be relied upon anymore.
+         */
+        if ((rval & TSS2_RC_LAYER_MASK) != TSS2_TPM_RC_LAYER) {
+            LOG_ERROR("Receiving response %zu of batch failed: 0x%"
+                      PRIx32, received, rval);
+            goto lost;
+        }
+        received++;
+    }
+    rval = TSS2_RC_SUCCESS;
+    goto out;
+
+drain:
+    /*
+     * The commands already sent have been executed by the TPM. Collect their
+     * responses, so that the TCTI is ready for the next command and the
+     * caller learns their results.
+     */
+    while (received < sent) {
+        rcs[received] = Tss2_Sys_ExecuteFinish(sysContexts[received],
+                                               TSS2_TCTI_TIMEOUT_BLOCK);
+        if ((rcs[received] & TSS2_RC_LAYER_MASK) != TSS2_TPM_RC_LAYER) {
+            LOG_ERROR("Receiving response %zu of batch failed: 0x%"
+                      PRIx32, received, rcs[received]);
+            goto lost;
+        }
+        received++;
+    }
+    goto out;
+
+lost:
+    /*
+     * The responses to the commands still in flight can not be received
+     * anymore. They carry the transport error; whether the TPM executed them
+     * is unknown.
+     */
+    for (i = received + 1; i < sent; i++)
+        rcs[i] = rcs[received];
+
+out:
+    /* A failed receive resets the TCTI, so this succeeds in all cases. */
+    if (depth > 1 && Tss2_Tcti_SetPipelineDepth(tcti, 1) != TSS2_RC_SUCCESS)
+        LOG_WARNING("Failed to reset the pipeline depth of the TCTI.");
+
+    return rval;
+}
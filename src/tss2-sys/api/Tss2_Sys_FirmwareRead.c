@@ -58,6 +58,17 @@ TSS2_RC Tss2_Sys_FirmwareRead_Complete(
                                               &ctx->nextData, fuData);
 }
 
+TSS2_RC Tss2_Sys_FirmwareRead_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *fuDataSize,
+    const uint8_t **fuData)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+
+    return CommonCompleteView(ctx, TPM2B_BUFFER_SIZE(TPM2B_MAX_BUFFER),
+                              fuDataSize, fuData);
+}
+
 TSS2_RC Tss2_Sys_FirmwareRead(
     TSS2_SYS_CONTEXT *sysContext,
     TSS2L_SYS_AUTH_COMMAND const *cmdAuthsArray,
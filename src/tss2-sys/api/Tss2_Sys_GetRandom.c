@@ -57,6 +57,17 @@ TSS2_RC Tss2_Sys_GetRandom_Complete(
                                           &ctx->nextData, randomBytes);
 }
 
+TSS2_RC Tss2_Sys_GetRandom_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *randomBytesSize,
+    const uint8_t **randomBytes)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+
+    return CommonCompleteView(ctx, TPM2B_BUFFER_SIZE(TPM2B_DIGEST),
+                              randomBytesSize, randomBytes);
+}
+
 TSS2_RC Tss2_Sys_GetRandom(
     TSS2_SYS_CONTEXT *sysContext,
     TSS2L_SYS_AUTH_COMMAND const *cmdAuthsArray,
@@ -64,6 +64,8 @@ TSS2_RC Tss2_Sys_Initialize(
     ctx->tctiContext = tctiContext;
     InitSysContextPtrs(ctx, contextSize);
     InitSysContextFields(ctx);
+    ctx->metrics = NULL;
+    ctx->metricsPrepareTime = 0;
     ctx->previousStage = CMD_STAGE_INITIALIZE;
 
     return TSS2_RC_SUCCESS;
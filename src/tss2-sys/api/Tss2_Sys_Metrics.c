@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************;
+ * Copyright 2026, agent
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_tpm2_types.h"
+#include "sysapi_util.h"
+#define LOGMODULE sys
+#include "util/log.h"
+
+/** Log a summary line for every command code with recorded metrics.
+ *
+ * Used for periodic dumps when no callback is given.
+ */
+static void
+metrics_log(const TSS2_SYS_METRICS *metrics, void *userdata)
+{
+    const TSS2_SYS_COMMAND_METRICS *entry;
+    size_t i;
+
+    (void)userdata;
+
+    for (i = 0; i < SYS_METRICS_CC_COUNT + metrics->otherCount; i++) {
+        entry = i < SYS_METRICS_CC_COUNT ? metrics->commands[i] :
+                &metrics->other[i - SYS_METRICS_CC_COUNT];
+        if (!entry || !entry->count)
+            continue;
+
+        LOG_INFO("cc 0x%08" PRIx32 ": count %" PRIu64 " errors %" PRIu64
+                 " retries %" PRIu64 " yielded %" PRIu64 " sent %" PRIu64
+                 " received %" PRIu64 " host %" PRIu64 "us tpm %" PRIu64
+                 "us p50 %" PRIu64 "us p99 %" PRIu64 "us",
+                 entry->commandCode, entry->count, entry->errors,
+                 entry->retries, entry->yielded, entry->bytesSent,
+                 entry->bytesReceived, entry->hostTimeNs / 1000,
+                 entry->tpmTimeNs / 1000,
+                 Tss2_Sys_Metrics_Percentile(entry, 50.0),
+                 Tss2_Sys_Metrics_Percentile(entry, 99.0));
+    }
+}
+
+/** Allocate an empty metrics collection.
+ *
+ * The collection is attached to one or more SAPI contexts with
+ * Tss2_Sys_SetMetrics(). It is not synchronized, contexts sharing a
+ * collection must not execute commands concurrently.
+ *
+ * @param[out] metrics The new collection. Free with Tss2_Sys_Metrics_Free().
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if metrics is NULL.
+ * @retval TSS2_SYS_RC_GENERAL_FAILURE if memory can not be allocated.
+ */
+TSS2_RC Tss2_Sys_Metrics_New(
+    TSS2_SYS_METRICS **metrics)
+{
+    if (!metrics)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    *metrics = calloc(1, sizeof(**metrics));
+    if (!*metrics) {
+        LOG_ERROR("Out of memory");
+        return TSS2_SYS_RC_GENERAL_FAILURE;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Free a metrics collection.
+ *
+ * The collection must not be attached to a SAPI context anymore.
+ *
+ * @param[in,out] metrics The collection to free. Set to NULL.
+ */
+void Tss2_Sys_Metrics_Free(
+    TSS2_SYS_METRICS **metrics)
+{
+    if (!metrics || !*metrics)
+        return;
+
+    Tss2_Sys_Metrics_Reset(*metrics);
+    free(*metrics);
+    *metrics = NULL;
+}
+
+/** Enable or disable execution metrics for a SAPI context.
+ *
+ * While a collection is attached, every command executed through the
+ * context records its sizes, timing and response code in it.
+ *
+ * @param[in] sysContext The SAPI context.
+ * @param[in] metrics The collection to record into, NULL to disable.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if sysContext is NULL.
+ * @retval TSS2_SYS_RC_BAD_SEQUENCE if a command is in flight.
+ */
+TSS2_RC Tss2_Sys_SetMetrics(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_METRICS *metrics)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+
+    if (!ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (ctx->previousStage == CMD_STAGE_SEND_COMMAND)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    ctx->metrics = metrics;
+    ctx->metricsPrepareTime = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Copy the metrics of all command codes seen so far.
+ *
+ * @param[in] metrics The collection.
+ * @param[out] entries Array receiving the entries, NULL to only query the
+ *             number of entries.
+ * @param[in,out] count Capacity of entries in, number of entries out.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if metrics or count is NULL.
+ * @retval TSS2_SYS_RC_BAD_SIZE if entries is too small. count is set to
+ *         the required capacity.
+ */
+TSS2_RC Tss2_Sys_Metrics_Query(
+    const TSS2_SYS_METRICS *metrics,
+    TSS2_SYS_COMMAND_METRICS *entries,
+    size_t *count)
+{
+    size_t i, n = 0;
+
+    if (!metrics || !count)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (!entries) {
+        *count = metrics->used;
+        return TSS2_RC_SUCCESS;
+    }
+    if (*count < metrics->used) {
+        *count = metrics->used;
+        return TSS2_SYS_RC_BAD_SIZE;
+    }
+
+    for (i = 0; i < SYS_METRICS_CC_COUNT; i++) {
+        if (metrics->commands[i])
+            entries[n++] = *metrics->commands[i];
+    }
+    for (i = 0; i < metrics->otherCount; i++)
+        entries[n++] = metrics->other[i];
+
+    *count = n;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Copy the metrics of a single command code.
+ *
+ * @param[in] metrics The collection.
+ * @param[in] commandCode The command code.
+ * @param[out] entry The metrics of the command, all zero if the command
+ *             was not executed yet.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if metrics or entry is NULL.
+ */
+TSS2_RC Tss2_Sys_Metrics_GetCommand(
+    const TSS2_SYS_METRICS *metrics,
+    TPM2_CC commandCode,
+    TSS2_SYS_COMMAND_METRICS *entry)
+{
+    TSS2_SYS_COMMAND_METRICS *found;
+
+    if (!metrics || !entry)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    found = SysMetricsLookup((TSS2_SYS_METRICS *)metrics, commandCode, false);
+    if (found) {
+        *entry = *found;
+    } else {
+        memset(entry, 0, sizeof(*entry));
+        entry->commandCode = commandCode;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Estimate a latency percentile from the histogram of a command.
+ *
+ * @param[in] entry The metrics of the command.
+ * @param[in] percentile The percentile, between 0 and 100.
+ * @retval The upper bound of the histogram bucket containing the
+ *         percentile in microseconds, 0 if no latencies were recorded.
+ */
+uint64_t Tss2_Sys_Metrics_Percentile(
+    const TSS2_SYS_COMMAND_METRICS *entry,
+    double percentile)
+{
+    uint64_t total = 0, seen = 0, rank;
+    size_t b;
+
+    if (!entry)
+        return 0;
+
+    for (b = 0; b < TSS2_SYS_METRICS_HISTOGRAM_BUCKETS; b++)
+        total += entry->histogram[b];
+    if (!total)
+        return 0;
+
+    if (percentile < 0.0)
+        percentile = 0.0;
+    if (percentile > 100.0)
+        percentile = 100.0;
+    rank = (uint64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    for (b = 0; b < TSS2_SYS_METRICS_HISTOGRAM_BUCKETS - 1; b++) {
+        seen += entry->histogram[b];
+        if (seen >= rank)
+            break;
+    }
+    if (b < 4)
+        return b;
+    return ((uint64_t)(5 + b % 4) << (b / 4 - 1)) - 1;
+}
+
+/** Discard all recorded metrics.
+ *
+ * @param[in,out] metrics The collection to reset.
+ */
+void Tss2_Sys_Metrics_Reset(
+    TSS2_SYS_METRICS *metrics)
+{
+    size_t i;
+
+    if (!metrics)
+        return;
+
+    for (i = 0; i < SYS_METRICS_CC_COUNT; i++) {
+        free(metrics->commands[i]);
+        metrics->commands[i] = NULL;
+    }
+    free(metrics->other);
+    metrics->other = NULL;
+    metrics->otherCount = 0;
+    metrics->used = 0;
+}
+
+/** Configure periodic dumps of a metrics collection.
+ *
+ * The dump is triggered by the first response received after the interval
+ * elapsed, no timer or thread is involved.
+ *
+ * @param[in,out] metrics The collection.
+ * @param[in] intervalMs Minimum time between two dumps, 0 to disable.
+ * @param[in] callback Called with the collection, NULL to log a summary
+ *            of every command at log level info.
+ * @param[in] userdata Passed to callback.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if metrics is NULL.
+ */
+TSS2_RC Tss2_Sys_Metrics_SetDump(
+    TSS2_SYS_METRICS *metrics,
+    uint32_t intervalMs,
+    TSS2_SYS_METRICS_DUMP_CB callback,
+    void *userdata)
+{
+    if (!metrics)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    metrics->dumpInterval = (uint64_t)intervalMs * 1000000;
+    metrics->lastDump = SysMetricsNow();
+    metrics->dumpCallback = callback ? callback : metrics_log;
+    metrics->dumpUserdata = userdata;
+    return TSS2_RC_SUCCESS;
+}
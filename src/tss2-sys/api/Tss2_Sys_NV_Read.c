@@ -80,6 +80,17 @@ TSS2_RC Tss2_Sys_NV_Read_Complete(
                                                  data);
 }
 
+TSS2_RC Tss2_Sys_NV_Read_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *dataSize,
+    const uint8_t **data)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+
+    return CommonCompleteView(ctx, TPM2B_BUFFER_SIZE(TPM2B_MAX_NV_BUFFER),
+                              dataSize, data);
+}
+
 TSS2_RC Tss2_Sys_NV_Read(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_RH_NV_AUTH authHandle,
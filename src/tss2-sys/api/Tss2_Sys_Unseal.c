@@ -59,6 +59,17 @@ TSS2_RC Tss2_Sys_Unseal_Complete(
                                                   outData);
 }
 
+TSS2_RC Tss2_Sys_Unseal_CompleteView(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *outDataSize,
+    const uint8_t **outData)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+
+    return CommonCompleteView(ctx, TPM2B_BUFFER_SIZE(TPM2B_SENSITIVE_DATA),
+                              outDataSize, outData);
+}
+
 TSS2_RC Tss2_Sys_Unseal(
     TSS2_SYS_CONTEXT *sysContext,
     TPMI_DH_OBJECT itemHandle,
@@ -9,7 +9,14 @@
 #include <config.h>
 #endif
 
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 #include "tss2_mu.h"
 #include "sysapi_util.h"
@@ -85,6 +92,8 @@ TSS2_RC CommonPreparePrologue(
         return rval;
 
     ctx->commandCode = commandCode;
+    if (ctx->metrics)
+        ctx->metricsPrepareTime = SysMetricsNow();
     ctx->numResponseHandles = GetNumResponseHandles(commandCode);
     ctx->rspParamsSize = (UINT32 *)(ctx->cmdBuffer + sizeof(TPM20_Header_Out) +
                          (GetNumResponseHandles(commandCode) * sizeof(UINT32)));
@@ -141,6 +150,46 @@ TSS2_RC CommonComplete(_TSS2_SYS_CONTEXT_BLOB *ctx)
     return rval;
 }
 
+/*
+ * Complete a command whose first response parameter is a TPM2B and return a
+ * pointer to its payload inside the response buffer instead of copying it.
+ * The view stays valid until the context is used for the next command.
+ */
+TSS2_RC CommonCompleteView(
+    _TSS2_SYS_CONTEXT_BLOB *ctx,
+    size_t maxSize,
+    size_t *size,
+    const uint8_t **buffer)
+{
+    UINT16 viewSize;
+    TSS2_RC rval;
+
+    if (!ctx || !size || !buffer)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    rval = CommonComplete(ctx);
+    if (rval)
+        return rval;
+
+    rval = Tss2_MU_UINT16_Unmarshal(ctx->cmdBuffer,
+                                    ctx->maxCmdSize,
+                                    &ctx->nextData, &viewSize);
+    if (rval)
+        return rval;
+
+    if (viewSize > maxSize)
+        return TSS2_MU_RC_BAD_SIZE;
+
+    if (viewSize > ctx->maxCmdSize - ctx->nextData)
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+
+    *size = viewSize;
+    *buffer = &ctx->cmdBuffer[ctx->nextData];
+    ctx->nextData += viewSize;
+
+    return TSS2_RC_SUCCESS;
+}
+
 TSS2_RC CommonOneCall(
     _TSS2_SYS_CONTEXT_BLOB *ctx,
     TSS2L_SYS_AUTH_COMMAND const *cmdAuthsArray,
@@ -433,3 +482,137 @@ TSS2_RC ValidateTPML_PCR_SELECTION(const TPML_PCR_SELECTION *pcr_selection)
     return TSS2_RC_SUCCESS;
 }
 #endif
+
+/* Monotonic time stamp in nanoseconds. */
+uint64_t SysMetricsNow(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER count, freq;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000000 +
+           (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000000 /
+           freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/*
+ * Histogram bucket of a latency, keeping the two most significant bits of
+ * the value. See TSS2_SYS_METRICS_HISTOGRAM_BUCKETS for the bucket ranges.
+ */
+size_t SysMetricsBucket(uint64_t latencyUs)
+{
+    size_t exponent = 0;
+    size_t bucket;
+
+    if (latencyUs < 4)
+        return (size_t)latencyUs;
+
+    while (latencyUs >= 8) {
+        latencyUs >>= 1;
+        exponent++;
+    }
+    bucket = 4 * (exponent + 1) + (latencyUs & 3);
+    if (bucket >= TSS2_SYS_METRICS_HISTOGRAM_BUCKETS)
+        bucket = TSS2_SYS_METRICS_HISTOGRAM_BUCKETS - 1;
+    return bucket;
+}
+
+TSS2_SYS_COMMAND_METRICS *SysMetricsLookup(
+    TSS2_SYS_METRICS *metrics,
+    TPM2_CC commandCode,
+    bool create)
+{
+    TSS2_SYS_COMMAND_METRICS *entry, *other;
+    size_t i;
+
+    if (commandCode >= TPM2_CC_FIRST && commandCode <= TPM2_CC_LAST) {
+        entry = metrics->commands[commandCode - TPM2_CC_FIRST];
+        if (entry || !create)
+            return entry;
+
+        entry = calloc(1, sizeof(*entry));
+        if (!entry)
+            return NULL;
+        entry->commandCode = commandCode;
+        metrics->commands[commandCode - TPM2_CC_FIRST] = entry;
+        metrics->used++;
+        return entry;
+    }
+
+    for (i = 0; i < metrics->otherCount; i++) {
+        if (metrics->other[i].commandCode == commandCode)
+            return &metrics->other[i];
+    }
+    if (!create)
+        return NULL;
+
+    other = realloc(metrics->other,
+                    (metrics->otherCount + 1) * sizeof(*other));
+    if (!other)
+        return NULL;
+    metrics->other = other;
+    entry = &other[metrics->otherCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->commandCode = commandCode;
+    metrics->used++;
+    return entry;
+}
+
+void SysMetricsCommandSent(_TSS2_SYS_CONTEXT_BLOB *ctx, UINT32 size)
+{
+    TSS2_SYS_COMMAND_METRICS *entry;
+    uint64_t now = SysMetricsNow();
+
+    /* Resubmissions of a command do not go through _Prepare again. */
+    ctx->metricsHostTime = ctx->metricsPrepareTime ?
+                           now - ctx->metricsPrepareTime : 0;
+    ctx->metricsPrepareTime = 0;
+    ctx->metricsSendTime = now;
+
+    entry = SysMetricsLookup(ctx->metrics, ctx->commandCode, true);
+    if (!entry) {
+        LOG_WARNING("Out of memory, metrics of command 0x%" PRIx32 " lost",
+                    ctx->commandCode);
+        return;
+    }
+    entry->bytesSent += size;
+    entry->hostTimeNs += ctx->metricsHostTime;
+}
+
+void SysMetricsResponseReceived(_TSS2_SYS_CONTEXT_BLOB *ctx, size_t size)
+{
+    TSS2_SYS_METRICS *metrics = ctx->metrics;
+    TSS2_SYS_COMMAND_METRICS *entry;
+    TPM2_RC rc = ctx->rsp_header.responseCode;
+    uint64_t now = SysMetricsNow();
+    uint64_t tpmTime = now - ctx->metricsSendTime;
+
+    entry = SysMetricsLookup(metrics, ctx->commandCode, false);
+    if (entry) {
+        entry->count++;
+        entry->bytesReceived += size;
+        entry->tpmTimeNs += tpmTime;
+        entry->histogram[SysMetricsBucket(
+            (ctx->metricsHostTime + tpmTime) / 1000)]++;
+
+        if (rc == TPM2_RC_RETRY || rc == TPM2_RC_TESTING)
+            entry->retries++;
+        else if (rc == TPM2_RC_YIELDED)
+            entry->yielded++;
+        else if (rc != TPM2_RC_SUCCESS)
+            entry->errors++;
+    }
+
+    if (metrics->dumpInterval &&
+        now - metrics->lastDump >= metrics->dumpInterval) {
+        metrics->lastDump = now;
+        metrics->dumpCallback(metrics, metrics->dumpUserdata);
+    }
+}
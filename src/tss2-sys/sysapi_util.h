@@ -19,6 +19,25 @@ enum cmdStates {CMD_STAGE_INITIALIZE,
                 CMD_STAGE_RECEIVE_RESPONSE,
                 CMD_STAGE_ALL = 0xff };
 
+/* Maximum number of commands kept in flight by Tss2_Sys_ExecuteBatch. */
+#define SYS_BATCH_PIPELINE_DEPTH 16
+
+/* Number of command codes between TPM2_CC_FIRST and TPM2_CC_LAST. */
+#define SYS_METRICS_CC_COUNT (TPM2_CC_LAST - TPM2_CC_FIRST + 1)
+
+struct TSS2_SYS_METRICS {
+    /* Standard commands, indexed by commandCode - TPM2_CC_FIRST. */
+    TSS2_SYS_COMMAND_METRICS *commands[SYS_METRICS_CC_COUNT];
+    /* Vendor and unknown commands. */
+    TSS2_SYS_COMMAND_METRICS *other;
+    size_t otherCount;
+    size_t used;
+    uint64_t dumpInterval;  /* In ns, 0 if periodic dumps are disabled */
+    uint64_t lastDump;
+    TSS2_SYS_METRICS_DUMP_CB dumpCallback;
+    void *dumpUserdata;
+};
+
 #pragma pack(push, 1)
 typedef struct _TPM20_Header_In {
   TPM2_ST tag;
@@ -58,6 +77,12 @@ typedef struct {
 
     /* Offset to next data in command/response buffer. */
     size_t nextData;
+
+    /* Opt-in execution metrics, NULL if disabled. */
+    TSS2_SYS_METRICS *metrics;
+    uint64_t metricsPrepareTime;
+    uint64_t metricsHostTime;
+    uint64_t metricsSendTime;
 } _TSS2_SYS_CONTEXT_BLOB;
 
 static inline _TSS2_SYS_CONTEXT_BLOB *
@@ -78,6 +103,9 @@ req_header_from_cxt(_TSS2_SYS_CONTEXT_BLOB *ctx)
     return (TPM20_Header_In *)ctx->cmdBuffer;
 }
 
+/* Capacity of the buffer member of a TPM2B type. */
+#define TPM2B_BUFFER_SIZE(type) sizeof(((type *)NULL)->buffer)
+
 typedef struct {
     TPM2_CC commandCode;
     int numCommandHandles;
@@ -94,6 +122,11 @@ void InitSysContextFields(_TSS2_SYS_CONTEXT_BLOB *ctx);
 void InitSysContextPtrs(_TSS2_SYS_CONTEXT_BLOB *ctx, size_t contextSize);
 TSS2_RC CompleteChecks(_TSS2_SYS_CONTEXT_BLOB *ctx);
 TSS2_RC CommonComplete(_TSS2_SYS_CONTEXT_BLOB *ctx);
+TSS2_RC CommonCompleteView(
+    _TSS2_SYS_CONTEXT_BLOB *ctx,
+    size_t maxSize,
+    size_t *size,
+    const uint8_t **buffer);
 
 TSS2_RC CommonOneCall(
     _TSS2_SYS_CONTEXT_BLOB *ctx,
@@ -105,6 +138,14 @@ TSS2_RC CommonPreparePrologue(
     TPM2_CC commandCode);
 
 TSS2_RC CommonPrepareEpilogue(_TSS2_SYS_CONTEXT_BLOB *ctx);
+uint64_t SysMetricsNow(void);
+size_t SysMetricsBucket(uint64_t latencyUs);
+TSS2_SYS_COMMAND_METRICS *SysMetricsLookup(
+    TSS2_SYS_METRICS *metrics,
+    TPM2_CC commandCode,
+    bool create);
+void SysMetricsCommandSent(_TSS2_SYS_CONTEXT_BLOB *ctx, UINT32 size);
+void SysMetricsResponseReceived(_TSS2_SYS_CONTEXT_BLOB *ctx, size_t size);
 bool IsAlgorithmWeak(TPM2_ALG_ID algorith, TPM2_KEY_SIZE key_size);
 TSS2_RC ValidatePublicTemplate(const TPM2B_PUBLIC *pub);
 TSS2_RC ValidateNV_Public(const TPM2B_NV_PUBLIC *nv_public_info);
@@ -576,9 +576,12 @@ void tcti_cmd_init_context_data (TSS2_TCTI_COMMON_CONTEXT *tcti_common)
     TSS2_TCTI_FINALIZE (tcti_common) = tcti_cmd_finalize;
     TSS2_TCTI_GET_POLL_HANDLES (tcti_common) = tcti_cmd_get_poll_handles;
     TSS2_TCTI_MAKE_STICKY (tcti_common) = tcti_make_sticky_not_implemented;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (tcti_common) = tcti_set_pipeline_depth_not_implemented;
     tcti_common->state = TCTI_STATE_TRANSMIT;
     tcti_common->locality = 0;
     memset (&tcti_common->header, 0, sizeof (tcti_common->header));
+    tcti_common->pipeline_depth = 1;
+    tcti_common->pending = 0;
 }
 
 /*
@@ -33,7 +33,7 @@ tcti_common_context_cast (TSS2_TCTI_CONTEXT *ctx)
 TSS2_TCTI_CONTEXT*
 tcti_common_down_cast (TSS2_TCTI_COMMON_CONTEXT *ctx)
 {
-    return (TSS2_TCTI_CONTEXT*)&ctx->v2;
+    return (TSS2_TCTI_CONTEXT*)&ctx->v3;
 }
 
 TSS2_RC
@@ -49,7 +49,8 @@ tcti_common_cancel_checks (
         return TSS2_TCTI_RC_BAD_CONTEXT;
     }
 
-    if (tcti_common->state != TCTI_STATE_RECEIVE) {
+    if (tcti_common->state != TCTI_STATE_RECEIVE ||
+        tcti_common->pending > 1) {
         return TSS2_TCTI_RC_BAD_SEQUENCE;
     }
     return TSS2_RC_SUCCESS;
@@ -69,6 +70,12 @@ tcti_common_transmit_checks (
         return TSS2_TCTI_RC_BAD_CONTEXT;
     }
 
+    if (tcti_common->state == TCTI_STATE_RECEIVE &&
+        tcti_common->pending != 0 &&
+        tcti_common->pending < tcti_common->pipeline_depth) {
+        return TSS2_RC_SUCCESS;
+    }
+
     if (tcti_common->state != TCTI_STATE_TRANSMIT) {
         return TSS2_TCTI_RC_BAD_SEQUENCE;
     }
@@ -116,6 +123,53 @@ tcti_common_set_locality_checks (
     return TSS2_RC_SUCCESS;
 }
 
+TSS2_RC
+tcti_common_set_pipeline_depth_checks (
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common,
+    size_t depth,
+    uint64_t magic)
+{
+    if (tcti_common == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+
+    if (TSS2_TCTI_MAGIC(tcti_common) != magic) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+
+    if (depth == 0 || depth > TCTI_PIPELINE_DEPTH_MAX) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    if (tcti_common->state != TCTI_STATE_TRANSMIT) {
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+void
+tcti_common_transmit_done (
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common)
+{
+    tcti_common->pending += 1;
+    tcti_common->state = TCTI_STATE_RECEIVE;
+}
+
+void
+tcti_common_receive_done (
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common,
+    TSS2_RC rc)
+{
+    tcti_common->header.size = 0;
+    if (rc == TSS2_RC_SUCCESS && tcti_common->pending > 1) {
+        tcti_common->pending -= 1;
+        tcti_common->state = TCTI_STATE_RECEIVE;
+    } else {
+        tcti_common->pending = 0;
+        tcti_common->state = TCTI_STATE_TRANSMIT;
+    }
+}
+
 TSS2_RC
 tcti_make_sticky_not_implemented (
     TSS2_TCTI_CONTEXT *tctiContext,
@@ -128,6 +182,16 @@ tcti_make_sticky_not_implemented (
     return TSS2_TCTI_RC_NOT_IMPLEMENTED;
 }
 
+TSS2_RC
+tcti_set_pipeline_depth_not_implemented (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth)
+{
+    UNUSED(tctiContext);
+    UNUSED(depth);
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
 TSS2_RC
 header_unmarshal (
     const uint8_t *buf,
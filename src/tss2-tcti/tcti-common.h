@@ -11,7 +11,14 @@
 
 #include "tss2_tcti.h"
 
-#define TCTI_VERSION 0x2
+#define TCTI_VERSION 0x3
+
+/*
+ * Upper bound for the pipeline depth. All commands of a pipeline are written
+ * before any response is read, so this also bounds the amount of data that
+ * has to fit into the socket buffers.
+ */
+#define TCTI_PIPELINE_DEPTH_MAX 16
 
 #define TPM_HEADER_SIZE (sizeof (TPM2_ST) + sizeof (UINT32) + sizeof (UINT32))
 
@@ -45,6 +52,17 @@ typedef struct {
  *     setLocality: produces TSS2_TCTI_RC_BAD_SEQUENCE
  *   FINAL:
  *     all function calls produce TSS2_TCTI_RC_BAD_SEQUENCE
+ *
+ * A TCTI supporting pipelining relaxes this for a pipeline depth > 1, which
+ * is set by setPipelineDepth while in the TRANSMIT state:
+ *   RECEIVE:
+ *     transmit:    allowed while fewer than 'pipeline_depth' responses are
+ *                  pending, success leaves the state machine in RECEIVE
+ *     receive:     success transitions the state machine to TRANSMIT once
+ *                  no response is pending anymore
+ *                  unrecoverable failures drop all pending responses
+ *     cancel:      produces TSS2_TCTI_RC_BAD_SEQUENCE if more than one
+ *                  response is pending
  */
 typedef enum {
     TCTI_STATE_FINAL,
@@ -53,12 +71,14 @@ typedef enum {
 } tcti_state_t;
 
 typedef struct {
-    TSS2_TCTI_CONTEXT_COMMON_V2 v2;
+    TSS2_TCTI_CONTEXT_COMMON_V3 v3;
     tcti_state_t state;
     tpm_header_t header;
     uint8_t locality;
     bool partial_read_supported;
     bool partial;
+    size_t pipeline_depth;
+    size_t pending;
 } TSS2_TCTI_COMMON_CONTEXT;
 
 /*
@@ -105,6 +125,27 @@ TSS2_RC
 tcti_common_set_locality_checks (
     TSS2_TCTI_COMMON_CONTEXT *tcti_common,
     uint64_t magic);
+/*
+ * This function performs checks on the common context structure and the
+ * depth passed to a TCTI 'set_pipeline_depth' function.
+ */
+TSS2_RC
+tcti_common_set_pipeline_depth_checks (
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common,
+    size_t depth,
+    uint64_t magic);
+/*
+ * These functions update the state machine after a command has been sent and
+ * after a response has been received (or receiving failed with 'rc') by a
+ * TCTI supporting pipelining.
+ */
+void
+tcti_common_transmit_done (
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common);
+void
+tcti_common_receive_done (
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common,
+    TSS2_RC rc);
 /*
  * Just a function with the right prototype that returns the not implemented
  * RC for the TCTI layer.
@@ -114,6 +155,10 @@ tcti_make_sticky_not_implemented (
     TSS2_TCTI_CONTEXT *tctiContext,
     TPM2_HANDLE *handle,
     uint8_t sticky);
+TSS2_RC
+tcti_set_pipeline_depth_not_implemented (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth);
 /*
  * Utility to function to parse the first 10 bytes of a buffer and populate
  * the 'header' structure with the results. The provided buffer is assumed to
@@ -0,0 +1,385 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright 2026, agent
+ * All rights reserved.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "tss2_tcti.h"
+#include "tcti-common.h"
+#include "tcti-device.h"
+#include "tcti-device-uring.h"
+#include "util/io.h"
+#define LOGMODULE tcti
+#include "util/log.h"
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup)
+
+/* Room for the linked write and read of 128 contexts. */
+#define URING_ENTRIES 256
+
+/* The low bit of the user data tells the read from the write of a context. */
+#define URING_OP_WRITE 0
+#define URING_OP_READ 1
+
+typedef struct {
+    int fd;
+    unsigned int users;
+    /* submission queue */
+    void *sq_ring;
+    size_t sq_ring_size;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_entries;
+    unsigned int *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    /* completion queue, shares the mapping of the submission queue with
+     * IORING_FEAT_SINGLE_MMAP */
+    void *cq_ring;
+    size_t cq_ring_size;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+} device_uring_t;
+
+static device_uring_t uring = { .fd = -1 };
+
+static void
+device_uring_unmap (void)
+{
+    if (uring.sqes != NULL && uring.sqes != MAP_FAILED) {
+        munmap (uring.sqes, uring.sqes_size);
+    }
+    if (uring.cq_ring != NULL && uring.cq_ring != MAP_FAILED &&
+        uring.cq_ring != uring.sq_ring) {
+        munmap (uring.cq_ring, uring.cq_ring_size);
+    }
+    if (uring.sq_ring != NULL && uring.sq_ring != MAP_FAILED) {
+        munmap (uring.sq_ring, uring.sq_ring_size);
+    }
+    if (uring.fd >= 0) {
+        close (uring.fd);
+    }
+    memset (&uring, 0, sizeof (uring));
+    uring.fd = -1;
+}
+
+static TSS2_RC
+device_uring_setup (void)
+{
+    struct io_uring_params params;
+    uint8_t *sq, *cq;
+
+    memset (&params, 0, sizeof (params));
+    uring.fd = syscall (__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (uring.fd < 0) {
+        LOG_ERROR ("Failed to set up io_uring, errno %d: %s",
+                   errno, strerror (errno));
+        uring.fd = -1;
+        return TSS2_TCTI_RC_NOT_SUPPORTED;
+    }
+
+    uring.sq_ring_size = params.sq_off.array +
+                         params.sq_entries * sizeof (unsigned int);
+    uring.cq_ring_size = params.cq_off.cqes +
+                         params.cq_entries * sizeof (struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (uring.cq_ring_size > uring.sq_ring_size) {
+            uring.sq_ring_size = uring.cq_ring_size;
+        }
+        uring.cq_ring_size = uring.sq_ring_size;
+    }
+    uring.sq_ring = mmap (NULL, uring.sq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, uring.fd,
+                          IORING_OFF_SQ_RING);
+    if (uring.sq_ring == MAP_FAILED) {
+        goto fail;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        uring.cq_ring = uring.sq_ring;
+    } else {
+        uring.cq_ring = mmap (NULL, uring.cq_ring_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, uring.fd,
+                              IORING_OFF_CQ_RING);
+        if (uring.cq_ring == MAP_FAILED) {
+            goto fail;
+        }
+    }
+    uring.sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+    uring.sqes = mmap (NULL, uring.sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQES);
+    if (uring.sqes == MAP_FAILED) {
+        goto fail;
+    }
+
+    sq = uring.sq_ring;
+    uring.sq_head = (unsigned int *)(sq + params.sq_off.head);
+    uring.sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    uring.sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+    uring.sq_entries = (unsigned int *)(sq + params.sq_off.ring_entries);
+    uring.sq_array = (unsigned int *)(sq + params.sq_off.array);
+    cq = uring.cq_ring;
+    uring.cq_head = (unsigned int *)(cq + params.cq_off.head);
+    uring.cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    uring.cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+    uring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    LOG_DEBUG ("Set up io_uring fd %d with %" PRIu32 " entries", uring.fd,
+               params.sq_entries);
+    return TSS2_RC_SUCCESS;
+
+fail:
+    LOG_ERROR ("Failed to map io_uring, errno %d: %s", errno, strerror (errno));
+    device_uring_unmap ();
+    return TSS2_TCTI_RC_IO_ERROR;
+}
+
+TSS2_RC
+device_uring_acquire (void)
+{
+    TSS2_RC rc;
+
+    if (uring.users == 0) {
+        rc = device_uring_setup ();
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
+    }
+    uring.users++;
+    return TSS2_RC_SUCCESS;
+}
+
+void
+device_uring_release (void)
+{
+    if (uring.users == 0) {
+        return;
+    }
+    if (--uring.users == 0) {
+        device_uring_unmap ();
+    }
+}
+
+int
+device_uring_fd (void)
+{
+    return uring.fd;
+}
+
+static int
+device_uring_enter (
+    unsigned int to_submit,
+    unsigned int flags)
+{
+    int ret;
+
+    TEMP_RETRY (ret, syscall (__NR_io_uring_enter, uring.fd, to_submit, 0,
+                              flags, NULL, 0));
+    return ret;
+}
+
+static void
+device_uring_prep (
+    struct io_uring_sqe *sqe,
+    uint8_t opcode,
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
+    size_t size,
+    uint64_t op)
+{
+    memset (sqe, 0, sizeof (*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = tcti_dev->fd;
+    sqe->off = (uint64_t)-1;
+    sqe->addr = (uintptr_t)tcti_dev->rsp_buf;
+    sqe->len = size;
+    sqe->user_data = (uintptr_t)tcti_dev | op;
+}
+
+TSS2_RC
+device_uring_submit (
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
+    size_t command_size)
+{
+    unsigned int head, tail, mask, index;
+    struct io_uring_sqe *sqe;
+    int ret;
+
+    head = __atomic_load_n (uring.sq_head, __ATOMIC_ACQUIRE);
+    tail = *uring.sq_tail;
+    mask = *uring.sq_mask;
+    if (*uring.sq_entries - (tail - head) < 2) {
+        LOG_ERROR ("io_uring submission queue is full");
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+
+    /*
+     * The response is read into the buffer holding the command. The read is
+     * linked to the write, so it isn't started before the write completed.
+     */
+    index = tail & mask;
+    sqe = &uring.sqes[index];
+    device_uring_prep (sqe, IORING_OP_WRITE, tcti_dev, command_size,
+                       URING_OP_WRITE);
+    sqe->flags = IOSQE_IO_LINK;
+    uring.sq_array[index] = index;
+    index = (tail + 1) & mask;
+    sqe = &uring.sqes[index];
+    device_uring_prep (sqe, IORING_OP_READ, tcti_dev,
+                       sizeof (tcti_dev->rsp_buf), URING_OP_READ);
+    uring.sq_array[index] = index;
+    __atomic_store_n (uring.sq_tail, tail + 2, __ATOMIC_RELEASE);
+
+    ret = device_uring_enter (2, 0);
+    if (ret < 0) {
+        LOG_ERROR ("Failed to submit to io_uring, errno %d: %s",
+                   errno, strerror (errno));
+        ret = 0;
+    }
+    tcti_dev->uring_inflight += ret;
+    if (ret != 2) {
+        /* withdraw what the kernel didn't take */
+        __atomic_store_n (uring.sq_tail, tail + ret, __ATOMIC_RELEASE);
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+    tcti_dev->uring_res = 0;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Hand the completions in the queue to their contexts. Returns the number of
+ * completions reaped.
+ */
+static unsigned int
+device_uring_reap (void)
+{
+    unsigned int head, tail, count = 0;
+    struct io_uring_cqe *cqe;
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev;
+
+    head = *uring.cq_head;
+    tail = __atomic_load_n (uring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++, count++) {
+        cqe = &uring.cqes[head & *uring.cq_mask];
+        tcti_dev = (TSS2_TCTI_DEVICE_CONTEXT *)(uintptr_t)
+                   (cqe->user_data & ~(uint64_t)URING_OP_READ);
+        if (cqe->user_data & URING_OP_READ) {
+            tcti_dev->uring_res = cqe->res;
+        } else if (cqe->res < 0) {
+            LOG_ERROR ("Failed to write command to fd %d: %s",
+                       tcti_dev->fd, strerror (-cqe->res));
+        }
+        tcti_dev->uring_inflight--;
+    }
+    __atomic_store_n (uring.cq_head, head, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+static int32_t
+remaining_ms (
+    const struct timespec *start,
+    int32_t timeout)
+{
+    struct timespec now;
+    int64_t elapsed;
+
+    if (timeout < 0) {
+        return timeout;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - start->tv_sec) * 1000 +
+              (now.tv_nsec - start->tv_nsec) / 1000000;
+    return elapsed >= timeout ? 0 : timeout - elapsed;
+}
+
+TSS2_RC
+device_uring_wait (
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
+    int32_t timeout)
+{
+    struct pollfd fds = { .fd = uring.fd, .events = POLLIN };
+    struct timespec start;
+    int rc_poll;
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    device_uring_reap ();
+    while (tcti_dev->uring_inflight > 0) {
+        TEMP_RETRY (rc_poll, poll (&fds, 1, remaining_ms (&start, timeout)));
+        if (rc_poll < 0) {
+            LOG_ERROR ("Failed to poll io_uring fd %d, got errno %d: %s",
+                       uring.fd, errno, strerror (errno));
+            return TSS2_TCTI_RC_IO_ERROR;
+        } else if (rc_poll == 0) {
+            LOG_INFO ("Poll timed out on io_uring fd %d.", uring.fd);
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        }
+        if (device_uring_reap () == 0) {
+            /* flush completions the kernel held back on overflow */
+            device_uring_enter (0, IORING_ENTER_GETEVENTS);
+            device_uring_reap ();
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+#else /* HAVE_LINUX_IO_URING_H */
+
+TSS2_RC
+device_uring_acquire (void)
+{
+    LOG_ERROR ("io_uring support not available");
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+void
+device_uring_release (void)
+{
+}
+
+int
+device_uring_fd (void)
+{
+    return -1;
+}
+
+TSS2_RC
+device_uring_submit (
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
+    size_t command_size)
+{
+    UNUSED(tcti_dev);
+    UNUSED(command_size);
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC
+device_uring_wait (
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
+    int32_t timeout)
+{
+    UNUSED(tcti_dev);
+    UNUSED(timeout);
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright 2026, agent
+ * All rights reserved.
+ */
+#ifndef TCTI_DEVICE_URING_H
+#define TCTI_DEVICE_URING_H
+
+#include <stdint.h>
+
+#include "tcti-device.h"
+
+/*
+ * io_uring backend of the device TCTI. All contexts with the 'uring' option
+ * share a single ring, so the completions for all of them can be waited for
+ * on a single file descriptor. The ring is process wide and not synchronized:
+ * all contexts using it must be driven from the same thread.
+ */
+
+/*
+ * Take a reference on the shared ring, setting it up on first use.
+ */
+TSS2_RC
+device_uring_acquire (void);
+/*
+ * Drop a reference on the shared ring, tearing it down with the last one.
+ */
+void
+device_uring_release (void);
+/*
+ * File descriptor of the shared ring. It becomes readable when any of the
+ * submitted operations completes.
+ */
+int
+device_uring_fd (void);
+/*
+ * Submit writing the 'command_size' bytes of the command in the response
+ * buffer of 'tcti_dev' to its device, linked with reading the response into
+ * the same buffer.
+ */
+TSS2_RC
+device_uring_submit (
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
+    size_t command_size);
+/*
+ * Reap the completions of all contexts on the ring until the operations of
+ * 'tcti_dev' are done or 'timeout' expires. The result of the read is left
+ * in 'tcti_dev->uring_res'.
+ */
+TSS2_RC
+device_uring_wait (
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
+    int32_t timeout);
+
+#endif /* TCTI_DEVICE_URING_H */
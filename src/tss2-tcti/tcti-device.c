@@ -52,7 +52,9 @@
 #include "tss2_mu.h"
 #include "tcti-common.h"
 #include "tcti-device.h"
+#include "tcti-device-uring.h"
 #include "util/io.h"
+#include "util/key-value-parse.h"
 #define LOGMODULE tcti
 #include "util/log.h"
 
@@ -115,6 +117,20 @@ tcti_device_transmit (
                    command_size,
                    "sending %zu byte command buffer:",
                    command_size);
+    if (tcti_dev->uring) {
+        if (command_size > sizeof (tcti_dev->rsp_buf)) {
+            LOG_ERROR ("Command of %zu bytes exceeds the maximum of %zu.",
+                       command_size, sizeof (tcti_dev->rsp_buf));
+            return TSS2_TCTI_RC_BAD_VALUE;
+        }
+        memcpy (tcti_dev->rsp_buf, command_buffer, command_size);
+        rc = device_uring_submit (tcti_dev, command_size);
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
+        tcti_common->state = TCTI_STATE_RECEIVE;
+        return TSS2_RC_SUCCESS;
+    }
     size = write_all (tcti_dev->fd,
                       command_buffer,
                       command_size);
@@ -148,6 +164,11 @@ tcti_device_transmit (
  * buffer we print a warning. This allows "expert applications" to
  * precalculate the required response buffer size for whatever commands they
  * may send.
+ *
+ * If the kernel supports partial reads, a size query reads the whole response
+ * into the context with a single read and returns its size. The following
+ * call with a buffer is served from the context without touching the device,
+ * so a response costs one poll and one read either way.
  */
 TSS2_RC
 tcti_device_receive (
@@ -162,7 +183,6 @@ tcti_device_receive (
     ssize_t size = 0;
     struct pollfd fds;
     int rc_poll, nfds = 1;
-    uint8_t header[TPM_HEADER_SIZE];
     size_t offset = 2;
     UINT32 partial_size;
 
@@ -173,14 +193,43 @@ tcti_device_receive (
         return rc;
     }
 
+    /*
+     * With io_uring the response is read into the context by the kernel.
+     * Once it is there it is handed out like one read by a size query.
+     */
+    if (tcti_dev->uring && !tcti_common->partial) {
+        rc = device_uring_wait (tcti_dev, timeout);
+        if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+            return rc;
+        } else if (rc != TSS2_RC_SUCCESS) {
+            goto out;
+        }
+        if (tcti_dev->uring_res == 0) {
+            LOG_WARNING ("Got EOF instead of response.");
+            rc = TSS2_TCTI_RC_NO_CONNECTION;
+            goto out;
+        } else if (tcti_dev->uring_res < 0) {
+            LOG_ERROR ("Failed to read response from fd %d: %s",
+                       tcti_dev->fd, strerror (-tcti_dev->uring_res));
+            rc = TSS2_TCTI_RC_IO_ERROR;
+            goto out;
+        }
+        tcti_dev->rsp_size = tcti_dev->uring_res;
+        tcti_common->partial = true;
+    }
+
     if (!response_buffer) {
-        if (!tcti_common->partial_read_supported) {
+        if (tcti_common->partial) {
+            /* Response already read by a previous size query */
+            *response_size = tcti_dev->rsp_size;
+            return TSS2_RC_SUCCESS;
+        } else if (!tcti_common->partial_read_supported) {
             LOG_DEBUG("Partial read not supported ");
             *response_size = 4096;
             return TSS2_RC_SUCCESS;
         } else {
-            /* Read the header only and get the response size out of it */
-            LOG_DEBUG("Partial read - reading response size");
+            /* Read the whole response and get the response size out of it */
+            LOG_DEBUG("Partial read - reading response");
             fds.fd = tcti_dev->fd;
             fds.events = POLLIN;
 
@@ -193,15 +242,16 @@ tcti_device_receive (
                 LOG_INFO ("Poll timed out on fd %d.", tcti_dev->fd);
                 return TSS2_TCTI_RC_TRY_AGAIN;
             } else if (fds.revents == POLLIN) {
-                TEMP_RETRY (size, read (tcti_dev->fd, header, TPM_HEADER_SIZE));
-                if (size < 0 || size != TPM_HEADER_SIZE) {
+                TEMP_RETRY (size, read (tcti_dev->fd, tcti_dev->rsp_buf,
+                                        sizeof (tcti_dev->rsp_buf)));
+                if (size < 0 || (size_t)size < TPM_HEADER_SIZE) {
                     LOG_ERROR ("Failed to get response size fd %d, got errno %d: %s",
                            tcti_dev->fd, errno, strerror (errno));
                     return TSS2_TCTI_RC_IO_ERROR;
                 }
             }
-            LOG_DEBUG("Partial read - received header");
-            rc = Tss2_MU_UINT32_Unmarshal(header, TPM_HEADER_SIZE,
+            LOG_DEBUG("Partial read - received %zd bytes", size);
+            rc = Tss2_MU_UINT32_Unmarshal(tcti_dev->rsp_buf, TPM_HEADER_SIZE,
                                           &offset, &partial_size);
             if (rc != TSS2_RC_SUCCESS) {
                 LOG_ERROR ("Failed to unmarshal response size.");
@@ -215,64 +265,58 @@ tcti_device_receive (
 
             LOG_DEBUG("Partial read - received response size %d.", partial_size);
             tcti_common->partial = true;
-            *response_size = partial_size;
-            memcpy(&tcti_common->header, header, TPM_HEADER_SIZE);
+            tcti_dev->rsp_size = size;
+            *response_size = size;
             return rc;
         }
     }
 
-    /* In case when the whole response is just the 10 bytes header
-     * and we have read it already to get the size, we don't need
-     * to call poll and read again. Just copy what we have read
-     * and return.
-     */
-    if (tcti_common->partial == true && *response_size == TPM_HEADER_SIZE) {
-        memcpy(response_buffer, &tcti_common->header, TPM_HEADER_SIZE);
+    if (tcti_common->partial == true) {
+        /* The response was read by the size query, hand it out. */
+        if (*response_size < tcti_dev->rsp_size) {
+            LOG_ERROR ("Response size to big: %zu > %zu",
+                       tcti_dev->rsp_size, *response_size);
+            *response_size = tcti_dev->rsp_size;
+            return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+        }
+        memcpy (response_buffer, tcti_dev->rsp_buf, tcti_dev->rsp_size);
+        size = tcti_dev->rsp_size;
         tcti_common->partial = false;
-        goto out;
-    }
-
-    /*
-     * The older kernel driver will only return a response buffer in a single
-     * read operation. If we try to read again before sending another command
-     * the kernel will close the file descriptor and we'll get an EOF.
-     * Newer kernels should have partial reads enabled.
-     */
-    fds.fd = tcti_dev->fd;
-    fds.events = POLLIN;
-
-    rc_poll = poll(&fds, nfds, timeout);
-    if (rc_poll < 0) {
-        LOG_ERROR ("Failed to poll for response from fd %d, got errno %d: %s",
-                   tcti_dev->fd, errno, strerror (errno));
-        return TSS2_TCTI_RC_IO_ERROR;
-    } else if (rc_poll == 0) {
-        LOG_INFO ("Poll timed out on fd %d.", tcti_dev->fd);
-        return TSS2_TCTI_RC_TRY_AGAIN;
-    } else if (fds.revents == POLLIN) {
-        if (tcti_common->partial == true) {
-            memcpy(response_buffer, &tcti_common->header, TPM_HEADER_SIZE);
-            TEMP_RETRY (size, read (tcti_dev->fd, response_buffer +
-                        TPM_HEADER_SIZE, *response_size - TPM_HEADER_SIZE));
-        } else {
+    } else {
+        /*
+         * The older kernel driver will only return a response buffer in a
+         * single read operation. If we try to read again before sending
+         * another command the kernel will close the file descriptor and
+         * we'll get an EOF. Newer kernels should have partial reads enabled.
+         */
+        fds.fd = tcti_dev->fd;
+        fds.events = POLLIN;
+
+        rc_poll = poll(&fds, nfds, timeout);
+        if (rc_poll < 0) {
+            LOG_ERROR ("Failed to poll for response from fd %d, got errno %d: %s",
+                       tcti_dev->fd, errno, strerror (errno));
+            return TSS2_TCTI_RC_IO_ERROR;
+        } else if (rc_poll == 0) {
+            LOG_INFO ("Poll timed out on fd %d.", tcti_dev->fd);
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        } else if (fds.revents == POLLIN) {
             TEMP_RETRY (size, read (tcti_dev->fd, response_buffer,
                                     *response_size));
+            if (size < 0) {
+                LOG_ERROR ("Failed to read response from fd %d, got errno %d: %s",
+                   tcti_dev->fd, errno, strerror (errno));
+                return TSS2_TCTI_RC_IO_ERROR;
+            }
         }
-        if (size < 0) {
-            LOG_ERROR ("Failed to read response from fd %d, got errno %d: %s",
-               tcti_dev->fd, errno, strerror (errno));
-            return TSS2_TCTI_RC_IO_ERROR;
+        if (size == 0) {
+            LOG_WARNING ("Got EOF instead of response.");
+            rc = TSS2_TCTI_RC_NO_CONNECTION;
+            goto out;
         }
     }
-    if (size == 0) {
-        LOG_WARNING ("Got EOF instead of response.");
-        rc = TSS2_TCTI_RC_NO_CONNECTION;
-        goto out;
-    }
 
-    size += tcti_common->partial ? TPM_HEADER_SIZE : 0;
     LOGBLOB_DEBUG(response_buffer, size, "Response Received");
-    tcti_common->partial = false;
 
     if ((size_t)size < TPM_HEADER_SIZE) {
         LOG_ERROR ("Received %zu bytes, not enough to hold a TPM2 response "
@@ -319,6 +363,14 @@ tcti_device_finalize (
     if (tcti_dev == NULL) {
         return;
     }
+    if (tcti_dev->uring) {
+        /* the kernel still references the context while I/O is in flight */
+        if (tcti_dev->uring_inflight > 0) {
+            device_uring_wait (tcti_dev, TSS2_TCTI_TIMEOUT_BLOCK);
+        }
+        device_uring_release ();
+        tcti_dev->uring = false;
+    }
     close (tcti_dev->fd);
     tcti_common->state = TCTI_STATE_FINAL;
 }
@@ -349,7 +401,11 @@ tcti_device_get_poll_handles (
     }
 
     *num_handles = 1;
-    if (handles != NULL) {
+    if (handles != NULL && tcti_dev->uring) {
+        /* shared by all contexts using io_uring */
+        handles->fd = device_uring_fd ();
+        handles->events = POLLIN;
+    } else if (handles != NULL) {
         handles->fd = tcti_dev->fd;
         handles->events = POLLIN | POLLOUT;
     }
@@ -380,39 +436,17 @@ static int open_tpm (
 #endif
 }
 
-TSS2_RC
-Tss2_Tcti_Device_Init (
-    TSS2_TCTI_CONTEXT *tctiContext,
-    size_t *size,
+/*
+ * Open the device node 'conf', or the first of the default ones that can be
+ * opened if NULL, and probe it for partial read support.
+ */
+static TSS2_RC
+device_open (
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev,
     const char *conf)
 {
-    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev;
-    TSS2_TCTI_COMMON_CONTEXT *tcti_common;
-    char *used_conf = NULL;
-
-    if (tctiContext == NULL && size == NULL) {
-        return TSS2_TCTI_RC_BAD_VALUE;
-    } else if (tctiContext == NULL) {
-        *size = sizeof (TSS2_TCTI_DEVICE_CONTEXT);
-        return TSS2_RC_SUCCESS;
-    }
-
-    /* Init TCTI context */
-    TSS2_TCTI_MAGIC (tctiContext) = TCTI_DEVICE_MAGIC;
-    TSS2_TCTI_VERSION (tctiContext) = TCTI_VERSION;
-    TSS2_TCTI_TRANSMIT (tctiContext) = tcti_device_transmit;
-    TSS2_TCTI_RECEIVE (tctiContext) = tcti_device_receive;
-    TSS2_TCTI_FINALIZE (tctiContext) = tcti_device_finalize;
-    TSS2_TCTI_CANCEL (tctiContext) = tcti_device_cancel;
-    TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = tcti_device_get_poll_handles;
-    TSS2_TCTI_SET_LOCALITY (tctiContext) = tcti_device_set_locality;
-    TSS2_TCTI_MAKE_STICKY (tctiContext) = tcti_make_sticky_not_implemented;
-    tcti_dev = tcti_device_context_cast (tctiContext);
-    tcti_common = tcti_device_down_cast (tcti_dev);
-    tcti_common->state = TCTI_STATE_TRANSMIT;
-    memset (&tcti_common->header, 0, sizeof (tcti_common->header));
-    tcti_common->locality = 3;
-    tcti_common->partial = false;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_device_down_cast (tcti_dev);
+    const char *used_conf = NULL;
 
     if (conf == NULL) {
         LOG_TRACE ("No TCTI device file specified");
@@ -445,7 +479,7 @@ Tss2_Tcti_Device_Init (
         } else {
             LOG_TRACE ("Successfully opened specified TCTI device file %s", conf);
         }
-        used_conf = (char *)conf;
+        used_conf = conf;
     }
     /* probe if the device support partial response read */
     LOG_DEBUG ("Probe device for partial response read support");
@@ -513,12 +547,120 @@ Tss2_Tcti_Device_Init (
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * This function is a callback conforming to the KeyValueFunc prototype. It
+ * is called by the key-value-parse module for each key / value pair extracted
+ * from the configuration string.
+ */
+static TSS2_RC
+device_kv_callback (const key_value_t *key_value,
+                    void *user_data)
+{
+    device_conf_t *device_conf = (device_conf_t*)user_data;
+
+    if (key_value == NULL || user_data == NULL) {
+        LOG_WARNING ("%s passed NULL parameter", __func__);
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    LOG_DEBUG ("key: %s / value: %s\n", key_value->key, key_value->value);
+    if (strcmp (key_value->key, "path") == 0) {
+        device_conf->path = key_value->value;
+        return TSS2_RC_SUCCESS;
+    } else if (strcmp (key_value->key, "uring") == 0) {
+        if (strcmp (key_value->value, "1") == 0) {
+            device_conf->uring = true;
+        } else if (strcmp (key_value->value, "0") == 0) {
+            device_conf->uring = false;
+        } else {
+            return TSS2_TCTI_RC_BAD_VALUE;
+        }
+        return TSS2_RC_SUCCESS;
+    } else {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+}
+
+TSS2_RC
+Tss2_Tcti_Device_Init (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *size,
+    const char *conf)
+{
+    TSS2_TCTI_DEVICE_CONTEXT *tcti_dev;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common;
+    device_conf_t device_conf = { .path = NULL, .uring = false };
+    char *conf_copy = NULL;
+    TSS2_RC rc;
+
+    if (tctiContext == NULL && size == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    } else if (tctiContext == NULL) {
+        *size = sizeof (TSS2_TCTI_DEVICE_CONTEXT);
+        return TSS2_RC_SUCCESS;
+    }
+
+    /* Init TCTI context */
+    TSS2_TCTI_MAGIC (tctiContext) = TCTI_DEVICE_MAGIC;
+    TSS2_TCTI_VERSION (tctiContext) = TCTI_VERSION;
+    TSS2_TCTI_TRANSMIT (tctiContext) = tcti_device_transmit;
+    TSS2_TCTI_RECEIVE (tctiContext) = tcti_device_receive;
+    TSS2_TCTI_FINALIZE (tctiContext) = tcti_device_finalize;
+    TSS2_TCTI_CANCEL (tctiContext) = tcti_device_cancel;
+    TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = tcti_device_get_poll_handles;
+    TSS2_TCTI_SET_LOCALITY (tctiContext) = tcti_device_set_locality;
+    TSS2_TCTI_MAKE_STICKY (tctiContext) = tcti_make_sticky_not_implemented;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (tctiContext) = tcti_set_pipeline_depth_not_implemented;
+    tcti_dev = tcti_device_context_cast (tctiContext);
+    tcti_common = tcti_device_down_cast (tcti_dev);
+    tcti_common->state = TCTI_STATE_TRANSMIT;
+    memset (&tcti_common->header, 0, sizeof (tcti_common->header));
+    tcti_common->pipeline_depth = 1;
+    tcti_common->pending = 0;
+    tcti_common->locality = 3;
+    tcti_common->partial = false;
+
+    tcti_dev->uring = false;
+    tcti_dev->uring_inflight = 0;
+
+    /* a plain path or key / value pairs */
+    if (conf != NULL && strchr (conf, '=') != NULL) {
+        conf_copy = strdup (conf);
+        if (conf_copy == NULL) {
+            LOG_ERROR ("Failed to allocate memory: %s", strerror (errno));
+            return TSS2_TCTI_RC_MEMORY;
+        }
+        rc = parse_key_value_string (conf_copy,
+                                     device_kv_callback,
+                                     &device_conf);
+        if (rc != TSS2_RC_SUCCESS) {
+            goto out;
+        }
+    } else {
+        device_conf.path = conf;
+    }
+
+    rc = device_open (tcti_dev, device_conf.path);
+    if (rc == TSS2_RC_SUCCESS && device_conf.uring) {
+        rc = device_uring_acquire ();
+        if (rc != TSS2_RC_SUCCESS) {
+            close (tcti_dev->fd);
+            goto out;
+        }
+        tcti_dev->uring = true;
+    }
+
+out:
+    free (conf_copy);
+    return rc;
+}
+
 const TSS2_TCTI_INFO tss2_tcti_info = {
     .version = TCTI_VERSION,
     .name = "tcti-device",
     .description = "TCTI module for communication with Linux kernel interface.",
-    .config_help = "Path to TPM character device. Default value is: "
-        "TCTI_DEVICE_DEFAULT",
+    .config_help = "Path to TPM character device, or key / value pairs: "
+        "path=<device>,uring=<0|1> to submit the I/O through io_uring. "
+        "Default value is: TCTI_DEVICE_DEFAULT",
     .init = Tss2_Tcti_Device_Init,
 };
 
@@ -10,9 +10,20 @@
 
 #define TCTI_DEVICE_MAGIC 0x89205e72e319e5bbULL
 
+typedef struct {
+    const char *path;   /* device node, NULL for the default ones */
+    bool uring;         /* use the io_uring backend */
+} device_conf_t;
+
 typedef struct {
     TSS2_TCTI_COMMON_CONTEXT common;
     int fd;
+    /* response read ahead by a size query when partial reads are enabled */
+    uint8_t rsp_buf[TPM2_MAX_RESPONSE_SIZE];
+    size_t rsp_size;
+    bool uring;
+    unsigned int uring_inflight; /* submitted operations not yet completed */
+    int32_t uring_res;           /* result of the response read */
 } TSS2_TCTI_DEVICE_CONTEXT;
 
 #endif /* TCTI_DEVICE_H */
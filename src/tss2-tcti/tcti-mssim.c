@@ -8,8 +8,10 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +56,23 @@ tcti_mssim_down_cast (TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim)
     }
     return &tcti_mssim->common;
 }
+
+/*
+ * Connect to the UNIX socket 'path' if one is configured, else to 'host' /
+ * 'port' over TCP.
+ */
+static TSS2_RC
+mssim_socket_connect (
+    const char *path,
+    const char *host,
+    uint16_t port,
+    SOCKET *sock)
+{
+    if (path != NULL) {
+        return socket_connect_unix (path, sock);
+    }
+    return socket_connect (host, port, sock);
+}
 /*
  * This function is for sending one of the MS_SIM_* platform commands to the
  * Microsoft TPM2 simulator. These are sent over the platform socket.
@@ -149,19 +168,19 @@ send_sim_session_end (
  * the simulator will accept a TPM command buffer.
  */
 #define SIM_CMD_SIZE (sizeof (UINT32) + sizeof (UINT8) + sizeof (UINT32))
-TSS2_RC
-send_sim_cmd_setup (
+static TSS2_RC
+sim_cmd_setup_marshal (
     TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim,
-    UINT32 size)
+    UINT32 size,
+    uint8_t buf [SIM_CMD_SIZE])
 {
     TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_mssim_down_cast (tcti_mssim);
-    uint8_t buf [SIM_CMD_SIZE] = { 0 };
     size_t offset = 0;
     TSS2_RC rc;
 
     rc = Tss2_MU_UINT32_Marshal (MS_SIM_TPM_SEND_COMMAND,
                                  buf,
-                                 sizeof (buf),
+                                 SIM_CMD_SIZE,
                                  &offset);
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
@@ -169,13 +188,24 @@ send_sim_cmd_setup (
 
     rc = Tss2_MU_UINT8_Marshal (tcti_common->locality,
                                 buf,
-                                sizeof (buf),
+                                SIM_CMD_SIZE,
                                 &offset);
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
     }
 
-    rc = Tss2_MU_UINT32_Marshal (size, buf, sizeof (buf), &offset);
+    return Tss2_MU_UINT32_Marshal (size, buf, SIM_CMD_SIZE, &offset);
+}
+
+TSS2_RC
+send_sim_cmd_setup (
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim,
+    UINT32 size)
+{
+    uint8_t buf [SIM_CMD_SIZE] = { 0 };
+    TSS2_RC rc;
+
+    rc = sim_cmd_setup_marshal (tcti_mssim, size, buf);
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
     }
@@ -183,6 +213,52 @@ send_sim_cmd_setup (
     return socket_xmit_buf (tcti_mssim->tpm_sock, buf, sizeof (buf));
 }
 
+/*
+ * Send the simulator command setup followed by the TPM command buffer. Both
+ * are assembled into a single frame and sent with one write, so the setup
+ * isn't sent as a small segment of its own.
+ */
+static TSS2_RC
+mssim_send_command (
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim,
+    const uint8_t *cmd_buf,
+    size_t size)
+{
+    uint8_t frame [SIM_CMD_SIZE + TPM2_MAX_COMMAND_SIZE];
+    TSS2_RC rc;
+
+    if (size > TPM2_MAX_COMMAND_SIZE) {
+        rc = send_sim_cmd_setup (tcti_mssim, size);
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
+        return socket_xmit_buf (tcti_mssim->tpm_sock, cmd_buf, size);
+    }
+
+    rc = sim_cmd_setup_marshal (tcti_mssim, size, frame);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    memcpy (&frame [SIM_CMD_SIZE], cmd_buf, size);
+
+    return socket_xmit_buf (tcti_mssim->tpm_sock, frame, SIM_CMD_SIZE + size);
+}
+
+static TSS2_RC mssim_connect (TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim);
+
+/*
+ * Close both connections to the simulator and discard any buffered part of
+ * a response. A transmit on the closed context reconnects if configured.
+ */
+static void
+mssim_disconnect (
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim)
+{
+    socket_close (&tcti_mssim->tpm_sock);
+    socket_close (&tcti_mssim->platform_sock);
+    socket_rx_reset (&tcti_mssim->rx);
+}
+
 TSS2_RC
 tcti_mssim_transmit (
     TSS2_TCTI_CONTEXT *tcti_ctx,
@@ -192,6 +268,7 @@ tcti_mssim_transmit (
     TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim = tcti_mssim_context_cast (tcti_ctx);
     TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_mssim_down_cast (tcti_mssim);
     tpm_header_t header;
+    uint32_t attempt;
     TSS2_RC rc;
 
     rc = tcti_common_transmit_checks (tcti_common, cmd_buf, TCTI_MSSIM_MAGIC);
@@ -210,16 +287,36 @@ tcti_mssim_transmit (
 
     LOG_DEBUG ("Sending command with TPM_CC 0x%" PRIx32 " and size %" PRIu32,
                header.code, header.size);
-    rc = send_sim_cmd_setup (tcti_mssim, header.size);
-    if (rc != TSS2_RC_SUCCESS) {
-        return rc;
+    if (tcti_mssim->tpm_sock == INVALID_SOCKET) {
+        /* The connection was dropped by a failed receive. */
+        rc = TSS2_TCTI_RC_NO_CONNECTION;
+    } else {
+        rc = mssim_send_command (tcti_mssim, cmd_buf, size);
+    }
+    /*
+     * A connection that broke while idle (e.g. the simulator was restarted)
+     * is reestablished if configured. This is only safe while no response
+     * is outstanding on the old connection.
+     */
+    for (attempt = 0;
+         (rc == TSS2_TCTI_RC_IO_ERROR || rc == TSS2_TCTI_RC_NO_CONNECTION) &&
+         tcti_common->pending == 0 &&
+         attempt < tcti_mssim->mssim_conf.reconnect;
+         attempt++) {
+        LOG_WARNING ("Failed to send command, reconnecting (attempt %" PRIu32
+                     " of %" PRIu32 ").", attempt + 1,
+                     tcti_mssim->mssim_conf.reconnect);
+        mssim_disconnect (tcti_mssim);
+        rc = mssim_connect (tcti_mssim);
+        if (rc == TSS2_RC_SUCCESS) {
+            rc = mssim_send_command (tcti_mssim, cmd_buf, size);
+        }
     }
-    rc = socket_xmit_buf (tcti_mssim->tpm_sock, cmd_buf, size);
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
     }
 
-    tcti_common->state = TCTI_STATE_RECEIVE;
+    tcti_common_transmit_done (tcti_common);
 
     return rc;
 }
@@ -242,6 +339,7 @@ tcti_mssim_cancel (
     }
 
     tcti_common->state = TCTI_STATE_TRANSMIT;
+    tcti_common->pending = 0;
     tcti_mssim->cancel = 1;
 
     return rc;
@@ -294,6 +392,24 @@ tcti_mssim_get_poll_handles (
     return TSS2_RC_SUCCESS;
 }
 
+TSS2_RC
+tcti_mssim_set_pipeline_depth (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth)
+{
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim = tcti_mssim_context_cast (tctiContext);
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_mssim_down_cast (tcti_mssim);
+    TSS2_RC rc;
+
+    rc = tcti_common_set_pipeline_depth_checks (tcti_common, depth, TCTI_MSSIM_MAGIC);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    tcti_common->pipeline_depth = depth;
+    return TSS2_RC_SUCCESS;
+}
+
 void
 tcti_mssim_finalize(
     TSS2_TCTI_CONTEXT *tctiContext)
@@ -303,10 +419,52 @@ tcti_mssim_finalize(
     if (tcti_mssim == NULL) {
         return;
     }
-    send_sim_session_end (tcti_mssim->platform_sock);
-    send_sim_session_end (tcti_mssim->tpm_sock);
+    if (tcti_mssim->platform_sock != INVALID_SOCKET) {
+        send_sim_session_end (tcti_mssim->platform_sock);
+    }
+    if (tcti_mssim->tpm_sock != INVALID_SOCKET) {
+        send_sim_session_end (tcti_mssim->tpm_sock);
+    }
     socket_close (&tcti_mssim->platform_sock);
     socket_close (&tcti_mssim->tpm_sock);
+    free (tcti_mssim->conf_copy);
+    tcti_mssim->conf_copy = NULL;
+}
+
+/*
+ * Wait until at least 'size' bytes of the response are in the receive
+ * buffer. The socket is non-blocking: it is polled before the first read and
+ * again whenever a read finds no data, so parts of the response that arrive
+ * in separate segments are waited for instead of failing the receive.
+ */
+static TSS2_RC
+tcti_mssim_rx_wait (
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim,
+    size_t size,
+    int32_t timeout)
+{
+    bool poll = true;
+    TSS2_RC rc;
+
+    if (size > sizeof (tcti_mssim->rx.data)) {
+        LOG_ERROR ("Response of %zu bytes exceeds the receive buffer", size);
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+
+    while (socket_rx_buffered (&tcti_mssim->rx) < size) {
+        if (poll) {
+            rc = socket_poll (tcti_mssim->tpm_sock, timeout);
+            if (rc != TSS2_RC_SUCCESS) {
+                return rc;
+            }
+        }
+        rc = socket_rx_fill (tcti_mssim->tpm_sock, &tcti_mssim->rx);
+        poll = rc == TSS2_TCTI_RC_TRY_AGAIN;
+        if (rc != TSS2_RC_SUCCESS && !poll) {
+            return rc;
+        }
+    }
+    return TSS2_RC_SUCCESS;
 }
 
 TSS2_RC
@@ -324,7 +482,6 @@ tcti_mssim_receive (
     TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_mssim_down_cast (tcti_mssim);
     TSS2_RC rc;
     UINT32 trash;
-    int ret;
 
     rc = tcti_common_receive_checks (tcti_common,
                                      response_size,
@@ -346,23 +503,24 @@ tcti_mssim_receive (
 #endif /* TEST_FAPI_ASYNC */
     }
 
+    /*
+     * The size, the response and the trailing four bytes of 0's are taken
+     * from the receive buffer, which is filled with a single read of all
+     * available data. The socket is only read again for the parts that
+     * didn't arrive with that read.
+     */
     if (tcti_common->header.size == 0) {
         /* Receive the size of the response. */
         uint8_t size_buf [sizeof (UINT32)];
 
-        ret = socket_poll(tcti_mssim->tpm_sock, timeout);
-        if (ret != TSS2_RC_SUCCESS) {
-            if (ret == TSS2_TCTI_RC_TRY_AGAIN) {
-                return ret;
-            }
-            rc = ret;
-            goto out;
-        }
-        ret = socket_recv_buf (tcti_mssim->tpm_sock, size_buf, sizeof(UINT32));
-        if (ret != sizeof (UINT32)) {
-            rc = TSS2_TCTI_RC_IO_ERROR;
+        rc = tcti_mssim_rx_wait (tcti_mssim, sizeof (UINT32), timeout);
+        if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+            return rc;
+        } else if (rc != TSS2_RC_SUCCESS) {
             goto out;
         }
+        socket_rx_take (tcti_mssim->tpm_sock, &tcti_mssim->rx,
+                        size_buf, sizeof(UINT32));
 
         rc = Tss2_MU_UINT32_Unmarshal (size_buf,
                                        sizeof (size_buf), 0,
@@ -388,43 +546,31 @@ tcti_mssim_receive (
     }
     *response_size = tcti_common->header.size;
 
-    /* Receive the TPM response. */
+    /*
+     * Receive the TPM response and the appended four bytes of 0's. The
+     * simulator writes the trailer separately, so wait for both before
+     * taking anything: a TRY_AGAIN leaves the buffer intact for the next
+     * call.
+     */
     LOG_DEBUG ("Reading response of size %" PRIu32, tcti_common->header.size);
-    ret = socket_poll(tcti_mssim->tpm_sock, timeout);
-    if (ret != TSS2_RC_SUCCESS) {
-        if (ret == TSS2_TCTI_RC_TRY_AGAIN) {
-            return ret;
-        }
-        rc = ret;
-        goto out;
+    rc = tcti_mssim_rx_wait (tcti_mssim, tcti_common->header.size, timeout);
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = tcti_mssim_rx_wait (tcti_mssim,
+                                 tcti_common->header.size + sizeof (trash),
+                                 timeout);
     }
-    ret = socket_recv_buf (tcti_mssim->tpm_sock,
-                           (unsigned char *)response_buffer,
-                           tcti_common->header.size);
-    if (ret < (ssize_t)tcti_common->header.size) {
-        rc = TSS2_TCTI_RC_IO_ERROR;
+    if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+        return rc;
+    } else if (rc != TSS2_RC_SUCCESS) {
         goto out;
     }
+    socket_rx_take (tcti_mssim->tpm_sock, &tcti_mssim->rx,
+                    (unsigned char *)response_buffer,
+                    tcti_common->header.size);
     LOGBLOB_DEBUG(response_buffer, tcti_common->header.size,
                   "Response buffer received:");
-
-    ret = socket_poll (tcti_mssim->tpm_sock, timeout);
-    if (ret != TSS2_RC_SUCCESS) {
-        if (ret == TSS2_TCTI_RC_TRY_AGAIN) {
-            return ret;
-        }
-        rc = ret;
-        goto out;
-    }
-
-    /* Receive the appended four bytes of 0's */
-    ret = socket_recv_buf (tcti_mssim->tpm_sock,
-                           (unsigned char *)&trash, 4);
-    if (ret != 4) {
-        LOG_DEBUG ("Error reading last 4 bytes %" PRIu32, ret);
-        rc = TSS2_TCTI_RC_IO_ERROR;
-        goto out;
-    }
+    socket_rx_take (tcti_mssim->tpm_sock, &tcti_mssim->rx,
+                    (unsigned char *)&trash, sizeof (trash));
 
     if (tcti_mssim->cancel) {
         rc = tcti_platform_command (tctiContext, MS_SIM_CANCEL_OFF);
@@ -432,12 +578,21 @@ tcti_mssim_receive (
     }
     /*
      * Executing code beyond this point transitions the state machine to
-     * TRANSMIT. Another call to this function will not be possible until
-     * another command is sent to the TPM.
+     * TRANSMIT unless more pipelined responses are pending. Another call to
+     * this function will not be possible until another command is sent to
+     * the TPM.
      */
 out:
-    tcti_common->header.size = 0;
-    tcti_common->state = TCTI_STATE_TRANSMIT;
+    /*
+     * A response that failed to arrive leaves the stream at an unknown
+     * position, e.g. because the simulator closed the connection. Drop the
+     * connection, so that the next transmit reconnects instead of reading
+     * the rest of this response as the next one.
+     */
+    if (rc == TSS2_TCTI_RC_IO_ERROR || rc == TSS2_TCTI_RC_NO_CONNECTION) {
+        mssim_disconnect (tcti_mssim);
+    }
+    tcti_common_receive_done (tcti_common, rc);
 
     return rc;
 }
@@ -520,10 +675,56 @@ mssim_kv_callback (const key_value_t *key_value,
             return TSS2_TCTI_RC_BAD_VALUE;
         }
         return TSS2_RC_SUCCESS;
+    } else if (strcmp (key_value->key, "path") == 0) {
+        mssim_conf->path = key_value->value;
+        return TSS2_RC_SUCCESS;
+    } else if (strcmp (key_value->key, "ctrl_path") == 0) {
+        mssim_conf->ctrl_path = key_value->value;
+        return TSS2_RC_SUCCESS;
+    } else if (strcmp (key_value->key, "reconnect") == 0) {
+        if (!string_to_uint32 (key_value->value, &mssim_conf->reconnect)) {
+            return TSS2_TCTI_RC_BAD_VALUE;
+        }
+        return TSS2_RC_SUCCESS;
     } else {
         return TSS2_TCTI_RC_BAD_VALUE;
     }
 }
+/*
+ * Establish the TPM and the platform connection to the simulator and power
+ * it on. The simulator serves one client at a time, so the connections are
+ * owned by this context and closed when it is finalized.
+ */
+static TSS2_RC
+mssim_connect (
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim)
+{
+    mssim_conf_t *mssim_conf = &tcti_mssim->mssim_conf;
+    TSS2_RC rc;
+
+    rc = mssim_socket_connect (mssim_conf->path,
+                               mssim_conf->host,
+                               mssim_conf->port,
+                               &tcti_mssim->tpm_sock);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    rc = socket_set_nonblock (tcti_mssim->tpm_sock);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    rc = mssim_socket_connect (mssim_conf->ctrl_path,
+                               mssim_conf->host,
+                               mssim_conf->port + 1,
+                               &tcti_mssim->platform_sock);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    return simulator_setup ((TSS2_TCTI_CONTEXT*)tcti_mssim);
+}
 void
 tcti_mssim_init_context_data (
     TSS2_TCTI_COMMON_CONTEXT *tcti_common)
@@ -537,9 +738,12 @@ tcti_mssim_init_context_data (
     TSS2_TCTI_GET_POLL_HANDLES (tcti_common) = tcti_mssim_get_poll_handles;
     TSS2_TCTI_SET_LOCALITY (tcti_common) = tcti_mssim_set_locality;
     TSS2_TCTI_MAKE_STICKY (tcti_common) = tcti_make_sticky_not_implemented;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (tcti_common) = tcti_mssim_set_pipeline_depth;
     tcti_common->state = TCTI_STATE_TRANSMIT;
     tcti_common->locality = 0;
     memset (&tcti_common->header, 0, sizeof (tcti_common->header));
+    tcti_common->pipeline_depth = 1;
+    tcti_common->pending = 0;
 }
 /*
  * This is an implementation of the standard TCTI initialization function for
@@ -554,7 +758,6 @@ Tss2_Tcti_Mssim_Init (
     TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim = (TSS2_TCTI_MSSIM_CONTEXT*)tctiContext;
     TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_mssim_down_cast (tcti_mssim);
     TSS2_RC rc;
-    char *conf_copy = NULL;
     mssim_conf_t mssim_conf = MSSIM_CONF_DEFAULT_INIT;
 
     if (conf == NULL) {
@@ -573,6 +776,13 @@ Tss2_Tcti_Mssim_Init (
         return TSS2_RC_SUCCESS;
     }
 
+    tcti_mssim->conf_copy = NULL;
+    tcti_mssim->mssim_conf = mssim_conf;
+    tcti_mssim->tpm_sock = -1;
+    tcti_mssim->platform_sock = -1;
+    tcti_mssim->cancel = false;
+    socket_rx_reset (&tcti_mssim->rx);
+
     if (conf != NULL) {
         LOG_TRACE ("conf is not NULL");
         if (strlen (conf) > TCTI_MSSIM_CONF_MAX) {
@@ -580,61 +790,41 @@ Tss2_Tcti_Mssim_Init (
                          TCTI_MSSIM_CONF_MAX);
             return TSS2_TCTI_RC_BAD_VALUE;
         }
-        conf_copy = strdup (conf);
-        if (conf_copy == NULL) {
+        /* The parsed host name points into the copy, keep it for reconnects */
+        tcti_mssim->conf_copy = strdup (conf);
+        if (tcti_mssim->conf_copy == NULL) {
             LOG_ERROR ("Failed to allocate buffer: %s", strerror (errno));
             rc = TSS2_TCTI_RC_GENERAL_FAILURE;
             goto fail_out;
         }
         LOG_DEBUG ("Dup'd conf string to: 0x%" PRIxPTR,
-                   (uintptr_t)conf_copy);
-        rc = parse_key_value_string (conf_copy,
+                   (uintptr_t)tcti_mssim->conf_copy);
+        rc = parse_key_value_string (tcti_mssim->conf_copy,
                                      mssim_kv_callback,
-                                     &mssim_conf);
+                                     &tcti_mssim->mssim_conf);
         if (rc != TSS2_RC_SUCCESS) {
             goto fail_out;
         }
     }
-    LOG_DEBUG ("Initializing mssim TCTI with host: %s, port: %" PRIu16,
-               mssim_conf.host, mssim_conf.port);
-
-    tcti_mssim->tpm_sock = -1;
-    tcti_mssim->platform_sock = -1;
-
-    rc = socket_connect (mssim_conf.host,
-                         mssim_conf.port,
-                         &tcti_mssim->tpm_sock);
-    if (rc != TSS2_RC_SUCCESS) {
-        goto fail_out;
-    }
-
-    rc = socket_set_nonblock (tcti_mssim->tpm_sock);
-    if (rc != TSS2_RC_SUCCESS) {
-        goto fail_out;
-    }
-
-    rc = socket_connect (mssim_conf.host,
-                         mssim_conf.port + 1,
-                         &tcti_mssim->platform_sock);
-    if (rc != TSS2_RC_SUCCESS) {
-        goto fail_out;
+    if (tcti_mssim->mssim_conf.path != NULL) {
+        LOG_DEBUG ("Initializing mssim TCTI with path: %s",
+                   tcti_mssim->mssim_conf.path);
+    } else {
+        LOG_DEBUG ("Initializing mssim TCTI with host: %s, port: %" PRIu16,
+                   tcti_mssim->mssim_conf.host, tcti_mssim->mssim_conf.port);
     }
 
     tcti_mssim_init_context_data (tcti_common);
-    rc = simulator_setup (tctiContext);
+    rc = mssim_connect (tcti_mssim);
     if (rc != TSS2_RC_SUCCESS) {
         goto fail_out;
     }
 
-    if (conf_copy != NULL) {
-        free (conf_copy);
-    }
     return TSS2_RC_SUCCESS;
 
 fail_out:
-    if (conf_copy != NULL) {
-        free (conf_copy);
-    }
+    free (tcti_mssim->conf_copy);
+    tcti_mssim->conf_copy = NULL;
     socket_close (&tcti_mssim->tpm_sock);
     socket_close (&tcti_mssim->platform_sock);
 
@@ -646,7 +836,10 @@ const TSS2_TCTI_INFO tss2_tcti_info = {
     .version = TCTI_VERSION,
     .name = "tcti-socket",
     .description = "TCTI module for communication with the Microsoft TPM2 Simulator.",
-    .config_help = "Key / value string in the form \"host=localhost,port=2321\".",
+    .config_help = "Key / value string in the form \"host=localhost,port=2321\"."
+        " Optional keys: \"path=<socket>\" and \"ctrl_path=<socket>\" use"
+        " UNIX sockets for the TPM and platform channel, \"reconnect=<n>\""
+        " retries a failed transmit n times.",
     .init = Tss2_Tcti_Mssim_Init,
 };
 
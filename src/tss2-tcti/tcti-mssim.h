@@ -14,14 +14,19 @@
 
 /*
  * longest possible conf string:
- * HOST_NAME_MAX + max char uint16 (5) + strlen ("host=,port=") (11)
+ * HOST_NAME_MAX + max char uint16 (5) + max char uint32 (10) +
+ * 2 * UNIX_PATH_MAX +
+ * strlen ("host=,port=,reconnect=,path=,ctrl_path=") (39)
  */
-#define TCTI_MSSIM_CONF_MAX (_HOST_NAME_MAX + 16)
+#define TCTI_MSSIM_CONF_MAX (_HOST_NAME_MAX + 2 * _UNIX_PATH_MAX + 54)
 #define TCTI_MSSIM_DEFAULT_HOST "localhost"
 #define TCTI_MSSIM_DEFAULT_PORT 2321
 #define MSSIM_CONF_DEFAULT_INIT { \
     .host = TCTI_MSSIM_DEFAULT_HOST, \
     .port = TCTI_MSSIM_DEFAULT_PORT, \
+    .reconnect = 0, \
+    .path = NULL, \
+    .ctrl_path = NULL, \
 }
 
 #define TCTI_MSSIM_MAGIC 0xf05b04cd9f02728dULL
@@ -29,12 +34,18 @@
 typedef struct {
     char *host;
     uint16_t port;
+    uint32_t reconnect; /* reconnect attempts on transmit errors */
+    char *path;         /* UNIX socket of the TPM channel, replaces TCP */
+    char *ctrl_path;    /* UNIX socket of the platform channel */
 } mssim_conf_t;
 
 typedef struct {
     TSS2_TCTI_COMMON_CONTEXT common;
     SOCKET platform_sock;
     SOCKET tpm_sock;
+    char *conf_copy;
+    mssim_conf_t mssim_conf;
+    socket_rx_buf_t rx;
 /* Flag indicating if a command has been cancelled.
  * This is a temporary flag, which will be changed into
  * a tcti state when support for asynch operation will be added */
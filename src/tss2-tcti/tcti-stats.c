@@ -0,0 +1,652 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************;
+ * Copyright 2026, agent
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tss2_tpm2_types.h"
+#include "tss2_common.h"
+#include "tss2_tcti.h"
+#include "tcti-common.h"
+#define LOGMODULE tcti
+#include "util/log.h"
+
+#include "tcti-stats.h"
+#include "tss2_tctildr.h"
+
+static const uint64_t tcti_stats_bounds[TCTI_STATS_BUCKET_COUNT] = {
+    TCTI_STATS_BUCKETS
+};
+
+/*
+ * This function wraps the "up-cast" of the opaque TCTI context type to the
+ * type for the stats TCTI context. The only safeguard we have to ensure this
+ * operation is possible is the magic number in the stats TCTI context.
+ * If passed a NULL context, or the magic number check fails, this function
+ * will return NULL.
+ */
+TSS2_TCTI_STATS_CONTEXT*
+tcti_stats_context_cast (TSS2_TCTI_CONTEXT *tcti_ctx)
+{
+    if (tcti_ctx != NULL && TSS2_TCTI_MAGIC (tcti_ctx) == TCTI_STATS_MAGIC) {
+        return (TSS2_TCTI_STATS_CONTEXT*)tcti_ctx;
+    }
+    return NULL;
+}
+
+/*
+ * This function down-casts the stats TCTI context to the common context
+ * defined in the tcti-common module.
+ */
+TSS2_TCTI_COMMON_CONTEXT*
+tcti_stats_down_cast (TSS2_TCTI_STATS_CONTEXT *tcti_stats)
+{
+    if (tcti_stats == NULL) {
+        return NULL;
+    }
+    return &tcti_stats->common;
+}
+
+static uint64_t
+tcti_stats_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/*
+ * Find the statistics of a command code, inserting a new entry if the
+ * command code was not seen before. The entries are kept sorted so the
+ * export lists them in a stable order.
+ */
+static tcti_stats_command*
+tcti_stats_command_get (
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats,
+    uint32_t cc)
+{
+    tcti_stats_command *commands;
+    size_t low = 0, high = tcti_stats->command_count, mid;
+
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (tcti_stats->commands[mid].cc == cc) {
+            return &tcti_stats->commands[mid];
+        } else if (tcti_stats->commands[mid].cc < cc) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    commands = realloc (tcti_stats->commands,
+                        (tcti_stats->command_count + 1) * sizeof (*commands));
+    if (commands == NULL) {
+        return NULL;
+    }
+    memmove (&commands[low + 1], &commands[low],
+             (tcti_stats->command_count - low) * sizeof (*commands));
+    memset (&commands[low], 0, sizeof (*commands));
+    commands[low].cc = cc;
+    tcti_stats->commands = commands;
+    tcti_stats->command_count++;
+    return &commands[low];
+}
+
+static void
+tcti_stats_count_rc (
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats,
+    uint32_t rc)
+{
+    tcti_stats_rc *rcs;
+    size_t i;
+
+    for (i = 0; i < tcti_stats->rc_count; i++) {
+        if (tcti_stats->rcs[i].rc == rc) {
+            tcti_stats->rcs[i].count++;
+            return;
+        }
+    }
+
+    rcs = realloc (tcti_stats->rcs, (tcti_stats->rc_count + 1) * sizeof (*rcs));
+    if (rcs == NULL) {
+        LOG_WARNING ("Out of memory, response code 0x%" PRIx32 " not counted",
+                     rc);
+        return;
+    }
+    rcs[tcti_stats->rc_count].rc = rc;
+    rcs[tcti_stats->rc_count].count = 1;
+    tcti_stats->rcs = rcs;
+    tcti_stats->rc_count++;
+}
+
+/*
+ * Write the statistics in the Prometheus text exposition format. The file
+ * is written to a temporary file and renamed, so readers never see a
+ * partially written file. Every series carries the process ID as label so
+ * the series of several processes can be told apart once collected.
+ */
+static int
+tcti_stats_export (TSS2_TCTI_STATS_CONTEXT *tcti_stats)
+{
+    tcti_stats_command *cmd;
+    long pid = tcti_stats->pid;
+    char *tmp;
+    size_t i, b;
+    uint64_t cumulative;
+    FILE *file;
+    int fd, ret = 0;
+
+    if (tcti_stats->file == NULL) {
+        return 0;
+    }
+
+    tmp = malloc (strlen (tcti_stats->file) + sizeof (".XXXXXX"));
+    if (tmp == NULL) {
+        return -1;
+    }
+    strcpy (tmp, tcti_stats->file);
+    strcat (tmp, ".XXXXXX");
+
+    fd = mkstemp (tmp);
+    if (fd < 0) {
+        LOG_WARNING ("Failed to create %s: %s", tmp, strerror (errno));
+        free (tmp);
+        return -1;
+    }
+    /* mkstemp creates the file 0600, the collector may run as another user */
+    if (fchmod (fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) != 0) {
+        LOG_WARNING ("Failed to chmod %s: %s", tmp, strerror (errno));
+    }
+    file = fdopen (fd, "w");
+    if (file == NULL) {
+        LOG_WARNING ("Failed to open %s: %s", tmp, strerror (errno));
+        close (fd);
+        remove (tmp);
+        free (tmp);
+        return -1;
+    }
+
+    fprintf (file,
+             "# HELP tss2_tcti_commands_total TPM commands completed.\n"
+             "# TYPE tss2_tcti_commands_total counter\n");
+    for (i = 0; i < tcti_stats->command_count; i++) {
+        cmd = &tcti_stats->commands[i];
+        fprintf (file, "tss2_tcti_commands_total{pid=\"%ld\",cc=\"0x%08"
+                 PRIx32 "\"} %" PRIu64 "\n", pid, cmd->cc, cmd->count);
+    }
+
+    fprintf (file,
+             "# HELP tss2_tcti_command_errors_total TPM commands completed "
+             "with a response code other than success.\n"
+             "# TYPE tss2_tcti_command_errors_total counter\n");
+    for (i = 0; i < tcti_stats->command_count; i++) {
+        cmd = &tcti_stats->commands[i];
+        fprintf (file, "tss2_tcti_command_errors_total{pid=\"%ld\",cc=\"0x%08"
+                 PRIx32 "\"} %" PRIu64 "\n", pid, cmd->cc, cmd->errors);
+    }
+
+    fprintf (file,
+             "# HELP tss2_tcti_sent_bytes_total Command bytes sent to the TPM.\n"
+             "# TYPE tss2_tcti_sent_bytes_total counter\n");
+    for (i = 0; i < tcti_stats->command_count; i++) {
+        cmd = &tcti_stats->commands[i];
+        fprintf (file, "tss2_tcti_sent_bytes_total{pid=\"%ld\",cc=\"0x%08"
+                 PRIx32 "\"} %" PRIu64 "\n", pid, cmd->cc, cmd->bytes_sent);
+    }
+
+    fprintf (file,
+             "# HELP tss2_tcti_received_bytes_total Response bytes received "
+             "from the TPM.\n"
+             "# TYPE tss2_tcti_received_bytes_total counter\n");
+    for (i = 0; i < tcti_stats->command_count; i++) {
+        cmd = &tcti_stats->commands[i];
+        fprintf (file, "tss2_tcti_received_bytes_total{pid=\"%ld\",cc=\"0x%08"
+                 PRIx32 "\"} %" PRIu64 "\n", pid, cmd->cc,
+                 cmd->bytes_received);
+    }
+
+    fprintf (file,
+             "# HELP tss2_tcti_command_duration_seconds Time from transmitting "
+             "a command to receiving its response.\n"
+             "# TYPE tss2_tcti_command_duration_seconds histogram\n");
+    for (i = 0; i < tcti_stats->command_count; i++) {
+        cmd = &tcti_stats->commands[i];
+        cumulative = 0;
+        for (b = 0; b < TCTI_STATS_BUCKET_COUNT; b++) {
+            cumulative += cmd->buckets[b];
+            fprintf (file, "tss2_tcti_command_duration_seconds_bucket{pid=\"%ld"
+                     "\",cc=\"0x%08" PRIx32 "\",le=\"%g\"} %" PRIu64 "\n",
+                     pid, cmd->cc, (double)tcti_stats_bounds[b] / 1000000,
+                     cumulative);
+        }
+        fprintf (file, "tss2_tcti_command_duration_seconds_bucket{pid=\"%ld"
+                 "\",cc=\"0x%08" PRIx32 "\",le=\"+Inf\"} %" PRIu64 "\n", pid,
+                 cmd->cc, cmd->count);
+        fprintf (file, "tss2_tcti_command_duration_seconds_sum{pid=\"%ld\","
+                 "cc=\"0x%08" PRIx32 "\"} %" PRIu64 ".%06" PRIu64 "\n", pid,
+                 cmd->cc, cmd->latency_us / 1000000,
+                 cmd->latency_us % 1000000);
+        fprintf (file, "tss2_tcti_command_duration_seconds_count{pid=\"%ld\","
+                 "cc=\"0x%08" PRIx32 "\"} %" PRIu64 "\n", pid, cmd->cc,
+                 cmd->count);
+    }
+
+    fprintf (file,
+             "# HELP tss2_tcti_responses_total TPM responses by response code "
+             "other than success.\n"
+             "# TYPE tss2_tcti_responses_total counter\n");
+    for (i = 0; i < tcti_stats->rc_count; i++) {
+        fprintf (file, "tss2_tcti_responses_total{pid=\"%ld\",rc=\"0x%08"
+                 PRIx32 "\"} %" PRIu64 "\n", pid, tcti_stats->rcs[i].rc,
+                 tcti_stats->rcs[i].count);
+    }
+
+    fprintf (file,
+             "# HELP tss2_tcti_busy_seconds_total Time with a command in "
+             "flight.\n"
+             "# TYPE tss2_tcti_busy_seconds_total counter\n"
+             "tss2_tcti_busy_seconds_total{pid=\"%ld\"} %" PRIu64 ".%06"
+             PRIu64 "\n"
+             "# HELP tss2_tcti_in_flight Commands transmitted and not yet "
+             "answered.\n"
+             "# TYPE tss2_tcti_in_flight gauge\n"
+             "tss2_tcti_in_flight{pid=\"%ld\"} %d\n",
+             pid, tcti_stats->busy_us / 1000000, tcti_stats->busy_us % 1000000,
+             pid, tcti_stats->sent != 0);
+
+    if (ferror (file)) {
+        LOG_WARNING ("Failed to write %s", tmp);
+        ret = -1;
+    }
+    if (fclose (file) != 0) {
+        ret = -1;
+    }
+    if (ret == 0 && rename (tmp, tcti_stats->file) != 0) {
+        LOG_WARNING ("Failed to rename %s: %s", tmp, strerror (errno));
+        ret = -1;
+    }
+    if (ret != 0) {
+        remove (tmp);
+    }
+    free (tmp);
+    return ret;
+}
+
+/*
+ * Account a complete response to the command in flight.
+ */
+static void
+tcti_stats_record (
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats,
+    const uint8_t *response_buffer,
+    size_t response_size)
+{
+    tcti_stats_command *cmd;
+    tpm_header_t header = { 0 };
+    uint64_t now = tcti_stats_now ();
+    uint64_t latency = now - tcti_stats->sent;
+    size_t b;
+
+    tcti_stats->busy_us += latency;
+    tcti_stats->sent = 0;
+
+    if (response_size < TPM_HEADER_SIZE ||
+        header_unmarshal (response_buffer, &header) != TSS2_RC_SUCCESS) {
+        LOG_WARNING ("Response too short for a TPM header, not counted");
+        return;
+    }
+
+    cmd = tcti_stats_command_get (tcti_stats, tcti_stats->cc);
+    if (cmd == NULL) {
+        LOG_WARNING ("Out of memory, command 0x%" PRIx32 " not counted",
+                     tcti_stats->cc);
+        return;
+    }
+    cmd->count++;
+    cmd->bytes_received += response_size;
+    cmd->latency_us += latency;
+    for (b = 0; b < TCTI_STATS_BUCKET_COUNT; b++) {
+        if (latency <= tcti_stats_bounds[b]) {
+            break;
+        }
+    }
+    cmd->buckets[b]++;
+
+    if (header.code != TPM2_RC_SUCCESS) {
+        cmd->errors++;
+        tcti_stats_count_rc (tcti_stats, header.code);
+    }
+
+    if (tcti_stats->interval != 0 &&
+        now - tcti_stats->exported >= tcti_stats->interval) {
+        tcti_stats->exported = now;
+        tcti_stats_export (tcti_stats);
+    }
+}
+
+TSS2_RC
+tcti_stats_transmit (
+    TSS2_TCTI_CONTEXT *tcti_ctx,
+    size_t size,
+    const uint8_t *cmd_buf)
+{
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats = tcti_stats_context_cast (tcti_ctx);
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_stats_down_cast (tcti_stats);
+    tcti_stats_command *cmd;
+    tpm_header_t header = { 0 };
+    TSS2_RC rc;
+
+    if (tcti_stats == NULL) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    rc = tcti_common_transmit_checks (tcti_common, cmd_buf, TCTI_STATS_MAGIC);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (size >= TPM_HEADER_SIZE) {
+        header_unmarshal (cmd_buf, &header);
+    }
+
+    rc = Tss2_Tcti_Transmit (tcti_stats->tcti_child, size, cmd_buf);
+    if (rc != TSS2_RC_SUCCESS) {
+        LOG_ERROR ("Failed calling TCTI transmit of child TCTI module");
+        return rc;
+    }
+
+    tcti_stats->cc = header.code;
+    tcti_stats->sent = tcti_stats_now ();
+    cmd = tcti_stats_command_get (tcti_stats, header.code);
+    if (cmd != NULL) {
+        cmd->bytes_sent += size;
+    }
+
+    tcti_common->state = TCTI_STATE_RECEIVE;
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+tcti_stats_receive (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *response_size,
+    unsigned char *response_buffer,
+    int32_t timeout)
+{
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats = tcti_stats_context_cast (tctiContext);
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_stats_down_cast (tcti_stats);
+    TSS2_RC rc;
+
+    if (tcti_stats == NULL) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    rc = tcti_common_receive_checks (tcti_common, response_size,
+                                     TCTI_STATS_MAGIC);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    rc = Tss2_Tcti_Receive (tcti_stats->tcti_child,
+                            response_size, response_buffer,
+                            timeout);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    /* partial read */
+    if (response_buffer == NULL) {
+        return rc;
+    }
+
+    tcti_stats_record (tcti_stats, response_buffer, *response_size);
+
+    tcti_common->state = TCTI_STATE_TRANSMIT;
+    return rc;
+}
+
+TSS2_RC
+tcti_stats_cancel (
+    TSS2_TCTI_CONTEXT *tctiContext)
+{
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats = tcti_stats_context_cast (tctiContext);
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_stats_down_cast (tcti_stats);
+    TSS2_RC rc;
+
+    if (tcti_stats == NULL) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    rc = tcti_common_cancel_checks (tcti_common, TCTI_STATS_MAGIC);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    rc = Tss2_Tcti_Cancel (tcti_stats->tcti_child);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    if (tcti_stats->sent != 0) {
+        tcti_stats->busy_us += tcti_stats_now () - tcti_stats->sent;
+        tcti_stats->sent = 0;
+    }
+
+    tcti_common->state = TCTI_STATE_TRANSMIT;
+    return rc;
+}
+
+TSS2_RC
+tcti_stats_set_locality (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    uint8_t locality)
+{
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats = tcti_stats_context_cast (tctiContext);
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_stats_down_cast (tcti_stats);
+    TSS2_RC rc;
+
+    if (tcti_stats == NULL) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+
+    rc = tcti_common_set_locality_checks (tcti_common, TCTI_STATS_MAGIC);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    rc = Tss2_Tcti_SetLocality (tcti_stats->tcti_child, locality);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    tcti_common->locality = locality;
+    return rc;
+}
+
+TSS2_RC
+tcti_stats_get_poll_handles (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    TSS2_TCTI_POLL_HANDLE *handles,
+    size_t *num_handles)
+{
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats = tcti_stats_context_cast (tctiContext);
+
+    if (tcti_stats == NULL) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+
+    return Tss2_Tcti_GetPollHandles (tcti_stats->tcti_child, handles,
+                                     num_handles);
+}
+
+void
+tcti_stats_finalize (
+    TSS2_TCTI_CONTEXT *tctiContext)
+{
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats = tcti_stats_context_cast (tctiContext);
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_stats_down_cast (tcti_stats);
+
+    if (tcti_stats == NULL) {
+        return;
+    }
+
+    /*
+     * The default file is named after the process and nobody would clean it
+     * up, so it goes away with the TCTI. A file given by the user gets the
+     * final statistics.
+     */
+    if (tcti_stats->file != NULL && tcti_stats->file_default) {
+        if (unlink (tcti_stats->file) != 0 && errno != ENOENT) {
+            LOG_WARNING ("Failed to remove %s: %s", tcti_stats->file,
+                         strerror (errno));
+        }
+    } else {
+        tcti_stats_export (tcti_stats);
+    }
+
+    Tss2_TctiLdr_Finalize (&tcti_stats->tcti_child);
+    free (tcti_stats->commands);
+    tcti_stats->commands = NULL;
+    tcti_stats->command_count = 0;
+    free (tcti_stats->rcs);
+    tcti_stats->rcs = NULL;
+    tcti_stats->rc_count = 0;
+    free (tcti_stats->file);
+    tcti_stats->file = NULL;
+
+    tcti_common->state = TCTI_STATE_FINAL;
+}
+
+/*
+ * Read the export file and interval from the environment. An empty file
+ * name disables the export.
+ */
+static TSS2_RC
+tcti_stats_config (TSS2_TCTI_STATS_CONTEXT *tcti_stats)
+{
+    const char *file = getenv (ENV_STATS_FILE);
+    const char *interval = getenv (ENV_STATS_INTERVAL);
+    char default_file[sizeof (DEFAULT_STATS_FILE_FMT) + 24];
+    unsigned long value = DEFAULT_STATS_INTERVAL;
+    char *end;
+
+    if (interval != NULL) {
+        errno = 0;
+        value = strtoul (interval, &end, 10);
+        if (errno != 0 || end == interval || *end != '\0') {
+            LOG_ERROR ("Invalid " ENV_STATS_INTERVAL ": %s", interval);
+            return TSS2_TCTI_RC_BAD_VALUE;
+        }
+    }
+    tcti_stats->interval = (uint64_t)value * 1000;
+    tcti_stats->pid = (long)getpid ();
+
+    if (file == NULL) {
+        snprintf (default_file, sizeof (default_file), DEFAULT_STATS_FILE_FMT,
+                  tcti_stats->pid);
+        file = default_file;
+        tcti_stats->file_default = true;
+        LOG_TRACE (ENV_STATS_FILE " not set. Using default stats file: %s",
+                   file);
+    }
+    if (file[0] == '\0') {
+        tcti_stats->file = NULL;
+        return TSS2_RC_SUCCESS;
+    }
+
+    tcti_stats->file = strdup (file);
+    if (tcti_stats->file == NULL) {
+        LOG_ERROR ("Out of memory");
+        return TSS2_TCTI_RC_MEMORY;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * This is an implementation of the standard TCTI initialization function for
+ * this module.
+ */
+TSS2_RC
+Tss2_Tcti_Stats_Init (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *size,
+    const char *conf)
+{
+    TSS2_TCTI_STATS_CONTEXT *tcti_stats = (TSS2_TCTI_STATS_CONTEXT*) tctiContext;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_stats_down_cast (tcti_stats);
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    if (tctiContext == NULL && size == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    } else if (tctiContext == NULL) {
+        *size = sizeof (TSS2_TCTI_STATS_CONTEXT);
+        return TSS2_RC_SUCCESS;
+    }
+
+    if (conf == NULL) {
+        LOG_TRACE ("tctiContext: 0x%" PRIxPTR ", size: 0x%" PRIxPTR ""
+                   " no configuration will be used.",
+                   (uintptr_t)tctiContext, (uintptr_t)size);
+    } else {
+        LOG_TRACE ("tctiContext: 0x%" PRIxPTR ", size: 0x%" PRIxPTR ", conf: %s",
+                   (uintptr_t)tctiContext, (uintptr_t)size, conf);
+    }
+
+    memset (tcti_stats, 0, sizeof (*tcti_stats));
+    rc = tcti_stats_config (tcti_stats);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    rc = Tss2_TctiLdr_Initialize (conf, &tcti_stats->tcti_child);
+    if (rc != TSS2_RC_SUCCESS) {
+        LOG_ERROR ("Error loading TCTI: %s", conf);
+        free (tcti_stats->file);
+        tcti_stats->file = NULL;
+        return rc;
+    }
+
+    TSS2_TCTI_MAGIC (tcti_common) = TCTI_STATS_MAGIC;
+    TSS2_TCTI_VERSION (tcti_common) = TCTI_VERSION;
+    TSS2_TCTI_TRANSMIT (tcti_common) = tcti_stats_transmit;
+    TSS2_TCTI_RECEIVE (tcti_common) = tcti_stats_receive;
+    TSS2_TCTI_FINALIZE (tcti_common) = tcti_stats_finalize;
+    TSS2_TCTI_CANCEL (tcti_common) = tcti_stats_cancel;
+    TSS2_TCTI_GET_POLL_HANDLES (tcti_common) = tcti_stats_get_poll_handles;
+    TSS2_TCTI_SET_LOCALITY (tcti_common) = tcti_stats_set_locality;
+    TSS2_TCTI_MAKE_STICKY (tcti_common) = tcti_make_sticky_not_implemented;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (tcti_common) = tcti_set_pipeline_depth_not_implemented;
+    tcti_common->state = TCTI_STATE_TRANSMIT;
+    tcti_common->locality = 3;
+    tcti_common->pipeline_depth = 1;
+    tcti_stats->exported = tcti_stats_now ();
+
+    return TSS2_RC_SUCCESS;
+}
+
+/* public info structure */
+const TSS2_TCTI_INFO tss2_tcti_info = {
+    .version = TCTI_VERSION,
+    .name = "tcti-stats",
+    .description = "TCTI module for TPM command statistics in Prometheus format.",
+    .config_help = "The child tcti module and its config string: <name>:<conf>",
+    .init = Tss2_Tcti_Stats_Init,
+};
+
+const TSS2_TCTI_INFO*
+Tss2_Tcti_Info (void)
+{
+    return &tss2_tcti_info;
+}
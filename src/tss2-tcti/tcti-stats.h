@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************;
+ * Copyright 2026, agent
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifndef TCTI_STATS_H
+#define TCTI_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tss2_tcti.h"
+#include "tcti-common.h"
+
+#define TCTI_STATS_MAGIC 0x5e1f8a2c3b7d4e90ULL
+
+#define ENV_STATS_FILE          "TCTI_STATS_FILE"
+#define ENV_STATS_INTERVAL      "TCTI_STATS_INTERVAL"
+#define DEFAULT_STATS_FILE_FMT  "/dev/shm/tss2-tcti-stats-%ld.prom"
+#define DEFAULT_STATS_INTERVAL  1000 /* ms */
+
+/* Upper bounds of the latency histogram buckets in microseconds. */
+#define TCTI_STATS_BUCKETS \
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, \
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+#define TCTI_STATS_BUCKET_COUNT 16
+
+typedef struct {
+    uint32_t cc;
+    uint64_t count;         /* Complete responses */
+    uint64_t errors;        /* Responses with a response code != 0 */
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t latency_us;    /* Sum of transmit to response latencies */
+    /* Non-cumulative, the last element counts latencies above all bounds */
+    uint64_t buckets[TCTI_STATS_BUCKET_COUNT + 1];
+} tcti_stats_command;
+
+typedef struct {
+    uint32_t rc;
+    uint64_t count;
+} tcti_stats_rc;
+
+typedef struct {
+    TSS2_TCTI_COMMON_CONTEXT common;
+    TSS2_TCTI_CONTEXT *tcti_child;
+    /* Per command code statistics, sorted by command code */
+    tcti_stats_command *commands;
+    size_t command_count;
+    /* Response codes other than TPM2_RC_SUCCESS */
+    tcti_stats_rc *rcs;
+    size_t rc_count;
+    uint32_t cc;            /* Command code of the command in flight */
+    uint64_t sent;          /* Transmission time of the command in flight */
+    uint64_t busy_us;       /* Total time with a command in flight */
+    uint64_t interval;      /* Export interval in us, 0 to only export on finalize */
+    uint64_t exported;      /* Time of the last export */
+    char *file;
+    bool file_default;      /* file is the per process default file */
+    long pid;               /* Value of the pid label of every series */
+} TSS2_TCTI_STATS_CONTEXT;
+
+#endif /* TCTI_STATS_H */
@@ -8,8 +8,10 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -81,6 +83,23 @@ tcti_swtpm_down_cast (TSS2_TCTI_SWTPM_CONTEXT *tcti_swtpm)
     return &tcti_swtpm->common;
 }
 
+/*
+ * Connect to the UNIX socket 'path' if one is configured, else to 'host' /
+ * 'port' over TCP.
+ */
+static TSS2_RC
+swtpm_connect (
+    const char *path,
+    const char *host,
+    uint16_t port,
+    SOCKET *sock)
+{
+    if (path != NULL) {
+        return socket_connect_unix (path, sock);
+    }
+    return socket_connect (host, port, sock);
+}
+
 /*
  * This function is for sending one of the SWTPM_* control commands to the swtpm
  * simulator. These are sent over the out-of-band control socket.
@@ -135,9 +154,10 @@ TSS2_RC tcti_control_command (
     uint8_t resp_buf[SWTPM_CTRL_RESP_MAX_LEN] = { 0 };
     size_t resp_buf_len = sizeof(uint32_t);
 
-    rc = socket_connect (tcti_swtpm->swtpm_conf.host,
-                         tcti_swtpm->swtpm_conf.port + 1,
-                         &tcti_swtpm->ctrl_sock);
+    rc = swtpm_connect (tcti_swtpm->swtpm_conf.ctrl_path,
+                        tcti_swtpm->swtpm_conf.host,
+                        tcti_swtpm->swtpm_conf.port + 1,
+                        &tcti_swtpm->ctrl_sock);
     if (rc != TSS2_RC_SUCCESS) {
         LOG_ERROR ("Failed to connect to control socket.");
         rc = TSS2_TCTI_RC_IO_ERROR;
@@ -255,6 +275,7 @@ tcti_swtpm_transmit (
     TSS2_TCTI_SWTPM_CONTEXT *tcti_swtpm = tcti_swtpm_context_cast (tcti_ctx);
     TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_swtpm_down_cast (tcti_swtpm);
     tpm_header_t header;
+    uint32_t attempt;
     TSS2_RC rc;
 
     rc = tcti_common_transmit_checks (tcti_common, cmd_buf, TCTI_SWTPM_MAGIC);
@@ -274,19 +295,48 @@ tcti_swtpm_transmit (
     LOG_DEBUG ("Sending command with TPM_CC 0x%" PRIx32 " and size %" PRIu32,
                header.code, header.size);
 
-    rc = socket_connect (tcti_swtpm->swtpm_conf.host,
-                         tcti_swtpm->swtpm_conf.port,
-                         &tcti_swtpm->tpm_sock);
-    if (rc != TSS2_RC_SUCCESS) {
-        return rc;
+    /*
+     * The swtpm serves one client at a time, so the connection is only kept
+     * while responses are outstanding. Pipelined commands share the
+     * connection of the first command.
+     */
+    if (tcti_common->pending == 0) {
+        rc = swtpm_connect (tcti_swtpm->swtpm_conf.path,
+                            tcti_swtpm->swtpm_conf.host,
+                            tcti_swtpm->swtpm_conf.port,
+                            &tcti_swtpm->tpm_sock);
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
     }
 
     rc = socket_xmit_buf (tcti_swtpm->tpm_sock, cmd_buf, size);
+    /*
+     * The connection may have been closed by the swtpm meanwhile. It is
+     * reestablished if configured, as long as no response is outstanding.
+     */
+    for (attempt = 0;
+         rc == TSS2_TCTI_RC_IO_ERROR && tcti_common->pending == 0 &&
+         attempt < tcti_swtpm->swtpm_conf.reconnect;
+         attempt++) {
+        LOG_WARNING ("Failed to send command, reconnecting (attempt %" PRIu32
+                     " of %" PRIu32 ").", attempt + 1,
+                     tcti_swtpm->swtpm_conf.reconnect);
+        socket_close (&tcti_swtpm->tpm_sock);
+        socket_rx_reset (&tcti_swtpm->rx);
+        rc = swtpm_connect (tcti_swtpm->swtpm_conf.path,
+                            tcti_swtpm->swtpm_conf.host,
+                            tcti_swtpm->swtpm_conf.port,
+                            &tcti_swtpm->tpm_sock);
+        if (rc == TSS2_RC_SUCCESS) {
+            rc = socket_xmit_buf (tcti_swtpm->tpm_sock, cmd_buf, size);
+        }
+    }
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
     }
 
-    tcti_common->state = TCTI_STATE_RECEIVE;
+    tcti_common_transmit_done (tcti_common);
 
     return rc;
 }
@@ -335,16 +385,60 @@ tcti_swtpm_set_locality (
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * The TPM connection is opened by transmit and stays open until the last
+ * pending response is received, so the handle is only available while a
+ * command is in flight.
+ */
 TSS2_RC
 tcti_swtpm_get_poll_handles (
     TSS2_TCTI_CONTEXT *tctiContext,
     TSS2_TCTI_POLL_HANDLE *handles,
     size_t *num_handles)
 {
-    UNUSED(tctiContext);
-    UNUSED(handles);
-    UNUSED(num_handles);
-    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+    TSS2_TCTI_SWTPM_CONTEXT *tcti_swtpm = tcti_swtpm_context_cast (tctiContext);
+
+    if (num_handles == NULL || tcti_swtpm == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+
+    if (handles != NULL && *num_handles < 1) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+
+    *num_handles = 1;
+    if (handles != NULL) {
+        if (tcti_swtpm->tpm_sock == INVALID_SOCKET) {
+            LOG_ERROR ("No connection to poll, no command in flight.");
+            return TSS2_TCTI_RC_BAD_SEQUENCE;
+        }
+#ifdef _WIN32
+        *handles = tcti_swtpm->tpm_sock;
+#else
+        handles->fd = tcti_swtpm->tpm_sock;
+        handles->events = POLLIN;
+#endif
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+tcti_swtpm_set_pipeline_depth (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth)
+{
+    TSS2_TCTI_SWTPM_CONTEXT *tcti_swtpm = tcti_swtpm_context_cast (tctiContext);
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_swtpm_down_cast (tcti_swtpm);
+    TSS2_RC rc;
+
+    rc = tcti_common_set_pipeline_depth_checks (tcti_common, depth, TCTI_SWTPM_MAGIC);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    tcti_common->pipeline_depth = depth;
+    return TSS2_RC_SUCCESS;
 }
 
 void
@@ -384,7 +478,6 @@ tcti_swtpm_receive (
     }
 
     if (timeout != TSS2_TCTI_TIMEOUT_BLOCK) {
-        LOG_TRACE("Asynchronous I/O not actually implemented.");
 #ifdef TEST_FAPI_ASYNC
         if (wait < 1) {
             LOG_TRACE("Simulating Async by requesting another invocation.");
@@ -397,10 +490,31 @@ tcti_swtpm_receive (
 #endif /* TEST_FAPI_ASYNC */
     }
 
+    /*
+     * The header and the response body are taken from the receive buffer,
+     * which is filled with a single read of all available data. Typically
+     * the whole response arrives with that read.
+     */
     if (tcti_common->header.size == 0) {
         LOG_DEBUG("Receiving header to determine the size of the response.");
         uint8_t res_header[10];
-        ret = socket_recv_buf (tcti_swtpm->tpm_sock, &res_header[0], 10);
+        if (socket_rx_buffered (&tcti_swtpm->rx) < sizeof (res_header)) {
+            /* Leave the connection open if the response is not there yet. */
+            if (timeout != TSS2_TCTI_TIMEOUT_BLOCK) {
+                rc = socket_poll (tcti_swtpm->tpm_sock, timeout);
+                if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+                    return rc;
+                } else if (rc != TSS2_RC_SUCCESS) {
+                    goto out;
+                }
+            }
+            rc = socket_rx_fill (tcti_swtpm->tpm_sock, &tcti_swtpm->rx);
+            if (rc != TSS2_RC_SUCCESS) {
+                goto out;
+            }
+        }
+        ret = socket_rx_take (tcti_swtpm->tpm_sock, &tcti_swtpm->rx,
+                              &res_header[0], 10);
         if (ret != 10) {
             rc = TSS2_TCTI_RC_IO_ERROR;
             goto out;
@@ -428,9 +542,9 @@ tcti_swtpm_receive (
 
     if (tcti_common->header.size > 10) {
         LOG_DEBUG ("Reading response of size %" PRIu32, tcti_common->header.size);
-        ret = socket_recv_buf (tcti_swtpm->tpm_sock,
-                               (unsigned char *)&response_buffer[10],
-                               tcti_common->header.size - 10);
+        ret = socket_rx_take (tcti_swtpm->tpm_sock, &tcti_swtpm->rx,
+                              (unsigned char *)&response_buffer[10],
+                              tcti_common->header.size - 10);
         if (ret < (ssize_t)tcti_common->header.size - 10) {
             rc = TSS2_TCTI_RC_IO_ERROR;
             goto out;
@@ -447,14 +561,16 @@ tcti_swtpm_receive (
                   "Response received:");
     /*
      * Executing code beyond this point transitions the state machine to
-     * TRANSMIT. Another call to this function will not be possible until
-     * another command is sent to the TPM.
+     * TRANSMIT unless more pipelined responses are pending. Another call to
+     * this function will not be possible until another command is sent to
+     * the TPM.
      */
 out:
-    socket_close (&tcti_swtpm->tpm_sock);
-
-    tcti_common->header.size = 0;
-    tcti_common->state = TCTI_STATE_TRANSMIT;
+    tcti_common_receive_done (tcti_common, rc);
+    if (tcti_common->pending == 0) {
+        socket_close (&tcti_swtpm->tpm_sock);
+        socket_rx_reset (&tcti_swtpm->rx);
+    }
 
     return rc;
 }
@@ -503,6 +619,17 @@ swtpm_kv_callback (const key_value_t *key_value,
             return TSS2_TCTI_RC_BAD_VALUE;
         }
         return TSS2_RC_SUCCESS;
+    } else if (strcmp (key_value->key, "path") == 0) {
+        swtpm_conf->path = key_value->value;
+        return TSS2_RC_SUCCESS;
+    } else if (strcmp (key_value->key, "ctrl_path") == 0) {
+        swtpm_conf->ctrl_path = key_value->value;
+        return TSS2_RC_SUCCESS;
+    } else if (strcmp (key_value->key, "reconnect") == 0) {
+        if (!string_to_uint32 (key_value->value, &swtpm_conf->reconnect)) {
+            return TSS2_TCTI_RC_BAD_VALUE;
+        }
+        return TSS2_RC_SUCCESS;
     } else {
         return TSS2_TCTI_RC_BAD_VALUE;
     }
@@ -520,8 +647,11 @@ tcti_swtpm_init_context_data (
     TSS2_TCTI_GET_POLL_HANDLES (tcti_common) = tcti_swtpm_get_poll_handles;
     TSS2_TCTI_SET_LOCALITY (tcti_common) = tcti_swtpm_set_locality;
     TSS2_TCTI_MAKE_STICKY (tcti_common) = tcti_make_sticky_not_implemented;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (tcti_common) = tcti_swtpm_set_pipeline_depth;
     tcti_common->state = TCTI_STATE_TRANSMIT;
     memset (&tcti_common->header, 0, sizeof (tcti_common->header));
+    tcti_common->pipeline_depth = 1;
+    tcti_common->pending = 0;
 }
 /*
  * This is an implementation of the standard TCTI initialization function for
@@ -554,6 +684,9 @@ Tss2_Tcti_Swtpm_Init (
 
     tcti_swtpm->swtpm_conf.host = TCTI_SWTPM_DEFAULT_HOST;
     tcti_swtpm->swtpm_conf.port = TCTI_SWTPM_DEFAULT_PORT;
+    tcti_swtpm->swtpm_conf.reconnect = 0;
+    tcti_swtpm->swtpm_conf.path = NULL;
+    tcti_swtpm->swtpm_conf.ctrl_path = NULL;
 
     if (conf != NULL) {
         LOG_TRACE ("conf is not NULL");
@@ -576,16 +709,22 @@ Tss2_Tcti_Swtpm_Init (
             goto fail_out;
         }
     }
-    LOG_DEBUG ("Initializing swtpm TCTI with host: %s, port: %" PRIu16,
-               tcti_swtpm->swtpm_conf.host, tcti_swtpm->swtpm_conf.port);
+    if (tcti_swtpm->swtpm_conf.path != NULL) {
+        LOG_DEBUG ("Initializing swtpm TCTI with path: %s",
+                   tcti_swtpm->swtpm_conf.path);
+    } else {
+        LOG_DEBUG ("Initializing swtpm TCTI with host: %s, port: %" PRIu16,
+                   tcti_swtpm->swtpm_conf.host, tcti_swtpm->swtpm_conf.port);
+    }
 
     tcti_swtpm->tpm_sock = -1;
     tcti_swtpm->ctrl_sock = -1;
 
     /* sanity check */
-    rc = socket_connect (tcti_swtpm->swtpm_conf.host,
-                         tcti_swtpm->swtpm_conf.port,
-                         &tcti_swtpm->tpm_sock);
+    rc = swtpm_connect (tcti_swtpm->swtpm_conf.path,
+                        tcti_swtpm->swtpm_conf.host,
+                        tcti_swtpm->swtpm_conf.port,
+                        &tcti_swtpm->tpm_sock);
     socket_close (&tcti_swtpm->tpm_sock);
     if (rc != TSS2_RC_SUCCESS) {
         LOG_ERROR ("Cannot connect to swtpm TPM socket");
@@ -593,11 +732,13 @@ Tss2_Tcti_Swtpm_Init (
     }
 
     tcti_swtpm_init_context_data (tcti_common);
+    socket_rx_reset (&tcti_swtpm->rx);
 
     rc = tcti_swtpm_set_locality(tctiContext, 0);
     if (rc != TSS2_RC_SUCCESS) {
         LOG_WARNING ("Could not set locality via control channel: 0x%" PRIx32,
                      rc);
+        socket_close (&tcti_swtpm->tpm_sock);
         return rc;
     }
 
@@ -615,7 +756,10 @@ const TSS2_TCTI_INFO tss2_tcti_info = {
     .version = TCTI_VERSION,
     .name = "tcti-swtpm",
     .description = "TCTI module for communication with the swtpm.",
-    .config_help = "Key / value string in the form \"host=localhost,port=2321\".",
+    .config_help = "Key / value string in the form \"host=localhost,port=2321\"."
+        " Optional keys: \"path=<socket>\" and \"ctrl_path=<socket>\" use"
+        " UNIX sockets for the TPM and control channel, \"reconnect=<n>\""
+        " retries a failed transmit n times.",
     .init = Tss2_Tcti_Swtpm_Init,
 };
 
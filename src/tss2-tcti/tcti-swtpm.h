@@ -14,14 +14,19 @@
 
 /*
  * longest possible conf string:
- * HOST_NAME_MAX + max char uint16 (5) + strlen ("host=,port=") (11)
+ * HOST_NAME_MAX + max char uint16 (5) + max char uint32 (10) +
+ * 2 * UNIX_PATH_MAX +
+ * strlen ("host=,port=,reconnect=,path=,ctrl_path=") (39)
  */
-#define TCTI_SWTPM_CONF_MAX (_HOST_NAME_MAX + 16)
+#define TCTI_SWTPM_CONF_MAX (_HOST_NAME_MAX + 2 * _UNIX_PATH_MAX + 54)
 #define TCTI_SWTPM_DEFAULT_HOST "localhost"
 #define TCTI_SWTPM_DEFAULT_PORT 2321
 #define SWTPM_CONF_DEFAULT_INIT { \
     .host = TCTI_SWTPM_DEFAULT_HOST, \
     .port = TCTI_SWTPM_DEFAULT_PORT, \
+    .reconnect = 0, \
+    .path = NULL, \
+    .ctrl_path = NULL, \
 }
 
 #define TCTI_SWTPM_MAGIC 0x496E66696E656F6EULL
@@ -36,6 +41,9 @@
 typedef struct {
     char *host;
     uint16_t port;
+    uint32_t reconnect; /* reconnect attempts on transmit errors */
+    char *path;         /* UNIX socket of the TPM channel, replaces TCP */
+    char *ctrl_path;    /* UNIX socket of the control channel */
 } swtpm_conf_t;
 
 typedef struct {
@@ -44,6 +52,7 @@ typedef struct {
     SOCKET tpm_sock;
     char *conf_copy;
     swtpm_conf_t swtpm_conf;
+    socket_rx_buf_t rx;
 } TSS2_TCTI_SWTPM_CONTEXT;
 
 #endif /* TCTI_SWTPM_H */
@@ -277,11 +277,14 @@ Tss2_Tcti_Tbs_Init (
     TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = tcti_tbs_get_poll_handles;
     TSS2_TCTI_SET_LOCALITY (tctiContext) = tcti_tbs_set_locality;
     TSS2_TCTI_MAKE_STICKY (tctiContext) = tcti_make_sticky_not_implemented;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (tctiContext) = tcti_set_pipeline_depth_not_implemented;
     tcti_tbs = tcti_tbs_context_cast (tctiContext);
     tcti_common = tcti_tbs_down_cast (tcti_tbs);
     tcti_common->state = TCTI_STATE_TRANSMIT;
 
     memset (&tcti_common->header, 0, sizeof (tcti_common->header));
+    tcti_common->pipeline_depth = 1;
+    tcti_common->pending = 0;
     tcti_common->locality = 0;
 
     params.includeTpm20 = 1;
@@ -265,6 +265,17 @@ tctildr_make_sticky (
     }
     return Tss2_Tcti_MakeSticky (ldr_ctx->tcti, handle, sticky);
 }
+TSS2_RC
+tctildr_set_pipeline_depth (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth)
+{
+    TSS2_TCTILDR_CONTEXT *ldr_ctx = tctildr_context_cast (tctiContext);
+    if (ldr_ctx == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    return Tss2_Tcti_SetPipelineDepth (ldr_ctx->tcti, depth);
+}
 
 void
 tctildr_finalize (
@@ -442,6 +453,7 @@ Tss2_TctiLdr_Initialize_Ex (const char *name,
     TSS2_TCTI_GET_POLL_HANDLES (ldr_ctx) = tctildr_get_poll_handles;
     TSS2_TCTI_SET_LOCALITY (ldr_ctx) = tctildr_set_locality;
     TSS2_TCTI_MAKE_STICKY (ldr_ctx) = tctildr_make_sticky;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (ldr_ctx) = tctildr_set_pipeline_depth;
     ldr_ctx->library_handle = dl_handle;
     ldr_ctx->tcti = *tctiContext;
     *tctiContext = (TSS2_TCTI_CONTEXT*)ldr_ctx;
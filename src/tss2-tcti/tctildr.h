@@ -21,7 +21,7 @@
 
 typedef void* TSS2_TCTI_LIBRARY_HANDLE;
 typedef struct {
-    TSS2_TCTI_CONTEXT_COMMON_V2 v2;
+    TSS2_TCTI_CONTEXT_COMMON_V3 v3;
     TSS2_TCTI_LIBRARY_HANDLE library_handle;
     TSS2_TCTI_INFO *info;
     TSS2_TCTI_CONTEXT *tcti;
@@ -71,6 +71,10 @@ tctildr_make_sticky (
     TPM2_HANDLE *handle,
     uint8_t sticky);
 TSS2_RC
+tctildr_set_pipeline_depth (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth);
+TSS2_RC
 tcti_from_info (TSS2_TCTI_INFO_FUNC infof,
                 const char *conf,
                 TSS2_TCTI_CONTEXT **context);
@@ -18,6 +18,7 @@
 #include <poll.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #endif
 
@@ -189,6 +190,7 @@ socket_connect (
     struct addrinfo *p;
     char port_str[MAX_PORT_STR_LEN];
     int ret = 0;
+    int nodelay = 1;
 #ifdef _WIN32
     char host_buff[_HOST_NAME_MAX];
     const char *h = hostname;
@@ -256,7 +258,59 @@ socket_connect (
         return TSS2_TCTI_RC_IO_ERROR;
     }
 
+    /*
+     * Commands and responses are written as complete frames, so there is
+     * nothing to gain from delaying small segments.
+     */
+    if (setsockopt (*sock, IPPROTO_TCP, TCP_NODELAY,
+                    (const void *)&nodelay, sizeof (nodelay)) != 0) {
+        LOG_DEBUG ("Failed to set TCP_NODELAY on socket %d", *sock);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+socket_connect_unix (
+    const char *path,
+    SOCKET *sock)
+{
+#ifdef _WIN32
+    (void) path;
+    (void) sock;
+    LOG_ERROR ("UNIX domain sockets are not supported on this platform");
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+#else
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (path == NULL || sock == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (strlen (path) >= sizeof (addr.sun_path)) {
+        LOG_ERROR ("Socket path %s exceeds maximum of %zu", path,
+                   sizeof (addr.sun_path) - 1);
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+    strcpy (addr.sun_path, path);
+
+    *sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (*sock == INVALID_SOCKET) {
+        LOG_WARNING ("Failed to create UNIX socket: errno %d: %s",
+                     errno, strerror (errno));
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+
+    LOG_DEBUG ("Attempting connection to UNIX socket %s", path);
+    if (connect (*sock, (struct sockaddr*)&addr, sizeof (addr)) ==
+        SOCKET_ERROR) {
+        LOG_WARNING ("Failed to connect to UNIX socket %s: errno %d: %s",
+                     path, errno, strerror (errno));
+        socket_close (sock);
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+
     return TSS2_RC_SUCCESS;
+#endif
 }
 
 TSS2_RC
@@ -307,3 +361,98 @@ socket_poll (SOCKET sock, int timeout)
 #endif
     return TSS2_RC_SUCCESS;
 }
+
+size_t
+socket_rx_buffered (
+    const socket_rx_buf_t *rx)
+{
+    return rx->length - rx->offset;
+}
+
+void
+socket_rx_reset (
+    socket_rx_buf_t *rx)
+{
+    rx->offset = 0;
+    rx->length = 0;
+}
+
+TSS2_RC
+socket_rx_fill (
+    SOCKET sock,
+    socket_rx_buf_t *rx)
+{
+    ssize_t ret;
+
+    /* keep data that was received but not taken yet at the start */
+    if (rx->offset > 0) {
+        memmove (rx->data, &rx->data [rx->offset], socket_rx_buffered (rx));
+        rx->length -= rx->offset;
+        rx->offset = 0;
+    }
+    if (rx->length == sizeof (rx->data)) {
+        return TSS2_RC_SUCCESS;
+    }
+
+#ifdef _WIN32
+    TEMP_RETRY (ret, recv (sock, (char *) &rx->data [rx->length],
+                           sizeof (rx->data) - rx->length, 0));
+    if (ret < 0 && WSAGetLastError () == WSAEWOULDBLOCK) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+    if (ret < 0) {
+        LOG_WARNING ("read on fd %d failed with errno %d: %s",
+                     sock, WSAGetLastError(), strerror (WSAGetLastError()));
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+#else
+    TEMP_RETRY (ret, read (sock, &rx->data [rx->length],
+                           sizeof (rx->data) - rx->length));
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+    if (ret < 0) {
+        LOG_WARNING ("read on fd %d failed with errno %d: %s",
+                     sock, errno, strerror (errno));
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+#endif
+    if (ret == 0) {
+        LOG_WARNING ("Attempted read from fd %d, but EOF returned", sock);
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+    LOGBLOB_DEBUG (&rx->data [rx->length], ret, "read %zd bytes from fd %d:",
+                   ret, sock);
+    rx->length += ret;
+
+    return TSS2_RC_SUCCESS;
+}
+
+ssize_t
+socket_rx_take (
+    SOCKET sock,
+    socket_rx_buf_t *rx,
+    uint8_t *data,
+    size_t size)
+{
+    size_t taken = socket_rx_buffered (rx);
+    ssize_t ret;
+
+    if (taken > size) {
+        taken = size;
+    }
+    memcpy (data, &rx->data [rx->offset], taken);
+    rx->offset += taken;
+    if (rx->offset == rx->length) {
+        socket_rx_reset (rx);
+    }
+    if (taken == size) {
+        return taken;
+    }
+
+    ret = socket_recv_buf (sock, &data [taken], size - taken);
+    if (ret < 0) {
+        return taken;
+    }
+    return taken + ret;
+}
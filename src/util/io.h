@@ -24,6 +24,9 @@ typedef SSIZE_T ssize_t;
 #define SOCKET_ERROR -1
 #endif
 
+/* upper bound of the sun_path length across platforms */
+#define _UNIX_PATH_MAX 108
+
 #include "tss2_tpm2_types.h"
 
 #ifdef _WIN32
@@ -80,6 +83,14 @@ socket_connect (
     const char *hostname,
     uint16_t port,
     SOCKET *socket);
+/*
+ * Connect to the UNIX domain stream socket at 'path'. Not supported on
+ * Windows.
+ */
+TSS2_RC
+socket_connect_unix (
+    const char *path,
+    SOCKET *socket);
 TSS2_RC
 socket_close (
     SOCKET *socket);
@@ -100,6 +111,48 @@ TSS2_RC
 socket_poll (
     SOCKET sock,
     int timeout);
+/*
+ * Receive buffer for a stream socket. A single read fetches as much of the
+ * peer's data as is available, so a response that is consumed in several
+ * parts (size, body, trailer) usually costs one read only.
+ */
+#define SOCKET_RX_BUF_SIZE (TPM2_MAX_RESPONSE_SIZE + 16)
+typedef struct {
+    size_t offset;
+    size_t length;
+    uint8_t data[SOCKET_RX_BUF_SIZE];
+} socket_rx_buf_t;
+/*
+ * Number of bytes received but not yet taken from 'rx'.
+ */
+size_t
+socket_rx_buffered (
+    const socket_rx_buf_t *rx);
+/*
+ * Discard all buffered data, e.g. when the connection is closed.
+ */
+void
+socket_rx_reset (
+    socket_rx_buf_t *rx);
+/*
+ * Append whatever 'sock' has available to 'rx' with a single read. Blocks
+ * like 'read' unless the socket is non-blocking, in which case
+ * TSS2_TCTI_RC_TRY_AGAIN is returned when no data is available.
+ */
+TSS2_RC
+socket_rx_fill (
+    SOCKET sock,
+    socket_rx_buf_t *rx);
+/*
+ * Take 'size' bytes into 'data': first from 'rx', the rest is read from
+ * 'sock'. Returns the number of bytes taken, less than 'size' on error / EOF.
+ */
+ssize_t
+socket_rx_take (
+    SOCKET sock,
+    socket_rx_buf_t *rx,
+    uint8_t *data,
+    size_t size);
 
 #ifdef __cplusplus
 }
@@ -7,8 +7,10 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "tss2_tpm2_types.h"
@@ -54,6 +56,30 @@ parse_key_value (char *key_value_str,
 
     return true;
 }
+/*
+ * Convert the decimal number in 'str' to an unsigned 32 bit value. Signs,
+ * leading whitespace, trailing characters and values above UINT32_MAX are
+ * rejected. Returns false if the string isn't a valid number, 'value' is
+ * only written on success.
+ */
+bool
+string_to_uint32 (const char *str,
+                  uint32_t *value)
+{
+    char *end = NULL;
+    unsigned long tmp;
+
+    if (str == NULL || value == NULL || str[0] < '0' || str[0] > '9') {
+        return false;
+    }
+    errno = 0;
+    tmp = strtoul (str, &end, 10);
+    if (errno != 0 || *end != '\0' || tmp > UINT32_MAX) {
+        return false;
+    }
+    *value = tmp;
+    return true;
+}
 /*
  * This function parses the provided configuration string extracting the
  * key/value pairs. Each key/value pair extracted is stored in a key_value_t
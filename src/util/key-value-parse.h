@@ -30,5 +30,8 @@ TSS2_RC
 parse_key_value_string (char *kv_str,
                         KeyValueFunc callback,
                         void *user_data);
+bool
+string_to_uint32 (const char *str,
+                  uint32_t *value);
 
 #endif /* KEY_VALUE_PARSE_H */
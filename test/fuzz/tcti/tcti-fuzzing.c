@@ -229,9 +229,12 @@ tcti_fuzzing_init_context_data (
     TSS2_TCTI_GET_POLL_HANDLES (tcti_common) = tcti_fuzzing_get_poll_handles;
     TSS2_TCTI_SET_LOCALITY (tcti_common) = tcti_fuzzing_set_locality;
     TSS2_TCTI_MAKE_STICKY (tcti_common) = tcti_make_sticky_not_implemented;
+    TSS2_TCTI_SET_PIPELINE_DEPTH (tcti_common) = tcti_set_pipeline_depth_not_implemented;
     tcti_common->state = TCTI_STATE_TRANSMIT;
     tcti_common->locality = 3;
     memset (&tcti_common->header, 0, sizeof (tcti_common->header));
+    tcti_common->pipeline_depth = 1;
+    tcti_common->pending = 0;
 }
 
 /*
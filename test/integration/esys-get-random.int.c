@@ -34,6 +34,7 @@ test_esys_get_random(ESYS_CONTEXT * esys_context)
     TSS2_RC r;
 
     TPM2B_DIGEST *randomBytes;
+    TPM2B_DIGEST randomBytesData;
     r = Esys_GetRandom(esys_context, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
                        48, &randomBytes);
     if (r != TPM2_RC_SUCCESS) {
@@ -45,6 +46,17 @@ test_esys_get_random(ESYS_CONTEXT * esys_context)
                   "Randoms (count=%i):", randomBytes->size);
     Esys_Free(randomBytes);
 
+    r = Esys_GetRandom_Into(esys_context, ESYS_TR_NONE, ESYS_TR_NONE,
+                            ESYS_TR_NONE, 48, &randomBytesData);
+    if (r != TPM2_RC_SUCCESS) {
+        LOG_ERROR("GetRandom_Into FAILED! Response Code : 0x%x", r);
+        goto error;
+    }
+    if (randomBytesData.size != 48) {
+        LOG_ERROR("GetRandom_Into returned %i bytes", randomBytesData.size);
+        goto error;
+    }
+
     LOG_INFO("GetRandom Test Passed!");
 
     ESYS_TR session = ESYS_TR_NONE;
@@ -431,6 +431,94 @@ tpm2b_public_rsa_unique_size_marshal_success(void **state) {
     assert_int_equal (ptr1->size, HOST_TO_BE_16(0x11a));
 }
 
+/*
+ * A restricted RSA storage key survives a marshal / unmarshal / marshal
+ * round trip
+ */
+static void
+tpm2b_public_roundtrip(void **state)
+{
+    TPM2B_PUBLIC pub2b = {0}, pub2b_out = {0};
+    TPMT_PUBLIC *pub = &pub2b.publicArea;
+    uint8_t buffer[sizeof(pub2b)], buffer_out[sizeof(pub2b)];
+    size_t offset = 0, size;
+    TSS2_RC rc;
+
+    pub->type = TPM2_ALG_RSA;
+    pub->nameAlg = TPM2_ALG_SHA256;
+    pub->objectAttributes = TPMA_OBJECT_USERWITHAUTH |
+        TPMA_OBJECT_RESTRICTED | TPMA_OBJECT_DECRYPT |
+        TPMA_OBJECT_FIXEDTPM | TPMA_OBJECT_FIXEDPARENT |
+        TPMA_OBJECT_SENSITIVEDATAORIGIN;
+    pub->authPolicy.size = 32;
+    memset(pub->authPolicy.buffer, 0xa5, 32);
+    pub->parameters.rsaDetail.symmetric.algorithm = TPM2_ALG_AES;
+    pub->parameters.rsaDetail.symmetric.keyBits.aes = 128;
+    pub->parameters.rsaDetail.symmetric.mode.aes = TPM2_ALG_CFB;
+    pub->parameters.rsaDetail.scheme.scheme = TPM2_ALG_NULL;
+    pub->parameters.rsaDetail.keyBits = 2048;
+    pub->unique.rsa.size = 256;
+    memset(pub->unique.rsa.buffer, 0x5a, 256);
+
+    rc = Tss2_MU_TPM2B_PUBLIC_Marshal(&pub2b, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = offset;
+
+    offset = 0;
+    rc = Tss2_MU_TPM2B_PUBLIC_Unmarshal(buffer, size, &offset, &pub2b_out);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+    assert_int_equal (pub2b_out.size, size - sizeof(UINT16));
+    assert_int_equal (pub2b_out.publicArea.objectAttributes,
+                      pub->objectAttributes);
+    assert_int_equal (pub2b_out.publicArea.parameters.rsaDetail.keyBits, 2048);
+
+    offset = 0;
+    rc = Tss2_MU_TPM2B_PUBLIC_Marshal(&pub2b_out, buffer_out,
+                                      sizeof(buffer_out), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+    assert_memory_equal (buffer, buffer_out, size);
+}
+
+/*
+ * Size functions report the same number of bytes the marshal function writes
+ */
+static void
+tpm2b_size(void **state)
+{
+    TPM2B_DIGEST dgst = {4, {0}};
+    TPM2B_ECC_POINT point = {0};
+    uint8_t buffer[sizeof(dgst) + sizeof(point)] = {0};
+    size_t size = 0, offset = 0;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2B_DIGEST_Size(&dgst, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 2 + 4);
+
+    /* The size member of a TPM2B with a subtype is not used for the size */
+    point.size = 1;
+    point.point.x.size = 4;
+    point.point.y.size = 8;
+    rc = Tss2_MU_TPM2B_ECC_POINT_Size(&point, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 2 + 2 + 4 + 2 + 8);
+
+    rc = Tss2_MU_TPM2B_ECC_POINT_Marshal(&point, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+
+    dgst.size = sizeof(dgst.buffer) + 1;
+    rc = Tss2_MU_TPM2B_DIGEST_Size(&dgst, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_SIZE);
+
+    rc = Tss2_MU_TPM2B_DIGEST_Size(&dgst, NULL);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+    rc = Tss2_MU_TPM2B_DIGEST_Size(NULL, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(tpm2b_marshal_success),
@@ -446,6 +534,8 @@ int main(void) {
         cmocka_unit_test(tpm2b_unmarshal_buffer_size_lt_data_nad_lt_offset),
         cmocka_unit_test(tpm2b_public_rsa_marshal_success),
         cmocka_unit_test(tpm2b_public_rsa_unique_size_marshal_success),
+        cmocka_unit_test(tpm2b_public_roundtrip),
+        cmocka_unit_test (tpm2b_size),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
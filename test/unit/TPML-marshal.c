@@ -473,6 +473,100 @@ tpml_unmarshal_invalid_count(void **state)
     assert_int_equal (rc, TSS2_SYS_RC_MALFORMED_RESPONSE);
 }
 
+/*
+ * Size functions report the same number of bytes the marshal function writes
+ */
+static void
+tpml_size(void **state)
+{
+    TPML_HANDLE hndl = {0};
+    TPML_PCR_SELECTION sel = {0};
+    uint8_t buffer[sizeof(hndl) + sizeof(sel)] = { 0 };
+    size_t size = 0, offset = 0;
+    TSS2_RC rc;
+
+    hndl.count = 2;
+    rc = Tss2_MU_TPML_HANDLE_Size(&hndl, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 4 + 2 * 4);
+
+    sel.count = 2;
+    sel.pcrSelections[0].hash = TPM2_ALG_SHA1;
+    sel.pcrSelections[0].sizeofSelect = 3;
+    sel.pcrSelections[1].hash = TPM2_ALG_SHA256;
+    sel.pcrSelections[1].sizeofSelect = 2;
+    rc = Tss2_MU_TPML_PCR_SELECTION_Size(&sel, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 4 + (2 + 1 + 3) + (2 + 1 + 2));
+
+    rc = Tss2_MU_TPML_PCR_SELECTION_Marshal(&sel, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+
+    hndl.count = TPM2_MAX_CAP_HANDLES + 2;
+    rc = Tss2_MU_TPML_HANDLE_Size(&hndl, &size);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+
+    sel.pcrSelections[1].sizeofSelect = TPM2_PCR_SELECT_MAX + 1;
+    rc = Tss2_MU_TPML_PCR_SELECTION_Size(&sel, &size);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+}
+
+/*
+ * Full capability lists go through the bulk byte-swap path. Marshal them at
+ * an unaligned offset and check every element and the round trip.
+ */
+static void
+tpml_bulk_round_trip(void **state)
+{
+    TPML_HANDLE hndl = {0}, hndl_out;
+    TPML_ALG alg = {0}, alg_out;
+    uint8_t buffer[1 + sizeof(hndl) + sizeof(alg)] = { 0 };
+    size_t offset = 1, offset_out = 1;
+    UINT32 i, be32;
+    UINT16 be16;
+    TSS2_RC rc;
+
+    hndl.count = TPM2_MAX_CAP_HANDLES;
+    for (i = 0; i < hndl.count; i++)
+        hndl.handle[i] = 0x81000000 + i * 0x01010101;
+    alg.count = TPM2_MAX_ALG_LIST_SIZE - 3;
+    for (i = 0; i < alg.count; i++)
+        alg.algorithms[i] = 0x1234 + i * 0x0101;
+
+    rc = Tss2_MU_TPML_HANDLE_Marshal(&hndl, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, 1 + 4 + hndl.count * 4);
+    for (i = 0; i < hndl.count; i++) {
+        memcpy(&be32, &buffer[1 + 4 + i * 4], sizeof(be32));
+        assert_int_equal (BE_TO_HOST_32(be32), hndl.handle[i]);
+    }
+
+    rc = Tss2_MU_TPML_ALG_Marshal(&alg, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    for (i = 0; i < alg.count; i++) {
+        memcpy(&be16, &buffer[1 + 4 + hndl.count * 4 + 4 + i * 2], sizeof(be16));
+        assert_int_equal (BE_TO_HOST_16(be16), alg.algorithms[i]);
+    }
+
+    rc = Tss2_MU_TPML_HANDLE_Unmarshal(buffer, sizeof(buffer), &offset_out, &hndl_out);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPML_ALG_Unmarshal(buffer, sizeof(buffer), &offset_out, &alg_out);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset_out, offset);
+    assert_memory_equal (&hndl_out, &hndl, sizeof(hndl));
+    assert_memory_equal (&alg_out, &alg, sizeof(alg));
+
+    /* The list no longer fits: nothing is written past the count */
+    offset = 0;
+    rc = Tss2_MU_TPML_HANDLE_Marshal(&hndl, buffer, 4 + hndl.count * 4 - 1, &offset);
+    assert_int_equal (rc, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (offset, 0);
+
+    rc = Tss2_MU_TPML_HANDLE_Unmarshal(buffer, 4 + hndl.count * 4 - 1, NULL, &hndl_out);
+    assert_int_equal (rc, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpml_marshal_success),
@@ -487,6 +581,8 @@ int main(void) {
         cmocka_unit_test (tpml_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpml_unmarshal_buffer_size_lt_data_nad_lt_offset),
         cmocka_unit_test (tpml_unmarshal_invalid_count),
+        cmocka_unit_test (tpml_size),
+        cmocka_unit_test (tpml_bulk_round_trip),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -10,6 +10,7 @@
 
 #include <stdarg.h>
 #include <stddef.h>
+#include <string.h>
 #include <setjmp.h>
 #include <cmocka.h>
 #include <stdio.h>
@@ -342,6 +343,93 @@ tpms_unmarshal_buffer_size_lt_data_nad_lt_offset(void **state)
     assert_int_equal (offset, sizeof(alg));
 }
 
+/*
+ * A quote attestation survives a marshal / unmarshal / marshal round trip
+ */
+static void
+tpms_attest_roundtrip(void **state)
+{
+    TPMS_ATTEST attest = {0}, attest_out = {0};
+    uint8_t buffer[sizeof(attest)], buffer_out[sizeof(attest)];
+    size_t offset = 0, size;
+    TSS2_RC rc;
+
+    attest.magic = TPM2_GENERATED_VALUE;
+    attest.type = TPM2_ST_ATTEST_QUOTE;
+    attest.qualifiedSigner.size = 34;
+    memset(attest.qualifiedSigner.name, 0x11, 34);
+    attest.extraData.size = 16;
+    memset(attest.extraData.buffer, 0x22, 16);
+    attest.clockInfo.clock = 0x0102030405060708ULL;
+    attest.clockInfo.resetCount = 1;
+    attest.clockInfo.restartCount = 2;
+    attest.clockInfo.safe = TPM2_YES;
+    attest.firmwareVersion = 0x1122334455667788ULL;
+    attest.attested.quote.pcrSelect.count = 2;
+    attest.attested.quote.pcrSelect.pcrSelections[0].hash = TPM2_ALG_SHA1;
+    attest.attested.quote.pcrSelect.pcrSelections[0].sizeofSelect = 3;
+    attest.attested.quote.pcrSelect.pcrSelections[0].pcrSelect[0] = 0xff;
+    attest.attested.quote.pcrSelect.pcrSelections[1].hash = TPM2_ALG_SHA256;
+    attest.attested.quote.pcrSelect.pcrSelections[1].sizeofSelect = 3;
+    attest.attested.quote.pcrSelect.pcrSelections[1].pcrSelect[2] = 0x0f;
+    attest.attested.quote.pcrDigest.size = 32;
+    memset(attest.attested.quote.pcrDigest.buffer, 0x33, 32);
+
+    rc = Tss2_MU_TPMS_ATTEST_Marshal(&attest, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = offset;
+
+    offset = 0;
+    rc = Tss2_MU_TPMS_ATTEST_Unmarshal(buffer, size, &offset, &attest_out);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+    assert_int_equal (attest_out.magic, TPM2_GENERATED_VALUE);
+    assert_int_equal (attest_out.clockInfo.clock, 0x0102030405060708ULL);
+    assert_int_equal (attest_out.firmwareVersion, 0x1122334455667788ULL);
+    assert_int_equal (attest_out.attested.quote.pcrSelect.count, 2);
+
+    offset = 0;
+    rc = Tss2_MU_TPMS_ATTEST_Marshal(&attest_out, buffer_out,
+                                     sizeof(buffer_out), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+    assert_memory_equal (buffer, buffer_out, size);
+}
+
+/*
+ * Size functions report the same number of bytes the marshal function writes
+ */
+static void
+tpms_size(void **state)
+{
+    TPMS_ALG_PROPERTY alg = {0};
+    TPMS_CAPABILITY_DATA cap = {0};
+    uint8_t buffer[sizeof(cap)] = { 0 };
+    size_t size = 0, offset = 0;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPMS_ALG_PROPERTY_Size(&alg, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 2 + 4);
+
+    cap.capability = TPM2_CAP_ECC_CURVES;
+    cap.data.eccCurves.count = 3;
+    rc = Tss2_MU_TPMS_CAPABILITY_DATA_Size(&cap, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 4 + 4 + 3 * 2);
+
+    rc = Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&cap, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+
+    cap.capability = 0xbeef;
+    rc = Tss2_MU_TPMS_CAPABILITY_DATA_Size(&cap, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_VALUE);
+
+    rc = Tss2_MU_TPMS_CAPABILITY_DATA_Size(NULL, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpms_marshal_success),
@@ -354,6 +442,8 @@ int main(void) {
         cmocka_unit_test (tpms_unmarshal_buffer_null_offset_null),
         cmocka_unit_test (tpms_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpms_unmarshal_buffer_size_lt_data_nad_lt_offset),
+        cmocka_unit_test (tpms_attest_roundtrip),
+        cmocka_unit_test (tpms_size),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -411,6 +411,41 @@ tpmt_marshal_unmarshal_sig_invalid_selector(void **state)
     assert_int_equal (offset, 0);
 }
 
+/*
+ * Size functions report the same number of bytes the marshal function writes
+ */
+static void
+tpmt_size(void **state)
+{
+    TPMT_PUBLIC pub = {0};
+    uint8_t buffer[sizeof(pub)] = {0};
+    size_t size = 0, offset = 0;
+    TSS2_RC rc;
+
+    pub.type = TPM2_ALG_RSA;
+    pub.nameAlg = TPM2_ALG_SHA256;
+    pub.authPolicy.size = 32;
+    pub.parameters.rsaDetail.symmetric.algorithm = TPM2_ALG_AES;
+    pub.parameters.rsaDetail.symmetric.keyBits.aes = 128;
+    pub.parameters.rsaDetail.symmetric.mode.aes = TPM2_ALG_CFB;
+    pub.parameters.rsaDetail.scheme.scheme = TPM2_ALG_NULL;
+    pub.parameters.rsaDetail.keyBits = 2048;
+    pub.unique.rsa.size = 256;
+
+    rc = Tss2_MU_TPMT_PUBLIC_Size(&pub, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 2 + 2 + 4 + (2 + 32) + (2 + 2 + 2) + 2 + 2 + 4 +
+                      (2 + 256));
+
+    rc = Tss2_MU_TPMT_PUBLIC_Marshal(&pub, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, size);
+
+    pub.type = 0xbeef;
+    rc = Tss2_MU_TPMT_PUBLIC_Size(&pub, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_VALUE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpmt_marshal_success),
@@ -424,6 +459,7 @@ int main(void) {
         cmocka_unit_test (tpmt_unmarshal_buffer_null_offset_null),
         cmocka_unit_test (tpmt_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpmt_unmarshal_buffer_size_lt_data_nad_lt_offset),
+        cmocka_unit_test (tpmt_size),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
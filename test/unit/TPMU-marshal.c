@@ -402,6 +402,31 @@ tpmu_name_marshal(void **state)
     assert_memory_equal (buf + 2, digest, TPM2_SHA1_DIGEST_SIZE);
 }
 
+/*
+ * Size functions report the same number of bytes the marshal function writes
+ */
+static void
+tpmu_size(void **state)
+{
+    TPMU_HA ha = {0};
+    size_t size = 1;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPMU_HA_Size(&ha, TPM2_ALG_SHA256, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, TPM2_SHA256_DIGEST_SIZE);
+
+    rc = Tss2_MU_TPMU_HA_Size(&ha, TPM2_ALG_NULL, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 0);
+
+    rc = Tss2_MU_TPMU_HA_Size(&ha, 0xbeef, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_VALUE);
+
+    rc = Tss2_MU_TPMU_HA_Size(&ha, TPM2_ALG_SHA256, NULL);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpmu_marshal_success),
@@ -415,6 +440,7 @@ int main(void) {
         cmocka_unit_test (tpmu_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpmu_unmarshal_buffer_size_lt_data_nad_lt_offset),
         cmocka_unit_test (tpmu_name_marshal),
+        cmocka_unit_test (tpmu_size),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifndef TEST_UNIT_BENCHMARK_H_
+#define TEST_UNIT_BENCHMARK_H_
+
+#include <time.h>
+
+/* The time between two CLOCK_MONOTONIC readings in nanoseconds. */
+static inline double
+elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 +
+           (end->tv_nsec - start->tv_nsec);
+}
+
+#endif /* TEST_UNIT_BENCHMARK_H_ */
@@ -0,0 +1,499 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "esys_int.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * These tests save an ESYS_CONTEXT holding a persistent object, an NV index,
+ * a transient object and a session with Esys_Context_Save and restore it into
+ * a new ESYS_CONTEXT with Esys_Context_Restore, counting the commands that
+ * reach the TPM.
+ */
+
+#define TCTI_SNAP_MAGIC 0x534e415000000000ULL        /* 'SNAP\0' */
+#define TCTI_SNAP_VERSION 0x1
+
+#define PERSISTENT_HANDLE 0x81000001
+#define NV_HANDLE 0x01000001
+#define TRANSIENT_HANDLE 0x80000001
+#define SESSION_HANDLE 0x02000000
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    uint8_t command[TPM2_MAX_COMMAND_SIZE];
+    size_t command_size;
+    int read_publics;
+    int context_saves;
+    int context_loads;
+    int flushes;
+} TSS2_TCTI_CONTEXT_SNAP;
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_SNAP tcti;
+    ESYS_CONTEXT *esys_context;
+    ESYS_TR key, nv, transient, session;
+    TPMA_SESSION attributes;
+    TPM2B_NONCE nonce_tpm;
+    uint8_t *snapshot;
+    size_t snapshot_size;
+} snapshot_state;
+
+static const TPM2B_PUBLIC key_public = {
+    .size = 0,
+    .publicArea = {
+        .type = TPM2_ALG_KEYEDHASH,
+        .nameAlg = TPM2_ALG_SHA256,
+        .objectAttributes = TPMA_OBJECT_USERWITHAUTH,
+        .parameters.keyedHashDetail.scheme.scheme = TPM2_ALG_NULL,
+    },
+};
+
+static const TPM2B_NV_PUBLIC nv_public = {
+    .size = 0,
+    .nvPublic = {
+        .nvIndex = NV_HANDLE,
+        .nameAlg = TPM2_ALG_SHA256,
+        .attributes = TPMA_NV_AUTHWRITE | TPMA_NV_AUTHREAD,
+        .dataSize = 32,
+    },
+};
+
+static const TPM2B_NAME name = {
+    .size = 4, .name = { 0x00, 0x0b, 0xaa, 0xbb }
+};
+
+static const TPM2B_NONCE nonce_tpm = {
+    .size = 32, .buffer = { 0x5a, 0x5a, 0x5a, 0x5a }
+};
+
+static TSS2_RC
+tcti_snap_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                   size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_SNAP *tcti = (TSS2_TCTI_CONTEXT_SNAP *) tctiContext;
+    size_t offset = 6;
+    TPM2_CC command_code;
+
+    assert_true(size <= sizeof(tcti->command));
+    memcpy(tcti->command, buffer, size);
+    tcti->command_size = size;
+
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, &offset,
+                                              &command_code),
+                     TSS2_RC_SUCCESS);
+    switch (command_code) {
+    case TPM2_CC_ReadPublic:
+    case TPM2_CC_NV_ReadPublic:
+        tcti->read_publics++;
+        break;
+    case TPM2_CC_ContextSave:
+        tcti->context_saves++;
+        break;
+    case TPM2_CC_ContextLoad:
+        tcti->context_loads++;
+        break;
+    case TPM2_CC_FlushContext:
+        tcti->flushes++;
+        break;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/* Answer the commands used by these tests like a TPM would. Receive may be
+   called twice per command, so the commands are counted in transmit. */
+static TSS2_RC
+tcti_snap_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                  size_t * response_size,
+                  uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_SNAP *tcti = (TSS2_TCTI_CONTEXT_SNAP *) tctiContext;
+    uint8_t rsp[TPM2_MAX_RESPONSE_SIZE];
+    size_t offset = 10, size_offset = 2, rc_offset = 6, cmd_offset = 6;
+    TPM2_CC command_code;
+    TPM2_HANDLE handle;
+    TPMS_CONTEXT context = { 0 };
+    UNUSED(timeout);
+
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(tcti->command,
+                                              tcti->command_size, &cmd_offset,
+                                              &command_code),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_TPM2_ST_Marshal(TPM2_ST_NO_SESSIONS, rsp,
+                                             sizeof(rsp), NULL),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, rsp,
+                                            sizeof(rsp), &rc_offset),
+                     TSS2_RC_SUCCESS);
+
+    switch (command_code) {
+    case TPM2_CC_ReadPublic:
+        assert_int_equal(Tss2_MU_TPM2B_PUBLIC_Marshal(&key_public, rsp,
+                                                      sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&name, rsp, sizeof(rsp),
+                                                    &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&name, rsp, sizeof(rsp),
+                                                    &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_NV_ReadPublic:
+        assert_int_equal(Tss2_MU_TPM2B_NV_PUBLIC_Marshal(&nv_public, rsp,
+                                                         sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&name, rsp, sizeof(rsp),
+                                                    &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_StartAuthSession:
+        assert_int_equal(Tss2_MU_TPM2_HANDLE_Marshal(SESSION_HANDLE, rsp,
+                                                     sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NONCE_Marshal(&nonce_tpm, rsp,
+                                                     sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_ContextSave:
+        assert_int_equal(Tss2_MU_TPM2_HANDLE_Unmarshal(tcti->command,
+                                                       tcti->command_size,
+                                                       &cmd_offset, &handle),
+                         TSS2_RC_SUCCESS);
+        context.sequence = tcti->context_saves;
+        context.savedHandle = (handle == TRANSIENT_HANDLE) ? 0x80000000 :
+                                                             handle;
+        context.hierarchy = TPM2_RH_OWNER;
+        context.contextBlob.size = 16;
+        memset(context.contextBlob.buffer, 0xc1, 16);
+        assert_int_equal(Tss2_MU_TPMS_CONTEXT_Marshal(&context, rsp,
+                                                      sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_ContextLoad:
+        assert_int_equal(Tss2_MU_TPMS_CONTEXT_Unmarshal(tcti->command,
+                                                        tcti->command_size,
+                                                        &cmd_offset, &context),
+                         TSS2_RC_SUCCESS);
+        handle = (context.savedHandle == 0x80000000) ? TRANSIENT_HANDLE + 1 :
+                                                       context.savedHandle;
+        assert_int_equal(Tss2_MU_TPM2_HANDLE_Marshal(handle, rsp,
+                                                     sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_FlushContext:
+        break;
+    default:
+        LOG_ERROR("Unexpected command 0x%" PRIx32, command_code);
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    assert_int_equal(Tss2_MU_UINT32_Marshal(offset, rsp, sizeof(rsp),
+                                            &size_offset),
+                     TSS2_RC_SUCCESS);
+
+    if (response_buffer != NULL)
+        memcpy(response_buffer, rsp, offset);
+    *response_size = offset;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_snap_initialize(TSS2_TCTI_CONTEXT_SNAP * tcti)
+{
+    TSS2_TCTI_CONTEXT *tctiContext = (TSS2_TCTI_CONTEXT *) tcti;
+
+    memset(tcti, 0, sizeof(*tcti));
+    TSS2_TCTI_MAGIC(tctiContext) = TCTI_SNAP_MAGIC;
+    TSS2_TCTI_VERSION(tctiContext) = TCTI_SNAP_VERSION;
+    TSS2_TCTI_TRANSMIT(tctiContext) = tcti_snap_transmit;
+    TSS2_TCTI_RECEIVE(tctiContext) = tcti_snap_receive;
+}
+
+static ESYS_TR
+attach(ESYS_CONTEXT *esys_context, TPM2_HANDLE tpm_handle)
+{
+    ESYS_TR object;
+
+    assert_int_equal(Esys_TR_FromTPMPublic(esys_context, tpm_handle,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, &object),
+                     TSS2_RC_SUCCESS);
+    return object;
+}
+
+/* Save a context with one object of each kind and finalize it */
+static int
+setup(void **state)
+{
+    snapshot_state *s = calloc(1, sizeof(*s));
+    TPMT_SYM_DEF symmetric = { .algorithm = TPM2_ALG_NULL };
+    TPMA_SESSION attributes;
+    TPM2B_NONCE *nonce;
+    TSS2_RC r;
+
+    assert_non_null(s);
+    tcti_snap_initialize(&s->tcti);
+    assert_int_equal(Esys_Initialize(&s->esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &s->tcti, NULL),
+                     TSS2_RC_SUCCESS);
+
+    s->key = attach(s->esys_context, PERSISTENT_HANDLE);
+    s->nv = attach(s->esys_context, NV_HANDLE);
+    s->transient = attach(s->esys_context, TRANSIENT_HANDLE);
+    assert_int_equal(Esys_StartAuthSession(s->esys_context, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE, NULL,
+                                           TPM2_SE_HMAC, &symmetric,
+                                           TPM2_ALG_SHA256, &s->session),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TRSess_SetAttributes(s->esys_context, s->session,
+                                               TPMA_SESSION_CONTINUESESSION |
+                                               TPMA_SESSION_AUDIT, 0xff),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TRSess_GetAttributes(s->esys_context, s->session,
+                                               &s->attributes),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TRSess_GetNonceTPM(s->esys_context, s->session,
+                                             &nonce),
+                     TSS2_RC_SUCCESS);
+    s->nonce_tpm = *nonce;
+    free(nonce);
+
+    assert_int_equal(Esys_Context_Save(s->esys_context, &s->snapshot,
+                                       &s->snapshot_size),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(s->tcti.context_saves, 2);
+
+    /* The session has been saved and can no longer be used */
+    r = Esys_TRSess_GetAttributes(s->esys_context, s->session, &attributes);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+
+    Esys_Finalize(&s->esys_context);
+    *state = s;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    snapshot_state *s = *state;
+
+    free(s->snapshot);
+    free(s);
+    return 0;
+}
+
+static void
+test_restore(void **state)
+{
+    snapshot_state *s = *state;
+    TSS2_TCTI_CONTEXT_SNAP tcti;
+    ESYS_CONTEXT *esys_context;
+    TPM2_HANDLE tpm_handle;
+    TPMA_SESSION attributes;
+    TPM2B_NONCE *nonce;
+    TPM2B_NAME *esys_name;
+    ESYS_TR object;
+
+    tcti_snap_initialize(&tcti);
+    assert_int_equal(Esys_Initialize(&esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &tcti, NULL),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_Context_Restore(esys_context, s->snapshot,
+                                          s->snapshot_size),
+                     TSS2_RC_SUCCESS);
+    /* No metadata is read from the TPM */
+    assert_int_equal(tcti.read_publics, 0);
+    assert_int_equal(tcti.context_loads, 2);
+
+    assert_int_equal(Esys_TR_GetTpmHandle(esys_context, s->key, &tpm_handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tpm_handle, PERSISTENT_HANDLE);
+    assert_int_equal(Esys_TR_GetName(esys_context, s->key, &esys_name),
+                     TSS2_RC_SUCCESS);
+    free(esys_name);
+    assert_int_equal(Esys_TR_GetTpmHandle(esys_context, s->nv, &tpm_handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tpm_handle, NV_HANDLE);
+    assert_int_equal(Esys_TR_GetTpmHandle(esys_context, s->transient,
+                                          &tpm_handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tpm_handle, TRANSIENT_HANDLE + 1);
+
+    assert_int_equal(Esys_TR_GetTpmHandle(esys_context, s->session,
+                                          &tpm_handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tpm_handle, SESSION_HANDLE);
+    assert_int_equal(Esys_TRSess_GetAttributes(esys_context, s->session,
+                                               &attributes),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(attributes, s->attributes);
+    assert_int_equal(Esys_TRSess_GetNonceTPM(esys_context, s->session,
+                                             &nonce),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(nonce->size, s->nonce_tpm.size);
+    assert_memory_equal(nonce->buffer, s->nonce_tpm.buffer, nonce->size);
+    free(nonce);
+
+    /* New objects do not collide with the restored ones */
+    object = attach(esys_context, PERSISTENT_HANDLE);
+    assert_true(object > s->session);
+
+    Esys_Finalize(&esys_context);
+}
+
+static void
+test_restore_used_context(void **state)
+{
+    snapshot_state *s = *state;
+    TSS2_TCTI_CONTEXT_SNAP tcti;
+    ESYS_CONTEXT *esys_context;
+
+    tcti_snap_initialize(&tcti);
+    assert_int_equal(Esys_Initialize(&esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &tcti, NULL),
+                     TSS2_RC_SUCCESS);
+    attach(esys_context, PERSISTENT_HANDLE);
+    assert_int_equal(Esys_Context_Restore(esys_context, s->snapshot,
+                                          s->snapshot_size),
+                     TSS2_ESYS_RC_BAD_SEQUENCE);
+    assert_int_equal(tcti.context_loads, 0);
+
+    Esys_Finalize(&esys_context);
+}
+
+static void
+test_restore_truncated(void **state)
+{
+    snapshot_state *s = *state;
+    TSS2_TCTI_CONTEXT_SNAP tcti;
+    ESYS_CONTEXT *esys_context;
+    ESYS_TR objects[] = { s->key, s->nv, s->transient, s->session };
+    TPM2_HANDLE tpm_handle;
+    ESYS_TR handle_cnt;
+    size_t i;
+
+    tcti_snap_initialize(&tcti);
+    assert_int_equal(Esys_Initialize(&esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &tcti, NULL),
+                     TSS2_RC_SUCCESS);
+    handle_cnt = esys_context->esys_handle_cnt;
+    assert_int_equal(Esys_Context_Restore(esys_context, s->snapshot,
+                                          s->snapshot_size - 1),
+                     TSS2_MU_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal(esys_context->esys_handle_cnt, handle_cnt);
+
+    /* The transient object has been loaded and flushed again */
+    assert_int_equal(tcti.context_loads, 1);
+    assert_int_equal(tcti.flushes, 1);
+    for (i = 0; i < sizeof(objects) / sizeof(objects[0]); i++) {
+        assert_int_equal(Esys_TR_GetTpmHandle(esys_context, objects[i],
+                                              &tpm_handle),
+                         TSS2_ESYS_RC_BAD_TR);
+    }
+
+    Esys_Finalize(&esys_context);
+}
+
+/*
+ * Metadata entries restored before a session take ESYS_TRs that the new
+ * context would otherwise hand out next. Loading the session must not reuse
+ * them, also when the resource table grows while the session is loaded.
+ */
+#define METADATA_OBJECTS (_ESYS_RSRC_TABLE_MIN_SIZE - 1)
+
+static void
+test_restore_metadata_before_session(void **state)
+{
+    TSS2_TCTI_CONTEXT_SNAP tcti;
+    ESYS_CONTEXT *esys_context;
+    TPMT_SYM_DEF symmetric = { .algorithm = TPM2_ALG_NULL };
+    ESYS_TR objects[METADATA_OBJECTS], session;
+    TPM2_HANDLE tpm_handle;
+    uint8_t *snapshot;
+    size_t snapshot_size, i;
+
+    tcti_snap_initialize(&tcti);
+    assert_int_equal(Esys_Initialize(&esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &tcti, NULL),
+                     TSS2_RC_SUCCESS);
+    for (i = 0; i < METADATA_OBJECTS; i++)
+        objects[i] = attach(esys_context, PERSISTENT_HANDLE);
+    assert_int_equal(Esys_StartAuthSession(esys_context, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE, NULL,
+                                           TPM2_SE_HMAC, &symmetric,
+                                           TPM2_ALG_SHA256, &session),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_Context_Save(esys_context, &snapshot,
+                                       &snapshot_size),
+                     TSS2_RC_SUCCESS);
+    Esys_Finalize(&esys_context);
+
+    tcti_snap_initialize(&tcti);
+    assert_int_equal(Esys_Initialize(&esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &tcti, NULL),
+                     TSS2_RC_SUCCESS);
+    /* The next ESYS_TR of the new context is the first one of the snapshot */
+    esys_context->esys_handle_cnt = objects[0];
+    assert_int_equal(Esys_Context_Restore(esys_context, snapshot,
+                                          snapshot_size),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tcti.context_loads, 1);
+
+    for (i = 0; i < METADATA_OBJECTS; i++) {
+        assert_int_equal(Esys_TR_GetTpmHandle(esys_context, objects[i],
+                                              &tpm_handle),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(tpm_handle, PERSISTENT_HANDLE);
+    }
+    assert_int_equal(Esys_TR_GetTpmHandle(esys_context, session, &tpm_handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tpm_handle, SESSION_HANDLE);
+
+    Esys_Finalize(&esys_context);
+    free(snapshot);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_restore, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_restore_used_context, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(test_restore_truncated, setup,
+                                        teardown),
+        cmocka_unit_test(test_restore_metadata_before_session),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
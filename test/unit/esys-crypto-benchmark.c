@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "tss2_esys.h"
+#include "esys_crypto.h"
+
+#include "benchmark.h"
+
+/*
+ * Compute the cpHashes of a command with one to three sessions using SHA256
+ * and SHA384, once with a separate pass over the parameter area per hash
+ * algorithm and with the single pass table computation, the latter with fresh
+ * and with reused digest contexts, and report the time spent per command. The
+ * parameter area has the size of an NV_Write with a full MAX_NV_BUFFER. That
+ * both yield the same digests is checked by esys-crypto. It is not part of the
+ * test suite and is run by 'make benchmark'.
+ */
+
+#define ITERATIONS 2000
+#define PARAM_SIZE 2048
+
+static const struct {
+    const char *label;
+    size_t count;
+    TPM2_ALG_ID algs[HASH_TAB_MAX];
+} configs[] = {
+    { "1 x SHA256", 1, { TPM2_ALG_SHA256 } },
+    { "1 x SHA384", 1, { TPM2_ALG_SHA384 } },
+    { "2 x SHA256", 2, { TPM2_ALG_SHA256, TPM2_ALG_SHA256 } },
+    { "SHA256 + SHA384", 2, { TPM2_ALG_SHA256, TPM2_ALG_SHA384 } },
+    { "3 x SHA384", 3, { TPM2_ALG_SHA384, TPM2_ALG_SHA384, TPM2_ALG_SHA384 } },
+    { "SHA256 + 2 x SHA384", 3,
+      { TPM2_ALG_SHA256, TPM2_ALG_SHA384, TPM2_ALG_SHA384 } },
+};
+
+/* Enter every algorithm once, as iesys_compute_cp_hashtab() does. */
+static size_t
+distinct_algs(const TPM2_ALG_ID *algs, size_t count, HASH_TAB_ITEM *tab)
+{
+    size_t i, j, num = 0;
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < num; j++)
+            if (tab[j].alg == algs[i])
+                break;
+        if (j == num)
+            tab[num++].alg = algs[i];
+    }
+    return num;
+}
+
+static void
+cphash_benchmark(void **state)
+{
+    uint8_t ccBuffer[4] = { 0x00, 0x00, 0x01, 0x37 };
+    uint8_t param[PARAM_SIZE];
+    TPM2B_NAME name1 = { .size = 6, .name = { 0x00, 0x0b, 0x01, 0x00 } };
+    TPM2B_NAME name2 = { .size = 34, .name = { 0x00, 0x0b, 0x01, 0x00 } };
+    HASH_TAB_ITEM tab[HASH_TAB_MAX], ref[HASH_TAB_MAX];
+    IESYS_CRYPTO_HASH_CACHE *cache = NULL;
+    ESYS_CRYPTO_CALLBACKS crypto_cb;
+    struct timespec start, end;
+    size_t c, j, num;
+    TSS2_RC rc;
+    int i;
+
+    rc = iesys_initialize_crypto_backend(&crypto_cb, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    memset(param, 0xa5, sizeof(param));
+
+    for (c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        num = distinct_algs(configs[c].algs, configs[c].count, ref);
+        distinct_algs(configs[c].algs, configs[c].count, tab);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ITERATIONS; i++) {
+            for (j = 0; j < num; j++) {
+                ref[j].size = sizeof(ref[j].digest);
+                rc = iesys_crypto_cpHash(&crypto_cb,
+                                         ref[j].alg, ccBuffer, &name1, &name2,
+                                         NULL, param, sizeof(param),
+                                         &ref[j].digest[0], &ref[j].size);
+                assert_int_equal (rc, TSS2_RC_SUCCESS);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("cpHash %s, pass per algorithm: %.1f ns\n", configs[c].label,
+               elapsed_ns(&start, &end) / ITERATIONS);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ITERATIONS; i++) {
+            rc = iesys_crypto_pHash_tab(&crypto_cb, NULL,
+                                        NULL, ccBuffer, &name1, &name2, NULL,
+                                        param, sizeof(param), &tab[0], num);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("cpHash %s, single pass: %.1f ns\n", configs[c].label,
+               elapsed_ns(&start, &end) / ITERATIONS);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ITERATIONS; i++) {
+            rc = iesys_crypto_pHash_tab(&crypto_cb, &cache,
+                                        NULL, ccBuffer, &name1, &name2, NULL,
+                                        param, sizeof(param), &tab[0], num);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("cpHash %s, single pass, reused contexts: %.1f ns\n",
+               configs[c].label, elapsed_ns(&start, &end) / ITERATIONS);
+    }
+    iesys_crypto_hash_cache_free(&cache);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(cphash_benchmark),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
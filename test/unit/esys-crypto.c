@@ -18,6 +18,8 @@
 
 #include "tss2_esys.h"
 #include "esys_crypto.h"
+#include "esys_int.h"
+#include "esys_iutil.h"
 
 #define LOGMODULE tests
 #include "util/log.h"
@@ -27,6 +29,14 @@
  * covered by the integration tests.
  */
 
+static ESYS_CRYPTO_CALLBACKS crypto_cb;
+
+static int
+setup_crypto_cb(void **state)
+{
+    return iesys_initialize_crypto_backend(&crypto_cb, NULL) != TSS2_RC_SUCCESS;
+}
+
 static void
 check_hash_functions(void **state)
 {
@@ -36,49 +46,50 @@ check_hash_functions(void **state)
     TPM2B tpm2b;
     size_t size = 0;
 
-    rc = iesys_crypto_hash_start(NULL, TPM2_ALG_SHA384);
+    rc = iesys_crypto_hash_start(&crypto_cb, NULL, TPM2_ALG_SHA384);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
 #ifndef OSSL
-    rc = iesys_crypto_hash_start(&context, TPM2_ALG_SHA512);
+    rc = iesys_crypto_hash_start(&crypto_cb, &context, TPM2_ALG_SHA512);
     assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
 #endif
 
-    rc = iesys_crypto_hash_start(&context, 0);
+    rc = iesys_crypto_hash_start(&crypto_cb, &context, 0);
     assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
 
-    rc = iesys_crypto_hash_start(&context, TPM2_ALG_SHA384);
+    rc = iesys_crypto_hash_start(&crypto_cb, &context, TPM2_ALG_SHA384);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 
-    rc = iesys_crypto_hash_finish(NULL, &buffer[0], &size);
+    rc = iesys_crypto_hash_finish(&crypto_cb, NULL, &buffer[0], &size);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_hash_finish(&context, &buffer[0], &size);
+    rc = iesys_crypto_hash_finish(&crypto_cb, &context, &buffer[0], &size);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_SIZE);
 
-    iesys_crypto_hash_abort(NULL);
-    iesys_crypto_hash_abort(&context);
+    iesys_crypto_hash_abort(&crypto_cb, NULL);
+    iesys_crypto_hash_abort(&crypto_cb, &context);
 
-    rc = iesys_crypto_hash_update(NULL, &buffer[0], 10);
+    rc = iesys_crypto_hash_update(&crypto_cb, NULL, &buffer[0], 10);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_hash_update2b(NULL, &tpm2b);
+    rc = iesys_crypto_hash_update2b(&crypto_cb, NULL, &tpm2b);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
     /* Create invalid context */
-    rc = iesys_crypto_hmac_start(&context, TPM2_ALG_SHA1, &buffer[0], 10);
+    rc = iesys_crypto_hmac_start(&crypto_cb,
+                                 &context, TPM2_ALG_SHA1, &buffer[0], 10);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 
-    iesys_crypto_hash_abort(&context);
+    iesys_crypto_hash_abort(&crypto_cb, &context);
 
-    rc = iesys_crypto_hash_update(context, &buffer[0], 10);
+    rc = iesys_crypto_hash_update(&crypto_cb, context, &buffer[0], 10);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_hash_finish(&context, &buffer[0], &size);
+    rc = iesys_crypto_hash_finish(&crypto_cb, &context, &buffer[0], &size);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
     /* cleanup */
-    iesys_crypto_hmac_abort(&context);
+    iesys_crypto_hmac_abort(&crypto_cb, &context);
 }
 
 static void
@@ -90,52 +101,468 @@ check_hmac_functions(void **state)
     TPM2B tpm2b;
     size_t size = 0;
 
-    rc = iesys_crypto_hmac_start(NULL, TPM2_ALG_SHA384, &buffer[0], 10);
+    rc = iesys_crypto_hmac_start(&crypto_cb,
+                                 NULL, TPM2_ALG_SHA384, &buffer[0], 10);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
 #ifndef OSSL
-    rc = iesys_crypto_hmac_start(&context, TPM2_ALG_SHA512, &buffer[0], 10);
+    rc = iesys_crypto_hmac_start(&crypto_cb,
+                                 &context, TPM2_ALG_SHA512, &buffer[0], 10);
     assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
 #endif
 
-    rc = iesys_crypto_hmac_start(&context, 0,  &buffer[0], 10);
+    rc = iesys_crypto_hmac_start(&crypto_cb, &context, 0,  &buffer[0], 10);
     assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
 
-    rc = iesys_crypto_hmac_start(&context, TPM2_ALG_SHA1,  &buffer[0], 10);
+    rc = iesys_crypto_hmac_start(&crypto_cb,
+                                 &context, TPM2_ALG_SHA1,  &buffer[0], 10);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 
-    rc = iesys_crypto_hmac_finish(NULL, &buffer[0], &size);
+    rc = iesys_crypto_hmac_finish(&crypto_cb, NULL, &buffer[0], &size);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_hmac_finish2b(NULL, &tpm2b);
+    rc = iesys_crypto_hmac_finish2b(&crypto_cb, NULL, &tpm2b);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_hmac_finish(&context, &buffer[0], &size);
+    rc = iesys_crypto_hmac_finish(&crypto_cb, &context, &buffer[0], &size);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_SIZE);
 
-    iesys_crypto_hmac_abort(NULL);
-    iesys_crypto_hmac_abort(&context);
+    iesys_crypto_hmac_abort(&crypto_cb, NULL);
+    iesys_crypto_hmac_abort(&crypto_cb, &context);
 
-    rc = iesys_crypto_hmac_update(NULL, &buffer[0], 10);
+    rc = iesys_crypto_hmac_update(&crypto_cb, NULL, &buffer[0], 10);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_hmac_update2b(NULL, &tpm2b);
+    rc = iesys_crypto_hmac_update2b(&crypto_cb, NULL, &tpm2b);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
     /* Create invalid context */
-    rc = iesys_crypto_hash_start(&context, TPM2_ALG_SHA1);
+    rc = iesys_crypto_hash_start(&crypto_cb, &context, TPM2_ALG_SHA1);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 
-    iesys_crypto_hmac_abort(&context);
+    iesys_crypto_hmac_abort(&crypto_cb, &context);
 
-    rc = iesys_crypto_hmac_update(context, &buffer[0], 10);
+    rc = iesys_crypto_hmac_update(&crypto_cb, context, &buffer[0], 10);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_hmac_finish(&context, &buffer[0], &size);
+    rc = iesys_crypto_hmac_finish(&crypto_cb, &context, &buffer[0], &size);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
     /* cleanup */
-    iesys_crypto_hash_abort(&context);
+    iesys_crypto_hash_abort(&crypto_cb, &context);
+}
+
+static void
+compute_hmac(IESYS_CRYPTO_HMAC_CACHE **cache, const uint8_t *key, size_t key_size,
+             TPM2B_DIGEST *hmac)
+{
+    IESYS_CRYPTO_CONTEXT_BLOB *context;
+    uint8_t data[3] = { 1, 2, 3 };
+    TSS2_RC rc;
+
+    rc = iesys_crypto_hmac_start_cached(&context, cache, TPM2_ALG_SHA256,
+                                        key, key_size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = iesys_crypto_hmac_update(&crypto_cb, context, &data[0], sizeof(data));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    memset(hmac, 0, sizeof(*hmac));
+    hmac->size = sizeof(hmac->buffer);
+    rc = iesys_crypto_hmac_finish2b(&crypto_cb, &context, (TPM2B *) hmac);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+
+/**
+ * A cached keyed HMAC context yields the same results as a freshly keyed one,
+ * also after the key changed and while the cached context is in use.
+ */
+static void
+check_hmac_cache(void **state)
+{
+    IESYS_CRYPTO_HMAC_CACHE *cache = NULL;
+    IESYS_CRYPTO_CONTEXT_BLOB *busy;
+    uint8_t key1[20], key2[32];
+    TPM2B_DIGEST ref1, ref2, hmac;
+    TSS2_RC rc;
+
+    memset(&key1[0], 0x11, sizeof(key1));
+    memset(&key2[0], 0x22, sizeof(key2));
+
+    compute_hmac(NULL, &key1[0], sizeof(key1), &ref1);
+    compute_hmac(NULL, &key2[0], sizeof(key2), &ref2);
+    assert_int_not_equal (memcmp(&ref1, &ref2, sizeof(ref1)), 0);
+
+    compute_hmac(&cache, &key1[0], sizeof(key1), &hmac);
+    assert_memory_equal (&hmac, &ref1, sizeof(hmac));
+    compute_hmac(&cache, &key1[0], sizeof(key1), &hmac);
+    assert_memory_equal (&hmac, &ref1, sizeof(hmac));
+    compute_hmac(&cache, &key2[0], sizeof(key2), &hmac);
+    assert_memory_equal (&hmac, &ref2, sizeof(hmac));
+    compute_hmac(&cache, &key2[0], sizeof(key1), &hmac);
+    assert_int_not_equal (memcmp(&hmac, &ref2, sizeof(hmac)), 0);
+
+    /* Fall back to an uncached context while the cached one is in use */
+    rc = iesys_crypto_hmac_start_cached(&busy, &cache, TPM2_ALG_SHA256,
+                                        &key1[0], sizeof(key1));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    compute_hmac(&cache, &key1[0], sizeof(key1), &hmac);
+    assert_memory_equal (&hmac, &ref1, sizeof(hmac));
+    iesys_crypto_hmac_abort(&crypto_cb, &busy);
+    assert_null (busy);
+
+    compute_hmac(&cache, &key1[0], sizeof(key1), &hmac);
+    assert_memory_equal (&hmac, &ref1, sizeof(hmac));
+
+    iesys_crypto_hmac_cache_free(&cache);
+    assert_null (cache);
+    iesys_crypto_hmac_cache_free(&cache);
+}
+
+/*
+ * KDFa with a reused keyed HMAC state yields the same keys as keying an HMAC
+ * per output block; the expected values were computed independently.
+ */
+static void
+check_kdfa_cached(void **state)
+{
+    static const uint8_t kdfa_sha256[] = {
+        0xdd, 0xec, 0x0a, 0x45, 0x90, 0x65, 0x63, 0x08,
+        0x4e, 0x46, 0xfe, 0x3c, 0x00, 0x44, 0xb8, 0x33,
+        0x04, 0x33, 0xa2, 0x63, 0x1e, 0x34, 0x07, 0x1f,
+        0xc6, 0xeb, 0xef, 0xaf, 0x1d, 0xa9, 0xc4, 0x06,
+        0x19, 0x68, 0xfe, 0x32, 0x52, 0x24, 0xd5, 0xa8,
+        0x80, 0xef, 0xf6, 0xa3, 0xd4, 0xb9, 0xd5, 0xd4,
+        0x53, 0x8b, 0x14, 0x1a, 0x1d, 0x66, 0xbb, 0x93,
+        0x5b, 0x36, 0xa6, 0x4c, 0x6c, 0x69, 0x21, 0x0a,
+        0x62, 0x6a, 0x42, 0xda, 0x01, 0xf5, 0x32, 0xc1,
+        0xe5, 0xf0, 0x16, 0xb2, 0x61, 0x0d, 0x51, 0x25,
+        0x77, 0x93, 0x01, 0xce, 0x2e, 0xf4, 0xe0, 0x72,
+        0x4b, 0x16, 0xcf, 0x0f, 0xf8, 0x63, 0xbd, 0x7c,
+        0xf5, 0x41, 0x11, 0x24, 0xa5, 0x79, 0x99, 0xc4,
+        0xee, 0x24, 0xb0, 0xe4, 0x8c, 0x16, 0xd8, 0x86,
+        0x35, 0x75, 0x4b, 0xea, 0xe7, 0xc5, 0x63, 0xcb,
+        0x26, 0xa4, 0xdc, 0x90, 0xec, 0xc9, 0x69, 0x8e,
+    };
+    static const uint8_t kdfa_sha1[] = {
+        0x00, 0xa8, 0x8f, 0x31, 0x0b, 0x79, 0xd9, 0x1a,
+        0x44, 0x41, 0x31, 0x37, 0x4d, 0xa2, 0x53, 0xb6,
+        0x6f, 0x56, 0x3a, 0x26, 0x20, 0x59, 0x0e, 0xfb,
+        0xee, 0x76, 0x82, 0x77, 0xc6, 0xa3, 0x43, 0x38,
+        0x59, 0xe0, 0x75, 0x67, 0xa2, 0xdc, 0x89, 0x49,
+        0xed, 0xe8,
+    };
+    static const uint8_t xor_sha256[] = {
+        0x7f, 0x93, 0x22, 0x74, 0xa4, 0xf0, 0x01, 0xc1,
+        0xd9, 0xf2, 0x1a, 0x1a, 0x96, 0x64, 0xa8, 0x25,
+        0x98, 0xbe, 0xf9, 0x36, 0x80, 0x72, 0xf7, 0x7a,
+        0x72, 0xbf, 0x14, 0x55, 0xfc, 0x12, 0x70, 0xdc,
+        0xea, 0xe8, 0x4f, 0x08, 0x30, 0x0e, 0x88, 0x2e,
+        0x07, 0x77, 0xa2, 0x9e, 0x89, 0x0e, 0x73, 0x54,
+        0xc1, 0x96, 0x32, 0xfe, 0x48, 0x17, 0x23, 0x01,
+        0x56, 0x8e, 0x8e, 0x82, 0xc5, 0xb7, 0x1b, 0x59,
+        0x32, 0x90, 0x6b, 0x02, 0x6a, 0x0a, 0x43, 0x6d,
+        0x81, 0xa7, 0xfb, 0x81, 0x0a, 0x8a, 0x43, 0x49,
+    };
+    struct {
+        TPM2_ALG_ID alg;
+        uint32_t bits;
+        const uint8_t *key;
+    } vectors[] = {
+        { TPM2_ALG_SHA256, 1024, &kdfa_sha256[0] },
+        { TPM2_ALG_SHA1, 329, &kdfa_sha1[0] },
+    };
+    IESYS_CRYPTO_HMAC_CACHE *cache = NULL;
+    TPM2B_NONCE contextU = { .size = 16 }, contextV = { .size = 16 };
+    uint8_t hmacKey[32], out[sizeof(kdfa_sha256)], data[sizeof(xor_sha256)];
+    uint32_t counter;
+    size_t i, j;
+    TSS2_RC rc;
+
+    for (i = 0; i < sizeof(hmacKey); i++)
+        hmacKey[i] = i;
+    for (i = 0; i < contextU.size; i++) {
+        contextU.buffer[i] = 0xa0 + i;
+        contextV.buffer[i] = 0xb0 + i;
+    }
+
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        size_t size = (vectors[i].bits + 7) / 8;
+
+        memset(&out[0], 0, sizeof(out));
+        rc = iesys_crypto_KDFa(&crypto_cb, vectors[i].alg, &hmacKey[0],
+                               sizeof(hmacKey), "CFB", &contextU, &contextV,
+                               vectors[i].bits, NULL, &out[0], 0);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (&out[0], vectors[i].key, size);
+
+        memset(&out[0], 0, sizeof(out));
+        rc = iesys_crypto_KDFa_cached(&crypto_cb, NULL, vectors[i].alg,
+                                      &hmacKey[0], sizeof(hmacKey), "CFB",
+                                      &contextU, &contextV, vectors[i].bits,
+                                      NULL, &out[0], 0);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (&out[0], vectors[i].key, size);
+
+        /* The cache is keyed by the first vector and rekeyed by the second */
+        for (j = 0; j < 2; j++) {
+            counter = 0;
+            memset(&out[0], 0, sizeof(out));
+            rc = iesys_crypto_KDFa_cached(&crypto_cb, &cache, vectors[i].alg,
+                                          &hmacKey[0], sizeof(hmacKey), "CFB",
+                                          &contextU, &contextV,
+                                          vectors[i].bits, &counter, &out[0],
+                                          0);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_memory_equal (&out[0], vectors[i].key, size);
+            assert_int_not_equal (counter, 0);
+        }
+    }
+    iesys_crypto_hmac_cache_free(&cache);
+    assert_null (cache);
+
+    memset(&data[0], 0, sizeof(data));
+    rc = iesys_xor_parameter_obfuscation(&crypto_cb, TPM2_ALG_SHA256,
+                                         &hmacKey[0], sizeof(hmacKey),
+                                         &contextU, &contextV,
+                                         &data[0], sizeof(data));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (&data[0], &xor_sha256[0], sizeof(data));
+
+    rc = iesys_xor_parameter_obfuscation(&crypto_cb, TPM2_ALG_SHA256,
+                                         &hmacKey[0], sizeof(hmacKey),
+                                         &contextU, &contextV,
+                                         &data[0], sizeof(data));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    for (i = 0; i < sizeof(data); i++)
+        assert_int_equal (data[i], 0);
+}
+
+/*
+ * The single pass table computation yields the same digests as computing
+ * each parameter hash separately.
+ */
+static void
+check_phash_tab(void **state)
+{
+    uint8_t rcBuffer[4] = { 0 }, ccBuffer[4] = { 0, 0, 0x01, 0x37 };
+    uint8_t buffer[10000];
+    TPM2B_NAME name = { .size = 3, .name = { 0x40, 0x00, 0x01 } };
+    HASH_TAB_ITEM tab[HASH_TAB_MAX + 1] = {
+        { .alg = TPM2_ALG_SHA256 },
+        { .alg = TPM2_ALG_SHA384 },
+        { .alg = TPM2_ALG_SHA1 },
+    };
+    uint8_t digest[sizeof(TPMU_HA)];
+    size_t size, i;
+    TSS2_RC rc;
+
+    for (i = 0; i < sizeof(buffer); i++)
+        buffer[i] = (uint8_t)i;
+
+    rc = iesys_crypto_pHash_tab(&crypto_cb, NULL,
+                                NULL, ccBuffer, &name, NULL, &name, buffer,
+                                sizeof(buffer), &tab[0], HASH_TAB_MAX);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    for (i = 0; i < HASH_TAB_MAX; i++) {
+        size = sizeof(digest);
+        rc = iesys_crypto_cpHash(&crypto_cb,
+                                 tab[i].alg, ccBuffer, &name, NULL, &name,
+                                 buffer, sizeof(buffer), &digest[0], &size);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (size, tab[i].size);
+        assert_memory_equal (&digest[0], &tab[i].digest[0], size);
+    }
+
+    rc = iesys_crypto_pHash_tab(&crypto_cb, NULL,
+                                rcBuffer, ccBuffer, NULL, NULL, NULL, buffer,
+                                100, &tab[0], 2);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = sizeof(digest);
+    rc = iesys_crypto_rpHash(&crypto_cb,
+                             TPM2_ALG_SHA384, rcBuffer, ccBuffer, buffer, 100,
+                             &digest[0], &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (&digest[0], &tab[1].digest[0], size);
+
+    rc = iesys_crypto_pHash_tab(&crypto_cb, NULL,
+                                NULL, ccBuffer, NULL, NULL, NULL, buffer,
+                                sizeof(buffer), &tab[0], HASH_TAB_MAX + 1);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
+
+    rc = iesys_crypto_pHash_tab(&crypto_cb, NULL,
+                                NULL, NULL, NULL, NULL, NULL, buffer,
+                                sizeof(buffer), &tab[0], 1);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    tab[1].alg = 0;
+    rc = iesys_crypto_pHash_tab(&crypto_cb, NULL,
+                                NULL, ccBuffer, NULL, NULL, NULL, buffer,
+                                sizeof(buffer), &tab[0], 2);
+    assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
+
+    size = 20;
+    rc = iesys_crypto_cpHash(&crypto_cb,
+                             TPM2_ALG_SHA256, ccBuffer, NULL, NULL, NULL,
+                             buffer, sizeof(buffer), &digest[0], &size);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_SIZE);
+}
+
+/*
+ * Digest contexts taken from a hash cache yield the same parameter hashes as
+ * fresh ones and are handed out again once they were released.
+ */
+static void
+check_phash_tab_cached(void **state)
+{
+    IESYS_CRYPTO_HASH_CACHE *cache = NULL;
+    IESYS_CRYPTO_CONTEXT_BLOB *context[HASH_TAB_MAX + 1], *first, *reused;
+    uint8_t ccBuffer[4] = { 0, 0, 0x01, 0x37 };
+    uint8_t buffer[1000];
+    TPM2B_NAME name = { .size = 3, .name = { 0x40, 0x00, 0x01 } };
+    HASH_TAB_ITEM ref[2] = {
+        { .alg = TPM2_ALG_SHA256 },
+        { .alg = TPM2_ALG_SHA1 },
+    };
+    HASH_TAB_ITEM tab[2];
+    size_t i;
+    TSS2_RC rc;
+
+    for (i = 0; i < sizeof(buffer); i++)
+        buffer[i] = (uint8_t)i;
+
+    rc = iesys_crypto_pHash_tab(&crypto_cb, NULL,
+                                NULL, ccBuffer, &name, NULL, NULL, buffer,
+                                sizeof(buffer), &ref[0], 2);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    for (i = 0; i < 3; i++) {
+        memcpy(&tab[0], &ref[0], sizeof(tab));
+        memset(&tab[0].digest[0], 0, sizeof(tab[0].digest));
+        memset(&tab[1].digest[0], 0, sizeof(tab[1].digest));
+        rc = iesys_crypto_pHash_tab(&crypto_cb, &cache,
+                                    NULL, ccBuffer, &name, NULL, NULL, buffer,
+                                    sizeof(buffer), &tab[0], 2);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_non_null (cache);
+        assert_memory_equal (&tab[0], &ref[0], sizeof(tab));
+    }
+
+    /* A released context is handed out again */
+    rc = iesys_crypto_hash_start_cached(&first, &cache, TPM2_ALG_SHA256);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    reused = first;
+    iesys_crypto_hash_abort(&crypto_cb, &first);
+    assert_null (first);
+    rc = iesys_crypto_hash_start_cached(&context[0], &cache, TPM2_ALG_SHA384);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal (context[0], reused);
+
+    /* Fall back to uncached contexts while all cached ones are in use */
+    for (i = 1; i < HASH_TAB_MAX + 1; i++) {
+        rc = iesys_crypto_hash_start_cached(&context[i], &cache,
+                                            TPM2_ALG_SHA256);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    for (i = 0; i < HASH_TAB_MAX + 1; i++) {
+        rc = iesys_crypto_hash_update(&crypto_cb, context[i], &buffer[0], 10);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    tab[0].size = sizeof(tab[0].digest);
+    rc = iesys_crypto_hash_finish(&crypto_cb, &context[HASH_TAB_MAX],
+                                  &tab[0].digest[0], &tab[0].size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (tab[0].size, TPM2_SHA256_DIGEST_SIZE);
+    for (i = 0; i < HASH_TAB_MAX; i++)
+        iesys_crypto_hash_abort(&crypto_cb, &context[i]);
+
+    rc = iesys_crypto_hash_start_cached(&context[0], &cache, TPM2_ALG_SHA1);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    iesys_crypto_hash_abort(&crypto_cb, &context[0]);
+
+    rc = iesys_crypto_hash_start_cached(&context[0], &cache, 0);
+    assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
+
+    iesys_crypto_hash_cache_free(&cache);
+    assert_null (cache);
+    iesys_crypto_hash_cache_free(&cache);
+}
+
+/*
+ * The cp and rp hash tables of a command with three sessions hold one entry
+ * per distinct session hash algorithm, each equal to the parameter hash
+ * computed separately with that algorithm.
+ */
+static void
+check_phash_tab_sessions(void **state)
+{
+    ESYS_CONTEXT *ctx;
+    TSS2_TCTI_CONTEXT_COMMON_V1 tcti = {0};
+    RSRC_NODE_T sessions[3] = { 0 };
+    const TPM2_ALG_ID algs[3] = {
+        TPM2_ALG_SHA256, TPM2_ALG_SHA384, TPM2_ALG_SHA384
+    };
+    TPM2B_NAME name1 = { .size = 6, .name = { 0x00, 0x0b, 0x01, 0x00 } };
+    TPM2B_NAME name2 = { .size = 34, .name = { 0x00, 0x0b, 0x01, 0x00 } };
+    uint8_t rcBuffer[4] = { 0 }, ccBuffer[4];
+    uint8_t rpBuffer[100];
+    uint8_t digest[sizeof(TPMU_HA)];
+    const uint8_t *cpBuffer;
+    size_t cpBuffer_size, size, i;
+    HASH_TAB_ITEM tab[3];
+    uint8_t num;
+    TSS2_RC rc;
+
+    tcti.version = 1;
+    tcti.transmit = (void*) 0xdeadbeef;
+    tcti.receive = (void*) 0xdeadbeef;
+
+    rc = Esys_Initialize(&ctx, (TSS2_TCTI_CONTEXT *) &tcti, NULL);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetRandom_Prepare(ctx->sys, 32);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetCommandCode(ctx->sys, &ccBuffer[0]);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetCpBuffer(ctx->sys, &cpBuffer_size, &cpBuffer);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+
+    for (i = 0; i < 3; i++) {
+        sessions[i].rsrc.misc.rsrc_session.authHash = algs[i];
+        ctx->session_tab[i] = &sessions[i];
+    }
+    ctx->authsCount = 3;
+
+    rc = iesys_compute_cp_hashtab(ctx, &name1, &name2, NULL, &tab[0], &num);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(num, 2);
+    for (i = 0; i < num; i++) {
+        assert_int_equal(tab[i].alg, algs[i]);
+        size = sizeof(digest);
+        rc = iesys_crypto_cpHash(&crypto_cb, tab[i].alg, ccBuffer,
+                                 &name1, &name2, NULL,
+                                 cpBuffer, cpBuffer_size, &digest[0], &size);
+        assert_int_equal(rc, TSS2_RC_SUCCESS);
+        assert_int_equal(size, tab[i].size);
+        assert_memory_equal(&digest[0], &tab[i].digest[0], size);
+    }
+
+    for (i = 0; i < sizeof(rpBuffer); i++)
+        rpBuffer[i] = (uint8_t)i;
+    rc = iesys_compute_rp_hashtab(ctx, rpBuffer, sizeof(rpBuffer),
+                                  &tab[0], &num);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(num, 2);
+    for (i = 0; i < num; i++) {
+        size = sizeof(digest);
+        rc = iesys_crypto_rpHash(&crypto_cb, tab[i].alg, rcBuffer, ccBuffer,
+                                 rpBuffer, sizeof(rpBuffer), &digest[0],
+                                 &size);
+        assert_int_equal(rc, TSS2_RC_SUCCESS);
+        assert_int_equal(size, tab[i].size);
+        assert_memory_equal(&digest[0], &tab[i].digest[0], size);
+    }
+
+    for (i = 0; i < 3; i++)
+        ctx->session_tab[i] = NULL;
+    Esys_Finalize(&ctx);
 }
 
 static void
@@ -144,7 +571,7 @@ check_random(void **state)
     TSS2_RC rc;
     size_t num_bytes = 0;
     TPM2B_NONCE nonce;
-    rc = iesys_crypto_random2b(&nonce, num_bytes);
+    rc = iesys_crypto_random2b(&crypto_cb, &nonce, num_bytes);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 }
 
@@ -191,12 +618,14 @@ check_pk_encrypt(void **state)
     };
 
     inPublicRSA.publicArea.nameAlg = 0;
-    rc = iesys_crypto_pk_encrypt(&inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
+    rc = iesys_crypto_pk_encrypt(&crypto_cb,
+                                 &inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
     assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
 
     inPublicRSA.publicArea.nameAlg = TPM2_ALG_SHA1;
     inPublicRSA.publicArea.parameters.rsaDetail.scheme.scheme = 0;
-    rc = iesys_crypto_pk_encrypt(&inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
+    rc = iesys_crypto_pk_encrypt(&crypto_cb,
+                                 &inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 }
 
@@ -209,34 +638,39 @@ check_aes_encrypt(void **state)
     uint8_t buffer[5] = { 1, 2, 3, 4, 5 };
     size_t size = 5;
 
-    rc = iesys_crypto_sym_aes_encrypt(NULL, TPM2_ALG_AES, 192, TPM2_ALG_CFB,
+    rc = iesys_crypto_sym_aes_encrypt(&crypto_cb,
+                                      NULL, TPM2_ALG_AES, 192, TPM2_ALG_CFB,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 192, TPM2_ALG_CFB,
+    rc = iesys_crypto_sym_aes_encrypt(&crypto_cb,
+                                      &key[0], TPM2_ALG_AES, 192, TPM2_ALG_CFB,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 256, TPM2_ALG_CFB,
+    rc = iesys_crypto_sym_aes_encrypt(&crypto_cb,
+                                      &key[0], TPM2_ALG_AES, 256, TPM2_ALG_CFB,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], 0, 256, TPM2_ALG_CFB,
+    rc = iesys_crypto_sym_aes_encrypt(&crypto_cb, &key[0], 0, 256, TPM2_ALG_CFB,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 256, 0,
+    rc = iesys_crypto_sym_aes_encrypt(&crypto_cb, &key[0], TPM2_ALG_AES, 256, 0,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 999, TPM2_ALG_CFB,
+    rc = iesys_crypto_sym_aes_encrypt(&crypto_cb,
+                                      &key[0], TPM2_ALG_AES, 999, TPM2_ALG_CFB,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 
-    rc = iesys_crypto_sym_aes_decrypt(NULL, TPM2_ALG_AES, 192, TPM2_ALG_CFB,
+    rc = iesys_crypto_sym_aes_decrypt(&crypto_cb,
+                                      NULL, TPM2_ALG_AES, 192, TPM2_ALG_CFB,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_sym_aes_decrypt(&key[0], 0, 192, TPM2_ALG_CFB,
+    rc = iesys_crypto_sym_aes_decrypt(&crypto_cb, &key[0], 0, 192, TPM2_ALG_CFB,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 }
@@ -275,17 +709,134 @@ check_get_sys_context(void **state)
     Esys_Finalize(&ctx);
 }
 
+/* Counting wrappers around the built-in backend. */
+typedef struct {
+    ESYS_CRYPTO_CALLBACKS *inner;
+    int hash_start;
+    int hmac_start;
+    int init;
+} CALLBACK_COUNTERS;
+
+static TSS2_RC
+count_hash_start(ESYS_CRYPTO_CONTEXT_BLOB **context, TPM2_ALG_ID hashAlg,
+                 void *userdata)
+{
+    CALLBACK_COUNTERS *counters = userdata;
+
+    counters->hash_start++;
+    return counters->inner->hash_start(context, hashAlg,
+                                       counters->inner->userdata);
+}
+
+static TSS2_RC
+count_hmac_start(ESYS_CRYPTO_CONTEXT_BLOB **context, TPM2_ALG_ID hashAlg,
+                 const uint8_t *key, size_t size, void *userdata)
+{
+    CALLBACK_COUNTERS *counters = userdata;
+
+    counters->hmac_start++;
+    return counters->inner->hmac_start(context, hashAlg, key, size,
+                                       counters->inner->userdata);
+}
+
+static TSS2_RC
+count_init(void *userdata)
+{
+    CALLBACK_COUNTERS *counters = userdata;
+
+    counters->init++;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+check_crypto_callbacks(void **state)
+{
+    ESYS_CONTEXT *ctx;
+    TSS2_TCTI_CONTEXT_COMMON_V1 tcti = {0};
+    ESYS_CRYPTO_CALLBACKS callbacks;
+    CALLBACK_COUNTERS counters = { .inner = &crypto_cb };
+    TPM2B_NAME name = { .size = 4, .name = { 0x00, 0x0b, 0x01, 0x02 } };
+    uint8_t key[32], buffer[64];
+    TPM2B_NONCE nonce = { .size = 4, .buffer = { 1, 2, 3, 4 } };
+    TPM2B_AUTH hmac = { .size = sizeof(hmac.buffer) };
+    size_t size = sizeof(buffer);
+    TSS2_RC rc;
+
+    memset(&key[0], 0x33, sizeof(key));
+
+    tcti.version = 1;
+    tcti.transmit = (void*) 0xdeadbeef;
+    tcti.receive = (void*) 0xdeadbeef;
+
+    rc = Esys_Initialize(&ctx, (TSS2_TCTI_CONTEXT *) &tcti, NULL);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+
+    rc = Esys_SetCryptoCallbacks(NULL, NULL);
+    assert_int_equal(rc, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    callbacks = crypto_cb;
+    callbacks.hmac_finish = NULL;
+    rc = Esys_SetCryptoCallbacks(ctx, &callbacks);
+    assert_int_equal(rc, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    callbacks = crypto_cb;
+    callbacks.hash_start = count_hash_start;
+    callbacks.hmac_start = count_hmac_start;
+    callbacks.init = count_init;
+    callbacks.userdata = &counters;
+    rc = Esys_SetCryptoCallbacks(ctx, &callbacks);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(counters.init, 1);
+
+    /* Derived operations are routed through the installed callbacks. */
+    rc = iesys_crypto_cpHash(&ctx->crypto_backend, TPM2_ALG_SHA256,
+                             &buffer[0], &name, NULL, NULL, &key[0],
+                             sizeof(key), &buffer[0], &size);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(counters.hash_start, 1);
+
+    rc = iesys_crypto_KDFa(&ctx->crypto_backend, TPM2_ALG_SHA256, &key[0],
+                           sizeof(key), "ATH", &nonce, &nonce, 256, NULL,
+                           &buffer[0], 0);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(counters.hmac_start, 1);
+
+    rc = iesys_crypto_authHmac(&ctx->crypto_backend, TPM2_ALG_SHA256, NULL,
+                               &key[0], sizeof(key), &buffer[0], 32,
+                               &nonce, &nonce, NULL, NULL, 0, &hmac);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(counters.hmac_start, 2);
+
+    /* NULL restores the built-in backend. */
+    rc = Esys_SetCryptoCallbacks(ctx, NULL);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    size = sizeof(buffer);
+    rc = iesys_crypto_cpHash(&ctx->crypto_backend, TPM2_ALG_SHA256,
+                             &buffer[0], &name, NULL, NULL, &key[0],
+                             sizeof(key), &buffer[0], &size);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(counters.hash_start, 1);
+
+    Esys_Finalize(&ctx);
+}
+
 int
 main(int argc, char *argv[])
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(check_hash_functions),
         cmocka_unit_test(check_hmac_functions),
+        cmocka_unit_test(check_hmac_cache),
+        cmocka_unit_test(check_kdfa_cached),
+        cmocka_unit_test(check_phash_tab),
+        cmocka_unit_test(check_phash_tab_cached),
+        cmocka_unit_test(check_phash_tab_sessions),
         cmocka_unit_test(check_random),
         cmocka_unit_test(check_pk_encrypt),
         cmocka_unit_test(check_aes_encrypt),
         cmocka_unit_test(check_free),
         cmocka_unit_test(check_get_sys_context),
+        cmocka_unit_test(check_crypto_callbacks),
     };
-    return cmocka_run_group_tests(tests, NULL, NULL);
+    return cmocka_run_group_tests(tests, setup_crypto_cb, NULL);
 }
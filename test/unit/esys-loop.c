@@ -0,0 +1,479 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+
+#include "tss2-esys/esys_int.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * These tests drive several ESYS_CONTEXTs with pending Esys_GetRandom_Async
+ * commands through an ESYS_LOOP. Each context sits on a fake TCTI whose poll
+ * handle is the read end of a pipe: writing a byte to the pipe makes the
+ * response to the pending command available.
+ */
+
+#define TCTI_PIPE_MAGIC 0x5049504500000000ULL        /* 'PIPE\0' */
+#define TCTI_PIPE_VERSION 0x1
+
+#define CONTEXTS 4
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    int fd;
+    int ready;
+} TSS2_TCTI_CONTEXT_PIPE;
+
+typedef struct {
+    int pipes[CONTEXTS][2];
+    TSS2_TCTI_CONTEXT_PIPE tcti[CONTEXTS];
+    ESYS_CONTEXT *esys[CONTEXTS];
+    ESYS_LOOP *loop;
+} loop_state;
+
+typedef struct {
+    int calls;
+    int commands;
+} callback_data;
+
+/* TPM2_GetRandom response with 4 bytes */
+static const uint8_t response[] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x04, 0x01, 0x02, 0x03, 0x04
+};
+
+static TSS2_TCTI_CONTEXT_PIPE *
+tcti_pipe_cast(TSS2_TCTI_CONTEXT * ctx)
+{
+    TSS2_TCTI_CONTEXT_PIPE *ctxi = (TSS2_TCTI_CONTEXT_PIPE *) ctx;
+    if (ctxi == NULL || ctxi->magic != TCTI_PIPE_MAGIC) {
+        LOG_ERROR("Bad tcti passed.");
+        exit(1);
+    }
+    return ctxi;
+}
+
+static TSS2_RC
+tcti_pipe_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                   size_t size, const uint8_t * buffer)
+{
+    UNUSED(size);
+    UNUSED(buffer);
+    tcti_pipe_cast(tctiContext);
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * The size query consumes one byte from the pipe if there is one and
+ * returns TRY_AGAIN otherwise.
+ */
+static TSS2_RC
+tcti_pipe_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                  size_t * response_size,
+                  uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_PIPE *tcti = tcti_pipe_cast(tctiContext);
+    struct pollfd pfd = { .fd = tcti->fd, .events = POLLIN };
+    uint8_t byte;
+
+    if (!tcti->ready) {
+        if (poll(&pfd, 1, timeout) <= 0 || read(tcti->fd, &byte, 1) != 1)
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        tcti->ready = 1;
+    }
+    if (response_buffer == NULL) {
+        *response_size = sizeof(response);
+        return TSS2_RC_SUCCESS;
+    }
+    assert_true(*response_size >= sizeof(response));
+    memcpy(response_buffer, response, sizeof(response));
+    *response_size = sizeof(response);
+    tcti->ready = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_pipe_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    UNUSED(tctiContext);
+}
+
+static TSS2_RC
+tcti_pipe_getpollhandles(TSS2_TCTI_CONTEXT * tctiContext,
+                         TSS2_TCTI_POLL_HANDLE * handles,
+                         size_t * num_handles)
+{
+    TSS2_TCTI_CONTEXT_PIPE *tcti = tcti_pipe_cast(tctiContext);
+
+    if (handles != NULL) {
+        assert_int_equal(*num_handles, 1);
+        handles[0].fd = tcti->fd;
+        handles[0].events = POLLIN;
+    }
+    *num_handles = 1;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_pipe_initialize(TSS2_TCTI_CONTEXT_PIPE * tcti, int fd)
+{
+    TSS2_TCTI_CONTEXT *tctiContext = (TSS2_TCTI_CONTEXT *) tcti;
+
+    memset(tcti, 0, sizeof(*tcti));
+    TSS2_TCTI_MAGIC(tctiContext) = TCTI_PIPE_MAGIC;
+    TSS2_TCTI_VERSION(tctiContext) = TCTI_PIPE_VERSION;
+    TSS2_TCTI_TRANSMIT(tctiContext) = tcti_pipe_transmit;
+    TSS2_TCTI_RECEIVE(tctiContext) = tcti_pipe_receive;
+    TSS2_TCTI_FINALIZE(tctiContext) = tcti_pipe_finalize;
+    TSS2_TCTI_CANCEL(tctiContext) = NULL;
+    TSS2_TCTI_GET_POLL_HANDLES(tctiContext) = tcti_pipe_getpollhandles;
+    TSS2_TCTI_SET_LOCALITY(tctiContext) = NULL;
+    tcti->fd = fd;
+}
+
+static int
+setup(void **state)
+{
+    loop_state *ls = calloc(1, sizeof(*ls));
+    TSS2_RC r;
+    int i;
+
+    assert_non_null(ls);
+    for (i = 0; i < CONTEXTS; i++) {
+        assert_int_equal(pipe(ls->pipes[i]), 0);
+        tcti_pipe_initialize(&ls->tcti[i], ls->pipes[i][0]);
+        r = Esys_Initialize(&ls->esys[i], (TSS2_TCTI_CONTEXT *) &ls->tcti[i],
+                            NULL);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+    r = Esys_Loop_Initialize(&ls->loop);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    *state = ls;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    loop_state *ls = *state;
+    int i;
+
+    Esys_Loop_Finalize(&ls->loop);
+    assert_null(ls->loop);
+    for (i = 0; i < CONTEXTS; i++) {
+        Esys_Finalize(&ls->esys[i]);
+        close(ls->pipes[i][0]);
+        close(ls->pipes[i][1]);
+    }
+    free(ls);
+    return 0;
+}
+
+static void
+getrandom_async(ESYS_CONTEXT *esys_context)
+{
+    TSS2_RC r;
+
+    r = Esys_GetRandom_Async(esys_context, ESYS_TR_NONE, ESYS_TR_NONE,
+                             ESYS_TR_NONE, 4);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static void
+respond(int fd)
+{
+    assert_int_equal(write(fd, "x", 1), 1);
+}
+
+/* Finish the command and start another one until 'commands' are done. */
+static TSS2_RC
+getrandom_callback(ESYS_CONTEXT *esys_context, void *userdata)
+{
+    callback_data *data = userdata;
+    TPM2B_DIGEST *random_bytes = NULL;
+    TSS2_RC r;
+
+    data->calls++;
+    r = Esys_GetRandom_Finish(esys_context, &random_bytes);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+    assert_int_equal(random_bytes->size, 4);
+    free(random_bytes);
+
+    if (--data->commands == 0)
+        return TSS2_RC_SUCCESS;
+    getrandom_async(esys_context);
+    return TSS2_ESYS_RC_TRY_AGAIN;
+}
+
+static void
+esys_loop_run(void **state)
+{
+    loop_state *ls = *state;
+    callback_data data[CONTEXTS] = {{ 0 }};
+    TSS2_RC r;
+    int i;
+
+    for (i = 0; i < CONTEXTS; i++) {
+        data[i].commands = 1;
+        getrandom_async(ls->esys[i]);
+        r = Esys_Loop_Add(ls->loop, ls->esys[i], getrandom_callback, &data[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+
+    /* Nothing to read yet */
+    r = Esys_Loop_Dispatch(ls->loop, 0);
+    assert_int_equal(r, TSS2_ESYS_RC_TRY_AGAIN);
+
+    /* Only the second context becomes ready */
+    respond(ls->pipes[1][1]);
+    r = Esys_Loop_Dispatch(ls->loop, -1);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    for (i = 0; i < CONTEXTS; i++)
+        assert_int_equal(data[i].calls, i == 1 ? 1 : 0);
+
+    for (i = CONTEXTS - 1; i >= 0; i--) {
+        if (i != 1)
+            respond(ls->pipes[i][1]);
+    }
+    r = Esys_Loop_Run(ls->loop);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    for (i = 0; i < CONTEXTS; i++) {
+        assert_int_equal(data[i].calls, 1);
+        assert_int_equal(data[i].commands, 0);
+    }
+
+    /* The loop is empty now */
+    r = Esys_Loop_Dispatch(ls->loop, -1);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static void
+esys_loop_try_again(void **state)
+{
+    loop_state *ls = *state;
+    callback_data data = { .commands = 3 };
+    TSS2_RC r;
+    int i;
+
+    getrandom_async(ls->esys[0]);
+    r = Esys_Loop_Add(ls->loop, ls->esys[0], getrandom_callback, &data);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* A callback returning TRY_AGAIN keeps its context in the loop */
+    for (i = 0; i < 3; i++)
+        respond(ls->pipes[0][1]);
+    r = Esys_Loop_Run(ls->loop);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(data.calls, 3);
+    assert_int_equal(data.commands, 0);
+}
+
+static void
+esys_loop_shared_fd(void **state)
+{
+    loop_state *ls = *state;
+    callback_data data[2] = {{ .commands = 1 }, { .commands = 1 }};
+    TSS2_RC r;
+    int i;
+
+    /* Both contexts wait on the same pipe */
+    ls->tcti[1].fd = ls->pipes[0][0];
+    for (i = 0; i < 2; i++) {
+        getrandom_async(ls->esys[i]);
+        r = Esys_Loop_Add(ls->loop, ls->esys[i], getrandom_callback, &data[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+
+    /*
+     * One response wakes up both contexts. The first one takes it, the
+     * second one sees TRY_AGAIN from the TCTI and stays in the loop.
+     */
+    respond(ls->pipes[0][1]);
+    r = Esys_Loop_Dispatch(ls->loop, -1);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(data[0].commands + data[1].commands, 1);
+
+    respond(ls->pipes[0][1]);
+    r = Esys_Loop_Run(ls->loop);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(data[0].commands, 0);
+    assert_int_equal(data[1].commands, 0);
+}
+
+typedef struct {
+    loop_state *ls;
+    int calls;
+} reopen_data;
+
+/*
+ * Close the pipe of the first context and open a new one whose read end gets
+ * the same fd number, like a TCTI reconnecting between two commands.
+ */
+static TSS2_RC
+reopen_callback(ESYS_CONTEXT *esys_context, void *userdata)
+{
+    reopen_data *data = userdata;
+    TPM2B_DIGEST *random_bytes = NULL;
+    int *fds = data->ls->pipes[0];
+    int new_fds[2];
+    TSS2_RC r;
+
+    data->calls++;
+    r = Esys_GetRandom_Finish(esys_context, &random_bytes);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+    free(random_bytes);
+    if (data->calls > 1)
+        return TSS2_RC_SUCCESS;
+
+    close(fds[0]);
+    close(fds[1]);
+    assert_int_equal(pipe(new_fds), 0);
+    if (new_fds[0] != fds[0]) {
+        assert_int_equal(dup2(new_fds[0], fds[0]), fds[0]);
+        close(new_fds[0]);
+    }
+    fds[1] = new_fds[1];
+
+    getrandom_async(esys_context);
+    return TSS2_ESYS_RC_TRY_AGAIN;
+}
+
+static void
+esys_loop_reopen_fd(void **state)
+{
+    loop_state *ls = *state;
+    reopen_data data = { .ls = ls };
+    TSS2_RC r;
+
+    getrandom_async(ls->esys[0]);
+    r = Esys_Loop_Add(ls->loop, ls->esys[0], reopen_callback, &data);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    respond(ls->pipes[0][1]);
+    r = Esys_Loop_Dispatch(ls->loop, -1);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(data.calls, 1);
+
+    /* The new pipe behind the same fd number wakes the loop up */
+    respond(ls->pipes[0][1]);
+    r = Esys_Loop_Dispatch(ls->loop, 1000);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(data.calls, 2);
+}
+
+static void
+esys_loop_remove(void **state)
+{
+    loop_state *ls = *state;
+    callback_data data = { .commands = 1 };
+    TSS2_RC r;
+
+    getrandom_async(ls->esys[0]);
+    r = Esys_Loop_Add(ls->loop, ls->esys[0], getrandom_callback, &data);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_Loop_Remove(ls->loop, ls->esys[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_Loop_Remove(ls->loop, ls->esys[0]);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+
+    respond(ls->pipes[0][1]);
+    r = Esys_Loop_Run(ls->loop);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(data.calls, 0);
+}
+
+static void
+esys_loop_timeout(void **state)
+{
+    loop_state *ls = *state;
+    callback_data data[2] = {{ .commands = 1 }, { .commands = 1 }};
+    TSS2_RC r;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        r = Esys_SetTimeout(ls->esys[i], 100 + i);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        getrandom_async(ls->esys[i]);
+        r = Esys_Loop_Add(ls->loop, ls->esys[i], getrandom_callback, &data[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(ls->esys[i]->timeout, 0);
+    }
+    /* Adding again does not lose the timeout to restore */
+    r = Esys_Loop_Add(ls->loop, ls->esys[0], getrandom_callback, &data[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* Both removing a context and finishing its command restore it */
+    r = Esys_Loop_Remove(ls->loop, ls->esys[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(ls->esys[0]->timeout, 100);
+    respond(ls->pipes[1][1]);
+    r = Esys_Loop_Run(ls->loop);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(data[1].commands, 0);
+    assert_int_equal(ls->esys[1]->timeout, 101);
+}
+
+static void
+esys_loop_bad_reference(void **state)
+{
+    loop_state *ls = *state;
+    TSS2_RC r;
+
+    r = Esys_Loop_Initialize(NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Loop_Add(ls->loop, ls->esys[0], NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Loop_Add(NULL, ls->esys[0], getrandom_callback, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Loop_Dispatch(NULL, 0);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Loop_Run(NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(esys_loop_run, setup, teardown),
+        cmocka_unit_test_setup_teardown(esys_loop_try_again, setup, teardown),
+        cmocka_unit_test_setup_teardown(esys_loop_shared_fd, setup, teardown),
+        cmocka_unit_test_setup_teardown(esys_loop_reopen_fd, setup, teardown),
+        cmocka_unit_test_setup_teardown(esys_loop_remove, setup, teardown),
+        cmocka_unit_test_setup_teardown(esys_loop_timeout, setup, teardown),
+        cmocka_unit_test_setup_teardown(esys_loop_bad_reference, setup,
+                                        teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
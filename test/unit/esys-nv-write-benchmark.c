@@ -0,0 +1,199 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+#include "benchmark.h"
+
+/*
+ * Issue repeated NV_Write commands on the same NV index against a fake TPM and
+ * count the hash computations started by ESAPI. The name of the index only has
+ * to be computed again by the first write, which sets TPMA_NV_WRITTEN; later
+ * writes and Esys_TR_GetName reuse the name memoized in the resource. The time
+ * of a single name computation is reported as the amount saved per command.
+ * The memoization itself is checked by esys-nv-write. It is not part of the
+ * test suite and is run by 'make benchmark'.
+ */
+
+#define ITERATIONS 2000
+#define NV_HANDLE 0x01000001
+
+#define TCTI_NV_MAGIC 0x4e56000000000000ULL        /* 'NV\0' */
+#define TCTI_NV_VERSION 0x1
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command_code;
+} TSS2_TCTI_CONTEXT_NV;
+
+/* TPM2_NV_ReadPublic response for an unwritten NV_HANDLE using SHA256 */
+static const uint8_t nv_read_public_rsp[] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x3e, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x0e, 0x01, 0x00, 0x00, 0x01, 0x00, 0x0b, 0x00, 0x04,
+    0x00, 0x04, 0x00, 0x00, 0x00, 0x40,
+    0x00, 0x22, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Successful response to a command with a password session */
+static const uint8_t password_rsp[] = {
+    0x80, 0x02, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00
+};
+
+static ESYS_CRYPTO_HASH_START_FNP default_hash_start;
+static int hash_count;
+
+static TSS2_RC
+counting_hash_start(ESYS_CRYPTO_CONTEXT_BLOB **context, TPM2_ALG_ID hashAlg,
+                    void *userdata)
+{
+    hash_count++;
+    return default_hash_start(context, hashAlg, userdata);
+}
+
+static TSS2_RC
+tcti_nv_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                 size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_NV *tcti = (TSS2_TCTI_CONTEXT_NV *) tctiContext;
+    size_t offset = 6;
+
+    return Tss2_MU_UINT32_Unmarshal(buffer, size, &offset,
+                                    &tcti->command_code);
+}
+
+static TSS2_RC
+tcti_nv_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                size_t * response_size,
+                uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_NV *tcti = (TSS2_TCTI_CONTEXT_NV *) tctiContext;
+    const uint8_t *rsp = password_rsp;
+    size_t rsp_size = sizeof(password_rsp);
+    UNUSED(timeout);
+
+    if (tcti->command_code == TPM2_CC_NV_ReadPublic) {
+        rsp = nv_read_public_rsp;
+        rsp_size = sizeof(nv_read_public_rsp);
+    }
+    if (response_buffer != NULL)
+        memcpy(response_buffer, rsp, rsp_size);
+    *response_size = rsp_size;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_nv_initialize(TSS2_TCTI_CONTEXT_NV * tcti)
+{
+    TSS2_TCTI_CONTEXT *tctiContext = (TSS2_TCTI_CONTEXT *) tcti;
+
+    memset(tcti, 0, sizeof(*tcti));
+    TSS2_TCTI_MAGIC(tctiContext) = TCTI_NV_MAGIC;
+    TSS2_TCTI_VERSION(tctiContext) = TCTI_NV_VERSION;
+    TSS2_TCTI_TRANSMIT(tctiContext) = tcti_nv_transmit;
+    TSS2_TCTI_RECEIVE(tctiContext) = tcti_nv_receive;
+}
+
+static void
+nv_write_benchmark(void **state)
+{
+    TSS2_TCTI_CONTEXT_NV tcti;
+    ESYS_CONTEXT *esys_context;
+    ESYS_CRYPTO_CALLBACKS crypto_cb;
+    TPM2B_MAX_NV_BUFFER data = { .size = 32 };
+    TPM2B_NV_PUBLIC nv_public = {
+        .size = 14,
+        .nvPublic = {
+            .nvIndex = NV_HANDLE,
+            .nameAlg = TPM2_ALG_SHA256,
+            .attributes = TPMA_NV_AUTHWRITE | TPMA_NV_AUTHREAD |
+                          TPMA_NV_WRITTEN,
+            .dataSize = 64,
+        },
+    };
+    TPM2B_NAME name;
+    ESYS_TR nv_index;
+    struct timespec start, end;
+    TSS2_RC rc;
+    int i;
+    UNUSED(state);
+
+    rc = iesys_initialize_crypto_backend(&crypto_cb, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    default_hash_start = crypto_cb.hash_start;
+    crypto_cb.hash_start = counting_hash_start;
+
+    tcti_nv_initialize(&tcti);
+    rc = Esys_Initialize(&esys_context, (TSS2_TCTI_CONTEXT *) &tcti, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Esys_SetCryptoCallbacks(esys_context, &crypto_cb);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Esys_TR_FromTPMPublic(esys_context, NV_HANDLE, ESYS_TR_NONE,
+                               ESYS_TR_NONE, ESYS_TR_NONE, &nv_index);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    hash_count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ITERATIONS; i++) {
+        rc = Esys_NV_Write(esys_context, nv_index, nv_index,
+                           ESYS_TR_PASSWORD, ESYS_TR_NONE, ESYS_TR_NONE,
+                           &data, 0);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%d NV_Write: %.1f ns per command, %d name computations\n",
+           ITERATIONS, elapsed_ns(&start, &end) / ITERATIONS, hash_count);
+
+    /* The written index as computed from scratch */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ITERATIONS; i++) {
+        rc = iesys_nv_get_name(&crypto_cb, &nv_public, &name);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Name computation saved per NV_Write: %.1f ns\n",
+           elapsed_ns(&start, &end) / ITERATIONS);
+
+    Esys_Finalize(&esys_context);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(nv_write_benchmark),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+#include "benchmark.h"
+
+/**
+ * Look up the objects in the resource table of the ESYS_CONTEXT for different
+ * numbers of objects and report the time per lookup, in order to show that it
+ * does not depend on the number of objects. The functional checks of the table
+ * are done by esys-rsrc-table. It is run by 'make benchmark'.
+ */
+
+#define ITERATIONS 10
+
+static void
+lookup_benchmark(size_t count)
+{
+    ESYS_CONTEXT *ectx = calloc(1, sizeof(ESYS_CONTEXT));
+    struct timespec start, end;
+    RSRC_NODE_T *node;
+    TSS2_RC r;
+    size_t i;
+    int j;
+
+    assert_non_null(ectx);
+    for (i = 0; i < count; i++) {
+        r = esys_CreateResourceObject(ectx, ESYS_TR_MIN_OBJECT + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (j = 0; j < ITERATIONS; j++) {
+        for (i = 0; i < count; i++) {
+            r = esys_GetResourceObject(ectx, ESYS_TR_MIN_OBJECT + i, &node);
+            assert_int_equal(r, TSS2_RC_SUCCESS);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%zu objects: %.1f ns per lookup\n", count,
+           elapsed_ns(&start, &end) / (count * ITERATIONS));
+
+    iesys_DeleteAllResourceObjects(ectx);
+    free(ectx);
+}
+
+static void
+rsrc_table_benchmark(void **state)
+{
+    UNUSED(state);
+
+    lookup_benchmark(10);
+    lookup_benchmark(1000);
+    lookup_benchmark(100000);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(rsrc_table_benchmark),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,218 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the resource table of the ESYS_CONTEXT. Objects are
+ * created, looked up and deleted for different numbers of objects, so that the
+ * table has to be resized several times. Additionally the reuse of freed
+ * objects through the pool of the context is checked.
+ */
+
+static int
+setup(void **state)
+{
+    ESYS_CONTEXT *ectx = calloc(1, sizeof(ESYS_CONTEXT));
+    if (ectx == NULL)
+        return -1;
+    *state = ectx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    iesys_DeleteAllResourceObjects(ectx);
+    assert_null(ectx->rsrc_table);
+    assert_int_equal(ectx->rsrc_count, 0);
+    ectx->pool_size = 0;
+    iesys_pool_trim(ectx);
+    free(ectx);
+    return 0;
+}
+
+static void
+check_rsrc_table(ESYS_CONTEXT *ectx, size_t count)
+{
+    TSS2_RC r;
+    size_t i;
+    RSRC_NODE_T *node;
+    RSRC_NODE_T **nodes = calloc(count, sizeof(RSRC_NODE_T *));
+
+    assert_non_null(nodes);
+
+    for (i = 0; i < count; i++) {
+        r = esys_CreateResourceObject(ectx, ESYS_TR_MIN_OBJECT + i, &nodes[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        nodes[i]->rsrc.handle = TPM2_TRANSIENT_FIRST + i;
+    }
+    assert_int_equal(ectx->rsrc_count, count);
+
+    /* Objects must not have been moved while the table was grown */
+    for (i = 0; i < count; i++) {
+        r = esys_GetResourceObject(ectx, ESYS_TR_MIN_OBJECT + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_ptr_equal(node, nodes[i]);
+    }
+
+    /* Global handles are created on demand next to the objects */
+    r = esys_GetResourceObject(ectx, ESYS_TR_RH_OWNER, &node);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(node->rsrc.handle, TPM2_RH_OWNER);
+    assert_int_equal(ectx->rsrc_count, count + 1);
+
+    /* Delete every second object */
+    for (i = 0; i < count; i += 2) {
+        r = iesys_DeleteResourceObject(ectx, ESYS_TR_MIN_OBJECT + i);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+    r = iesys_DeleteResourceObject(ectx, ESYS_TR_MIN_OBJECT);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+
+    r = esys_GetResourceObject(ectx, ESYS_TR_MIN_OBJECT + count - 1 -
+                               (count - 1) % 2, &node);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+
+    for (i = 1; i < count; i += 2) {
+        r = esys_GetResourceObject(ectx, ESYS_TR_MIN_OBJECT + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(node->rsrc.handle, TPM2_TRANSIENT_FIRST + i);
+    }
+    assert_int_equal(ectx->rsrc_count, count / 2 + 1);
+
+    free(nodes);
+}
+
+static void
+test_rsrc_table_10(void **state)
+{
+    check_rsrc_table((ESYS_CONTEXT *) * state, 10);
+}
+
+static void
+test_rsrc_table_1k(void **state)
+{
+    check_rsrc_table((ESYS_CONTEXT *) * state, 1000);
+}
+
+static void
+test_rsrc_table_100k(void **state)
+{
+    check_rsrc_table((ESYS_CONTEXT *) * state, 100000);
+}
+
+static void
+test_rsrc_table_empty(void **state)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *node;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    r = esys_GetResourceObject(ectx, ESYS_TR_MIN_OBJECT, &node);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+
+    r = iesys_DeleteResourceObject(ectx, ESYS_TR_MIN_OBJECT);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+
+    r = esys_GetResourceObject(ectx, ESYS_TR_NONE, &node);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_null(node);
+}
+
+static void
+test_rsrc_pool(void **state)
+{
+    TSS2_RC r;
+    size_t i, j;
+    RSRC_NODE_T *nodes[10];
+    RSRC_NODE_T *node;
+    TPM2B_NAME *name;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    ectx->pool_size = 4;
+
+    for (i = 0; i < 10; i++) {
+        r = esys_CreateResourceObject(ectx, ESYS_TR_MIN_OBJECT + i, &nodes[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        nodes[i]->rsrc.handle = TPM2_TRANSIENT_FIRST + i;
+    }
+
+    /* Only pool_size of the freed objects are kept */
+    for (i = 0; i < 10; i++) {
+        r = iesys_DeleteResourceObject(ectx, ESYS_TR_MIN_OBJECT + i);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal(ectx->pool[0].size, sizeof(RSRC_NODE_T));
+    assert_int_equal(ectx->pool[0].count, 4);
+
+    /* The kept objects are reused and cleared */
+    for (i = 0; i < 4; i++) {
+        r = esys_CreateResourceObject(ectx, ESYS_TR_MIN_OBJECT + 10 + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(node->rsrc.handle, 0);
+        assert_int_equal(node->esys_handle, ESYS_TR_MIN_OBJECT + 10 + i);
+        for (j = 0; j < 4; j++) {
+            if (node == nodes[j])
+                break;
+        }
+        assert_int_not_equal(j, 4);
+    }
+    assert_int_equal(ectx->pool[0].count, 0);
+
+    /* Blocks of different sizes are kept in separate lists */
+    name = iesys_pool_calloc(ectx, sizeof(TPM2B_NAME));
+    assert_non_null(name);
+    name->size = sizeof(name->name);
+    memset(name->name, 0xaa, sizeof(name->name));
+    iesys_pool_free(ectx, name, sizeof(TPM2B_NAME));
+    /* Nothing but the list link is left in a pooled block */
+    for (j = sizeof(void *); j < sizeof(TPM2B_NAME); j++)
+        assert_int_equal(((uint8_t *) name)[j], 0);
+    iesys_pool_free(ectx, NULL, sizeof(TPM2B_NAME));
+    assert_int_equal(ectx->pool[1].size, sizeof(TPM2B_NAME));
+    assert_int_equal(ectx->pool[1].count, 1);
+    assert_ptr_equal(iesys_pool_calloc(ectx, sizeof(TPM2B_NAME)), name);
+    iesys_pool_free(ectx, name, sizeof(TPM2B_NAME));
+
+    /* Disabling the pool frees all kept blocks */
+    ectx->pool_size = 0;
+    iesys_pool_trim(ectx);
+    assert_int_equal(ectx->pool[1].count, 0);
+    assert_int_equal(ectx->pool[1].size, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_rsrc_table_empty, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_rsrc_table_10, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_rsrc_table_1k, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_rsrc_table_100k, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_rsrc_pool, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -586,10 +586,14 @@ check_Hash(void **state)
     };
     TPM2B_DIGEST *outHash;
     TPMT_TK_HASHCHECK *validation;
+    TPM2B_DIGEST outHashData;
+    TPMT_TK_HASHCHECK validationData;
     for (size_t i = 0; i < sizeof(esys_states) / sizeof(esys_states[0]); i++) {
         esys_context->state = esys_states[i];
         r = Esys_Hash_Finish(esys_context, &outHash, &validation);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_Hash_Finish_Into(esys_context, &outHashData, &validationData);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -603,10 +607,13 @@ check_HMAC(void **state)
         _ESYS_STATE_INTERNALERROR
     };
     TPM2B_DIGEST *outHMAC;
+    TPM2B_DIGEST outHMACData;
     for (size_t i = 0; i < sizeof(esys_states) / sizeof(esys_states[0]); i++) {
         esys_context->state = esys_states[i];
         r = Esys_HMAC_Finish(esys_context, &outHMAC);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_HMAC_Finish_Into(esys_context, &outHMACData);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -620,10 +627,13 @@ check_GetRandom(void **state)
         _ESYS_STATE_INTERNALERROR
     };
     TPM2B_DIGEST *randomBytes;
+    TPM2B_DIGEST randomBytesData;
     for (size_t i = 0; i < sizeof(esys_states) / sizeof(esys_states[0]); i++) {
         esys_context->state = esys_states[i];
         r = Esys_GetRandom_Finish(esys_context, &randomBytes);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_GetRandom_Finish_Into(esys_context, &randomBytesData);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -903,10 +913,13 @@ check_Sign(void **state)
         _ESYS_STATE_INTERNALERROR
     };
     TPMT_SIGNATURE *signature;
+    TPMT_SIGNATURE signatureData;
     for (size_t i = 0; i < sizeof(esys_states) / sizeof(esys_states[0]); i++) {
         esys_context->state = esys_states[i];
         r = Esys_Sign_Finish(esys_context, &signature);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_Sign_Finish_Into(esys_context, &signatureData);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -0,0 +1,346 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * These tests attach persistent objects and NV indices with
+ * Esys_TR_FromTPMPublic on several ESYS_CONTEXTs and count the commands that
+ * reach the TPM, with and without the shared metadata cache.
+ */
+
+#define TCTI_COUNT_MAGIC 0x434f554e54000000ULL        /* 'COUNT\0' */
+#define TCTI_COUNT_VERSION 0x1
+
+#define CONTEXTS 3
+#define THREADS 8
+#define THREAD_ITERATIONS 100
+
+#define PERSISTENT_HANDLE 0x81000001
+#define NV_HANDLE 0x01000001
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command_code;
+    int commands;
+} TSS2_TCTI_CONTEXT_COUNT;
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_COUNT tcti[THREADS];
+    ESYS_CONTEXT *esys[THREADS];
+} cache_state;
+
+/* TPM2_ReadPublic response for a keyed hash object with a 4 byte name */
+static const uint8_t read_public_rsp[] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x22, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x0e, 0x00, 0x08, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x10, 0x00, 0x00,
+    0x00, 0x04, 0x00, 0x0b, 0xaa, 0xbb,
+    0x00, 0x00
+};
+
+/* TPM2_NV_ReadPublic response for NV_HANDLE with a 4 byte name */
+static const uint8_t nv_read_public_rsp[] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x0e, 0x01, 0x00, 0x00, 0x01, 0x00, 0x0b, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x20,
+    0x00, 0x04, 0x00, 0x0b, 0xcc, 0xdd
+};
+
+/* Successful response to a command with a password session */
+static const uint8_t password_rsp[] = {
+    0x80, 0x02, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00
+};
+
+static TSS2_TCTI_CONTEXT_COUNT *
+tcti_count_cast(TSS2_TCTI_CONTEXT * ctx)
+{
+    TSS2_TCTI_CONTEXT_COUNT *ctxi = (TSS2_TCTI_CONTEXT_COUNT *) ctx;
+    if (ctxi == NULL || ctxi->magic != TCTI_COUNT_MAGIC) {
+        LOG_ERROR("Bad tcti passed.");
+        exit(1);
+    }
+    return ctxi;
+}
+
+static TSS2_RC
+tcti_count_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                    size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_COUNT *tcti = tcti_count_cast(tctiContext);
+    size_t offset = 6;
+
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, &offset,
+                                              &tcti->command_code),
+                     TSS2_RC_SUCCESS);
+    tcti->commands++;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_count_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                   size_t * response_size,
+                   uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_COUNT *tcti = tcti_count_cast(tctiContext);
+    const uint8_t *rsp;
+    size_t rsp_size;
+    UNUSED(timeout);
+
+    switch (tcti->command_code) {
+    case TPM2_CC_ReadPublic:
+        rsp = read_public_rsp;
+        rsp_size = sizeof(read_public_rsp);
+        break;
+    case TPM2_CC_NV_ReadPublic:
+        rsp = nv_read_public_rsp;
+        rsp_size = sizeof(nv_read_public_rsp);
+        break;
+    default:
+        rsp = password_rsp;
+        rsp_size = sizeof(password_rsp);
+        break;
+    }
+    if (response_buffer != NULL) {
+        assert_true(*response_size >= rsp_size);
+        memcpy(response_buffer, rsp, rsp_size);
+    }
+    *response_size = rsp_size;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_count_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    UNUSED(tctiContext);
+}
+
+static void
+tcti_count_initialize(TSS2_TCTI_CONTEXT_COUNT * tcti)
+{
+    TSS2_TCTI_CONTEXT *tctiContext = (TSS2_TCTI_CONTEXT *) tcti;
+
+    memset(tcti, 0, sizeof(*tcti));
+    TSS2_TCTI_MAGIC(tctiContext) = TCTI_COUNT_MAGIC;
+    TSS2_TCTI_VERSION(tctiContext) = TCTI_COUNT_VERSION;
+    TSS2_TCTI_TRANSMIT(tctiContext) = tcti_count_transmit;
+    TSS2_TCTI_RECEIVE(tctiContext) = tcti_count_receive;
+    TSS2_TCTI_FINALIZE(tctiContext) = tcti_count_finalize;
+    TSS2_TCTI_CANCEL(tctiContext) = NULL;
+    TSS2_TCTI_GET_POLL_HANDLES(tctiContext) = NULL;
+    TSS2_TCTI_SET_LOCALITY(tctiContext) = NULL;
+}
+
+static int
+setup(void **state)
+{
+    cache_state *cs = calloc(1, sizeof(*cs));
+    TSS2_RC r;
+    int i;
+
+    assert_non_null(cs);
+    for (i = 0; i < THREADS; i++) {
+        tcti_count_initialize(&cs->tcti[i]);
+        r = Esys_Initialize(&cs->esys[i], (TSS2_TCTI_CONTEXT *) &cs->tcti[i],
+                            NULL);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        r = Esys_SetSharedCache(cs->esys[i], 1);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+
+    *state = cs;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    cache_state *cs = *state;
+    int i;
+
+    for (i = 0; i < THREADS; i++)
+        Esys_Finalize(&cs->esys[i]);
+    free(cs);
+    Esys_ClearSharedCache();
+    return 0;
+}
+
+static void
+attach(ESYS_CONTEXT *esys_context, TPM2_HANDLE tpm_handle, TPM2B_NAME *name)
+{
+    ESYS_TR object;
+    TPM2B_NAME *object_name;
+    TSS2_RC r;
+
+    r = Esys_TR_FromTPMPublic(esys_context, tpm_handle, ESYS_TR_NONE,
+                              ESYS_TR_NONE, ESYS_TR_NONE, &object);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_TR_GetName(esys_context, object, &object_name);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    *name = *object_name;
+    free(object_name);
+    r = Esys_TR_Close(esys_context, &object);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static void
+esys_shared_cache_persistent(void **state)
+{
+    cache_state *cs = *state;
+    TPM2B_NAME name, cached_name;
+    int i;
+
+    attach(cs->esys[0], PERSISTENT_HANDLE, &name);
+    assert_int_equal(cs->tcti[0].commands, 1);
+
+    /* Served from the cache on every context that enabled it */
+    for (i = 0; i < CONTEXTS; i++) {
+        attach(cs->esys[i], PERSISTENT_HANDLE, &cached_name);
+        assert_int_equal(cached_name.size, name.size);
+        assert_memory_equal(cached_name.name, name.name, name.size);
+    }
+    assert_int_equal(cs->tcti[0].commands, 1);
+    for (i = 1; i < CONTEXTS; i++)
+        assert_int_equal(cs->tcti[i].commands, 0);
+
+    /* But not on the others */
+    assert_int_equal(Esys_SetSharedCache(cs->esys[1], 0), TSS2_RC_SUCCESS);
+    attach(cs->esys[1], PERSISTENT_HANDLE, &cached_name);
+    assert_int_equal(cs->tcti[1].commands, 1);
+
+    Esys_InvalidateSharedCache(PERSISTENT_HANDLE);
+    attach(cs->esys[2], PERSISTENT_HANDLE, &cached_name);
+    assert_int_equal(cs->tcti[2].commands, 1);
+}
+
+static void
+esys_shared_cache_nv_undefine(void **state)
+{
+    cache_state *cs = *state;
+    TPM2B_NAME name;
+    ESYS_TR nv_index;
+    TSS2_RC r;
+
+    attach(cs->esys[0], NV_HANDLE, &name);
+    attach(cs->esys[1], NV_HANDLE, &name);
+    assert_int_equal(cs->tcti[0].commands, 1);
+    assert_int_equal(cs->tcti[1].commands, 0);
+
+    /* Undefining the index on one context invalidates it for all */
+    r = Esys_TR_FromTPMPublic(cs->esys[0], NV_HANDLE, ESYS_TR_NONE,
+                              ESYS_TR_NONE, ESYS_TR_NONE, &nv_index);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_NV_UndefineSpace(cs->esys[0], ESYS_TR_RH_OWNER, nv_index,
+                              ESYS_TR_PASSWORD, ESYS_TR_NONE, ESYS_TR_NONE);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(cs->tcti[0].commands, 2);
+
+    attach(cs->esys[1], NV_HANDLE, &name);
+    assert_int_equal(cs->tcti[1].commands, 1);
+}
+
+static void
+esys_shared_cache_invalidate_pending(void **state)
+{
+    cache_state *cs = *state;
+    TPM2B_NAME name;
+    ESYS_TR object;
+    TSS2_RC r;
+
+    r = Esys_TR_FromTPMPublic_Async(cs->esys[0], PERSISTENT_HANDLE,
+                                    ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* The response may predate the invalidation, so it is not cached */
+    Esys_InvalidateSharedCache(PERSISTENT_HANDLE);
+    r = Esys_TR_FromTPMPublic_Finish(cs->esys[0], &object);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_TR_Close(cs->esys[0], &object);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    attach(cs->esys[1], PERSISTENT_HANDLE, &name);
+    assert_int_equal(cs->tcti[1].commands, 1);
+
+    /* The next read is cached again */
+    attach(cs->esys[2], PERSISTENT_HANDLE, &name);
+    assert_int_equal(cs->tcti[2].commands, 0);
+}
+
+static void *
+attach_thread(void *arg)
+{
+    ESYS_CONTEXT *esys_context = arg;
+    TPM2B_NAME name;
+    int i;
+
+    for (i = 0; i < THREAD_ITERATIONS; i++) {
+        attach(esys_context, PERSISTENT_HANDLE + (i % 4), &name);
+        if (i % 10 == 0)
+            Esys_InvalidateSharedCache(PERSISTENT_HANDLE + (i % 4));
+    }
+    return NULL;
+}
+
+static void
+esys_shared_cache_threads(void **state)
+{
+    cache_state *cs = *state;
+    pthread_t threads[THREADS];
+    int i, commands = 0;
+
+    for (i = 0; i < THREADS; i++)
+        assert_int_equal(pthread_create(&threads[i], NULL, attach_thread,
+                                        cs->esys[i]), 0);
+    for (i = 0; i < THREADS; i++) {
+        assert_int_equal(pthread_join(threads[i], NULL), 0);
+        commands += cs->tcti[i].commands;
+    }
+    assert_true(commands > 0);
+    assert_true(commands < THREADS * THREAD_ITERATIONS);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(esys_shared_cache_persistent, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(esys_shared_cache_nv_undefine, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(esys_shared_cache_invalidate_pending,
+                                        setup, teardown),
+        cmocka_unit_test_setup_teardown(esys_shared_cache_threads, setup,
+                                        teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,366 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * These tests serialize ESYS_TR objects attached with Esys_TR_FromTPMPublic
+ * using Esys_TR_SerializeBatch and check that Esys_TR_DeserializeBatch
+ * restores the same metadata.
+ */
+
+#define TCTI_PUB_MAGIC 0x5055420000000000ULL        /* 'PUB\0' */
+#define TCTI_PUB_VERSION 0x1
+
+#define PERSISTENT_HANDLE 0x81000001
+#define NV_HANDLE 0x01000001
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command_code;
+    TPM2B_NAME name;             /* The name returned by the TPM */
+} TSS2_TCTI_CONTEXT_PUB;
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_PUB tcti;
+    ESYS_CONTEXT *esys_context;
+    ESYS_TR objects[4];
+} batch_state;
+
+static const TPM2B_PUBLIC key_public = {
+    .size = 0,
+    .publicArea = {
+        .type = TPM2_ALG_KEYEDHASH,
+        .nameAlg = TPM2_ALG_SHA256,
+        .objectAttributes = TPMA_OBJECT_USERWITHAUTH,
+        .parameters.keyedHashDetail.scheme.scheme = TPM2_ALG_NULL,
+    },
+};
+
+static const TPM2B_NV_PUBLIC nv_public = {
+    .size = 0,
+    .nvPublic = {
+        .nvIndex = NV_HANDLE,
+        .nameAlg = TPM2_ALG_SHA256,
+        .attributes = TPMA_NV_AUTHWRITE | TPMA_NV_AUTHREAD,
+        .dataSize = 32,
+    },
+};
+
+static TSS2_RC
+tcti_pub_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                  size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_PUB *tcti = (TSS2_TCTI_CONTEXT_PUB *) tctiContext;
+    size_t offset = 6;
+
+    return Tss2_MU_UINT32_Unmarshal(buffer, size, &offset,
+                                    &tcti->command_code);
+}
+
+/* Answer ReadPublic and NV_ReadPublic with the public areas above */
+static TSS2_RC
+tcti_pub_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                 size_t * response_size,
+                 uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_PUB *tcti = (TSS2_TCTI_CONTEXT_PUB *) tctiContext;
+    uint8_t rsp[1024];
+    size_t offset = 10, size_offset = 2, rc_offset = 6;
+    UNUSED(timeout);
+
+    assert_int_equal(Tss2_MU_TPM2_ST_Marshal(TPM2_ST_NO_SESSIONS, rsp,
+                                             sizeof(rsp), NULL),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, rsp,
+                                            sizeof(rsp), &rc_offset),
+                     TSS2_RC_SUCCESS);
+    if (tcti->command_code == TPM2_CC_ReadPublic) {
+        assert_int_equal(Tss2_MU_TPM2B_PUBLIC_Marshal(&key_public, rsp,
+                                                      sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        /* name and qualifiedName */
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&tcti->name, rsp,
+                                                    sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&tcti->name, rsp,
+                                                    sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+    } else if (tcti->command_code == TPM2_CC_NV_ReadPublic) {
+        assert_int_equal(Tss2_MU_TPM2B_NV_PUBLIC_Marshal(&nv_public, rsp,
+                                                         sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&tcti->name, rsp,
+                                                    sizeof(rsp), &offset),
+                         TSS2_RC_SUCCESS);
+    } else {
+        LOG_ERROR("Unexpected command 0x%" PRIx32, tcti->command_code);
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    assert_int_equal(Tss2_MU_UINT32_Marshal(offset, rsp, sizeof(rsp),
+                                            &size_offset),
+                     TSS2_RC_SUCCESS);
+
+    if (response_buffer != NULL)
+        memcpy(response_buffer, rsp, offset);
+    *response_size = offset;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_pub_initialize(TSS2_TCTI_CONTEXT_PUB * tcti)
+{
+    TSS2_TCTI_CONTEXT *tctiContext = (TSS2_TCTI_CONTEXT *) tcti;
+
+    memset(tcti, 0, sizeof(*tcti));
+    TSS2_TCTI_MAGIC(tctiContext) = TCTI_PUB_MAGIC;
+    TSS2_TCTI_VERSION(tctiContext) = TCTI_PUB_VERSION;
+    TSS2_TCTI_TRANSMIT(tctiContext) = tcti_pub_transmit;
+    TSS2_TCTI_RECEIVE(tctiContext) = tcti_pub_receive;
+}
+
+/* Attach an object, returning the given name instead of the real one */
+static ESYS_TR
+attach(batch_state *state, TPM2_HANDLE tpm_handle, const TPM2B_NAME *name)
+{
+    ESYS_TR object;
+
+    state->tcti.name = *name;
+    assert_int_equal(Esys_TR_FromTPMPublic(state->esys_context, tpm_handle,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, &object),
+                     TSS2_RC_SUCCESS);
+    return object;
+}
+
+/* Attach a key and an NV index with both correct and bogus names */
+static int
+setup(void **state)
+{
+    batch_state *s = calloc(1, sizeof(*s));
+    TPM2B_NAME bogus = { .size = 4, .name = { 0x00, 0x0b, 0xaa, 0xbb } };
+    TPM2B_NAME *name;
+
+    assert_non_null(s);
+    tcti_pub_initialize(&s->tcti);
+    assert_int_equal(Esys_Initialize(&s->esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &s->tcti, NULL),
+                     TSS2_RC_SUCCESS);
+
+    s->objects[0] = attach(s, PERSISTENT_HANDLE, &bogus);
+    assert_int_equal(Esys_TR_GetName(s->esys_context, s->objects[0], &name),
+                     TSS2_RC_SUCCESS);
+    s->objects[1] = attach(s, PERSISTENT_HANDLE, name);
+    free(name);
+
+    s->objects[2] = attach(s, NV_HANDLE, &bogus);
+    assert_int_equal(Esys_TR_GetName(s->esys_context, s->objects[2], &name),
+                     TSS2_RC_SUCCESS);
+    s->objects[3] = attach(s, NV_HANDLE, name);
+    free(name);
+
+    *state = s;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    batch_state *s = *state;
+
+    Esys_Finalize(&s->esys_context);
+    free(s);
+    return 0;
+}
+
+/* Compare the metadata of two objects using the single object format */
+static void
+assert_same_metadata(ESYS_CONTEXT *ctx1, ESYS_TR object1,
+                     ESYS_CONTEXT *ctx2, ESYS_TR object2)
+{
+    uint8_t *buffer1, *buffer2;
+    size_t size1, size2;
+
+    assert_int_equal(Esys_TR_Serialize(ctx1, object1, &buffer1, &size1),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_Serialize(ctx2, object2, &buffer2, &size2),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(size1, size2);
+    assert_memory_equal(buffer1, buffer2, size1);
+    free(buffer1);
+    free(buffer2);
+}
+
+static void
+test_round_trip(void **state)
+{
+    batch_state *s = *state;
+    ESYS_TR *objects;
+    uint8_t *buffer, *single;
+    size_t buffer_size, single_size, singles_size = 0, count, i;
+
+    assert_int_equal(Esys_TR_SerializeBatch(s->esys_context, s->objects, 4,
+                                            &buffer, &buffer_size),
+                     TSS2_RC_SUCCESS);
+    for (i = 0; i < 4; i++) {
+        assert_int_equal(Esys_TR_Serialize(s->esys_context, s->objects[i],
+                                           &single, &single_size),
+                         TSS2_RC_SUCCESS);
+        singles_size += single_size;
+        free(single);
+    }
+    /* The derivable SHA256 names (2 + 34 bytes) of objects 1 and 3 are
+       omitted, a 12 byte header is added */
+    assert_true(buffer_size <= singles_size - 2 * 36 + 12);
+
+    assert_int_equal(Esys_TR_DeserializeBatch(s->esys_context, buffer,
+                                              buffer_size, &objects, &count),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(count, 4);
+    for (i = 0; i < 4; i++) {
+        assert_true(objects[i] != s->objects[i]);
+        assert_same_metadata(s->esys_context, s->objects[i],
+                             s->esys_context, objects[i]);
+    }
+    free(objects);
+    free(buffer);
+}
+
+static void
+test_context(void **state)
+{
+    batch_state *s = *state;
+    TSS2_TCTI_CONTEXT_PUB tcti;
+    ESYS_CONTEXT *esys_context;
+    ESYS_TR *objects, pcr = ESYS_TR_PCR0, tpm_handle;
+    uint8_t *buffer;
+    size_t buffer_size, count, i;
+
+    /* Predefined ESYS_TRs looked up by the application are not serialized */
+    assert_int_equal(Esys_TR_GetTpmHandle(s->esys_context, pcr, &tpm_handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_SerializeBatch(s->esys_context, NULL, 0,
+                                            &buffer, &buffer_size),
+                     TSS2_RC_SUCCESS);
+
+    tcti_pub_initialize(&tcti);
+    assert_int_equal(Esys_Initialize(&esys_context,
+                                     (TSS2_TCTI_CONTEXT *) &tcti, NULL),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_DeserializeBatch(esys_context, buffer,
+                                              buffer_size, &objects, &count),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(count, 4);
+    for (i = 0; i < count; i++) {
+        assert_int_equal(Esys_TR_GetTpmHandle(esys_context, objects[i],
+                                              &tpm_handle),
+                         TSS2_RC_SUCCESS);
+        assert_true(tpm_handle == PERSISTENT_HANDLE ||
+                    tpm_handle == NV_HANDLE);
+    }
+    free(objects);
+    free(buffer);
+    Esys_Finalize(&esys_context);
+}
+
+static void
+test_single(void **state)
+{
+    batch_state *s = *state;
+    ESYS_TR object;
+    uint8_t *buffer;
+    size_t buffer_size;
+
+    assert_int_equal(Esys_TR_SerializeBatch(s->esys_context, &s->objects[3], 1,
+                                            &buffer, &buffer_size),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_Deserialize(s->esys_context, buffer, buffer_size,
+                                         &object),
+                     TSS2_RC_SUCCESS);
+    assert_same_metadata(s->esys_context, s->objects[3],
+                         s->esys_context, object);
+    free(buffer);
+
+    assert_int_equal(Esys_TR_SerializeBatch(s->esys_context, s->objects, 2,
+                                            &buffer, &buffer_size),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_Deserialize(s->esys_context, buffer, buffer_size,
+                                         &object),
+                     TSS2_ESYS_RC_BAD_VALUE);
+    free(buffer);
+}
+
+static void
+test_bad_blob(void **state)
+{
+    batch_state *s = *state;
+    ESYS_TR *objects, bad_objects[] = { s->objects[0], s->objects[3] + 1 };
+    uint8_t *buffer;
+    size_t buffer_size, count;
+    TSS2_RC r;
+
+    assert_int_equal(Esys_TR_SerializeBatch(s->esys_context, bad_objects, 2,
+                                            &buffer, &buffer_size),
+                     TSS2_ESYS_RC_BAD_TR);
+    assert_null(buffer);
+
+    assert_int_equal(Esys_TR_SerializeBatch(s->esys_context, s->objects, 4,
+                                            &buffer, &buffer_size),
+                     TSS2_RC_SUCCESS);
+
+    /* Truncated in the last object */
+    r = Esys_TR_DeserializeBatch(s->esys_context, buffer, buffer_size - 1,
+                                 &objects, &count);
+    assert_int_equal(r, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+    assert_null(objects);
+    assert_int_equal(count, 0);
+
+    /* Unknown version */
+    buffer[5] = 3;
+    r = Esys_TR_DeserializeBatch(s->esys_context, buffer, buffer_size,
+                                 &objects, &count);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+    assert_int_equal(count, 0);
+    free(buffer);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_round_trip, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_context, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_single, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_bad_blob, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
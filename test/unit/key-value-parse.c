@@ -237,6 +237,37 @@ parse_key_value_string_NULL_user_data_test (void **state)
     rc = parse_key_value_string (test_str, key_value_callback, NULL);
     assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
 }
+/*
+ * Ensure that decimal numbers in the range of a uint32_t are converted.
+ */
+static void
+string_to_uint32_good_test (void **state)
+{
+    uint32_t value = 0;
+
+    assert_true (string_to_uint32 ("0", &value));
+    assert_int_equal (value, 0);
+    assert_true (string_to_uint32 ("4294967295", &value));
+    assert_int_equal (value, UINT32_MAX);
+}
+/*
+ * Ensure that anything but a plain decimal number in range is rejected and
+ * leaves the value untouched.
+ */
+static void
+string_to_uint32_bad_test (void **state)
+{
+    uint32_t value = 7;
+
+    assert_false (string_to_uint32 ("", &value));
+    assert_false (string_to_uint32 ("-1", &value));
+    assert_false (string_to_uint32 (" 1", &value));
+    assert_false (string_to_uint32 ("1x", &value));
+    assert_false (string_to_uint32 ("two", &value));
+    assert_false (string_to_uint32 ("4294967296", &value));
+    assert_false (string_to_uint32 (NULL, &value));
+    assert_int_equal (value, 7);
+}
 
 int
 main(int argc, char* argv[])
@@ -256,6 +287,8 @@ main(int argc, char* argv[])
         cmocka_unit_test (parse_key_value_string_NULL_kv_string_test),
         cmocka_unit_test (parse_key_value_string_NULL_callback_test),
         cmocka_unit_test (parse_key_value_string_NULL_user_data_test),
+        cmocka_unit_test (string_to_uint32_good_test),
+        cmocka_unit_test (string_to_uint32_bad_test),
     };
     return cmocka_run_group_tests (tests, NULL, NULL);
 }
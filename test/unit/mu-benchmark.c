@@ -0,0 +1,163 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <time.h>
+#include "tss2_mu.h"
+
+#include "benchmark.h"
+
+/*
+ * Round trip TPM2B_PUBLIC and TPMS_ATTEST structures through the marshaling
+ * library and report the time spent per (un)marshal call. The round trips
+ * themselves are checked by TPM2B-marshal and TPMS-marshal. It is not part of
+ * the test suite and is run by 'make benchmark'.
+ */
+
+#define ITERATIONS 20000
+
+static void
+fill_public(TPM2B_PUBLIC *pub)
+{
+    memset(pub, 0, sizeof(*pub));
+    pub->publicArea.type = TPM2_ALG_RSA;
+    pub->publicArea.nameAlg = TPM2_ALG_SHA256;
+    pub->publicArea.objectAttributes = TPMA_OBJECT_USERWITHAUTH |
+        TPMA_OBJECT_RESTRICTED | TPMA_OBJECT_DECRYPT |
+        TPMA_OBJECT_FIXEDTPM | TPMA_OBJECT_FIXEDPARENT |
+        TPMA_OBJECT_SENSITIVEDATAORIGIN;
+    pub->publicArea.authPolicy.size = 32;
+    memset(pub->publicArea.authPolicy.buffer, 0xa5, 32);
+    pub->publicArea.parameters.rsaDetail.symmetric.algorithm = TPM2_ALG_AES;
+    pub->publicArea.parameters.rsaDetail.symmetric.keyBits.aes = 128;
+    pub->publicArea.parameters.rsaDetail.symmetric.mode.aes = TPM2_ALG_CFB;
+    pub->publicArea.parameters.rsaDetail.scheme.scheme = TPM2_ALG_NULL;
+    pub->publicArea.parameters.rsaDetail.keyBits = 2048;
+    pub->publicArea.unique.rsa.size = 256;
+    memset(pub->publicArea.unique.rsa.buffer, 0x5a, 256);
+}
+
+static void
+fill_attest(TPMS_ATTEST *attest)
+{
+    memset(attest, 0, sizeof(*attest));
+    attest->magic = TPM2_GENERATED_VALUE;
+    attest->type = TPM2_ST_ATTEST_QUOTE;
+    attest->qualifiedSigner.size = 34;
+    memset(attest->qualifiedSigner.name, 0x11, 34);
+    attest->extraData.size = 16;
+    memset(attest->extraData.buffer, 0x22, 16);
+    attest->clockInfo.clock = 0x0102030405060708ULL;
+    attest->clockInfo.resetCount = 1;
+    attest->clockInfo.restartCount = 2;
+    attest->clockInfo.safe = TPM2_YES;
+    attest->firmwareVersion = 0x1122334455667788ULL;
+    attest->attested.quote.pcrSelect.count = 2;
+    attest->attested.quote.pcrSelect.pcrSelections[0].hash = TPM2_ALG_SHA1;
+    attest->attested.quote.pcrSelect.pcrSelections[0].sizeofSelect = 3;
+    attest->attested.quote.pcrSelect.pcrSelections[0].pcrSelect[0] = 0xff;
+    attest->attested.quote.pcrSelect.pcrSelections[1].hash = TPM2_ALG_SHA256;
+    attest->attested.quote.pcrSelect.pcrSelections[1].sizeofSelect = 3;
+    attest->attested.quote.pcrSelect.pcrSelections[1].pcrSelect[2] = 0x0f;
+    attest->attested.quote.pcrDigest.size = 32;
+    memset(attest->attested.quote.pcrDigest.buffer, 0x33, 32);
+}
+
+static void
+tpm2b_public_benchmark(void **state)
+{
+    TPM2B_PUBLIC pub, pub_out;
+    uint8_t buffer[sizeof(pub)];
+    size_t offset = 0, size;
+    struct timespec start, end;
+    TSS2_RC rc;
+    int i;
+
+    fill_public(&pub);
+    rc = Tss2_MU_TPM2B_PUBLIC_Marshal(&pub, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = offset;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ITERATIONS; i++) {
+        offset = 0;
+        rc = Tss2_MU_TPM2B_PUBLIC_Marshal(&pub, buffer, sizeof(buffer),
+                                          &offset);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert_int_equal (offset, size);
+    printf("TPM2B_PUBLIC marshal: %.1f ns\n",
+           elapsed_ns(&start, &end) / ITERATIONS);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ITERATIONS; i++) {
+        offset = 0;
+        pub_out.size = 0;
+        rc = Tss2_MU_TPM2B_PUBLIC_Unmarshal(buffer, size, &offset, &pub_out);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert_int_equal (offset, size);
+    printf("TPM2B_PUBLIC unmarshal: %.1f ns\n",
+           elapsed_ns(&start, &end) / ITERATIONS);
+}
+
+static void
+tpms_attest_benchmark(void **state)
+{
+    TPMS_ATTEST attest, attest_out;
+    uint8_t buffer[sizeof(attest)];
+    size_t offset = 0, size;
+    struct timespec start, end;
+    TSS2_RC rc;
+    int i;
+
+    fill_attest(&attest);
+    rc = Tss2_MU_TPMS_ATTEST_Marshal(&attest, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = offset;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ITERATIONS; i++) {
+        offset = 0;
+        rc = Tss2_MU_TPMS_ATTEST_Marshal(&attest, buffer, sizeof(buffer),
+                                         &offset);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert_int_equal (offset, size);
+    printf("TPMS_ATTEST marshal: %.1f ns\n",
+           elapsed_ns(&start, &end) / ITERATIONS);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ITERATIONS; i++) {
+        offset = 0;
+        rc = Tss2_MU_TPMS_ATTEST_Unmarshal(buffer, size, &offset, &attest_out);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert_int_equal (offset, size);
+    printf("TPMS_ATTEST unmarshal: %.1f ns\n",
+           elapsed_ns(&start, &end) / ITERATIONS);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(tpm2b_public_benchmark),
+        cmocka_unit_test(tpms_attest_benchmark),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_mu.h"
+#include "mu-bswap.h"
+#include "util/tss2_endian.h"
+
+/*
+ * Lengths cover empty input, everything shorter than one vector, exact
+ * multiples of the 16 and 32 byte blocks and odd tails after them.
+ */
+#define MAX_COUNT 133
+#define MAX_MISALIGN 4
+
+static const MU_BSWAP_IMPL *
+scalar_impl(void)
+{
+    const MU_BSWAP_IMPL *impl;
+
+    for (impl = mu_bswap_impls; impl->name != NULL; impl++)
+        if (strcmp(impl->name, "scalar") == 0)
+            return impl;
+    fail_msg("no scalar kernel");
+    return NULL;
+}
+
+static void
+fill(uint8_t *buf, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = (uint8_t)(i * 7 + 3);
+}
+
+/*
+ * The scalar kernel produces big-endian values.
+ */
+static void
+bswap_scalar_reference(void **state)
+{
+    const MU_BSWAP_IMPL *scalar = scalar_impl();
+    UINT32 in32[3] = { 0x01020304, 0xa0b0c0d0, 0xffeeddcc };
+    UINT16 in16[3] = { 0x0102, 0xa0b0, 0xffee };
+    uint8_t out[12];
+    uint8_t expect32[] = { 0x01, 0x02, 0x03, 0x04, 0xa0, 0xb0,
+                           0xc0, 0xd0, 0xff, 0xee, 0xdd, 0xcc };
+    uint8_t expect16[] = { 0x01, 0x02, 0xa0, 0xb0, 0xff, 0xee };
+
+    scalar->swap32(out, in32, 3);
+    assert_memory_equal(out, expect32, sizeof(expect32));
+    scalar->swap16(out, in16, 3);
+    assert_memory_equal(out, expect16, sizeof(expect16));
+}
+
+/*
+ * Every kernel the CPU supports is bit-exact with the scalar kernel for all
+ * lengths and source / destination misalignments and never writes past the
+ * end of the destination.
+ */
+static void
+bswap_kernels_match_scalar(void **state)
+{
+    const MU_BSWAP_IMPL *scalar = scalar_impl();
+    const MU_BSWAP_IMPL *impl;
+    uint8_t src[MAX_COUNT * 4 + MAX_MISALIGN];
+    uint8_t ref[MAX_COUNT * 4 + MAX_MISALIGN + 1];
+    uint8_t out[MAX_COUNT * 4 + MAX_MISALIGN + 1];
+    size_t count, src_off, dst_off;
+
+    fill(src, sizeof(src));
+
+    for (impl = mu_bswap_impls; impl->name != NULL; impl++) {
+        if (!impl->supported())
+            continue;
+        for (count = 0; count <= MAX_COUNT; count++) {
+            for (src_off = 0; src_off < MAX_MISALIGN; src_off++) {
+                for (dst_off = 0; dst_off < MAX_MISALIGN; dst_off++) {
+                    memset(ref, 0x5a, sizeof(ref));
+                    memset(out, 0x5a, sizeof(out));
+                    scalar->swap32(&ref[dst_off], &src[src_off], count);
+                    impl->swap32(&out[dst_off], &src[src_off], count);
+                    assert_memory_equal(out, ref, sizeof(ref));
+
+                    memset(ref, 0x5a, sizeof(ref));
+                    memset(out, 0x5a, sizeof(out));
+                    scalar->swap16(&ref[dst_off], &src[src_off], count);
+                    impl->swap16(&out[dst_off], &src[src_off], count);
+                    assert_memory_equal(out, ref, sizeof(ref));
+                }
+            }
+        }
+    }
+}
+
+/*
+ * The dispatching entry points agree with the scalar kernel and swapping
+ * twice restores the input.
+ */
+static void
+bswap_dispatch(void **state)
+{
+    const MU_BSWAP_IMPL *scalar = scalar_impl();
+    uint8_t src[MAX_COUNT * 4], ref[MAX_COUNT * 4], out[MAX_COUNT * 4];
+
+    fill(src, sizeof(src));
+
+    scalar->swap32(ref, src, MAX_COUNT);
+    mu_bswap32(out, src, MAX_COUNT);
+    assert_memory_equal(out, ref, sizeof(ref));
+    mu_bswap32(ref, out, MAX_COUNT);
+    assert_memory_equal(ref, src, sizeof(src));
+
+    scalar->swap16(ref, src, MAX_COUNT * 2);
+    mu_bswap16(out, src, MAX_COUNT * 2);
+    assert_memory_equal(out, ref, sizeof(ref));
+    mu_bswap16(ref, out, MAX_COUNT * 2);
+    assert_memory_equal(ref, src, sizeof(src));
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test (bswap_scalar_reference),
+        cmocka_unit_test (bswap_kernels_match_scalar),
+        cmocka_unit_test (bswap_dispatch),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
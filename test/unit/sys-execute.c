@@ -158,11 +158,517 @@ test_resubmit(void **state)
     return;
 }
 
+/**
+ * Test executes a batch of commands through a TCTI supporting a pipeline depth
+ * of up to BATCH_TCTI_DEPTH and through a TCTI without pipelining support.
+ */
+
+#define BATCH_SIZE 8
+#define BATCH_TCTI_DEPTH 4
+
+static size_t batch_in_flight;
+static size_t batch_max_in_flight;
+static size_t batch_depth;
+static size_t batch_transmits;
+static size_t batch_fail_at;    /* Number of the failing transmit, 0 if none */
+static size_t batch_receives;
+static size_t batch_rx_fail_at; /* Number of the failing receive, 0 if none */
+
+static TSS2_RC
+tcti_batch_transmit(
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t size,
+    uint8_t const *command)
+{
+    if (batch_in_flight >= batch_depth)
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+    if (++batch_transmits == batch_fail_at)
+        return TSS2_TCTI_RC_IO_ERROR;
+
+    batch_in_flight++;
+    if (batch_in_flight > batch_max_in_flight)
+        batch_max_in_flight = batch_in_flight;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_batch_receive(
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *size,
+    uint8_t *response,
+    int32_t timeout)
+{
+    if (batch_in_flight == 0)
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+
+    *size = sizeof(ok_response);
+    if (response == NULL)
+        return TSS2_RC_SUCCESS;
+
+    if (++batch_receives == batch_rx_fail_at) {
+        /* The connection is lost together with all pending responses */
+        batch_in_flight = 0;
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+
+    memcpy(response, ok_response, sizeof(ok_response));
+    batch_in_flight--;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_batch_set_pipeline_depth(
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t depth)
+{
+    if (depth > BATCH_TCTI_DEPTH)
+        return TSS2_TCTI_RC_BAD_VALUE;
+    if (batch_in_flight != 0)
+        return TSS2_TCTI_RC_BAD_SEQUENCE;
+
+    batch_depth = depth;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+check_batch(TSS2_TCTI_CONTEXT *tcti_ctx, size_t expected_depth)
+{
+    TSS2_SYS_CONTEXT *sys_ctx[BATCH_SIZE];
+    TSS2_RC rcs[BATCH_SIZE];
+    TPM2B_DIGEST random;
+    UINT32 size_ctx;
+    TSS2_RC r;
+    size_t i;
+
+    batch_in_flight = 0;
+    batch_max_in_flight = 0;
+    batch_depth = 1;
+    batch_transmits = 0;
+    batch_fail_at = 0;
+    batch_receives = 0;
+    batch_rx_fail_at = 0;
+
+    size_ctx = Tss2_Sys_GetContextSize(0);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        sys_ctx[i] = calloc (1, size_ctx);
+        assert_non_null (sys_ctx[i]);
+        r = Tss2_Sys_Initialize(sys_ctx[i], size_ctx, tcti_ctx, &ver);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+        r = Tss2_Sys_GetRandom_Prepare(sys_ctx[i], 32);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+    }
+
+    r = Tss2_Sys_ExecuteBatch(sys_ctx, BATCH_SIZE, rcs);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (batch_max_in_flight, expected_depth);
+    assert_int_equal (batch_in_flight, 0);
+    assert_int_equal (batch_depth, 1);
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        assert_int_equal (rcs[i], TSS2_RC_SUCCESS);
+        r = Tss2_Sys_GetRandom_Complete(sys_ctx[i], &random);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+        assert_int_equal (random.size, 32);
+        assert_memory_equal (random.buffer, &ok_response[12], 32);
+    }
+
+    /* Contexts that are not prepared are rejected */
+    r = Tss2_Sys_ExecuteBatch(sys_ctx, BATCH_SIZE, rcs);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_SEQUENCE);
+
+    for (i = 0; i < BATCH_SIZE; i++)
+        free (sys_ctx[i]);
+}
+
+static void
+test_batch_pipelined(void **state)
+{
+    TSS2_TCTI_CONTEXT_COMMON_V3 tcti_v3_ctx = { 0 };
+
+    tcti_v3_ctx.v2.v1.version = 3;
+    tcti_v3_ctx.v2.v1.transmit = tcti_batch_transmit;
+    tcti_v3_ctx.v2.v1.receive = tcti_batch_receive;
+    tcti_v3_ctx.setPipelineDepth = tcti_batch_set_pipeline_depth;
+
+    check_batch((TSS2_TCTI_CONTEXT *) &tcti_v3_ctx, BATCH_TCTI_DEPTH);
+}
+
+static void
+test_batch_serial(void **state)
+{
+    TSS2_TCTI_CONTEXT_COMMON_V1 tcti_v1_ctx = { 0 };
+
+    tcti_v1_ctx.version = 1;
+    tcti_v1_ctx.transmit = tcti_batch_transmit;
+    tcti_v1_ctx.receive = tcti_batch_receive;
+
+    check_batch((TSS2_TCTI_CONTEXT *) &tcti_v1_ctx, 1);
+}
+
+/*
+ * When a transmit fails halfway through a batch, the responses to the
+ * commands already sent are still received and the pipeline depth is reset.
+ */
+static void
+test_batch_transmit_failure(void **state)
+{
+    TSS2_TCTI_CONTEXT_COMMON_V3 tcti_v3_ctx = { 0 };
+    TSS2_SYS_CONTEXT *sys_ctx[BATCH_SIZE];
+    TSS2_RC rcs[BATCH_SIZE];
+    UINT32 size_ctx;
+    TSS2_RC r;
+    size_t i;
+
+    tcti_v3_ctx.v2.v1.version = 3;
+    tcti_v3_ctx.v2.v1.transmit = tcti_batch_transmit;
+    tcti_v3_ctx.v2.v1.receive = tcti_batch_receive;
+    tcti_v3_ctx.setPipelineDepth = tcti_batch_set_pipeline_depth;
+
+    batch_in_flight = 0;
+    batch_max_in_flight = 0;
+    batch_depth = 1;
+    batch_transmits = 0;
+    batch_receives = 0;
+    batch_rx_fail_at = 0;
+    /* Commands 0 to 3 fill the pipeline, 4 follows the first response */
+    batch_fail_at = BATCH_TCTI_DEPTH + 2;
+
+    size_ctx = Tss2_Sys_GetContextSize(0);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        sys_ctx[i] = calloc (1, size_ctx);
+        assert_non_null (sys_ctx[i]);
+        r = Tss2_Sys_Initialize(sys_ctx[i], size_ctx,
+                                (TSS2_TCTI_CONTEXT *) &tcti_v3_ctx, &ver);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+        r = Tss2_Sys_GetRandom_Prepare(sys_ctx[i], 32);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+    }
+
+    r = Tss2_Sys_ExecuteBatch(sys_ctx, BATCH_SIZE, rcs);
+    assert_int_equal (r, TSS2_TCTI_RC_IO_ERROR);
+    assert_int_equal (batch_in_flight, 0);
+    assert_int_equal (batch_depth, 1);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        if (i < batch_fail_at - 1)
+            assert_int_equal (rcs[i], TSS2_RC_SUCCESS);
+        else if (i == batch_fail_at - 1)
+            assert_int_equal (rcs[i], TSS2_TCTI_RC_IO_ERROR);
+        else
+            assert_int_equal (rcs[i], TSS2_SYS_RC_BAD_SEQUENCE);
+    }
+
+    for (i = 0; i < BATCH_SIZE; i++)
+        free (sys_ctx[i]);
+}
+
+/*
+ * The second receive of a batch pipelined four deep fails. The commands still
+ * in flight at that point never get a response and must not be reported as
+ * executed successfully.
+ */
+static void
+test_batch_receive_failure(void **state)
+{
+    TSS2_TCTI_CONTEXT_COMMON_V3 tcti_v3_ctx = { 0 };
+    TSS2_SYS_CONTEXT *sys_ctx[BATCH_SIZE];
+    TSS2_RC rcs[BATCH_SIZE];
+    UINT32 size_ctx;
+    TSS2_RC r;
+    size_t i;
+
+    tcti_v3_ctx.v2.v1.version = 3;
+    tcti_v3_ctx.v2.v1.transmit = tcti_batch_transmit;
+    tcti_v3_ctx.v2.v1.receive = tcti_batch_receive;
+    tcti_v3_ctx.setPipelineDepth = tcti_batch_set_pipeline_depth;
+
+    batch_in_flight = 0;
+    batch_max_in_flight = 0;
+    batch_depth = 1;
+    batch_transmits = 0;
+    batch_fail_at = 0;
+    batch_receives = 0;
+    batch_rx_fail_at = 2;
+
+    size_ctx = Tss2_Sys_GetContextSize(0);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        sys_ctx[i] = calloc (1, size_ctx);
+        assert_non_null (sys_ctx[i]);
+        r = Tss2_Sys_Initialize(sys_ctx[i], size_ctx,
+                                (TSS2_TCTI_CONTEXT *) &tcti_v3_ctx, &ver);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+        r = Tss2_Sys_GetRandom_Prepare(sys_ctx[i], 32);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+    }
+
+    r = Tss2_Sys_ExecuteBatch(sys_ctx, BATCH_SIZE, rcs);
+    assert_int_equal (r, TSS2_TCTI_RC_IO_ERROR);
+    assert_int_equal (batch_depth, 1);
+    /*
+     * Commands 0 to 3 fill the pipeline and 4 follows the first response.
+     * The second response is lost, and with it those of commands 2 to 4.
+     */
+    assert_int_equal (batch_transmits, BATCH_TCTI_DEPTH + 1);
+    assert_int_equal (rcs[0], TSS2_RC_SUCCESS);
+    for (i = 1; i <= BATCH_TCTI_DEPTH; i++)
+        assert_int_equal (rcs[i], TSS2_TCTI_RC_IO_ERROR);
+    for (i = BATCH_TCTI_DEPTH + 1; i < BATCH_SIZE; i++)
+        assert_int_equal (rcs[i], TSS2_SYS_RC_BAD_SEQUENCE);
+
+    for (i = 0; i < BATCH_SIZE; i++)
+        free (sys_ctx[i]);
+}
+
+static void
+test_batch_bad_args(void **state)
+{
+    TSS2_SYS_CONTEXT *sys_ctx = (TSS2_SYS_CONTEXT *)*state;
+    TSS2_SYS_CONTEXT *batch[2] = { NULL, sys_ctx };
+    TSS2_RC rcs[2];
+    TSS2_RC r;
+
+    r = Tss2_Sys_ExecuteBatch(NULL, 1, rcs);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_REFERENCE);
+    r = Tss2_Sys_ExecuteBatch(batch, 1, NULL);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_REFERENCE);
+    r = Tss2_Sys_ExecuteBatch(batch, 2, rcs);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_REFERENCE);
+    r = Tss2_Sys_ExecuteBatch(&batch[1], 1, rcs);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_SEQUENCE);
+    r = Tss2_Sys_ExecuteBatch(batch, 0, rcs);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+}
+
+/**
+ * Test that the CompleteView variant returns the TPM2B payload in place
+ * within the response buffer.
+ */
+static void
+test_complete_view(void **state)
+{
+    TSS2_TCTI_CONTEXT_COMMON_V1 tcti_v1_ctx = { 0 };
+    TSS2_SYS_CONTEXT *sys_ctx;
+    const uint8_t *random = NULL;
+    size_t random_size = 0;
+    UINT32 size_ctx;
+    TSS2_RC r;
+
+    tcti_v1_ctx.version = 1;
+    tcti_v1_ctx.transmit = tcti_batch_transmit;
+    tcti_v1_ctx.receive = tcti_batch_receive;
+    batch_in_flight = 0;
+    batch_depth = 1;
+    batch_rx_fail_at = 0;
+
+    size_ctx = Tss2_Sys_GetContextSize(0);
+    sys_ctx = calloc (1, size_ctx);
+    assert_non_null (sys_ctx);
+    r = Tss2_Sys_Initialize(sys_ctx, size_ctx,
+                            (TSS2_TCTI_CONTEXT *) &tcti_v1_ctx, &ver);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+
+    r = Tss2_Sys_GetRandom_CompleteView(sys_ctx, &random_size, &random);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_SEQUENCE);
+
+    r = Tss2_Sys_GetRandom_Prepare(sys_ctx, 32);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    r = Tss2_Sys_Execute(sys_ctx);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+
+    r = Tss2_Sys_GetRandom_CompleteView(sys_ctx, NULL, &random);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_REFERENCE);
+    r = Tss2_Sys_GetRandom_CompleteView(sys_ctx, &random_size, &random);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (random_size, 32);
+    assert_memory_equal (random, &ok_response[12], 32);
+
+    /* The view points into the response buffer inside the context */
+    assert_true (random > (uint8_t *) sys_ctx);
+    assert_true (random + random_size <= (uint8_t *) sys_ctx + size_ctx);
+
+    free (sys_ctx);
+}
+
+/**
+ * Test that execution metrics record counts, sizes, retries and latencies
+ * per command code once enabled.
+ */
+
+#define METRICS_RETRIES 3
+
+static size_t metrics_retries;
+
+static TSS2_RC
+tcti_metrics_receive(
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *size,
+    uint8_t *response,
+    int32_t timeout)
+{
+    const uint8_t *rsp = ok_response;
+
+    *size = sizeof(ok_response);
+    if (response == NULL)
+        return TSS2_RC_SUCCESS;
+
+    if (metrics_retries) {
+        metrics_retries--;
+        rsp = retry_response;
+        *size = sizeof(retry_response);
+    }
+    memcpy(response, rsp, *size);
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+metrics_dump(const TSS2_SYS_METRICS *metrics, void *userdata)
+{
+    size_t *dumps = userdata;
+
+    (*dumps)++;
+}
+
+static void
+test_metrics(void **state)
+{
+    TSS2_TCTI_CONTEXT_COMMON_V1 tcti_v1_ctx = { 0 };
+    TSS2_SYS_COMMAND_METRICS entries[2];
+    TSS2_SYS_COMMAND_METRICS entry;
+    TSS2_SYS_METRICS *metrics = NULL;
+    TSS2_SYS_CONTEXT *sys_ctx;
+    uint64_t latencies = 0;
+    size_t count, dumps = 0, i;
+    UINT32 size_ctx;
+    TSS2_RC r;
+
+    tcti_v1_ctx.version = 1;
+    tcti_v1_ctx.transmit = tcti_transmit;
+    tcti_v1_ctx.receive = tcti_metrics_receive;
+
+    size_ctx = Tss2_Sys_GetContextSize(0);
+    sys_ctx = calloc (1, size_ctx);
+    assert_non_null (sys_ctx);
+    r = Tss2_Sys_Initialize(sys_ctx, size_ctx,
+                            (TSS2_TCTI_CONTEXT *) &tcti_v1_ctx, &ver);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+
+    /* Commands executed before metrics are enabled are not recorded */
+    r = Tss2_Sys_GetRandom_Prepare(sys_ctx, 32);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    r = Tss2_Sys_Execute(sys_ctx);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+
+    r = Tss2_Sys_Metrics_New(&metrics);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    r = Tss2_Sys_SetMetrics(NULL, metrics);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_REFERENCE);
+    r = Tss2_Sys_SetMetrics(sys_ctx, metrics);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+
+    metrics_retries = METRICS_RETRIES;
+    r = Tss2_Sys_GetRandom_Prepare(sys_ctx, 32);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    do {
+        r = Tss2_Sys_Execute(sys_ctx);
+    } while (r == TPM2_RC_RETRY);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+
+    r = Tss2_Sys_Metrics_GetCommand(metrics, TPM2_CC_GetRandom, &entry);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (entry.commandCode, TPM2_CC_GetRandom);
+    assert_int_equal (entry.count, METRICS_RETRIES + 1);
+    assert_int_equal (entry.retries, METRICS_RETRIES);
+    assert_int_equal (entry.yielded, 0);
+    assert_int_equal (entry.errors, 0);
+    assert_int_equal (entry.bytesSent, 0xC * (METRICS_RETRIES + 1));
+    assert_int_equal (entry.bytesReceived, sizeof(retry_response) *
+                      METRICS_RETRIES + sizeof(ok_response));
+    for (i = 0; i < TSS2_SYS_METRICS_HISTOGRAM_BUCKETS; i++)
+        latencies += entry.histogram[i];
+    assert_int_equal (latencies, METRICS_RETRIES + 1);
+
+    /* Commands that were never executed report zero */
+    r = Tss2_Sys_Metrics_GetCommand(metrics, TPM2_CC_Startup, &entry);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (entry.commandCode, TPM2_CC_Startup);
+    assert_int_equal (entry.count, 0);
+
+    r = Tss2_Sys_Metrics_Query(metrics, NULL, &count);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 1);
+    count = 0;
+    r = Tss2_Sys_Metrics_Query(metrics, entries, &count);
+    assert_int_equal (r, TSS2_SYS_RC_BAD_SIZE);
+    assert_int_equal (count, 1);
+    count = 2;
+    r = Tss2_Sys_Metrics_Query(metrics, entries, &count);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 1);
+    assert_int_equal (entries[0].commandCode, TPM2_CC_GetRandom);
+    assert_int_equal (entries[0].count, METRICS_RETRIES + 1);
+
+    /* Periodic dumps are triggered by received responses */
+    r = Tss2_Sys_Metrics_SetDump(metrics, 1, metrics_dump, &dumps);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    for (i = 0; i < 1000000 && dumps == 0; i++) {
+        r = Tss2_Sys_GetRandom_Prepare(sys_ctx, 32);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+        r = Tss2_Sys_Execute(sys_ctx);
+        assert_int_equal (r, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal (dumps, 1);
+    r = Tss2_Sys_Metrics_SetDump(metrics, 0, NULL, NULL);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+
+    Tss2_Sys_Metrics_Reset(metrics);
+    r = Tss2_Sys_Metrics_Query(metrics, NULL, &count);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 0);
+
+    /* Disabling stops the recording */
+    r = Tss2_Sys_SetMetrics(sys_ctx, NULL);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    r = Tss2_Sys_GetRandom_Prepare(sys_ctx, 32);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    r = Tss2_Sys_Execute(sys_ctx);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    r = Tss2_Sys_Metrics_Query(metrics, NULL, &count);
+    assert_int_equal (r, TSS2_RC_SUCCESS);
+    assert_int_equal (count, 0);
+
+    Tss2_Sys_Metrics_Free(&metrics);
+    assert_null (metrics);
+    free (sys_ctx);
+}
+
+static void
+test_metrics_percentile(void **state)
+{
+    TSS2_SYS_COMMAND_METRICS entry = { 0 };
+
+    assert_int_equal (Tss2_Sys_Metrics_Percentile(&entry, 50.0), 0);
+
+    /* Bucket 2 counts 2us, bucket 10 counts [12us, 14us) */
+    entry.histogram[2] = 90;
+    entry.histogram[10] = 10;
+    assert_int_equal (Tss2_Sys_Metrics_Percentile(&entry, 50.0), 2);
+    assert_int_equal (Tss2_Sys_Metrics_Percentile(&entry, 90.0), 2);
+    assert_int_equal (Tss2_Sys_Metrics_Percentile(&entry, 99.0), 13);
+    assert_int_equal (Tss2_Sys_Metrics_Percentile(&entry, 100.0), 13);
+}
+
 int
 main(int argc, char *argv[])
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test_setup_teardown(test_resubmit, setup, teardown),
+        cmocka_unit_test(test_batch_pipelined),
+        cmocka_unit_test(test_batch_serial),
+        cmocka_unit_test(test_batch_transmit_failure),
+        cmocka_unit_test(test_batch_receive_failure),
+        cmocka_unit_test_setup_teardown(test_batch_bad_args, setup, teardown),
+        cmocka_unit_test(test_complete_view),
+        cmocka_unit_test(test_metrics),
+        cmocka_unit_test(test_metrics_percentile),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_tcti.h"
+#include "tss2_tcti_device.h"
+
+#include "benchmark.h"
+
+/*
+ * Drive 64 device TCTI contexts concurrently: send a command on each of them,
+ * then collect all responses, once with plain poll / read per context and once
+ * through the shared io_uring. Every context is backed by its own FIFO opened
+ * read / write, which hands each command back as the response, so the numbers
+ * are the I/O overhead of the TCTI only. It is not part of the test suite and
+ * is run by 'make benchmark'.
+ */
+
+#define CONTEXTS 64
+#define ITERATIONS 200
+
+typedef struct {
+    char dir[sizeof ("/tmp/tss2-bench-XXXXXX")];
+    char paths[CONTEXTS][sizeof ("/tmp/tss2-bench-XXXXXX/fifo-00")];
+} bench_state_t;
+
+/* TPM2_GetRandom for 8 bytes */
+static const uint8_t command[] = {
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x01, 0x7b, 0x00, 0x08
+};
+
+static int
+bench_setup(void **state)
+{
+    bench_state_t *bench = calloc(1, sizeof(*bench));
+    int i;
+
+    assert_non_null(bench);
+    strcpy(bench->dir, "/tmp/tss2-bench-XXXXXX");
+    assert_non_null(mkdtemp(bench->dir));
+    for (i = 0; i < CONTEXTS; i++) {
+        snprintf(bench->paths[i], sizeof(bench->paths[i]), "%s/fifo-%02d",
+                 bench->dir, i);
+        assert_int_equal(mkfifo(bench->paths[i], 0600), 0);
+    }
+
+    *state = bench;
+    return 0;
+}
+
+static int
+bench_teardown(void **state)
+{
+    bench_state_t *bench = *state;
+    int i;
+
+    for (i = 0; i < CONTEXTS; i++)
+        unlink(bench->paths[i]);
+    rmdir(bench->dir);
+    free(bench);
+    return 0;
+}
+
+/*
+ * Returns false if the TCTI could not be initialized because io_uring isn't
+ * available.
+ */
+static bool
+command_loop(bench_state_t *bench, bool uring)
+{
+    TSS2_TCTI_CONTEXT *tcti[CONTEXTS] = { NULL };
+    uint8_t response[4096];
+    struct timespec start, end;
+    char conf[128];
+    size_t size = 0;
+    TSS2_RC rc;
+    int i, j;
+
+    rc = Tss2_Tcti_Device_Init(NULL, &size, NULL);
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    for (i = 0; i < CONTEXTS; i++) {
+        snprintf(conf, sizeof(conf), "path=%s,uring=%d", bench->paths[i],
+                 uring);
+        tcti[i] = calloc(1, size);
+        assert_non_null(tcti[i]);
+        rc = Tss2_Tcti_Device_Init(tcti[i], &size, conf);
+        if (uring && i == 0 && (rc == TSS2_TCTI_RC_NOT_SUPPORTED ||
+                                rc == TSS2_TCTI_RC_NOT_IMPLEMENTED)) {
+            free(tcti[i]);
+            return false;
+        }
+        assert_int_equal(rc, TSS2_RC_SUCCESS);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (j = 0; j < ITERATIONS; j++) {
+        for (i = 0; i < CONTEXTS; i++) {
+            rc = Tss2_Tcti_Transmit(tcti[i], sizeof(command), command);
+            assert_int_equal(rc, TSS2_RC_SUCCESS);
+        }
+        for (i = 0; i < CONTEXTS; i++) {
+            size = sizeof(response);
+            rc = Tss2_Tcti_Receive(tcti[i], &size, response,
+                                   TSS2_TCTI_TIMEOUT_BLOCK);
+            assert_int_equal(rc, TSS2_RC_SUCCESS);
+            assert_int_equal(size, sizeof(command));
+            assert_memory_equal(response, command, sizeof(command));
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%d contexts with %s: %.1f us per command\n", CONTEXTS,
+           uring ? "io_uring" : "poll / read",
+           elapsed_ns(&start, &end) / ITERATIONS / CONTEXTS / 1000);
+
+    for (i = 0; i < CONTEXTS; i++) {
+        Tss2_Tcti_Finalize(tcti[i]);
+        free(tcti[i]);
+    }
+    return true;
+}
+
+static void
+device_concurrent_benchmark(void **state)
+{
+    bench_state_t *bench = *state;
+
+    command_loop(bench, false);
+    if (!command_loop(bench, true)) {
+        printf("io_uring not available, skipping\n");
+    }
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(device_concurrent_benchmark),
+    };
+    return cmocka_run_group_tests(tests, bench_setup, bench_teardown);
+}
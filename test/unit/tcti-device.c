@@ -98,6 +98,33 @@ tcti_device_init_conf_fail (void **state)
 
     free(ctx);
 }
+/* Test the key / value form of the config string */
+static void
+tcti_device_init_conf_kv_test (void **state)
+{
+    size_t tcti_size = 0;
+    TSS2_RC ret = TSS2_RC_SUCCESS;
+    TSS2_TCTI_CONTEXT *ctx = NULL;
+
+    ret = Tss2_Tcti_Device_Init (NULL, &tcti_size, NULL);
+    assert_true (ret == TSS2_RC_SUCCESS);
+    ctx = calloc (1, tcti_size);
+    assert_non_null (ctx);
+
+    /* rejected before the device is opened */
+    ret = Tss2_Tcti_Device_Init (ctx, &tcti_size, "path=/dev/tpm0,foo=1");
+    assert_int_equal (ret, TSS2_TCTI_RC_BAD_VALUE);
+    ret = Tss2_Tcti_Device_Init (ctx, &tcti_size, "path=/dev/tpm0,uring=2");
+    assert_int_equal (ret, TSS2_TCTI_RC_BAD_VALUE);
+
+    errno = ENOENT; /* No such file or directory */
+    will_return (__wrap_open, -1);
+    ret = Tss2_Tcti_Device_Init (ctx, &tcti_size,
+                                 "path=/dev/nonexistent,uring=0");
+    assert_int_equal (ret, TSS2_TCTI_RC_IO_ERROR);
+
+    free(ctx);
+}
 /* Test the device file recognition if no config string was specified */
 static void
 tcti_device_init_conf_default_fail (void **state)
@@ -341,6 +368,51 @@ tcti_device_receive_buffer_lt_response (void **state)
                             TSS2_TCTI_TIMEOUT_BLOCK);
     assert_int_equal (rc, TSS2_TCTI_RC_GENERAL_FAILURE);
 }
+/*
+ * With partial reads supported, querying the size reads the whole response
+ * with a single poll and read. The following call with a buffer doesn't
+ * touch the device. A buffer smaller than the response is rejected without
+ * losing the response.
+ */
+static void
+tcti_device_receive_partial_success (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_common_context_cast (ctx);
+    TSS2_RC rc;
+    uint8_t buf_out [BUF_SIZE] = { 0 };
+    size_t size = 0;
+
+    /* Keep state machine check in `receive` from returning error. */
+    tcti_common->state = TCTI_STATE_RECEIVE;
+    tcti_common->partial_read_supported = true;
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, BUF_SIZE);
+    will_return (__wrap_read, tpm2_buf);
+    rc = Tss2_Tcti_Receive (ctx,
+                            &size,
+                            NULL,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, BUF_SIZE);
+
+    size = BUF_SIZE - 1;
+    rc = Tss2_Tcti_Receive (ctx,
+                            &size,
+                            buf_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (size, BUF_SIZE);
+
+    rc = Tss2_Tcti_Receive (ctx,
+                            &size,
+                            buf_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, BUF_SIZE);
+    assert_memory_equal (tpm2_buf, buf_out, size);
+    assert_int_equal (tcti_common->state, TCTI_STATE_TRANSMIT);
+}
 /*
  * A test case for a successful call to the transmit function. This requires
  * that the context and the cmmand buffer be valid. The only indication of
@@ -446,6 +518,7 @@ main(int argc, char* argv[])
         cmocka_unit_test (tcti_device_init_all_null_test),
         cmocka_unit_test(tcti_device_init_size_test),
         cmocka_unit_test(tcti_device_init_conf_fail),
+        cmocka_unit_test(tcti_device_init_conf_kv_test),
         cmocka_unit_test(tcti_device_init_conf_default_fail),
         cmocka_unit_test(tcti_device_init_conf_default_success),
         cmocka_unit_test_setup_teardown (tcti_device_get_poll_handles_test,
@@ -463,6 +536,9 @@ main(int argc, char* argv[])
         cmocka_unit_test_setup_teardown (tcti_device_receive_buffer_lt_response,
                                          tcti_device_setup,
                                          tcti_device_teardown),
+        cmocka_unit_test_setup_teardown (tcti_device_receive_partial_success,
+                                         tcti_device_setup,
+                                         tcti_device_teardown),
         cmocka_unit_test_setup_teardown (tcti_device_transmit_success,
                                          tcti_device_setup,
                                          tcti_device_teardown),
@@ -8,6 +8,7 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <stdio.h>
@@ -136,6 +137,49 @@ conf_str_to_host_port_invalid_port_0_test (void **state)
     rc = parse_key_value_string (conf, mssim_kv_callback, &mssim_conf);
     assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
 }
+/* The 'reconnect' key is parsed as an unsigned number. */
+static void
+conf_str_reconnect_test (void **state)
+{
+    TSS2_RC rc;
+    char conf[] = "host=127.0.0.1,port=2321,reconnect=3";
+    mssim_conf_t mssim_conf = { 0 };
+
+    rc = parse_key_value_string (conf, mssim_kv_callback, &mssim_conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (mssim_conf.reconnect, 3);
+}
+/* The 'path' and 'ctrl_path' keys select UNIX sockets. */
+static void
+conf_str_path_test (void **state)
+{
+    TSS2_RC rc;
+    char conf[] = "path=/run/tpm.sock,ctrl_path=/run/ctrl.sock";
+    mssim_conf_t mssim_conf = { 0 };
+
+    rc = parse_key_value_string (conf, mssim_kv_callback, &mssim_conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_string_equal (mssim_conf.path, "/run/tpm.sock");
+    assert_string_equal (mssim_conf.ctrl_path, "/run/ctrl.sock");
+}
+/*
+ * Values of the 'reconnect' key that aren't numbers are rejected. The
+ * simulator serves one client at a time, so there is no 'pool' key.
+ */
+static void
+conf_str_reconnect_invalid_test (void **state)
+{
+    TSS2_RC rc;
+    char conf_pool[] = "pool=1";
+    char conf_reconnect[] = "reconnect=1x";
+    mssim_conf_t mssim_conf = { 0 };
+
+    rc = parse_key_value_string (conf_pool, mssim_kv_callback, &mssim_conf);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = parse_key_value_string (conf_reconnect, mssim_kv_callback,
+                                 &mssim_conf);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+}
 
 /* When passed all NULL values ensure that we get back the expected RC. */
 static void
@@ -161,6 +205,11 @@ tcti_socket_init_size_test (void **state)
     assert_int_equal (ret, TSS2_RC_SUCCESS);
     assert_int_equal (tcti_size, sizeof (TSS2_TCTI_MSSIM_CONTEXT));
 }
+/*
+ * Number of calls to the wrapped I/O functions, used to check how many
+ * system calls a command costs.
+ */
+static unsigned int read_calls, write_calls, poll_calls;
 /*
  * Wrap the 'connect' system call. The mock queue for this function must have
  * an integer to return as a response.
@@ -185,6 +234,7 @@ __wrap_read (int sockfd,
     ssize_t  ret = mock_type (ssize_t);
     uint8_t *buf_in = mock_ptr_type (uint8_t*);
 
+    read_calls++;
     memcpy (buf, buf_in, ret);
     return ret;
 }
@@ -198,6 +248,7 @@ __wrap_write (int sockfd,
               size_t len)
 
 {
+    write_calls++;
     return mock_type (TSS2_RC);
 }
 /*
@@ -208,6 +259,7 @@ __wrap_poll (struct pollfd *fds, nfds_t nfds, int timeout)
 {
     int ret = mock_type (int);
 
+    poll_calls++;
     fds->revents = fds->events;
     return ret;
 }
@@ -503,6 +555,304 @@ tcti_socket_transmit_success_test (void **state)
     rc = Tss2_Tcti_Transmit (ctx, command_size, command);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 }
+/*
+ * A command is sent with a single write of the simulator frame. When the
+ * simulator returns the whole response frame at once, receiving it costs a
+ * single poll and a single read.
+ */
+static void
+tcti_mssim_syscalls_per_command_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc;
+    uint8_t command [] = { 0x80, 0x01,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x01, 0x7b,
+                           0x00, 0x02 };
+    uint8_t response_in [] = { 0x00, 0x00, 0x00, 0x0c,
+                               0x80, 0x01,
+                               0x00, 0x00, 0x00, 0x0c,
+                               0x00, 0x00, 0x00, 0x00,
+                               0x01, 0x02,
+    /* simulator appends 4 bytes of 0's to every response */
+                               0x00, 0x00, 0x00, 0x00 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = sizeof (response_out);
+
+    read_calls = write_calls = poll_calls = 0;
+    /* setup (command code, locality, size) followed by the command */
+    will_return (__wrap_write, 9 + sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (write_calls, 1);
+
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, sizeof (response_in));
+    will_return (__wrap_read, response_in);
+    rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (response_size, sizeof (response_out));
+    assert_memory_equal (&response_in [4], response_out, response_size);
+
+    assert_int_equal (poll_calls, 1);
+    assert_int_equal (read_calls, 1);
+}
+/*
+ * Initialization over UNIX sockets connects and powers on the simulator the
+ * same way as over TCP.
+ */
+static void
+tcti_mssim_unix_socket_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim;
+
+    ctx = tcti_socket_init_from_conf ("path=/run/tpm.sock,"
+                                      "ctrl_path=/run/platform.sock");
+    tcti_mssim = (TSS2_TCTI_MSSIM_CONTEXT*)ctx;
+    assert_string_equal (tcti_mssim->mssim_conf.path, "/run/tpm.sock");
+    assert_string_equal (tcti_mssim->mssim_conf.ctrl_path,
+                         "/run/platform.sock");
+    assert_int_not_equal (tcti_mssim->tpm_sock, INVALID_SOCKET);
+    assert_int_not_equal (tcti_mssim->platform_sock, INVALID_SOCKET);
+
+    Tss2_Tcti_Finalize (ctx);
+    free (ctx);
+}
+/*
+ * Finalizing a context closes both connections, so the simulator can serve
+ * the next client. The next context connects and powers on the simulator
+ * again.
+ */
+static void
+tcti_mssim_finalize_closes_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim;
+
+    ctx = tcti_socket_init_from_conf ("host=127.0.0.1,port=666");
+    tcti_mssim = (TSS2_TCTI_MSSIM_CONTEXT*)ctx;
+    Tss2_Tcti_Finalize (ctx);
+    assert_int_equal (tcti_mssim->tpm_sock, INVALID_SOCKET);
+    assert_int_equal (tcti_mssim->platform_sock, INVALID_SOCKET);
+    free (ctx);
+
+    ctx = tcti_socket_init_from_conf ("host=127.0.0.1,port=666");
+    Tss2_Tcti_Finalize (ctx);
+    free (ctx);
+}
+/*
+ * A transmit that fails reconnects, powers on the simulator again and resends
+ * the command if 'reconnect' is configured.
+ */
+static void
+tcti_mssim_transmit_reconnect_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TSS2_RC rc;
+    uint8_t recv_buf[4] = { 0 };
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+
+    ctx = tcti_socket_init_from_conf ("host=127.0.0.1,port=666,reconnect=1");
+
+    /* the simulator command setup fails */
+    errno = EPIPE;
+    will_return (__wrap_write, -1);
+    /* reconnect both sockets and send the platform commands */
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_read, 4);
+    will_return (__wrap_read, recv_buf);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_read, 4);
+    will_return (__wrap_read, recv_buf);
+    /* resend the command */
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, 1);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    Tss2_Tcti_Finalize (ctx);
+    free (ctx);
+}
+
+/*
+ * The simulator closes the connection after the first command, before its
+ * response has been sent. The failed receive drops the connection, so the
+ * second command reconnects, powers on the simulator again and is sent on
+ * the new connection if 'reconnect' is configured.
+ */
+static void
+tcti_mssim_receive_reconnect_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim;
+    TSS2_RC rc;
+    uint8_t recv_buf[4] = { 0 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = sizeof (response_out);
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+
+    ctx = tcti_socket_init_from_conf ("host=127.0.0.1,port=666,reconnect=1");
+    tcti_mssim = (TSS2_TCTI_MSSIM_CONTEXT*)ctx;
+
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, 1);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    /* the simulator closes the connection instead of responding */
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, 0);
+    will_return (__wrap_read, recv_buf);
+    rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+    assert_int_equal (tcti_mssim->tpm_sock, INVALID_SOCKET);
+    assert_int_equal (tcti_mssim->platform_sock, INVALID_SOCKET);
+
+    /* reconnect both sockets and send the platform commands */
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_read, 4);
+    will_return (__wrap_read, recv_buf);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_read, 4);
+    will_return (__wrap_read, recv_buf);
+    /* send the second command */
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, 1);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_not_equal (tcti_mssim->tpm_sock, INVALID_SOCKET);
+
+    Tss2_Tcti_Finalize (ctx);
+    free (ctx);
+}
+/*
+ * Without 'reconnect' a transmit after the connection was dropped by a
+ * failed receive fails with TSS2_TCTI_RC_NO_CONNECTION.
+ */
+static void
+tcti_mssim_receive_no_reconnect_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TSS2_RC rc;
+    uint8_t recv_buf[4] = { 0 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = sizeof (response_out);
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+
+    ctx = tcti_socket_init_from_conf ("host=127.0.0.1,port=666");
+
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, 1);
+    will_return (__wrap_write, 4);
+    will_return (__wrap_write, sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    will_return (__wrap_poll, 1);
+    will_return (__wrap_read, 0);
+    will_return (__wrap_read, recv_buf);
+    rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_TCTI_RC_NO_CONNECTION);
+
+    Tss2_Tcti_Finalize (ctx);
+    free (ctx);
+}
+/*
+ * Transmit two commands back to back with a pipeline depth of 2 and receive
+ * both responses in order. A third command must be rejected until a response
+ * has been received.
+ */
+static void
+tcti_mssim_pipeline_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_common_context_cast (ctx);
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t command [] = { 0x80, 0x01,
+                           0x00, 0x00, 0x00, 0x0a,
+                           0x00, 0x00, 0x01, 0x7b };
+    uint8_t response_in [] = { 0x80, 0x01,
+                               0x00, 0x00, 0x00, 0x0a,
+                               0x00, 0x00, 0x00, 0x00,
+    /* simulator appends 4 bytes of 0's to every response */
+                               0x00, 0x00, 0x00, 0x00 };
+    uint8_t response_out [10] = { 0 };
+    size_t response_size;
+    int i;
+
+    rc = Tss2_Tcti_SetPipelineDepth (ctx, 0);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = Tss2_Tcti_SetPipelineDepth (ctx, TCTI_PIPELINE_DEPTH_MAX + 1);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = Tss2_Tcti_SetPipelineDepth (ctx, 2);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    for (i = 0; i < 2; i++) {
+        will_return (__wrap_write, 4);
+        will_return (__wrap_write, 1);
+        will_return (__wrap_write, 4);
+        will_return (__wrap_write, sizeof (command));
+        rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal (tcti_common->pending, 2);
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    rc = Tss2_Tcti_Cancel (ctx);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+    rc = Tss2_Tcti_SetPipelineDepth (ctx, 1);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+
+    for (i = 0; i < 2; i++) {
+        will_return (__wrap_poll, 1);
+        will_return (__wrap_read, 4);
+        will_return (__wrap_read, &response_in [2]);
+        will_return (__wrap_poll, 1);
+        will_return (__wrap_read, sizeof (response_out));
+        will_return (__wrap_read, response_in);
+        will_return (__wrap_poll, 1);
+        will_return (__wrap_read, 4);
+        will_return (__wrap_read, &response_in [10]);
+        response_size = sizeof (response_out);
+        rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                                TSS2_TCTI_TIMEOUT_BLOCK);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (response_size, sizeof (response_out));
+        assert_memory_equal (response_in, response_out, response_size);
+        assert_int_equal (tcti_common->pending, 1 - i);
+    }
+    assert_int_equal (tcti_common->state, TCTI_STATE_TRANSMIT);
+    response_size = sizeof (response_out);
+    rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+}
 
 int
 main (int   argc,
@@ -515,6 +865,9 @@ main (int   argc,
         cmocka_unit_test (conf_str_to_host_ipv6_port_no_port_test),
         cmocka_unit_test (conf_str_to_host_port_invalid_port_large_test),
         cmocka_unit_test (conf_str_to_host_port_invalid_port_0_test),
+        cmocka_unit_test (conf_str_reconnect_test),
+        cmocka_unit_test (conf_str_path_test),
+        cmocka_unit_test (conf_str_reconnect_invalid_test),
         cmocka_unit_test (tcti_socket_init_all_null_test),
         cmocka_unit_test (tcti_socket_init_size_test),
         cmocka_unit_test (tcti_socket_init_null_conf_test),
@@ -538,7 +891,18 @@ main (int   argc,
                                          tcti_socket_teardown),
         cmocka_unit_test_setup_teardown (tcti_socket_transmit_success_test,
                                   tcti_socket_setup,
-                                  tcti_socket_teardown)
+                                  tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mssim_syscalls_per_command_test,
+                                  tcti_socket_setup,
+                                  tcti_socket_teardown),
+        cmocka_unit_test (tcti_mssim_unix_socket_test),
+        cmocka_unit_test (tcti_mssim_finalize_closes_test),
+        cmocka_unit_test (tcti_mssim_transmit_reconnect_test),
+        cmocka_unit_test (tcti_mssim_receive_reconnect_test),
+        cmocka_unit_test (tcti_mssim_receive_no_reconnect_test),
+        cmocka_unit_test_setup_teardown (tcti_mssim_pipeline_test,
+                                         tcti_socket_setup,
+                                         tcti_socket_teardown)
     };
     return cmocka_run_group_tests (tests, NULL, NULL);
 }
@@ -0,0 +1,336 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************;
+ * Copyright 2026, agent
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_tcti.h"
+#include "tss2_tcti_stats.h"
+
+#include "tss2-tcti/tcti-common.h"
+#include "tss2-tcti/tcti-stats.h"
+
+#define TCTI_STUB_CONF      "stub"
+#define TCTI_STATS_FILE     "tcti-stats-test.prom"
+
+static const uint8_t getrandom_cmd[] = {
+    0x80, 0x01,                 /* TPM2_ST_NO_SESSIONS */
+    0x00, 0x00, 0x00, 0x0c,     /* size */
+    0x00, 0x00, 0x01, 0x7b,     /* TPM2_CC_GetRandom */
+    0x00, 0x08
+};
+
+static const uint8_t getrandom_rsp[] = {
+    0x80, 0x01,                 /* TPM2_ST_NO_SESSIONS */
+    0x00, 0x00, 0x00, 0x14,     /* size */
+    0x00, 0x00, 0x00, 0x00,     /* TPM2_RC_SUCCESS */
+    0x00, 0x08,
+    0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef
+};
+
+static const uint8_t retry_rsp[] = {
+    0x80, 0x01,                 /* TPM2_ST_NO_SESSIONS */
+    0x00, 0x00, 0x00, 0x0a,     /* size */
+    0x00, 0x00, 0x09, 0x22      /* TPM2_RC_RETRY */
+};
+
+static const uint8_t *stub_rsp;
+static size_t stub_rsp_size;
+
+/*
+ * Stub child TCTI answering every command with stub_rsp.
+ */
+static TSS2_RC
+tcti_stub_transmit (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t size,
+    const uint8_t *cmd_buf)
+{
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_stub_receive (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *response_size,
+    uint8_t *response_buffer,
+    int32_t timeout)
+{
+    if (response_buffer != NULL) {
+        memcpy (response_buffer, stub_rsp, stub_rsp_size);
+    }
+    *response_size = stub_rsp_size;
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+Tss2_TctiLdr_Initialize (const char *nameConf,
+                         TSS2_TCTI_CONTEXT **tctiContext)
+{
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common;
+
+    *tctiContext = NULL;
+
+    if (nameConf == NULL || strcmp (nameConf, TCTI_STUB_CONF) != 0) {
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+
+    tcti_common = calloc (1, sizeof (TSS2_TCTI_COMMON_CONTEXT));
+    assert_non_null (tcti_common);
+    TSS2_TCTI_MAGIC (tcti_common) = 0x1;
+    TSS2_TCTI_VERSION (tcti_common) = TCTI_VERSION;
+    TSS2_TCTI_TRANSMIT (tcti_common) = tcti_stub_transmit;
+    TSS2_TCTI_RECEIVE (tcti_common) = tcti_stub_receive;
+    tcti_common->state = TCTI_STATE_TRANSMIT;
+    *tctiContext = (TSS2_TCTI_CONTEXT *) tcti_common;
+    return TSS2_RC_SUCCESS;
+}
+
+void
+Tss2_TctiLdr_Finalize (TSS2_TCTI_CONTEXT **tctiContext)
+{
+    free (*tctiContext);
+    *tctiContext = NULL;
+}
+
+static char *
+read_file (const char *path)
+{
+    FILE *file = fopen (path, "r");
+    char *buf;
+    long size;
+
+    assert_non_null (file);
+    assert_int_equal (fseek (file, 0, SEEK_END), 0);
+    size = ftell (file);
+    assert_true (size > 0);
+    rewind (file);
+    buf = calloc (1, size + 1);
+    assert_non_null (buf);
+    assert_int_equal (fread (buf, 1, size, file), size);
+    fclose (file);
+    return buf;
+}
+
+/*
+ * Check that prom contains the line fmt, formatted with the process ID for
+ * the pid label.
+ */
+static void
+assert_line (const char *prom, const char *fmt)
+{
+    char line[256];
+
+    snprintf (line, sizeof (line), fmt, (long)getpid ());
+    assert_non_null (strstr (prom, line));
+}
+
+static void
+execute (TSS2_TCTI_CONTEXT *tcti, const uint8_t *rsp, size_t rsp_size)
+{
+    uint8_t buf[sizeof (getrandom_rsp)];
+    size_t size = 0;
+    TSS2_RC rc;
+
+    stub_rsp = rsp;
+    stub_rsp_size = rsp_size;
+
+    rc = Tss2_Tcti_Transmit (tcti, sizeof (getrandom_cmd), getrandom_cmd);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Tcti_Receive (tcti, &size, NULL, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, rsp_size);
+    rc = Tss2_Tcti_Receive (tcti, &size, buf, TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (buf, rsp, rsp_size);
+}
+
+static void
+tcti_stats_init_size_test (void **state)
+{
+    size_t tcti_size = 0;
+    TSS2_RC rc;
+
+    rc = Tss2_Tcti_Stats_Init (NULL, NULL, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+
+    rc = Tss2_Tcti_Stats_Init (NULL, &tcti_size, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (tcti_size, sizeof (TSS2_TCTI_STATS_CONTEXT));
+}
+
+static void
+tcti_stats_init_fail_test (void **state)
+{
+    TSS2_TCTI_STATS_CONTEXT tcti_stats;
+    TSS2_TCTI_CONTEXT *tcti = (TSS2_TCTI_CONTEXT*) &tcti_stats;
+    TSS2_RC rc;
+
+    /* Child TCTI can not be loaded */
+    rc = Tss2_Tcti_Stats_Init (tcti, NULL, "foo");
+    assert_int_equal (rc, TSS2_TCTI_RC_IO_ERROR);
+    assert_null (tcti_stats.file);
+
+    /* Malformed export interval */
+    setenv (ENV_STATS_INTERVAL, "1s", 1);
+    rc = Tss2_Tcti_Stats_Init (tcti, NULL, TCTI_STUB_CONF);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    unsetenv (ENV_STATS_INTERVAL);
+}
+
+static void
+tcti_stats_export_test (void **state)
+{
+    TSS2_TCTI_STATS_CONTEXT tcti_stats;
+    TSS2_TCTI_CONTEXT *tcti = (TSS2_TCTI_CONTEXT*) &tcti_stats;
+    struct stat st;
+    char *prom;
+    TSS2_RC rc;
+
+    remove (TCTI_STATS_FILE);
+    setenv (ENV_STATS_FILE, TCTI_STATS_FILE, 1);
+    setenv (ENV_STATS_INTERVAL, "0", 1);
+
+    rc = Tss2_Tcti_Stats_Init (tcti, NULL, TCTI_STUB_CONF);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_string_equal (tcti_stats.file, TCTI_STATS_FILE);
+    assert_false (tcti_stats.file_default);
+
+    execute (tcti, retry_rsp, sizeof (retry_rsp));
+    execute (tcti, getrandom_rsp, sizeof (getrandom_rsp));
+    execute (tcti, getrandom_rsp, sizeof (getrandom_rsp));
+
+    assert_int_equal (tcti_stats.command_count, 1);
+    assert_int_equal (tcti_stats.commands[0].cc, 0x17b);
+    assert_int_equal (tcti_stats.commands[0].count, 3);
+    assert_int_equal (tcti_stats.commands[0].errors, 1);
+    assert_int_equal (tcti_stats.commands[0].bytes_sent,
+                      3 * sizeof (getrandom_cmd));
+    assert_int_equal (tcti_stats.commands[0].bytes_received,
+                      sizeof (retry_rsp) + 2 * sizeof (getrandom_rsp));
+    assert_int_equal (tcti_stats.rc_count, 1);
+    assert_int_equal (tcti_stats.rcs[0].rc, 0x922);
+    assert_int_equal (tcti_stats.sent, 0);
+
+    /* Nothing is exported before finalize with an interval of 0 */
+    assert_int_not_equal (access (TCTI_STATS_FILE, F_OK), 0);
+
+    Tss2_Tcti_Finalize (tcti);
+    assert_null (tcti_stats.tcti_child);
+
+    prom = read_file (TCTI_STATS_FILE);
+    assert_non_null (strstr (prom,
+        "# TYPE tss2_tcti_command_duration_seconds histogram\n"));
+    assert_line (prom,
+        "tss2_tcti_commands_total{pid=\"%ld\",cc=\"0x0000017b\"} 3\n");
+    assert_line (prom,
+        "tss2_tcti_command_errors_total{pid=\"%ld\",cc=\"0x0000017b\"} 1\n");
+    assert_line (prom,
+        "tss2_tcti_sent_bytes_total{pid=\"%ld\",cc=\"0x0000017b\"} 36\n");
+    assert_line (prom,
+        "tss2_tcti_received_bytes_total{pid=\"%ld\",cc=\"0x0000017b\"} 50\n");
+    assert_line (prom,
+        "tss2_tcti_command_duration_seconds_bucket{pid=\"%ld\","
+        "cc=\"0x0000017b\",le=\"+Inf\"} 3\n");
+    assert_line (prom,
+        "tss2_tcti_command_duration_seconds_bucket{pid=\"%ld\","
+        "cc=\"0x0000017b\",le=\"10\"} 3\n");
+    assert_line (prom,
+        "tss2_tcti_command_duration_seconds_count{pid=\"%ld\","
+        "cc=\"0x0000017b\"} 3\n");
+    assert_line (prom,
+        "tss2_tcti_responses_total{pid=\"%ld\",rc=\"0x00000922\"} 1\n");
+    assert_line (prom, "tss2_tcti_in_flight{pid=\"%ld\"} 0\n");
+    assert_int_equal (stat (TCTI_STATS_FILE, &st), 0);
+    assert_int_equal (st.st_mode & 0777, 0644);
+    free (prom);
+
+    remove (TCTI_STATS_FILE);
+    unsetenv (ENV_STATS_FILE);
+    unsetenv (ENV_STATS_INTERVAL);
+}
+
+/*
+ * The per process default file is removed on finalize instead of being
+ * left behind with the final statistics.
+ */
+static void
+tcti_stats_default_file_test (void **state)
+{
+    TSS2_TCTI_STATS_CONTEXT tcti_stats;
+    TSS2_TCTI_CONTEXT *tcti = (TSS2_TCTI_CONTEXT*) &tcti_stats;
+    char file[sizeof (DEFAULT_STATS_FILE_FMT) + 24];
+    TSS2_RC rc;
+
+    unsetenv (ENV_STATS_FILE);
+    setenv (ENV_STATS_INTERVAL, "0", 1);
+    snprintf (file, sizeof (file), DEFAULT_STATS_FILE_FMT, (long)getpid ());
+
+    rc = Tss2_Tcti_Stats_Init (tcti, NULL, TCTI_STUB_CONF);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_string_equal (tcti_stats.file, file);
+    assert_true (tcti_stats.file_default);
+    assert_int_equal (tcti_stats.pid, (long)getpid ());
+
+    execute (tcti, getrandom_rsp, sizeof (getrandom_rsp));
+
+    /* Stand in for an export of the periodic interval */
+    if (access ("/dev/shm", W_OK) == 0) {
+        FILE *f = fopen (file, "w");
+        assert_non_null (f);
+        fclose (f);
+    }
+
+    Tss2_Tcti_Finalize (tcti);
+    assert_int_not_equal (access (file, F_OK), 0);
+    unsetenv (ENV_STATS_INTERVAL);
+}
+
+static void
+tcti_stats_export_disabled_test (void **state)
+{
+    TSS2_TCTI_STATS_CONTEXT tcti_stats;
+    TSS2_TCTI_CONTEXT *tcti = (TSS2_TCTI_CONTEXT*) &tcti_stats;
+    TSS2_RC rc;
+
+    setenv (ENV_STATS_FILE, "", 1);
+
+    rc = Tss2_Tcti_Stats_Init (tcti, NULL, TCTI_STUB_CONF);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_null (tcti_stats.file);
+
+    execute (tcti, getrandom_rsp, sizeof (getrandom_rsp));
+    assert_int_equal (tcti_stats.commands[0].count, 1);
+
+    Tss2_Tcti_Finalize (tcti);
+    unsetenv (ENV_STATS_FILE);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test (tcti_stats_init_size_test),
+        cmocka_unit_test (tcti_stats_init_fail_test),
+        cmocka_unit_test (tcti_stats_export_test),
+        cmocka_unit_test (tcti_stats_default_file_test),
+        cmocka_unit_test (tcti_stats_export_disabled_test),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,322 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+#include "tss2_tcti_swtpm.h"
+
+#include "util/io.h"
+
+#include "benchmark.h"
+
+/*
+ * Run a loop of TPM2_GetRandom commands through the SAPI and the swtpm TCTI
+ * against a minimal swtpm stand-in, once over TCP loopback and once over UNIX
+ * sockets, and report the time spent per command. The stand-in answers
+ * instantly, so the numbers are the transport overhead only. It is not part of
+ * the test suite and is run by 'make benchmark'.
+ */
+
+#define ITERATIONS 1000
+#define RANDOM_BYTES 16
+#define MAX_CLIENTS 16
+
+typedef struct {
+    pid_t server;
+    uint16_t port;
+    char dir[sizeof ("/tmp/tss2-bench-XXXXXX")];
+    char path[sizeof ("/tmp/tss2-bench-XXXXXX/tpm")];
+    char ctrl_path[sizeof ("/tmp/tss2-bench-XXXXXX/ctrl")];
+} bench_state_t;
+
+static int
+listen_tcp(uint16_t port, uint16_t *bound)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t len = sizeof(addr);
+    int sock;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+        return -1;
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(sock, MAX_CLIENTS) != 0 ||
+        getsockname(sock, (struct sockaddr *)&addr, &len) != 0) {
+        close(sock);
+        return -1;
+    }
+    if (bound != NULL)
+        *bound = ntohs(addr.sin_port);
+    return sock;
+}
+
+static int
+listen_unix(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int sock;
+
+    strcpy(addr.sun_path, path);
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+        return -1;
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(sock, MAX_CLIENTS) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/*
+ * Answer a control command with a zero result code, or a TPM2_GetRandom
+ * command with the requested number of bytes. Returns -1 when the client
+ * closed the connection.
+ */
+static int
+serve_request(int sock, int is_ctrl)
+{
+    uint8_t buf[4096];
+    uint8_t rsp[10 + sizeof(TPM2B_DIGEST)] = { 0 };
+    size_t offset = 0;
+    UINT32 size;
+    UINT16 requested;
+
+    if (is_ctrl) {
+        if (read(sock, buf, sizeof(buf)) <= 0)
+            return -1;
+        return write_all(sock, rsp, sizeof(UINT32)) == sizeof(UINT32) ? 0 : -1;
+    }
+
+    if (read_all(sock, buf, 10) != 10)
+        return -1;
+    offset = sizeof(TPM2_ST);
+    if (Tss2_MU_UINT32_Unmarshal(buf, 10, &offset, &size) != TSS2_RC_SUCCESS ||
+        offset != 6 || size < 12 || size > sizeof(buf) ||
+        read_all(sock, &buf[10], size - 10) != (ssize_t)(size - 10))
+        return -1;
+    offset = 10;
+    Tss2_MU_UINT16_Unmarshal(buf, size, &offset, &requested);
+    if (requested > sizeof(rsp) - 12)
+        requested = sizeof(rsp) - 12;
+
+    offset = 0;
+    Tss2_MU_UINT16_Marshal(TPM2_ST_NO_SESSIONS, rsp, sizeof(rsp), &offset);
+    Tss2_MU_UINT32_Marshal(12 + requested, rsp, sizeof(rsp), &offset);
+    Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, rsp, sizeof(rsp), &offset);
+    Tss2_MU_UINT16_Marshal(requested, rsp, sizeof(rsp), &offset);
+    memset(&rsp[offset], 0x5a, requested);
+    offset += requested;
+    return write_all(sock, rsp, offset) == (ssize_t)offset ? 0 : -1;
+}
+
+/*
+ * Stand-in for swtpm: listens on the TPM and control channel over TCP and
+ * UNIX sockets and serves all clients from a single poll loop.
+ */
+static void
+fake_swtpm(int listeners[4], pid_t parent)
+{
+    struct pollfd fds[4 + MAX_CLIENTS];
+    int is_ctrl[4 + MAX_CLIENTS];
+    nfds_t nfds = 4, i;
+
+    signal(SIGPIPE, SIG_IGN);
+    for (i = 0; i < 4; i++) {
+        fds[i].fd = listeners[i];
+        fds[i].events = POLLIN;
+        /* odd listeners are the control channels */
+        is_ctrl[i] = i % 2;
+    }
+
+    for (;;) {
+        /* exit if the benchmark died without tearing the server down */
+        if (getppid() != parent)
+            return;
+        if (poll(fds, nfds, 1000) <= 0)
+            continue;
+        for (i = 0; i < nfds; i++) {
+            if (fds[i].revents == 0)
+                continue;
+            if (i < 4) {
+                int sock = accept(fds[i].fd, NULL, NULL);
+                if (sock < 0)
+                    continue;
+                if (nfds == 4 + MAX_CLIENTS) {
+                    close(sock);
+                    continue;
+                }
+                fds[nfds].fd = sock;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                is_ctrl[nfds] = is_ctrl[i];
+                nfds++;
+            } else if (serve_request(fds[i].fd, is_ctrl[i]) != 0) {
+                close(fds[i].fd);
+                nfds--;
+                fds[i] = fds[nfds];
+                is_ctrl[i] = is_ctrl[nfds];
+                i--;
+            }
+        }
+    }
+}
+
+static int
+bench_setup(void **state)
+{
+    bench_state_t *bench = calloc(1, sizeof(*bench));
+    int listeners[4] = { -1, -1, -1, -1 };
+    pid_t parent = getpid();
+    int i;
+
+    assert_non_null(bench);
+    strcpy(bench->dir, "/tmp/tss2-bench-XXXXXX");
+    assert_non_null(mkdtemp(bench->dir));
+    snprintf(bench->path, sizeof(bench->path), "%s/tpm", bench->dir);
+    snprintf(bench->ctrl_path, sizeof(bench->ctrl_path), "%s/ctrl",
+             bench->dir);
+
+    /* the control channel is expected on the port following the TPM port */
+    for (i = 0; i < 16 && listeners[1] < 0; i++) {
+        if (listeners[0] >= 0)
+            close(listeners[0]);
+        listeners[0] = listen_tcp(0, &bench->port);
+        assert_true(listeners[0] >= 0);
+        if (bench->port < UINT16_MAX)
+            listeners[1] = listen_tcp(bench->port + 1, NULL);
+    }
+    assert_true(listeners[1] >= 0);
+    listeners[2] = listen_unix(bench->path);
+    assert_true(listeners[2] >= 0);
+    listeners[3] = listen_unix(bench->ctrl_path);
+    assert_true(listeners[3] >= 0);
+
+    bench->server = fork();
+    assert_true(bench->server >= 0);
+    if (bench->server == 0) {
+        fake_swtpm(listeners, parent);
+        _exit(0);
+    }
+    for (i = 0; i < 4; i++)
+        close(listeners[i]);
+
+    *state = bench;
+    return 0;
+}
+
+static int
+bench_teardown(void **state)
+{
+    bench_state_t *bench = *state;
+
+    kill(bench->server, SIGTERM);
+    waitpid(bench->server, NULL, 0);
+    unlink(bench->path);
+    unlink(bench->ctrl_path);
+    rmdir(bench->dir);
+    free(bench);
+    return 0;
+}
+
+static void
+getrandom_loop(const char *conf)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    TSS2_SYS_CONTEXT *sys;
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+    TPM2B_DIGEST random_bytes;
+    struct timespec start, end;
+    size_t size = 0;
+    TSS2_RC rc;
+    int i;
+
+    rc = Tss2_Tcti_Swtpm_Init(NULL, &size, conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    tcti = calloc(1, size);
+    assert_non_null(tcti);
+    rc = Tss2_Tcti_Swtpm_Init(tcti, &size, conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    size = Tss2_Sys_GetContextSize(0);
+    sys = calloc(1, size);
+    assert_non_null(sys);
+    rc = Tss2_Sys_Initialize(sys, size, tcti, &abi_version);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ITERATIONS; i++) {
+        random_bytes.size = 0;
+        rc = Tss2_Sys_GetRandom(sys, NULL, RANDOM_BYTES, &random_bytes, NULL);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert_int_equal (random_bytes.size, RANDOM_BYTES);
+
+    printf("GetRandom over %s: %.1f us\n", conf,
+           elapsed_ns(&start, &end) / ITERATIONS / 1000);
+
+    Tss2_Sys_Finalize(sys);
+    free(sys);
+    Tss2_Tcti_Finalize(tcti);
+    free(tcti);
+}
+
+static void
+tcp_getrandom_benchmark(void **state)
+{
+    bench_state_t *bench = *state;
+    char conf[64];
+
+    snprintf(conf, sizeof(conf), "host=127.0.0.1,port=%" PRIu16,
+             bench->port);
+    getrandom_loop(conf);
+}
+
+static void
+unix_getrandom_benchmark(void **state)
+{
+    bench_state_t *bench = *state;
+    char conf[128];
+
+    snprintf(conf, sizeof(conf), "path=%s,ctrl_path=%s", bench->path,
+             bench->ctrl_path);
+    getrandom_loop(conf);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(tcp_getrandom_benchmark),
+        cmocka_unit_test(unix_getrandom_benchmark),
+    };
+    return cmocka_run_group_tests(tests, bench_setup, bench_teardown);
+}
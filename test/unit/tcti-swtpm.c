@@ -8,6 +8,7 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <stdio.h>
@@ -136,6 +137,49 @@ conf_str_to_host_port_invalid_port_0_test (void **state)
     rc = parse_key_value_string (conf, swtpm_kv_callback, &swtpm_conf);
     assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
 }
+/* The 'reconnect' key is parsed as an unsigned number. */
+static void
+conf_str_reconnect_test (void **state)
+{
+    TSS2_RC rc;
+    char conf[] = "host=127.0.0.1,port=2321,reconnect=3";
+    swtpm_conf_t swtpm_conf = { 0 };
+
+    rc = parse_key_value_string (conf, swtpm_kv_callback, &swtpm_conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (swtpm_conf.reconnect, 3);
+}
+/* The 'path' and 'ctrl_path' keys select UNIX sockets. */
+static void
+conf_str_path_test (void **state)
+{
+    TSS2_RC rc;
+    char conf[] = "path=/run/tpm.sock,ctrl_path=/run/ctrl.sock";
+    swtpm_conf_t swtpm_conf = { 0 };
+
+    rc = parse_key_value_string (conf, swtpm_kv_callback, &swtpm_conf);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_string_equal (swtpm_conf.path, "/run/tpm.sock");
+    assert_string_equal (swtpm_conf.ctrl_path, "/run/ctrl.sock");
+}
+/*
+ * Values of the 'reconnect' key that aren't numbers are rejected. The swtpm
+ * serves one client at a time, so there is no 'pool' key.
+ */
+static void
+conf_str_reconnect_invalid_test (void **state)
+{
+    TSS2_RC rc;
+    char conf_pool[] = "pool=1";
+    char conf_reconnect[] = "reconnect=-1";
+    swtpm_conf_t swtpm_conf = { 0 };
+
+    rc = parse_key_value_string (conf_pool, swtpm_kv_callback, &swtpm_conf);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    rc = parse_key_value_string (conf_reconnect, swtpm_kv_callback,
+                                 &swtpm_conf);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+}
 
 /* When passed all NULL values ensure that we get back the expected RC. */
 static void
@@ -313,21 +357,57 @@ tcti_swtpm_init_fail_connect_test (void **state)
     free(ctx);
 }
 /*
- * This test ensures that the GetPollHandles function in the device TCTI
- * returns the expected value. Since this TCTI does not support async I/O
- * on account of limitations in the kernel it just returns the
- * NOT_IMPLEMENTED response code.
+ * This test ensures that the GetPollHandles function returns the TPM
+ * connection while a command is in flight. The connection is closed between
+ * commands, so there is nothing to poll before the first transmit.
  */
 static void
 tcti_swtpm_get_poll_handles_test (void **state)
 {
     TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_TCTI_SWTPM_CONTEXT *tcti_swtpm = (TSS2_TCTI_SWTPM_CONTEXT*)ctx;
     size_t num_handles = 5;
     TSS2_TCTI_POLL_HANDLE handles [5] = { 0 };
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+    uint8_t response_in [] = { 0x80, 0x02,
+                               0x00, 0x00, 0x00, 0x0c,
+                               0x00, 0x00, 0x00, 0x00,
+                               0x01, 0x02 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = sizeof (response_out);
     TSS2_RC rc;
 
+    rc = Tss2_Tcti_GetPollHandles (ctx, NULL, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
     rc = Tss2_Tcti_GetPollHandles (ctx, handles, &num_handles);
-    assert_int_equal (rc, TSS2_TCTI_RC_NOT_IMPLEMENTED);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_write, sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    num_handles = 0;
+    rc = Tss2_Tcti_GetPollHandles (ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_VALUE);
+    num_handles = 5;
+    rc = Tss2_Tcti_GetPollHandles (ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
+    assert_int_equal (handles [0].fd, tcti_swtpm->tpm_sock);
+    assert_int_equal (handles [0].events, POLLIN);
+
+    will_return (__wrap_read, sizeof (response_in));
+    will_return (__wrap_read, response_in);
+    rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Tcti_GetPollHandles (ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
 }
 /*
  * This test exercises the null check of tcti_swtpm_receive ()
@@ -524,6 +604,63 @@ tcti_swtpm_transmit_success_test (void **state)
     rc = Tss2_Tcti_Transmit (ctx, command_size, command);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 }
+/*
+ * Initialization and transmit over UNIX sockets connect the same way as
+ * over TCP.
+ */
+static void
+tcti_swtpm_unix_socket_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TSS2_TCTI_SWTPM_CONTEXT *tcti_swtpm;
+    TSS2_RC rc;
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+
+    ctx = tcti_swtpm_init_from_conf ("path=/run/tpm.sock,"
+                                     "ctrl_path=/run/ctrl.sock");
+    tcti_swtpm = (TSS2_TCTI_SWTPM_CONTEXT*)ctx;
+    assert_string_equal (tcti_swtpm->swtpm_conf.path, "/run/tpm.sock");
+    assert_string_equal (tcti_swtpm->swtpm_conf.ctrl_path, "/run/ctrl.sock");
+
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_write, sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    Tss2_Tcti_Finalize (ctx);
+    free (ctx);
+}
+/*
+ * A transmit that fails on a fresh connection reconnects and sends the
+ * command again if 'reconnect' is configured.
+ */
+static void
+tcti_swtpm_transmit_reconnect_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx;
+    TSS2_RC rc;
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+
+    ctx = tcti_swtpm_init_from_conf ("host=127.0.0.1,port=666,reconnect=1");
+
+    /* connect, fail to write, reconnect and write the command */
+    errno = EPIPE;
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_write, -1);
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_write, sizeof (command));
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    Tss2_Tcti_Finalize (ctx);
+    free (ctx);
+}
 /*
  * This test exercises the NULL checks of the transmit function.
  */
@@ -706,6 +843,62 @@ tcti_swtpm_locality_test (void **state)
     assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
 }
 
+/*
+ * This test sends two pipelined commands over a single connection and checks
+ * that the connection is kept open until the last response is received.
+ */
+static void
+tcti_swtpm_pipeline_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_TCTI_SWTPM_CONTEXT *tcti_swtpm = (TSS2_TCTI_SWTPM_CONTEXT*)ctx;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_common_context_cast (ctx);
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+    uint8_t response_in [] = { 0x80, 0x02,
+                               0x00, 0x00, 0x00, 0x0c,
+                               0x00, 0x00, 0x00, 0x00,
+                               0x01, 0x02 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size;
+    int i;
+
+    rc = Tss2_Tcti_SetPipelineDepth (ctx, 2);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    /* only the first command connects to tpm_sock */
+    will_return (__wrap_connect, 0);
+    will_return (__wrap_write, 0xc);
+    will_return (__wrap_write, 0xc);
+    for (i = 0; i < 2; i++) {
+        rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_SEQUENCE);
+
+    for (i = 0; i < 2; i++) {
+        will_return (__wrap_read, 10);
+        will_return (__wrap_read, response_in);
+        will_return (__wrap_read, sizeof (response_in) - 10);
+        will_return (__wrap_read, &response_in [10]);
+        response_size = sizeof (response_out);
+        rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                                TSS2_TCTI_TIMEOUT_BLOCK);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (response_in, response_out, response_size);
+        if (i == 0) {
+            assert_int_equal (tcti_common->state, TCTI_STATE_RECEIVE);
+            assert_int_not_equal (tcti_swtpm->tpm_sock, INVALID_SOCKET);
+        }
+    }
+    assert_int_equal (tcti_common->state, TCTI_STATE_TRANSMIT);
+    assert_int_equal (tcti_swtpm->tpm_sock, INVALID_SOCKET);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -718,6 +911,9 @@ main (int   argc,
         cmocka_unit_test (conf_str_to_host_port_invalid_port_large_test),
         cmocka_unit_test (conf_str_to_host_port_invalid_port_0_test),
         cmocka_unit_test (tcti_swtpm_init_all_null_test),
+        cmocka_unit_test (conf_str_reconnect_test),
+        cmocka_unit_test (conf_str_path_test),
+        cmocka_unit_test (conf_str_reconnect_invalid_test),
         cmocka_unit_test (tcti_swtpm_init_size_test),
         cmocka_unit_test (tcti_swtpm_init_null_conf_test),
         cmocka_unit_test (tcti_swtpm_get_info_test),
@@ -751,6 +947,8 @@ main (int   argc,
         cmocka_unit_test_setup_teardown (tcti_swtpm_transmit_success_test,
                                          tcti_swtpm_setup,
                                          tcti_swtpm_teardown),
+        cmocka_unit_test (tcti_swtpm_unix_socket_test),
+        cmocka_unit_test (tcti_swtpm_transmit_reconnect_test),
         cmocka_unit_test_setup_teardown (tcti_swtpm_transmit_null_test,
                                          tcti_swtpm_setup,
                                          tcti_swtpm_teardown),
@@ -772,6 +970,9 @@ main (int   argc,
         cmocka_unit_test_setup_teardown (tcti_swtpm_locality_test,
                                          tcti_swtpm_setup,
                                          tcti_swtpm_teardown),
+        cmocka_unit_test_setup_teardown (tcti_swtpm_pipeline_test,
+                                         tcti_swtpm_setup,
+                                         tcti_swtpm_teardown),
     };
     return cmocka_run_group_tests (tests, NULL, NULL);
 }